@@ -7,6 +7,7 @@
  * the COPYING file in the parent directory for full text.
  */
 
+#include <errno.h>
 #include <time.h>
 #include <netinet/in.h>
 
@@ -15,20 +16,569 @@
 #include <sstream>
 #include <iostream>
 
+#include <TApplicationException.h>
+#include <protocol/TBinaryProtocol.h>
+#include <transport/TTransportException.h>
+#include <transport/TTransportUtils.h>
+
 #include "libgenthrift/Cassandra.h"
 
 #include "libcassandra/cassandra.h"
+#include "libcassandra/column_cache.h"
+#include "libcassandra/column_view.h"
 #include "libcassandra/exception.h"
 #include "libcassandra/indexed_slices_query.h"
 #include "libcassandra/keyspace.h"
 #include "libcassandra/keyspace_definition.h"
+#include "libcassandra/request_coalescer.h"
+#include "libcassandra/request_validator.h"
+#include "libcassandra/row_visitor.h"
+#include "libcassandra/schema_cache.h"
+#include "libcassandra/token.h"
 #include "libcassandra/util_functions.h"
+#include "libcassandra/value_codec.h"
+#include "libcassandra/util/parallel.h"
+#include "libcassandra/util/pool.h"
 
 using namespace std;
+using namespace apache::thrift;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
 using namespace org::apache::cassandra;
 using namespace libcassandra;
 
 
+namespace
+{
+
+/*
+ * copy the columns out of a multiget result into the map returned to
+ * the caller
+ */
+void mergeMultigetSlice(map<string, vector<ColumnOrSuperColumn> >& result,
+                        map<string, vector<Column> >& ret)
+{
+  for (map<string, vector<ColumnOrSuperColumn> >::iterator it= result.begin();
+       it != result.end();
+       ++it)
+  {
+    moveColumns(it->second, ret[it->first]);
+  }
+}
+
+
+/*
+ * restore the values of a result with a value codec, if there is one
+ */
+void decodeColumns(const ValueCodec *codec, vector<Column>& columns)
+{
+  if (codec)
+  {
+    codec->decode(columns);
+  }
+}
+
+
+/*
+ * hosts a chunk moves to when its replica fails: the range's other
+ * replicas, then any pooled connection
+ */
+vector<string> fallbackHosts(const vector<string>& hosts)
+{
+  vector<string> ret;
+  if (! hosts.empty())
+  {
+    ret.assign(hosts.begin() + 1, hosts.end());
+  }
+  ret.push_back(string());
+  return ret;
+}
+
+
+/*
+ * decodeColumns for every row of a multiget result
+ */
+void decodeMultigetSlice(const ValueCodec *codec, map<string, vector<Column> >& ret)
+{
+  if (! codec)
+  {
+    return;
+  }
+  for (map<string, vector<Column> >::iterator it= ret.begin();
+       it != ret.end();
+       ++it)
+  {
+    decodeColumns(codec, it->second);
+  }
+}
+
+
+class MultigetSliceTask : public util::Task
+{
+
+public:
+
+  MultigetSliceTask(vector<string>::const_iterator first,
+                    vector<string>::const_iterator last,
+                    const ColumnParent& in_col_parent,
+                    const SlicePredicate& in_pred,
+                    ConsistencyLevel::type in_level,
+                    const vector<string>& in_hosts)
+    :
+      keys(first, last),
+      col_parent(in_col_parent),
+      pred(in_pred),
+      level(in_level),
+      hosts(in_hosts),
+      result()
+  {}
+
+  string getHost() const
+  {
+    return hosts.empty() ? string() : hosts.front();
+  }
+
+  vector<string> getFallbackHosts() const
+  {
+    return fallbackHosts(hosts);
+  }
+
+  void run(Cassandra &client)
+  {
+    client.getCassandra()->multiget_slice(result, keys, col_parent, pred, level);
+  }
+
+  map<string, vector<ColumnOrSuperColumn> > &getResult()
+  {
+    return result;
+  }
+
+private:
+
+  vector<string> keys;
+  const ColumnParent &col_parent;
+  const SlicePredicate &pred;
+  ConsistencyLevel::type level;
+  vector<string> hosts;
+  map<string, vector<ColumnOrSuperColumn> > result;
+
+};
+
+
+class MultigetCountTask : public util::Task
+{
+
+public:
+
+  MultigetCountTask(vector<string>::const_iterator first,
+                    vector<string>::const_iterator last,
+                    const ColumnParent& in_col_parent,
+                    const SlicePredicate& in_pred,
+                    ConsistencyLevel::type in_level,
+                    const vector<string>& in_hosts)
+    :
+      keys(first, last),
+      col_parent(in_col_parent),
+      pred(in_pred),
+      level(in_level),
+      hosts(in_hosts),
+      result()
+  {}
+
+  string getHost() const
+  {
+    return hosts.empty() ? string() : hosts.front();
+  }
+
+  vector<string> getFallbackHosts() const
+  {
+    return fallbackHosts(hosts);
+  }
+
+  void run(Cassandra &client)
+  {
+    client.getCassandra()->multiget_count(result, keys, col_parent, pred, level);
+  }
+
+  map<string, int32_t> &getResult()
+  {
+    return result;
+  }
+
+private:
+
+  vector<string> keys;
+  const ColumnParent &col_parent;
+  const SlicePredicate &pred;
+  ConsistencyLevel::type level;
+  vector<string> hosts;
+  map<string, int32_t> result;
+
+};
+
+
+/*
+ * splits keys into groups owned by the same token range, keeping their
+ * order, and lists the replicas of each group's range. All keys go in one
+ * group without replicas when the partitioner's tokens cannot be ordered
+ * here.
+ */
+void groupKeysByRange(Cassandra& client,
+                      util::CassandraPool& pool,
+                      const string& keyspace,
+                      const vector<string>& keys,
+                      vector<vector<string> >& groups,
+                      vector<vector<string> >& endpoints)
+{
+  if (! keyspace.empty())
+  {
+    vector<TokenRange> ring;
+    string partitioner;
+    pool.getRing(client, keyspace, ring, partitioner);
+    try
+    {
+      vector<size_t> group_of_range(ring.size() + 1, ring.size() + 1);
+      for (vector<string>::const_iterator it= keys.begin();
+           it != keys.end();
+           ++it)
+      {
+        size_t range= findOwningRange(partitioner, ring, computeToken(partitioner, *it));
+        if (group_of_range[range] > ring.size())
+        {
+          group_of_range[range]= groups.size();
+          groups.push_back(vector<string>());
+          endpoints.push_back(range < ring.size() ? ring[range].endpoints : vector<string>());
+        }
+        groups[group_of_range[range]].push_back(*it);
+      }
+      return;
+    }
+    catch (Exception &)
+    {
+      /* an unsupported partitioner; chunk the keys as they come */
+      groups.clear();
+      endpoints.clear();
+    }
+  }
+  groups.push_back(keys);
+  endpoints.push_back(vector<string>());
+}
+
+
+/*
+ * split keys into chunks of keys owned by the same token range, one task
+ * per chunk, and run the tasks over pooled connections to the replicas
+ * of each chunk's range. The ring is taken from the pool's cache.
+ */
+template <class TaskType>
+void runChunkedTasks(Cassandra& client,
+                     util::CassandraPool& pool,
+                     vector<TaskType>& tasks,
+                     const vector<string>& keys,
+                     const ColumnParent& col_parent,
+                     const SlicePredicate& pred,
+                     ConsistencyLevel::type level,
+                     uint32_t chunk_size,
+                     uint32_t max_threads,
+                     const string& keyspace)
+{
+  vector<vector<string> > groups;
+  vector<vector<string> > endpoints;
+  groupKeysByRange(client, pool, keyspace, keys, groups, endpoints);
+  size_t chunks= 0;
+  for (size_t i= 0; i < groups.size(); ++i)
+  {
+    chunks+= (groups[i].size() + chunk_size - 1) / chunk_size;
+  }
+  tasks.reserve(chunks);
+  for (size_t i= 0; i < groups.size(); ++i)
+  {
+    const vector<string> &group= groups[i];
+    for (size_t start= 0; start < group.size(); start+= chunk_size)
+    {
+      /*
+       * spread the chunks of a range over all of its replicas; the
+       * others are where a chunk goes when its replica fails
+       */
+      vector<string> hosts;
+      size_t first= endpoints[i].empty() ? 0 : (start / chunk_size) % endpoints[i].size();
+      for (size_t j= 0; j < endpoints[i].size(); ++j)
+      {
+        hosts.push_back(endpoints[i][(first + j) % endpoints[i].size()]);
+      }
+      size_t end= min(group.size(), start + chunk_size);
+      tasks.push_back(TaskType(group.begin() + start,
+                               group.begin() + end,
+                               col_parent,
+                               pred,
+                               level,
+                               hosts));
+    }
+  }
+  vector<util::Task *> work;
+  work.reserve(tasks.size());
+  for (typename vector<TaskType>::iterator it= tasks.begin();
+       it != tasks.end();
+       ++it)
+  {
+    work.push_back(&(*it));
+  }
+  util::runTasks(pool, work, max_threads, keyspace);
+}
+
+
+/*
+ * reads one column for getColumn
+ */
+class GetColumnFetch : public RequestCoalescer::Fetch
+{
+
+public:
+
+  GetColumnFetch(CassandraClient *in_client,
+                 const string &in_key,
+                 const ColumnPath &in_col_path,
+                 ConsistencyLevel::type in_level)
+    :
+      client(in_client),
+      key(in_key),
+      col_path(in_col_path),
+      level(in_level)
+  {}
+
+  void fetch(vector<Column> &result)
+  {
+    ColumnOrSuperColumn cosc;
+    client->get(cosc, key, col_path, level);
+    if (cosc.column.name.empty())
+    {
+      /* throw an exception */
+      throw(InvalidRequestException());
+    }
+    result.push_back(Column());
+    moveColumn(cosc.column, result.back());
+  }
+
+private:
+
+  CassandraClient *client;
+  const string &key;
+  const ColumnPath &col_path;
+  ConsistencyLevel::type level;
+
+};
+
+
+/*
+ * reads a column for getColumn, sending the prepared arguments the way
+ * CassandraClient::send_get sends its own
+ */
+class PreparedGetFetch : public RequestCoalescer::Fetch
+{
+
+public:
+
+  PreparedGetFetch(CassandraClient *in_client,
+                   const string &in_key,
+                   const PreparedGet &in_get)
+    :
+      client(in_client),
+      key(in_key),
+      get(in_get)
+  {}
+
+  void fetch(vector<Column> &result)
+  {
+    TProtocol *oprot= client->getOutputProtocol().get();
+    oprot->writeMessageBegin("get", T_CALL, 0);
+    get.write(oprot, key);
+    oprot->writeMessageEnd();
+    oprot->getTransport()->flush();
+    oprot->getTransport()->writeEnd();
+    ColumnOrSuperColumn cosc;
+    client->recv_get(cosc);
+    if (cosc.column.name.empty())
+    {
+      /* throw an exception */
+      throw(InvalidRequestException());
+    }
+    result.push_back(Column());
+    moveColumn(cosc.column, result.back());
+  }
+
+private:
+
+  CassandraClient *client;
+  const string &key;
+  const PreparedGet &get;
+
+};
+
+
+/*
+ * reads a slice of a row for getSliceNames and getSliceRange
+ */
+class GetSliceFetch : public RequestCoalescer::Fetch
+{
+
+public:
+
+  GetSliceFetch(CassandraClient *in_client,
+                const string &in_key,
+                const ColumnParent &in_col_parent,
+                const SlicePredicate &in_pred,
+                ConsistencyLevel::type in_level)
+    :
+      client(in_client),
+      key(in_key),
+      col_parent(in_col_parent),
+      pred(in_pred),
+      level(in_level)
+  {}
+
+  void fetch(vector<Column> &result)
+  {
+    vector<ColumnOrSuperColumn> ret_cosc;
+    client->get_slice(ret_cosc, key, col_parent, pred, level);
+    moveColumns(ret_cosc, result);
+  }
+
+private:
+
+  CassandraClient *client;
+  const string &key;
+  const ColumnParent &col_parent;
+  const SlicePredicate &pred;
+  ConsistencyLevel::type level;
+
+};
+
+
+/*
+ * restores the values read by another fetch with a value codec
+ */
+class DecodingFetch : public RequestCoalescer::Fetch
+{
+
+public:
+
+  DecodingFetch(RequestCoalescer::Fetch &in_fetch,
+                const ValueCodec *in_codec)
+    :
+      inner(in_fetch),
+      codec(in_codec)
+  {}
+
+  void fetch(vector<Column> &result)
+  {
+    inner.fetch(result);
+    decodeColumns(codec, result);
+  }
+
+private:
+
+  RequestCoalescer::Fetch &inner;
+  const ValueCodec *codec;
+
+};
+
+
+/*
+ * decodes a reply body that carried one of the declared exceptions with
+ * the generated result struct and throws it
+ */
+template <class ResultType, class SuccessType>
+void throwReplyException(const string& body, const string& method)
+{
+  boost::shared_ptr<TMemoryBuffer> buffer(
+    new TMemoryBuffer(reinterpret_cast<uint8_t *>(const_cast<char *>(body.data())),
+                      static_cast<uint32_t>(body.size())));
+  TBinaryProtocol protocol(buffer);
+  SuccessType success;
+  ResultType result;
+  result.success= &success;
+  result.read(&protocol);
+  if (result.__isset.ire)
+  {
+    throw result.ire;
+  }
+  if (result.__isset.ue)
+  {
+    throw result.ue;
+  }
+  if (result.__isset.te)
+  {
+    throw result.te;
+  }
+  throw TApplicationException(TApplicationException::MISSING_RESULT,
+                              method + " failed: unknown result");
+}
+
+
+/*
+ * skips whatever is left of a reply's result struct and finishes the
+ * message, so the connection can carry the next request
+ */
+void skipReplyRest(TProtocol *iprot)
+{
+  string fname;
+  TType ftype;
+  int16_t fid;
+  while (true)
+  {
+    iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == T_STOP)
+    {
+      break;
+    }
+    iprot->skip(ftype);
+    iprot->readFieldEnd();
+  }
+  iprot->readStructEnd();
+  iprot->readMessageEnd();
+  iprot->getTransport()->readEnd();
+}
+
+
+/*
+ * a pooled connection to a host that has not failed yet, using the
+ * given keyspace, or an empty pointer if none can be had
+ */
+tr1::shared_ptr<Cassandra> connectElsewhere(util::CassandraPool &pool,
+                                            const set<string> &failed_hosts,
+                                            const string &keyspace)
+{
+  vector<string> hosts= pool.getHosts();
+  for (vector<string>::iterator it= hosts.begin(); it != hosts.end(); ++it)
+  {
+    if (failed_hosts.count(*it))
+    {
+      continue;
+    }
+    tr1::shared_ptr<Cassandra> ret;
+    try
+    {
+      ret= pool.getConnection(*it);
+      if (! keyspace.empty() && ret->getCurrentKeyspace() != keyspace)
+      {
+        ret->setKeyspace(keyspace);
+      }
+      return ret;
+    }
+    catch (std::exception &)
+    {
+      if (ret)
+      {
+        pool.discardConnection(ret);
+      }
+    }
+  }
+  return tr1::shared_ptr<Cassandra>();
+}
+
+} /* end anonymous namespace */
+
+
 Cassandra::Cassandra()
   :
     thrift_client(NULL),
@@ -38,7 +588,11 @@ Cassandra::Cassandra()
 	server_version(),
 	current_keyspace(),
 	key_spaces(),
-	token_map()
+	token_map(),
+	column_cache(),
+	request_coalescer(),
+	value_codecs(),
+	schema_cache()
 {
 }
 
@@ -54,7 +608,11 @@ Cassandra::Cassandra(CassandraClient *in_thrift_client,
     server_version(),
     current_keyspace(),
     key_spaces(),
-    token_map()
+    token_map(),
+    column_cache(),
+    request_coalescer(),
+    value_codecs(),
+    schema_cache()
 {}
 
 
@@ -70,7 +628,11 @@ Cassandra::Cassandra(CassandraClient *in_thrift_client,
     server_version(),
     current_keyspace(keyspace),
     key_spaces(),
-    token_map()
+    token_map(),
+    column_cache(),
+    request_coalescer(),
+    value_codecs(),
+    schema_cache()
 {}
 
 
@@ -116,6 +678,11 @@ void Cassandra::insertColumn(const string& key,
                              ConsistencyLevel::type level,
                              int32_t ttl= 0)
 {
+  tr1::shared_ptr<const RequestValidator> validator= findValidator(column_family);
+  if (validator)
+  {
+    validator->validateInsert(super_column_name, column_name, value);
+  }
   ColumnParent col_parent;
   col_parent.column_family.assign(column_family);
   if (! super_column_name.empty()) 
@@ -125,7 +692,15 @@ void Cassandra::insertColumn(const string& key,
   }
   Column col;
   col.name.assign(column_name);
-  col.value.assign(value);
+  const ValueCodec *codec= findValueCodec(column_family);
+  if (codec)
+  {
+    codec->encode(value, col.value);
+  }
+  else
+  {
+    col.value.assign(value);
+  }
   col.timestamp= createTimestamp();
   if (ttl) 
   {
@@ -137,11 +712,18 @@ void Cassandra::insertColumn(const string& key,
   if ((int)key.size() ==0){
       level = ConsistencyLevel::QUORUM; 
   }  
-  /* 
-   * actually perform the insert 
-   * TODO - validate the ColumnParent before the insert
-   */
-  thrift_client->insert(key, col_parent, col, level);
+  /* actually perform the insert */
+  try
+  {
+    thrift_client->insert(key, col_parent, col, level);
+  }
+  catch (...)
+  {
+    /* a write that failed on the way back may still have been applied */
+    invalidateRow(key, column_family);
+    throw;
+  }
+  invalidateRow(key, column_family);
 }
 
 
@@ -185,18 +767,84 @@ void Cassandra::insertColumn(const string& key,
 }
 
 
+PreparedInsert Cassandra::prepareInsert(const string& column_family,
+                                        const string& super_column_name,
+                                        const string& column_name,
+                                        ConsistencyLevel::type level,
+                                        int32_t ttl)
+{
+  tr1::shared_ptr<const RequestValidator> validator= findValidator(column_family);
+  if (validator)
+  {
+    validator->validateInsertPath(super_column_name, column_name);
+  }
+  PreparedInsert ret(column_family, super_column_name, column_name, level, ttl);
+  ret.setKeyspace(current_keyspace);
+  return ret;
+}
+
+
+void Cassandra::insertColumn(const string& key,
+                             const PreparedInsert& insert,
+                             const string& value)
+{
+  const string& column_family= insert.getColumnFamily();
+  checkPreparedKeyspace(insert.getKeyspace());
+  tr1::shared_ptr<const RequestValidator> validator= findValidator(column_family);
+  if (validator)
+  {
+    validator->validateValue(insert.getColumnName(), value);
+  }
+  const ValueCodec *codec= findValueCodec(column_family);
+  string encoded;
+  if (codec)
+  {
+    codec->encode(value, encoded);
+  }
+  /*
+   * this mirrors CassandraClient::send_insert except that only the key,
+   * the value and the timestamp are encoded here
+   */
+  try
+  {
+    TProtocol *oprot= thrift_client->getOutputProtocol().get();
+    oprot->writeMessageBegin("insert", T_CALL, 0);
+    insert.write(oprot, key, codec ? encoded : value, createTimestamp());
+    oprot->writeMessageEnd();
+    oprot->getTransport()->flush();
+    oprot->getTransport()->writeEnd();
+    thrift_client->recv_insert();
+  }
+  catch (...)
+  {
+    invalidateRow(key, column_family);
+    throw;
+  }
+  invalidateRow(key, column_family);
+}
+
+
 void Cassandra::remove(const string &key,
                       const ColumnPath &col_path,
                       ConsistencyLevel::type level)
 {
-  thrift_client->remove(key, col_path, createTimestamp(), level);
+  try
+  {
+    thrift_client->remove(key, col_path, createTimestamp(), level);
+  }
+  catch (...)
+  {
+    invalidateRow(key, col_path.column_family);
+    throw;
+  }
+  invalidateRow(key, col_path.column_family);
 }
 
 
 void Cassandra::remove(const string &key,
                       const ColumnPath &col_path)
 {
-  thrift_client->remove(key, col_path, createTimestamp(), ConsistencyLevel::QUORUM);
+  remove(key, col_path, ConsistencyLevel::QUORUM);
 }
 
 void Cassandra::remove(const string& key,
@@ -242,6 +890,11 @@ Column Cassandra::getColumn(const string& key,
                             const string& column_name,
                             ConsistencyLevel::type level)
 {
+  tr1::shared_ptr<const RequestValidator> validator= findValidator(column_family);
+  if (validator)
+  {
+    validator->validatePath(super_column_name, column_name);
+  }
   ColumnPath col_path;
   col_path.column_family.assign(column_family);
   if (! super_column_name.empty()) 
@@ -251,15 +904,12 @@ Column Cassandra::getColumn(const string& key,
   }
   col_path.column.assign(column_name);
   col_path.__isset.column= true;
-  ColumnOrSuperColumn cosc;
-  /* TODO - validate column path */
-  thrift_client->get(cosc, key, col_path, level);
-  if (cosc.column.name.empty())
-  {
-    /* throw an exception */
-    throw(InvalidRequestException());
-  }
-  return cosc.column;
+  GetColumnFetch fetch(thrift_client, key, col_path, level);
+  return fetchColumn(key,
+                     column_family,
+                     ColumnCache::pathKey(super_column_name, column_name),
+                     level,
+                     fetch);
 }
 
 
@@ -279,26 +929,128 @@ Column Cassandra::getColumn(const string& key,
 }
 
 
-string Cassandra::getColumnValue(const string& key,
-                                 const string& column_family,
-                                 const string& super_column_name,
-                                 const string& column_name)
+PreparedGet Cassandra::prepareGet(const string& column_family,
+                                  const string& super_column_name,
+                                  const string& column_name,
+                                  ConsistencyLevel::type level)
 {
-  return getColumn(key, column_family, super_column_name, column_name).value;
+  tr1::shared_ptr<const RequestValidator> validator= findValidator(column_family);
+  if (validator)
+  {
+    validator->validatePath(super_column_name, column_name);
+  }
+  PreparedGet ret(column_family, super_column_name, column_name, level);
+  ret.setKeyspace(current_keyspace);
+  return ret;
 }
 
 
-string Cassandra::getColumnValue(const string& key,
-                                 const string& column_family,
-                                 const string& column_name)
+Column Cassandra::getColumn(const string& key, const PreparedGet& get)
 {
-	return getColumn(key, column_family, column_name).value;
+  checkPreparedKeyspace(get.getKeyspace());
+  PreparedGetFetch fetch(thrift_client, key, get);
+  return fetchColumn(key,
+                     get.getColumnFamily(),
+                     get.getCachePath(),
+                     get.getConsistencyLevel(),
+                     fetch);
 }
 
 
-int64_t Cassandra::getIntegerColumnValue(const string& key,
-                                         const string& column_family,
-                                         const string& column_name)
+bool Cassandra::tryGetColumn(const string& key,
+                             const string& column_family,
+                             const string& super_column_name,
+                             const string& column_name,
+                             ConsistencyLevel::type level,
+                             Column& col)
+{
+  tr1::shared_ptr<const RequestValidator> validator= findValidator(column_family);
+  if (validator)
+  {
+    validator->validatePath(super_column_name, column_name);
+  }
+  string cache_path;
+  uint64_t generation= 0;
+  if (column_cache)
+  {
+    vector<Column> cached;
+    cache_path= ColumnCache::pathKey(super_column_name, column_name);
+    if (column_cache->get(current_keyspace, column_family, key, cache_path, cached))
+    {
+      if (cached.empty())
+      {
+        return false;
+      }
+      col= cached.front();
+      return true;
+    }
+    generation= column_cache->getGeneration(current_keyspace, column_family, key);
+  }
+  ColumnParent col_parent;
+  col_parent.column_family.assign(column_family);
+  if (! super_column_name.empty())
+  {
+    col_parent.super_column.assign(super_column_name);
+    col_parent.__isset.super_column= true;
+  }
+  SlicePredicate pred;
+  pred.column_names.push_back(column_name);
+  pred.__isset.column_names= true;
+  vector<ColumnOrSuperColumn> ret_cosc;
+  thrift_client->get_slice(ret_cosc, key, col_parent, pred, level);
+  if (ret_cosc.empty() || ret_cosc.front().column.name.empty())
+  {
+    if (column_cache)
+    {
+      column_cache->putAbsent(current_keyspace, column_family, key, cache_path, generation);
+    }
+    return false;
+  }
+  Column &found= ret_cosc.front().column;
+  const ValueCodec *codec= findValueCodec(column_family);
+  if (codec)
+  {
+    codec->decode(found.value);
+  }
+  if (column_cache)
+  {
+    column_cache->put(current_keyspace, column_family, key, cache_path,
+                      vector<Column>(1, found), generation);
+  }
+  moveColumn(found, col);
+  return true;
+}
+
+
+bool Cassandra::tryGetColumn(const string& key,
+                             const string& column_family,
+                             const string& column_name,
+                             Column& col)
+{
+  return tryGetColumn(key, column_family, "", column_name, ConsistencyLevel::QUORUM, col);
+}
+
+
+string Cassandra::getColumnValue(const string& key,
+                                 const string& column_family,
+                                 const string& super_column_name,
+                                 const string& column_name)
+{
+  return getColumn(key, column_family, super_column_name, column_name).value;
+}
+
+
+string Cassandra::getColumnValue(const string& key,
+                                 const string& column_family,
+                                 const string& column_name)
+{
+	return getColumn(key, column_family, column_name).value;
+}
+
+
+int64_t Cassandra::getIntegerColumnValue(const string& key,
+                                         const string& column_family,
+                                         const string& column_name)
 {
 	string ret= getColumn(key, column_family, column_name).value;
   return deserializeLong(ret);
@@ -310,13 +1062,17 @@ SuperColumn Cassandra::getSuperColumn(const string& key,
                                       const string& super_column_name,
                                       ConsistencyLevel::type level)
 {
+  tr1::shared_ptr<const RequestValidator> validator= findValidator(column_family);
+  if (validator)
+  {
+    validator->validatePath(super_column_name, "");
+  }
   ColumnPath col_path;
   col_path.column_family.assign(column_family);
   col_path.super_column.assign(super_column_name);
   /* this is ugly but thanks to thrift is needed */
   col_path.__isset.super_column= true;
   ColumnOrSuperColumn cosc;
-  /* TODO - validate super column path */
   thrift_client->get(cosc, key, col_path, level);
   if (cosc.super_column.name.empty())
   {
@@ -340,19 +1096,24 @@ vector<Column> Cassandra::getSliceNames(const string& key,
                                         SlicePredicate& pred,
                                         ConsistencyLevel::type level)
 {
-  vector<ColumnOrSuperColumn> ret_cosc;
   vector<Column> result;
   /* damn you thrift! */
 //  pred.__isset.column_names= true;
-  thrift_client->get_slice(ret_cosc, key, col_parent, pred, level);
-  for (vector<ColumnOrSuperColumn>::iterator it= ret_cosc.begin();
-       it != ret_cosc.end();
-       ++it)
+  const string path= ColumnCache::predicateKey(col_parent, pred);
+  uint64_t generation= 0;
+  if (column_cache)
   {
-    if (! (*it).column.name.empty())
+    if (column_cache->get(current_keyspace, col_parent.column_family, key, path, result))
     {
-      result.push_back((*it).column);
+      return result;
     }
+    generation= column_cache->getGeneration(current_keyspace, col_parent.column_family, key);
+  }
+  GetSliceFetch fetch(thrift_client, key, col_parent, pred, level);
+  coalesce(col_parent.column_family, key, path, level, fetch, result);
+  if (column_cache)
+  {
+    column_cache->put(current_keyspace, col_parent.column_family, key, path, result, generation);
   }
   return result;
 }
@@ -371,19 +1132,24 @@ vector<Column> Cassandra::getSliceRange(const string& key,
                                         SlicePredicate& pred,
                                         ConsistencyLevel::type level)
 {
-  vector<ColumnOrSuperColumn> ret_cosc;
   vector<Column> result;
   /* damn you thrift! */
   pred.__isset.slice_range= true;
-  thrift_client->get_slice(ret_cosc, key, col_parent, pred, level);
-  for (vector<ColumnOrSuperColumn>::iterator it= ret_cosc.begin();
-       it != ret_cosc.end();
-       ++it)
+  const string path= ColumnCache::predicateKey(col_parent, pred);
+  uint64_t generation= 0;
+  if (column_cache)
   {
-    if (! (*it).column.name.empty())
+    if (column_cache->get(current_keyspace, col_parent.column_family, key, path, result))
     {
-      result.push_back((*it).column);
+      return result;
     }
+    generation= column_cache->getGeneration(current_keyspace, col_parent.column_family, key);
+  }
+  GetSliceFetch fetch(thrift_client, key, col_parent, pred, level);
+  coalesce(col_parent.column_family, key, path, level, fetch, result);
+  if (column_cache)
+  {
+    column_cache->put(current_keyspace, col_parent.column_family, key, path, result, generation);
   }
   return result;
 }
@@ -418,14 +1184,16 @@ Cassandra::getRangeSlice(const ColumnParent& col_parent,
                                   pred,
                                   key_range,
                                   level);
-  if (! key_slices.empty())
+  const ValueCodec *codec= findValueCodec(col_parent.column_family);
+  ret.reserve(key_slices.size());
+  for (vector<KeySlice>::iterator it= key_slices.begin();
+       it != key_slices.end();
+       ++it)
   {
-    for (vector<KeySlice>::iterator it= key_slices.begin();
-         it != key_slices.end();
-         ++it)
-    {
-      ret.push_back(make_pair((*it).key, getColumnList((*it).columns)));
-    }
+    ret.push_back(pair<string, vector<Column> >());
+    ret.back().first.swap((*it).key);
+    moveColumns((*it).columns, ret.back().second);
+    decodeColumns(codec, ret.back().second);
   }
   return ret;
 }
@@ -442,6 +1210,85 @@ Cassandra::getRangeSlice(const ColumnParent& col_parent,
 }
 
 
+void Cassandra::getRangeSlice(RowVisitor& visitor,
+                              const ColumnParent& col_parent,
+                              const SlicePredicate& pred,
+                              const string& start,
+                              const string& finish,
+                              const int32_t row_count,
+                              ConsistencyLevel::type level)
+{
+  KeyRange key_range;
+  key_range.start_key.assign(start);
+  key_range.end_key.assign(finish);
+  key_range.count= row_count;
+  key_range.__isset.start_key= true;
+  key_range.__isset.end_key= true;
+  thrift_client->send_get_range_slices(col_parent, pred, key_range, level);
+  recvRows("get_range_slices", findValueCodec(col_parent.column_family), &visitor, NULL);
+}
+
+
+void Cassandra::getSliceView(ColumnViewSet& result,
+                             const string& key,
+                             const ColumnParent& col_parent,
+                             const SlicePredicate& pred,
+                             ConsistencyLevel::type level)
+{
+  thrift_client->send_get_slice(key, col_parent, pred, level);
+  recvViews("get_slice", result, false);
+}
+
+
+void Cassandra::getRangeSliceView(ColumnViewSet& result,
+                                  const ColumnParent& col_parent,
+                                  const SlicePredicate& pred,
+                                  const string& start,
+                                  const string& finish,
+                                  const int32_t row_count,
+                                  ConsistencyLevel::type level)
+{
+  KeyRange key_range;
+  key_range.start_key.assign(start);
+  key_range.end_key.assign(finish);
+  key_range.count= row_count;
+  key_range.__isset.start_key= true;
+  key_range.__isset.end_key= true;
+  thrift_client->send_get_range_slices(col_parent, pred, key_range, level);
+  recvViews("get_range_slices", result, true);
+}
+
+
+void Cassandra::getSliceView(ArenaSliceResult& result,
+                             const string& key,
+                             const ColumnParent& col_parent,
+                             const SlicePredicate& pred,
+                             ConsistencyLevel::type level)
+{
+  thrift_client->send_get_slice(key, col_parent, pred, level);
+  recvViews("get_slice", result, false);
+}
+
+
+void Cassandra::getRangeSliceView(ArenaSliceResult& result,
+                                  const ColumnParent& col_parent,
+                                  const SlicePredicate& pred,
+                                  const string& start,
+                                  const string& finish,
+                                  const int32_t row_count,
+                                  ConsistencyLevel::type level)
+{
+  KeyRange key_range;
+  key_range.start_key.assign(start);
+  key_range.end_key.assign(finish);
+  key_range.count= row_count;
+  key_range.__isset.start_key= true;
+  key_range.__isset.end_key= true;
+  thrift_client->send_get_range_slices(col_parent, pred, key_range, level);
+  recvViews("get_range_slices", result, true);
+}
+
+
 vector<pair<string, vector<SuperColumn> > >
 Cassandra::getSuperRangeSlice(const ColumnParent& col_parent,
                               const SlicePredicate& pred,
@@ -451,6 +1298,7 @@ Cassandra::getSuperRangeSlice(const ColumnParent& col_parent,
                               ConsistencyLevel::type level)
 {
   vector<pair<string, vector<SuperColumn> > > ret;
+  const ValueCodec *codec= findValueCodec(col_parent.column_family);
   vector<KeySlice> key_slices;
   KeyRange key_range;
   key_range.start_key.assign(start);
@@ -463,13 +1311,22 @@ Cassandra::getSuperRangeSlice(const ColumnParent& col_parent,
                                   pred,
                                   key_range,
                                   level);
-  if (! key_slices.empty())
+  ret.reserve(key_slices.size());
+  for (vector<KeySlice>::iterator it= key_slices.begin();
+       it != key_slices.end();
+       ++it)
   {
-    for (vector<KeySlice>::iterator it= key_slices.begin();
-         it != key_slices.end();
-         ++it)
+    ret.push_back(pair<string, vector<SuperColumn> >());
+    ret.back().first.swap((*it).key);
+    moveSuperColumns((*it).columns, ret.back().second);
+    if (codec)
     {
-      ret.push_back(make_pair((*it).key, getSuperColumnList((*it).columns)));
+      for (vector<SuperColumn>::iterator sc= ret.back().second.begin();
+           sc != ret.back().second.end();
+           ++sc)
+      {
+        decodeColumns(codec, sc->columns);
+      }
     }
   }
   return ret;
@@ -488,6 +1345,25 @@ Cassandra::getSuperRangeSlice(const ColumnParent& col_parent,
 }
 
 
+void Cassandra::getSuperRangeSlice(SuperRowVisitor& visitor,
+                                   const ColumnParent& col_parent,
+                                   const SlicePredicate& pred,
+                                   const string& start,
+                                   const string& finish,
+                                   const int32_t row_count,
+                                   ConsistencyLevel::type level)
+{
+  KeyRange key_range;
+  key_range.start_key.assign(start);
+  key_range.end_key.assign(finish);
+  key_range.count= row_count;
+  key_range.__isset.start_key= true;
+  key_range.__isset.end_key= true;
+  thrift_client->send_get_range_slices(col_parent, pred, key_range, level);
+  recvRows("get_range_slices", findValueCodec(col_parent.column_family), NULL, &visitor);
+}
+
+
 vector<pair<string, vector<Column> > >
 Cassandra::getIndexedSlices(const IndexedSlicesQuery& query)
 {
@@ -503,17 +1379,98 @@ Cassandra::getIndexedSlices(const IndexedSlicesQuery& query)
                                     query.getConsistencyLevel());
 
   vector<pair<string, vector<Column> > > ret;
+  ret.reserve(key_slices.size());
 
+  const ValueCodec *codec= findValueCodec(query.getColumnFamily());
   for(vector<KeySlice>::iterator it= key_slices.begin();
       it != key_slices.end();
       ++it)
   {
-    ret.push_back(make_pair((*it).key, getColumnList((*it).columns)));
+    ret.push_back(pair<string, vector<Column> >());
+    ret.back().first.swap((*it).key);
+    moveColumns((*it).columns, ret.back().second);
+    decodeColumns(codec, ret.back().second);
   }
 
   return ret;
 }
 
+
+void Cassandra::getIndexedSlices(RowVisitor& visitor, const IndexedSlicesQuery& query)
+{
+  SlicePredicate thrift_slice_pred= createSlicePredicateObject(query);
+  ColumnParent thrift_col_parent;
+  thrift_col_parent.column_family.assign(query.getColumnFamily());
+  thrift_client->send_get_indexed_slices(thrift_col_parent,
+                                         query.getIndexClause(),
+                                         thrift_slice_pred,
+                                         query.getConsistencyLevel());
+  recvRows("get_indexed_slices", findValueCodec(query.getColumnFamily()), &visitor, NULL);
+}
+
+map<string, vector<Column> >
+Cassandra::multigetSlice(const vector<string>& keys,
+                         const ColumnParent& col_parent,
+                         const SlicePredicate& pred,
+                         ConsistencyLevel::type level,
+                         uint32_t chunk_size)
+{
+  map<string, vector<Column> > ret;
+  if (chunk_size == 0)
+  {
+    chunk_size= DEFAULT_MULTIGET_CHUNK_SIZE;
+  }
+  for (size_t start= 0; start < keys.size(); start+= chunk_size)
+  {
+    size_t end= min(keys.size(), start + chunk_size);
+    vector<string> chunk(keys.begin() + start, keys.begin() + end);
+    map<string, vector<ColumnOrSuperColumn> > result;
+    thrift_client->multiget_slice(result, chunk, col_parent, pred, level);
+    mergeMultigetSlice(result, ret);
+  }
+  decodeMultigetSlice(findValueCodec(col_parent.column_family), ret);
+  return ret;
+}
+
+
+map<string, vector<Column> >
+Cassandra::multigetSlice(const vector<string>& keys,
+                         const ColumnParent& col_parent,
+                         const SlicePredicate& pred)
+{
+  return multigetSlice(keys, col_parent, pred, ConsistencyLevel::QUORUM, DEFAULT_MULTIGET_CHUNK_SIZE);
+}
+
+
+map<string, vector<Column> >
+Cassandra::multigetSlice(util::CassandraPool& pool,
+                         const vector<string>& keys,
+                         const ColumnParent& col_parent,
+                         const SlicePredicate& pred,
+                         ConsistencyLevel::type level,
+                         uint32_t chunk_size,
+                         uint32_t max_threads)
+{
+  if (chunk_size == 0)
+  {
+    chunk_size= DEFAULT_MULTIGET_CHUNK_SIZE;
+  }
+  vector<MultigetSliceTask> tasks;
+  runChunkedTasks(*this, pool, tasks, keys, col_parent, pred, level,
+                  chunk_size, max_threads, current_keyspace);
+
+  map<string, vector<Column> > ret;
+  for (vector<MultigetSliceTask>::iterator it= tasks.begin();
+       it != tasks.end();
+       ++it)
+  {
+    mergeMultigetSlice(it->getResult(), ret);
+  }
+  decodeMultigetSlice(findValueCodec(col_parent.column_family), ret);
+  return ret;
+}
+
+
 int32_t Cassandra::getCount(const string& key, 
                             const ColumnParent& col_parent,
                             const SlicePredicate& pred,
@@ -531,11 +1488,93 @@ int32_t Cassandra::getCount(const string& key,
 }
 
 
+map<string, int32_t>
+Cassandra::multigetCount(const vector<string>& keys,
+                         const ColumnParent& col_parent,
+                         const SlicePredicate& pred,
+                         ConsistencyLevel::type level,
+                         uint32_t chunk_size)
+{
+  map<string, int32_t> ret;
+  if (chunk_size == 0)
+  {
+    chunk_size= DEFAULT_MULTIGET_CHUNK_SIZE;
+  }
+  for (size_t start= 0; start < keys.size(); start+= chunk_size)
+  {
+    size_t end= min(keys.size(), start + chunk_size);
+    vector<string> chunk(keys.begin() + start, keys.begin() + end);
+    map<string, int32_t> result;
+    thrift_client->multiget_count(result, chunk, col_parent, pred, level);
+    ret.insert(result.begin(), result.end());
+  }
+  return ret;
+}
+
+
+map<string, int32_t>
+Cassandra::multigetCount(const vector<string>& keys,
+                         const ColumnParent& col_parent,
+                         const SlicePredicate& pred)
+{
+  return multigetCount(keys, col_parent, pred, ConsistencyLevel::QUORUM, DEFAULT_MULTIGET_CHUNK_SIZE);
+}
+
+
+map<string, int32_t>
+Cassandra::multigetCount(util::CassandraPool& pool,
+                         const vector<string>& keys,
+                         const ColumnParent& col_parent,
+                         const SlicePredicate& pred,
+                         ConsistencyLevel::type level,
+                         uint32_t chunk_size,
+                         uint32_t max_threads)
+{
+  if (chunk_size == 0)
+  {
+    chunk_size= DEFAULT_MULTIGET_CHUNK_SIZE;
+  }
+  vector<MultigetCountTask> tasks;
+  runChunkedTasks(*this, pool, tasks, keys, col_parent, pred, level,
+                  chunk_size, max_threads, current_keyspace);
+
+  map<string, int32_t> ret;
+  for (vector<MultigetCountTask>::iterator it= tasks.begin();
+       it != tasks.end();
+       ++it)
+  {
+    ret.insert(it->getResult().begin(), it->getResult().end());
+  }
+  return ret;
+}
+
+
 vector<KeyspaceDefinition> Cassandra::getKeyspaces()
+{
+  if (schema_cache)
+  {
+    if (! schema_cache->isPolling() ||
+        ! schema_cache->isLoaded() ||
+        schema_cache->isStale())
+    {
+      schema_cache->refresh(*this);
+    }
+    key_spaces= schema_cache->getKeyspaces();
+  }
+  else
+  {
+    key_spaces= describeKeyspaces();
+  }
+  return key_spaces;
+}
+
+
+vector<KeyspaceDefinition> Cassandra::describeKeyspaces()
 {
   vector<KsDef> thrift_ks_defs;
   thrift_client->describe_keyspaces(thrift_ks_defs);
-  key_spaces.clear();
+  vector<KeyspaceDefinition> ret;
+  ret.reserve(thrift_ks_defs.size());
   for (vector<KsDef>::iterator it= thrift_ks_defs.begin();
          it != thrift_ks_defs.end();
          ++it)
@@ -546,10 +1585,52 @@ vector<KeyspaceDefinition> Cassandra::getKeyspaces()
                                thrift_entry.strategy_options,
                                thrift_entry.replication_factor,
                                thrift_entry.cf_defs);
-      key_spaces.push_back(entry);
+      ret.push_back(entry);
     }
 
-  return key_spaces;
+  return ret;
+}
+
+
+map<string, vector<string> > Cassandra::getSchemaVersions()
+{
+  map<string, vector<string> > ret;
+  thrift_client->describe_schema_versions(ret);
+  return ret;
+}
+
+
+bool Cassandra::waitForSchemaAgreement(uint32_t timeout_ms)
+{
+  /* polls start at 10ms apart and back off to one a second */
+  RetryPolicy polls(0, 10, 1000);
+  polls.setJitter(false);
+  unsigned int seed= 0;
+  const int64_t deadline= createMonotonicTimestamp() + static_cast<int64_t>(timeout_ms) * 1000;
+  for (uint32_t attempt= 1; ; ++attempt)
+  {
+    if (SchemaCache::isAgreement(getSchemaVersions()))
+    {
+      return true;
+    }
+    int64_t left_us= deadline - createMonotonicTimestamp();
+    if (left_us <= 0)
+    {
+      return false;
+    }
+    int64_t wait_us= static_cast<int64_t>(polls.getBackoff(attempt, &seed)) * 1000;
+    if (wait_us > left_us)
+    {
+      wait_us= left_us;
+    }
+    struct timespec ts;
+    ts.tv_sec= static_cast<time_t>(wait_us / 1000000);
+    ts.tv_nsec= static_cast<long>(wait_us % 1000000) * 1000L;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+    {
+      /* interrupted by a signal; sleep for whatever is left */
+    }
+  }
 }
 
 
@@ -558,6 +1639,7 @@ string Cassandra::createColumnFamily(const ColumnFamilyDefinition& cf_def)
   string schema_id;
   CfDef thrift_cf_def= createCfDefObject(cf_def);
   thrift_client->system_add_column_family(schema_id, thrift_cf_def);
+  invalidateSchema();
   return schema_id;
 }
 
@@ -566,6 +1648,7 @@ string Cassandra::updateColumnFamily(const ColumnFamilyDefinition& cf_def)
   string schema_id;
   CfDef thrift_cf_def= createCfDefObject(cf_def);
   thrift_client->system_update_column_family(schema_id, thrift_cf_def);
+  invalidateSchema();
   return schema_id;
 }
 
@@ -573,6 +1656,7 @@ string Cassandra::dropColumnFamily(const string& cf_name)
 {
   string schema_id;
   thrift_client->system_drop_column_family(schema_id, cf_name);
+  invalidateSchema();
   return schema_id;
 }
 
@@ -581,6 +1665,7 @@ string Cassandra::createKeyspace(const KeyspaceDefinition& ks_def)
   string ret;
   KsDef thrift_ks_def= createKsDefObject(ks_def);
   thrift_client->system_add_keyspace(ret, thrift_ks_def);
+  invalidateSchema();
   return ret;
 }
 
@@ -589,6 +1674,7 @@ string Cassandra::updateKeyspace(const KeyspaceDefinition& ks_def)
   string ret;
   KsDef thrift_ks_def= createKsDefObject(ks_def);
   thrift_client->system_update_keyspace(ret, thrift_ks_def);
+  invalidateSchema();
   return ret;
 }
 
@@ -596,6 +1682,7 @@ string Cassandra::dropKeyspace(const string& ks_name)
 {
   string ret;
   thrift_client->system_drop_keyspace(ret, ks_name);
+  invalidateSchema();
   return ret;
 }
 
@@ -640,11 +1727,766 @@ std::vector<org::apache::cassandra::TokenRange> Cassandra::describeRing(const st
    
 }
 
+string Cassandra::describePartitioner()
+{
+  string ret;
+  thrift_client->describe_partitioner(ret);
+  return ret;
+}
+
+
+vector<string> Cassandra::describeSplits(const string &cf_name,
+                                         const string &start_token,
+                                         const string &end_token,
+                                         int32_t keys_per_split)
+{
+  vector<string> ret;
+  thrift_client->describe_splits(ret, cf_name, start_token, end_token, keys_per_split);
+  return ret;
+}
+
 void Cassandra::batchInsert(const std::vector<ColumnInsertTuple> &columns,
                    const std::vector<SuperColumnInsertTuple> &super_columns, 
                    org::apache::cassandra::ConsistencyLevel::type level) {
   MutationsMap mutations;
 
+  buildMutations(columns, super_columns, mutations);
+  encodeMutations(mutations);
+
+  try
+  {
+    thrift_client->batch_mutate(mutations, level);
+  }
+  catch (...)
+  {
+    invalidateRows(mutations);
+    throw;
+  }
+  invalidateRows(mutations);
+}
+
+void Cassandra::batchInsert(const std::vector<ColumnInsertTuple> &columns,
+                   const std::vector<SuperColumnInsertTuple> &super_columns) {
+
+  batchInsert(columns, super_columns, ConsistencyLevel::QUORUM);
+}
+
+void Cassandra::batchInsert(const std::vector<ColumnInsertTuple> &columns,
+                            const std::vector<SuperColumnInsertTuple> &super_columns,
+                            ConsistencyLevel::type level,
+                            const RetryPolicy &policy)
+{
+  batchMutate(serializeBatch(columns, super_columns, level), policy);
+}
+
+SerializedBatch Cassandra::serializeBatch(const std::vector<ColumnInsertTuple> &columns,
+                                          const std::vector<SuperColumnInsertTuple> &super_columns,
+                                          ConsistencyLevel::type level)
+{
+  MutationsMap mutations;
+  buildMutations(columns, super_columns, mutations);
+  encodeMutations(mutations);
+  return SerializedBatch(mutations, level);
+}
+
+void Cassandra::batchMutate(const SerializedBatch &batch)
+{
+  /*
+   * this mirrors CassandraClient::send_batch_mutate except that the
+   * arguments are copied into the frame as already encoded bytes
+   */
+  try
+  {
+    TProtocol *oprot= thrift_client->getOutputProtocol().get();
+    oprot->writeMessageBegin("batch_mutate", T_CALL, 0);
+    oprot->getTransport()->write(batch.getData(), batch.size());
+    oprot->writeMessageEnd();
+    oprot->getTransport()->flush();
+    oprot->getTransport()->writeEnd();
+    thrift_client->recv_batch_mutate();
+  }
+  catch (...)
+  {
+    invalidateRows(batch.getRows());
+    throw;
+  }
+  invalidateRows(batch.getRows());
+}
+
+void Cassandra::batchMutate(const SerializedBatch &batch, const RetryPolicy &policy)
+{
+  unsigned int seed= static_cast<unsigned int>(createTimestamp());
+  bool need_reconnect= false;
+  for (uint32_t attempt= 1; ; ++attempt)
+  {
+    try
+    {
+      if (need_reconnect)
+      {
+        reconnect();
+        need_reconnect= false;
+      }
+      batchMutate(batch);
+      return;
+    }
+    catch (TimedOutException &)
+    {
+      if (attempt >= policy.getMaxAttempts())
+      {
+        throw;
+      }
+    }
+    catch (TTransportException &)
+    {
+      if (attempt >= policy.getMaxAttempts())
+      {
+        throw;
+      }
+      need_reconnect= true;
+    }
+    policy.backoff(attempt, &seed);
+  }
+}
+
+void Cassandra::batchMutate(const SerializedBatch &batch,
+                            const RetryPolicy &policy,
+                            util::CassandraPool &pool)
+{
+  unsigned int seed= static_cast<unsigned int>(createTimestamp());
+  set<string> failed_hosts;
+  tr1::shared_ptr<Cassandra> borrowed;
+  Cassandra *target= this;
+  bool need_reconnect= false;
+  for (uint32_t attempt= 1; ; ++attempt)
+  {
+    try
+    {
+      if (need_reconnect)
+      {
+        reconnect();
+        need_reconnect= false;
+      }
+      target->batchMutate(batch);
+      break;
+    }
+    catch (TimedOutException &)
+    {
+      if (attempt >= policy.getMaxAttempts())
+      {
+        if (borrowed)
+        {
+          pool.releaseConnection(borrowed);
+        }
+        throw;
+      }
+    }
+    catch (TTransportException &)
+    {
+      failed_hosts.insert(target->getHost());
+      if (borrowed)
+      {
+        pool.discardConnection(borrowed);
+        borrowed.reset();
+      }
+      if (attempt >= policy.getMaxAttempts())
+      {
+        throw;
+      }
+      /* the same bytes go to another host; this one only once all have failed */
+      borrowed= connectElsewhere(pool, failed_hosts, current_keyspace);
+      target= borrowed ? borrowed.get() : this;
+      need_reconnect= ! borrowed;
+    }
+    catch (...)
+    {
+      if (borrowed)
+      {
+        pool.releaseConnection(borrowed);
+      }
+      throw;
+    }
+    policy.backoff(attempt, &seed);
+  }
+  if (borrowed)
+  {
+    pool.releaseConnection(borrowed);
+    /* the other connection only dropped the rows from its own cache */
+    invalidateRows(batch.getRows());
+  }
+}
+
+void Cassandra::reconnect()
+{
+  boost::shared_ptr<TTransport> transport= thrift_client->getOutputProtocol()->getTransport();
+  transport->close();
+  transport->open(); /* throws an exception */
+  if (! current_keyspace.empty())
+  {
+    thrift_client->set_keyspace(current_keyspace);
+  }
+}
+
+void Cassandra::readReplyHeader(const string& method)
+{
+  /* this follows the generated recv_ methods up to the result struct */
+  TProtocol *iprot= thrift_client->getInputProtocol().get();
+  string fname;
+  TMessageType mtype;
+  int32_t rseqid= 0;
+  iprot->readMessageBegin(fname, mtype, rseqid);
+  if (mtype == T_EXCEPTION)
+  {
+    TApplicationException x;
+    x.read(iprot);
+    iprot->readMessageEnd();
+    iprot->getTransport()->readEnd();
+    throw x;
+  }
+  if (mtype != T_REPLY || fname.compare(method) != 0)
+  {
+    iprot->skip(T_STRUCT);
+    iprot->readMessageEnd();
+    iprot->getTransport()->readEnd();
+    throw TApplicationException(mtype != T_REPLY ?
+                                TApplicationException::INVALID_MESSAGE_TYPE :
+                                TApplicationException::WRONG_METHOD_NAME);
+  }
+}
+
+const char *Cassandra::beginReply(const string& method, uint32_t &len)
+{
+  /* the result struct is taken from the transport's buffer in one piece */
+  readReplyHeader(method);
+  TProtocol *iprot= thrift_client->getInputProtocol().get();
+  /* a framed transport holds the rest of the frame; ask for all of it */
+  len= 0;
+  const uint8_t *data= iprot->getTransport()->borrow(NULL, &len);
+  if (data == NULL)
+  {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "column views need a buffered transport");
+  }
+  return reinterpret_cast<const char *>(data);
+}
+
+void Cassandra::endReply(uint32_t len)
+{
+  TProtocol *iprot= thrift_client->getInputProtocol().get();
+  iprot->getTransport()->consume(len);
+  iprot->readMessageEnd();
+  iprot->getTransport()->readEnd();
+}
+
+void Cassandra::throwReplyError(const string& method, const string& body, bool range)
+{
+  if (range)
+  {
+    throwReplyException<Cassandra_get_range_slices_presult, vector<KeySlice> >(body, method);
+  }
+  throwReplyException<Cassandra_get_slice_presult, vector<ColumnOrSuperColumn> >(body, method);
+}
+
+void Cassandra::recvViews(const string& method, ColumnViewSet& result, bool range)
+{
+  uint32_t len= 0;
+  const char *data= beginReply(method, len);
+  tr1::shared_ptr<string> body(new string(data, len));
+  endReply(len);
+  if (! result.parse(body, range))
+  {
+    throwReplyError(method, *body, range);
+  }
+}
+
+void Cassandra::recvViews(const string& method, ArenaSliceResult& result, bool range)
+{
+  uint32_t len= 0;
+  const char *data= beginReply(method, len);
+  bool found= false;
+  try
+  {
+    /* decoded straight out of the transport's buffer */
+    found= result.parse(data, len, range);
+  }
+  catch (...)
+  {
+    endReply(len);
+    throw;
+  }
+  if (! found)
+  {
+    string body(data, len);
+    endReply(len);
+    throwReplyError(method, body, range);
+  }
+  endReply(len);
+}
+
+void Cassandra::recvRows(const string& method,
+                         const ValueCodec *codec,
+                         RowVisitor *visitor,
+                         SuperRowVisitor *super_visitor)
+{
+  /*
+   * this follows CassandraClient::recv_get_range_slices, except that the
+   * list of rows is decoded one KeySlice at a time and each is handed to
+   * the visitor before the next is read
+   */
+  readReplyHeader(method);
+  TProtocol *iprot= thrift_client->getInputProtocol().get();
+  InvalidRequestException ire;
+  UnavailableException ue;
+  TimedOutException te;
+  bool has_ire= false;
+  bool has_ue= false;
+  bool has_te= false;
+  bool found= false;
+  string fname;
+  TType ftype;
+  int16_t fid;
+  iprot->readStructBegin(fname);
+  while (true)
+  {
+    iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == T_STOP)
+    {
+      break;
+    }
+    if (fid == 0 && ftype == T_LIST)
+    {
+      TType etype;
+      uint32_t size;
+      iprot->readListBegin(etype, size);
+      KeySlice slice;
+      vector<Column> columns;
+      vector<SuperColumn> super_columns;
+      bool visiting= (etype == T_STRUCT);
+      for (uint32_t i= 0; i < size; ++i)
+      {
+        if (! visiting)
+        {
+          iprot->skip(etype);
+          continue;
+        }
+        slice.read(iprot);
+        try
+        {
+          if (visitor)
+          {
+            columns.clear();
+            moveColumns(slice.columns, columns);
+            if (codec)
+            {
+              codec->decode(columns);
+            }
+            visiting= visitor->visit(slice.key, columns);
+          }
+          else
+          {
+            super_columns.clear();
+            moveSuperColumns(slice.columns, super_columns);
+            for (vector<SuperColumn>::iterator sc= super_columns.begin();
+                 codec && sc != super_columns.end();
+                 ++sc)
+            {
+              codec->decode(sc->columns);
+            }
+            visiting= super_visitor->visit(slice.key, super_columns);
+          }
+        }
+        catch (...)
+        {
+          /* leave the connection usable before passing the error on */
+          for (++i; i < size; ++i)
+          {
+            iprot->skip(etype);
+          }
+          iprot->readListEnd();
+          iprot->readFieldEnd();
+          skipReplyRest(iprot);
+          throw;
+        }
+      }
+      iprot->readListEnd();
+      found= true;
+    }
+    else if (fid == 1 && ftype == T_STRUCT)
+    {
+      ire.read(iprot);
+      has_ire= true;
+    }
+    else if (fid == 2 && ftype == T_STRUCT)
+    {
+      ue.read(iprot);
+      has_ue= true;
+    }
+    else if (fid == 3 && ftype == T_STRUCT)
+    {
+      te.read(iprot);
+      has_te= true;
+    }
+    else
+    {
+      iprot->skip(ftype);
+    }
+    iprot->readFieldEnd();
+  }
+  iprot->readStructEnd();
+  iprot->readMessageEnd();
+  iprot->getTransport()->readEnd();
+  if (found)
+  {
+    return;
+  }
+  if (has_ire)
+  {
+    throw ire;
+  }
+  if (has_ue)
+  {
+    throw ue;
+  }
+  if (has_te)
+  {
+    throw te;
+  }
+  throw TApplicationException(TApplicationException::MISSING_RESULT,
+                              method + " failed: unknown result");
+}
+
+void Cassandra::setColumnCache(const tr1::shared_ptr<ColumnCache> &cache)
+{
+  column_cache= cache;
+}
+
+tr1::shared_ptr<ColumnCache> Cassandra::getColumnCache() const
+{
+  return column_cache;
+}
+
+void Cassandra::setRequestCoalescer(const tr1::shared_ptr<RequestCoalescer> &coalescer)
+{
+  request_coalescer= coalescer;
+}
+
+tr1::shared_ptr<RequestCoalescer> Cassandra::getRequestCoalescer() const
+{
+  return request_coalescer;
+}
+
+void Cassandra::coalesce(const string& column_family,
+                         const string& key,
+                         const string& path,
+                         ConsistencyLevel::type level,
+                         RequestCoalescer::Fetch& fetch,
+                         vector<Column>& result)
+{
+  /* values are restored once, by whoever performs the read */
+  const ValueCodec *codec= findValueCodec(column_family);
+  if (codec)
+  {
+    DecodingFetch decoding(fetch, codec);
+    coalesceFetch(column_family, key, path, level, decoding, result);
+  }
+  else
+  {
+    coalesceFetch(column_family, key, path, level, fetch, result);
+  }
+}
+
+Column Cassandra::fetchColumn(const string& key,
+                              const string& column_family,
+                              const string& path,
+                              ConsistencyLevel::type level,
+                              RequestCoalescer::Fetch& fetch)
+{
+  vector<Column> result;
+  uint64_t generation= 0;
+  if (column_cache)
+  {
+    if (column_cache->get(current_keyspace, column_family, key, path, result))
+    {
+      if (result.empty())
+      {
+        throw(NotFoundException());
+      }
+      return result.front();
+    }
+    generation= column_cache->getGeneration(current_keyspace, column_family, key);
+  }
+  try
+  {
+    coalesce(column_family, key, path, level, fetch, result);
+  }
+  catch (NotFoundException &)
+  {
+    if (column_cache)
+    {
+      column_cache->putAbsent(current_keyspace, column_family, key, path, generation);
+    }
+    throw;
+  }
+  if (column_cache)
+  {
+    column_cache->put(current_keyspace, column_family, key, path, result, generation);
+  }
+  return result.front();
+}
+
+void Cassandra::coalesceFetch(const string& column_family,
+                              const string& key,
+                              const string& path,
+                              ConsistencyLevel::type level,
+                              RequestCoalescer::Fetch& fetch,
+                              vector<Column>& result)
+{
+  if (request_coalescer)
+  {
+    request_coalescer->run(RequestCoalescer::requestKey(current_keyspace,
+                                                        column_family,
+                                                        key,
+                                                        path,
+                                                        level),
+                           fetch,
+                           result);
+  }
+  else
+  {
+    fetch.fetch(result);
+  }
+}
+
+void Cassandra::setValueCodec(const string& column_family,
+                              const tr1::shared_ptr<ValueCodec> &codec)
+{
+  if (codec)
+  {
+    tr1::shared_ptr<const RequestValidator> validator;
+    if (schema_cache && ! current_keyspace.empty())
+    {
+      if (schema_cache->isStale())
+      {
+        schema_cache->refresh(*this);
+      }
+      validator= schema_cache->findValidator(current_keyspace, column_family);
+    }
+    if (validator && ! validator->acceptsAnyValue())
+    {
+      throw Exception("value codecs need a column family validated as BytesType: " +
+                      column_family, 0);
+    }
+    value_codecs[column_family]= codec;
+  }
+  else
+  {
+    value_codecs.erase(column_family);
+  }
+}
+
+const map<string, tr1::shared_ptr<ValueCodec> > &Cassandra::getValueCodecs() const
+{
+  return value_codecs;
+}
+
+void Cassandra::decodeValues(const string& column_family,
+                             vector<ColumnOrSuperColumn> &columns) const
+{
+  const ValueCodec *codec= findValueCodec(column_family);
+  if (codec == NULL)
+  {
+    return;
+  }
+  for (vector<ColumnOrSuperColumn>::iterator it= columns.begin();
+       it != columns.end();
+       ++it)
+  {
+    if (it->__isset.super_column)
+    {
+      codec->decode(it->super_column.columns);
+    }
+    else
+    {
+      codec->decode(it->column.value);
+    }
+  }
+}
+
+void Cassandra::decodeValues(const string& column_family,
+                             vector<KeySlice> &rows) const
+{
+  if (findValueCodec(column_family) == NULL)
+  {
+    return;
+  }
+  for (vector<KeySlice>::iterator it= rows.begin(); it != rows.end(); ++it)
+  {
+    decodeValues(column_family, it->columns);
+  }
+}
+
+tr1::shared_ptr<ValueCodec> Cassandra::getValueCodec(const string& column_family) const
+{
+  map<string, tr1::shared_ptr<ValueCodec> >::const_iterator it= value_codecs.find(column_family);
+  if (it == value_codecs.end())
+  {
+    return tr1::shared_ptr<ValueCodec>();
+  }
+  return it->second;
+}
+
+void Cassandra::setSchemaCache(const tr1::shared_ptr<SchemaCache> &cache)
+{
+  schema_cache= cache;
+}
+
+tr1::shared_ptr<SchemaCache> Cassandra::getSchemaCache() const
+{
+  return schema_cache;
+}
+
+tr1::shared_ptr<const RequestValidator> Cassandra::findValidator(const string& column_family)
+{
+  if (! schema_cache || current_keyspace.empty())
+  {
+    return tr1::shared_ptr<const RequestValidator>();
+  }
+  bool refreshed= false;
+  if (schema_cache->isStale())
+  {
+    /* the schema was changed since it was read; never validate against the old one */
+    schema_cache->refresh(*this);
+    refreshed= true;
+  }
+  tr1::shared_ptr<const RequestValidator> ret= schema_cache->findValidator(current_keyspace,
+                                                                           column_family);
+  if (! ret && ! refreshed)
+  {
+    /* the column family may be newer than the cache */
+    schema_cache->refresh(*this);
+    ret= schema_cache->findValidator(current_keyspace, column_family);
+  }
+  if (! ret)
+  {
+    InvalidRequestException ire;
+    ire.why= "unconfigured columnfamily " + column_family;
+    throw ire;
+  }
+  return ret;
+}
+
+void Cassandra::checkPreparedKeyspace(const string& ks_name) const
+{
+  if (! ks_name.empty() && ks_name != current_keyspace)
+  {
+    InvalidRequestException ire;
+    ire.why= "request prepared for keyspace " + ks_name + " used with keyspace " + current_keyspace;
+    throw ire;
+  }
+}
+
+const ValueCodec *Cassandra::findValueCodec(const string& column_family) const
+{
+  if (value_codecs.empty())
+  {
+    return NULL;
+  }
+  map<string, tr1::shared_ptr<ValueCodec> >::const_iterator it= value_codecs.find(column_family);
+  return it == value_codecs.end() ? NULL : it->second.get();
+}
+
+void Cassandra::encodeMutations(MutationsMap& mutations) const
+{
+  if (value_codecs.empty())
+  {
+    return;
+  }
+  string encoded;
+  for (MutationsMap::iterator key_it= mutations.begin();
+       key_it != mutations.end();
+       ++key_it)
+  {
+    for (map<string, vector<Mutation> >::iterator cf_it= key_it->second.begin();
+         cf_it != key_it->second.end();
+         ++cf_it)
+    {
+      const ValueCodec *codec= findValueCodec(cf_it->first);
+      if (! codec)
+      {
+        continue;
+      }
+      for (vector<Mutation>::iterator it= cf_it->second.begin();
+           it != cf_it->second.end();
+           ++it)
+      {
+        ColumnOrSuperColumn &cosc= it->column_or_supercolumn;
+        if (cosc.__isset.column)
+        {
+          codec->encode(cosc.column.value, encoded);
+          cosc.column.value.swap(encoded);
+        }
+        for (vector<Column>::iterator col= cosc.super_column.columns.begin();
+             col != cosc.super_column.columns.end();
+             ++col)
+        {
+          codec->encode(col->value, encoded);
+          col->value.swap(encoded);
+        }
+      }
+    }
+  }
+}
+
+void Cassandra::invalidateRow(const string& key, const string& column_family)
+{
+  if (column_cache)
+  {
+    column_cache->invalidate(current_keyspace, column_family, key);
+  }
+}
+
+void Cassandra::invalidateRows(const MutationsMap& mutations)
+{
+  if (column_cache)
+  {
+    for (MutationsMap::const_iterator key_it= mutations.begin();
+         key_it != mutations.end();
+         ++key_it)
+    {
+      for (map<string, vector<Mutation> >::const_iterator cf_it= key_it->second.begin();
+           cf_it != key_it->second.end();
+           ++cf_it)
+      {
+        invalidateRow(key_it->first, cf_it->first);
+      }
+    }
+  }
+}
+
+void Cassandra::invalidateRows(const vector<pair<string, string> >& rows)
+{
+  if (column_cache)
+  {
+    for (vector<pair<string, string> >::const_iterator it= rows.begin();
+         it != rows.end();
+         ++it)
+    {
+      invalidateRow(it->first, it->second);
+    }
+  }
+}
+
+void Cassandra::invalidateSchema()
+{
+  if (schema_cache)
+  {
+    schema_cache->invalidate();
+  }
+}
+
+void Cassandra::buildMutations(const std::vector<ColumnInsertTuple> &columns,
+                               const std::vector<SuperColumnInsertTuple> &super_columns,
+                               MutationsMap &mutations)
+{
   for (std::vector<ColumnInsertTuple>::const_iterator column = columns.begin();
        column != columns.end(); column++) {
     addToMap(*column, mutations);
@@ -654,14 +2496,6 @@ void Cassandra::batchInsert(const std::vector<ColumnInsertTuple> &columns,
        super_column != super_columns.end(); super_column++) {
     addToMap(*super_column, mutations);
   }
-
-  thrift_client->batch_mutate(mutations, level);
-}
-
-void Cassandra::batchInsert(const std::vector<ColumnInsertTuple> &columns,
-                   const std::vector<SuperColumnInsertTuple> &super_columns) {
-
-  batchInsert(columns, super_columns, ConsistencyLevel::QUORUM);
 }
 
 void Cassandra::addToMap(const ColumnInsertTuple &tuple, MutationsMap &mutations) {
@@ -752,6 +2586,14 @@ void Cassandra::addToMap(const SuperColumnInsertTuple &tuple, MutationsMap &muta
 
 bool Cassandra::findKeyspace(const string& name)
 {
+  if (schema_cache)
+  {
+    if (! schema_cache->isLoaded() || schema_cache->isStale())
+    {
+      schema_cache->refresh(*this);
+    }
+    return schema_cache->findKeyspace(name).get() != NULL;
+  }
   for (vector<KeyspaceDefinition>::iterator it= key_spaces.begin();
       it != key_spaces.end();
       ++it)
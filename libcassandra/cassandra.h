@@ -21,6 +21,10 @@
 
 #include "libcassandra/indexed_slices_query.h"
 #include "libcassandra/keyspace_definition.h"
+#include "libcassandra/prepared_request.h"
+#include "libcassandra/request_coalescer.h"
+#include "libcassandra/retry_policy.h"
+#include "libcassandra/serialized_batch.h"
 
 namespace org
 {
@@ -37,6 +41,19 @@ namespace libcassandra
 {
 
 class Keyspace;
+class RequestValidator;
+class ColumnCache;
+class ColumnViewSet;
+class ArenaSliceResult;
+class RowVisitor;
+class SchemaCache;
+class SuperRowVisitor;
+class ValueCodec;
+
+namespace util
+{
+class CassandraPool;
+}
 
 class Cassandra
 {
@@ -61,6 +78,16 @@ public:
                           std::string   //value
                          > SuperColumnInsertTuple;
 
+  /**
+   * default number of keys sent in a single multiget request
+   */
+  static const uint32_t DEFAULT_MULTIGET_CHUNK_SIZE= 100;
+
+  /**
+   * default time waitForSchemaAgreement waits for the cluster to agree
+   */
+  static const uint32_t DEFAULT_SCHEMA_AGREEMENT_TIMEOUT_MS= 60000;
+
 public:
 
   Cassandra();
@@ -104,10 +131,34 @@ public:
   void setKeyspace(const std::string& ks_name);
 
   /**
-   * @return all the keyspace definitions.
+   * @return all the keyspace definitions. With a schema cache attached
+   *         they come from the cache, which is refreshed first unless it
+   *         is polling.
    */
   std::vector<KeyspaceDefinition> getKeyspaces();
 
+  /**
+   * @return all the keyspace definitions, read from the server
+   */
+  std::vector<KeyspaceDefinition> describeKeyspaces();
+
+  /**
+   * @return the schema versions of the cluster, each with the hosts that
+   *         have it; hosts that could not be asked are listed under
+   *         "UNREACHABLE"
+   */
+  std::map<std::string, std::vector<std::string> > getSchemaVersions();
+
+  /**
+   * Wait until every reachable node reports the same schema version, as
+   * it does once a schema change has spread through the cluster. The
+   * versions are polled quickly at first, then less often the longer
+   * agreement takes.
+   * @param[in] timeout_ms how long to wait at most
+   * @return true if the cluster agrees; false if it did not in time
+   */
+  bool waitForSchemaAgreement(uint32_t timeout_ms= DEFAULT_SCHEMA_AGREEMENT_TIMEOUT_MS);
+
   /**
    * Insert a column, possibly inside a supercolumn
    *
@@ -184,6 +235,37 @@ public:
                     const std::string& column_name,
                     const int64_t value);
 
+  /**
+   * Prepare inserts into one column. With a schema cache set the column
+   * is checked here, once, and only the values are checked per insert.
+   * The insert is tied to the current keyspace.
+   *
+   * @param[in] column_family the column family
+   * @param[in] super_column_name the super column name (optional)
+   * @param[in] column_name the column name
+   * @param[in] level consistency level
+   * @param[in] ttl time to live, 0 for none
+   * @return the prepared insert, which may be used on any connection
+   *         using the same keyspace
+   */
+  PreparedInsert prepareInsert(const std::string& column_family,
+                               const std::string& super_column_name,
+                               const std::string& column_name,
+                               org::apache::cassandra::ConsistencyLevel::type level,
+                               int32_t ttl= 0);
+
+  /**
+   * Insert a value into a prepared column. Throws InvalidRequestException
+   * if the insert was prepared for another keyspace.
+   *
+   * @param[in] key the column key
+   * @param[in] insert the prepared column
+   * @param[in] value the column value
+   */
+  void insertColumn(const std::string& key,
+                    const PreparedInsert& insert,
+                    const std::string& value);
+
   /**
    * Removes all the columns that match the given column path
    *
@@ -285,6 +367,61 @@ public:
                                            const std::string& column_family,
                                            const std::string& column_name);
 
+  /**
+   * Prepare reads of one column. With a schema cache set the column is
+   * checked here, once, instead of on every read. The read is tied to
+   * the current keyspace.
+   *
+   * @param[in] column_family the column family
+   * @param[in] super_column_name the super column name (optional)
+   * @param[in] column_name the column name
+   * @param[in] level consistency level
+   * @return the prepared read, which may be used on any connection
+   *         using the same keyspace
+   */
+  PreparedGet prepareGet(const std::string& column_family,
+                         const std::string& super_column_name,
+                         const std::string& column_name,
+                         org::apache::cassandra::ConsistencyLevel::type level);
+
+  /**
+   * Retrieve a prepared column. The column cache and the request
+   * coalescer are used as they are by getColumn. Throws
+   * InvalidRequestException if the read was prepared for another
+   * keyspace.
+   *
+   * @param[in] key the column key
+   * @param[in] get the prepared column
+   * @return a column
+   */
+  org::apache::cassandra::Column getColumn(const std::string& key,
+                                           const PreparedGet& get);
+
+  /**
+   * Retrieve a column without throwing when it does not exist. The lookup
+   * is a get_slice by name, so a missing column comes back as an empty
+   * result instead of a NotFoundException. With a column cache attached
+   * that has a negative TTL set, missing columns are remembered too.
+   * @param[in] key the column key
+   * @param[in] column_family the column family
+   * @param[in] super_column_name the super column name (optional)
+   * @param[in] column_name the column name
+   * @param[in] level consistency level
+   * @param[out] col receives the column if it exists
+   * @return true if the column exists; false otherwise
+   */
+  bool tryGetColumn(const std::string& key,
+                    const std::string& column_family,
+                    const std::string& super_column_name,
+                    const std::string& column_name,
+                    org::apache::cassandra::ConsistencyLevel::type level,
+                    org::apache::cassandra::Column& col);
+
+  bool tryGetColumn(const std::string& key,
+                    const std::string& column_family,
+                    const std::string& column_name,
+                    org::apache::cassandra::Column& col);
+
   /**
    * Retrieve a column value
    *
@@ -366,6 +503,95 @@ public:
                 const std::string& finish,
                 const int32_t row_count);
 
+  /**
+   * Read a slice of a row without decoding each column into strings. The
+   * columns in the result point into the reply buffer it owns.
+   * @param[out] result receives the columns; super columns are left out
+   * @param[in] key the row key
+   * @param[in] col_parent column family (and super column) of the row
+   * @param[in] pred which columns to read
+   * @param[in] level consistency level
+   */
+  void getSliceView(ColumnViewSet& result,
+                    const std::string& key,
+                    const org::apache::cassandra::ColumnParent& col_parent,
+                    const org::apache::cassandra::SlicePredicate& pred,
+                    org::apache::cassandra::ConsistencyLevel::type level);
+
+  /**
+   * Read a range of rows without decoding each key and column into
+   * strings. The rows and columns in the result point into the reply
+   * buffer it owns.
+   * @param[out] result receives the rows; super columns are left out
+   * @param[in] col_parent column family (and super column) to read
+   * @param[in] pred which columns to read from each row
+   * @param[in] start first row key
+   * @param[in] finish last row key
+   * @param[in] row_count maximum number of rows
+   * @param[in] level consistency level
+   */
+  void getRangeSliceView(ColumnViewSet& result,
+                         const org::apache::cassandra::ColumnParent& col_parent,
+                         const org::apache::cassandra::SlicePredicate& pred,
+                         const std::string& start,
+                         const std::string& finish,
+                         const int32_t row_count,
+                         org::apache::cassandra::ConsistencyLevel::type level);
+
+  /**
+   * Read a slice of a row into an arena backed result. The strings are
+   * copied out of the reply straight into the result's arena; reusing
+   * one result object for many queries avoids allocating per query.
+   * @param[out] result receives the columns; super columns are left out
+   * @param[in] key the row key
+   * @param[in] col_parent column family (and super column) of the row
+   * @param[in] pred which columns to read
+   * @param[in] level consistency level
+   */
+  void getSliceView(ArenaSliceResult& result,
+                    const std::string& key,
+                    const org::apache::cassandra::ColumnParent& col_parent,
+                    const org::apache::cassandra::SlicePredicate& pred,
+                    org::apache::cassandra::ConsistencyLevel::type level);
+
+  /**
+   * Read a range of rows into an arena backed result
+   * @param[out] result receives the rows; super columns are left out
+   * @param[in] col_parent column family (and super column) to read
+   * @param[in] pred which columns to read from each row
+   * @param[in] start first row key
+   * @param[in] finish last row key
+   * @param[in] row_count maximum number of rows
+   * @param[in] level consistency level
+   */
+  void getRangeSliceView(ArenaSliceResult& result,
+                         const org::apache::cassandra::ColumnParent& col_parent,
+                         const org::apache::cassandra::SlicePredicate& pred,
+                         const std::string& start,
+                         const std::string& finish,
+                         const int32_t row_count,
+                         org::apache::cassandra::ConsistencyLevel::type level);
+
+  /**
+   * Read a range of rows, handing each row to a visitor as soon as it is
+   * decoded from the reply instead of building the whole result
+   * @param[in] visitor receives the rows; once it returns false the
+   *                    remaining rows are skipped without being decoded
+   * @param[in] col_parent column family (and super column) to read
+   * @param[in] pred which columns to read from each row
+   * @param[in] start first row key
+   * @param[in] finish last row key
+   * @param[in] row_count maximum number of rows
+   * @param[in] level consistency level
+   */
+  void getRangeSlice(RowVisitor& visitor,
+                     const org::apache::cassandra::ColumnParent& col_parent,
+                     const org::apache::cassandra::SlicePredicate& pred,
+                     const std::string& start,
+                     const std::string& finish,
+                     const int32_t row_count,
+                     org::apache::cassandra::ConsistencyLevel::type level);
+
   std::vector<std::pair<std::string, std::vector<org::apache::cassandra::SuperColumn> > >
   getSuperRangeSlice(const org::apache::cassandra::ColumnParent& col_parent,
                      const org::apache::cassandra::SlicePredicate& pred,
@@ -374,6 +600,26 @@ public:
                      const int32_t count,
                      org::apache::cassandra::ConsistencyLevel::type level);
 
+  /**
+   * Read a range of rows of a super column family, handing each row to a
+   * visitor as soon as it is decoded from the reply
+   * @param[in] visitor receives the rows; once it returns false the
+   *                    remaining rows are skipped without being decoded
+   * @param[in] col_parent column family to read
+   * @param[in] pred which super columns to read from each row
+   * @param[in] start first row key
+   * @param[in] finish last row key
+   * @param[in] count maximum number of rows
+   * @param[in] level consistency level
+   */
+  void getSuperRangeSlice(SuperRowVisitor& visitor,
+                          const org::apache::cassandra::ColumnParent& col_parent,
+                          const org::apache::cassandra::SlicePredicate& pred,
+                          const std::string& start,
+                          const std::string& finish,
+                          const int32_t count,
+                          org::apache::cassandra::ConsistencyLevel::type level);
+
   std::vector<std::pair<std::string, std::vector<org::apache::cassandra::SuperColumn> > >
   getSuperRangeSlice(const org::apache::cassandra::ColumnParent& col_parent,
                      const org::apache::cassandra::SlicePredicate& pred,
@@ -390,6 +636,66 @@ public:
   std::vector<std::pair<std::string, std::vector<org::apache::cassandra::Column> > >
   getIndexedSlices(const IndexedSlicesQuery& query);
 
+  /**
+   * Run a secondary index query, handing each matching row to a visitor
+   * as soon as it is decoded from the reply
+   * @param[in] visitor receives the rows; once it returns false the
+   *                    remaining rows are skipped without being decoded
+   * @param[in] query the index query
+   */
+  void getIndexedSlices(RowVisitor& visitor, const IndexedSlicesQuery& query);
+
+  /**
+   * Retrieve the same slice from many rows. Keys are sent in chunks of
+   * chunk_size keys, one request per chunk, over this connection.
+   * @param[in] keys the row keys to fetch
+   * @param[in] col_parent the column family (and super column) to read
+   * @param[in] pred the slice to read from each row
+   * @param[in] level consistency level
+   * @param[in] chunk_size maximum number of keys per request
+   * @return map from row key to the columns found in that row
+   */
+  std::map<std::string, std::vector<org::apache::cassandra::Column> >
+  multigetSlice(const std::vector<std::string>& keys,
+                const org::apache::cassandra::ColumnParent& col_parent,
+                const org::apache::cassandra::SlicePredicate& pred,
+                org::apache::cassandra::ConsistencyLevel::type level,
+                uint32_t chunk_size);
+
+  std::map<std::string, std::vector<org::apache::cassandra::Column> >
+  multigetSlice(const std::vector<std::string>& keys,
+                const org::apache::cassandra::ColumnParent& col_parent,
+                const org::apache::cassandra::SlicePredicate& pred);
+
+  /**
+   * Retrieve the same slice from many rows. Keys are grouped by the token
+   * range that owns them (see describeRing), each group is split in
+   * chunks of chunk_size keys and the chunks are fetched concurrently over
+   * pooled connections to the range's replicas, switched to this
+   * connection's keyspace. A chunk whose replica fails with a transport
+   * error is read from the range's other replicas, then from any pooled
+   * connection. The ring and partitioner come from the pool (see
+   * CassandraPool::getRing) and are read over this connection when the
+   * pool has none; with a partitioner whose tokens cannot be ordered on
+   * the client the keys are chunked in the order given.
+   * @param[in] pool where connections are taken from
+   * @param[in] keys the row keys to fetch
+   * @param[in] col_parent the column family (and super column) to read
+   * @param[in] pred the slice to read from each row
+   * @param[in] level consistency level
+   * @param[in] chunk_size maximum number of keys per request
+   * @param[in] max_threads maximum number of requests in flight
+   * @return map from row key to the columns found in that row
+   */
+  std::map<std::string, std::vector<org::apache::cassandra::Column> >
+  multigetSlice(util::CassandraPool& pool,
+                const std::vector<std::string>& keys,
+                const org::apache::cassandra::ColumnParent& col_parent,
+                const org::apache::cassandra::SlicePredicate& pred,
+                org::apache::cassandra::ConsistencyLevel::type level,
+                uint32_t chunk_size,
+                uint32_t max_threads);
+
   /**
    * @return number of columns in a row or super column
    */
@@ -405,6 +711,52 @@ public:
                    const org::apache::cassandra::ColumnParent& col_parent,
                    const org::apache::cassandra::SlicePredicate& pred);
 
+  /**
+   * Count the columns in many rows. Keys are sent in chunks of
+   * chunk_size keys, one request per chunk, over this connection.
+   * @param[in] keys the row keys to count
+   * @param[in] col_parent the column family (and super column) to count in
+   * @param[in] pred the slice to count in each row
+   * @param[in] level consistency level
+   * @param[in] chunk_size maximum number of keys per request
+   * @return map from row key to number of columns
+   */
+  std::map<std::string, int32_t>
+  multigetCount(const std::vector<std::string>& keys,
+                const org::apache::cassandra::ColumnParent& col_parent,
+                const org::apache::cassandra::SlicePredicate& pred,
+                org::apache::cassandra::ConsistencyLevel::type level,
+                uint32_t chunk_size);
+
+  std::map<std::string, int32_t>
+  multigetCount(const std::vector<std::string>& keys,
+                const org::apache::cassandra::ColumnParent& col_parent,
+                const org::apache::cassandra::SlicePredicate& pred);
+
+  /**
+   * Count the columns in many rows. Keys are grouped and chunked as by
+   * the pooled multigetSlice, with the pool's cached ring, and the chunks
+   * are counted concurrently over pooled connections to the replicas,
+   * switched to this connection's keyspace. A chunk whose replica fails
+   * moves on to the other replicas as in multigetSlice.
+   * @param[in] pool where connections are taken from
+   * @param[in] keys the row keys to count
+   * @param[in] col_parent the column family (and super column) to count in
+   * @param[in] pred the slice to count in each row
+   * @param[in] level consistency level
+   * @param[in] chunk_size maximum number of keys per request
+   * @param[in] max_threads maximum number of requests in flight
+   * @return map from row key to number of columns
+   */
+  std::map<std::string, int32_t>
+  multigetCount(util::CassandraPool& pool,
+                const std::vector<std::string>& keys,
+                const org::apache::cassandra::ColumnParent& col_parent,
+                const org::apache::cassandra::SlicePredicate& pred,
+                org::apache::cassandra::ConsistencyLevel::type level,
+                uint32_t chunk_size,
+                uint32_t max_threads);
+
   /**
    * Create a keyspace
    * @param[in] ks_def object representing defintion for keyspace to create
@@ -479,6 +831,25 @@ public:
    */
   std::vector<org::apache::cassandra::TokenRange> describeRing(const std::string &keyspace);
 
+  /**
+   * @return class name of the partitioner used by the cluster
+   */
+  std::string describePartitioner();
+
+  /**
+   * Cut a token range into splits of roughly keys_per_split keys each,
+   * based on the data held by the node this connection talks to
+   * @param[in] cf_name the column family to split
+   * @param[in] start_token start of the token range
+   * @param[in] end_token end of the token range
+   * @param[in] keys_per_split approximate number of keys in each split
+   * @return the split boundaries, starting with start_token and ending with end_token
+   */
+  std::vector<std::string> describeSplits(const std::string &cf_name,
+                                          const std::string &start_token,
+                                          const std::string &end_token,
+                                          int32_t keys_per_split);
+
   /**
    * Inserts in the same call to cassandra a set of columns and supercolumns
    * @param[in] columns to insert
@@ -490,10 +861,164 @@ public:
 
   void batchInsert(const std::vector<ColumnInsertTuple> &columns,
                    const std::vector<SuperColumnInsertTuple> &super_columns); 
+
+  /**
+   * Inserts a set of columns and supercolumns, retrying on time outs and
+   * transport errors. The batch is encoded once and the same bytes are
+   * resent on every attempt.
+   * @param[in] columns to insert
+   * @param[in] super_columns to insert
+   * @param[in] level consistency level
+   * @param[in] policy how often and how long to back off between attempts
+   */
+  void batchInsert(const std::vector<ColumnInsertTuple> &columns,
+                   const std::vector<SuperColumnInsertTuple> &super_columns,
+                   org::apache::cassandra::ConsistencyLevel::type level,
+                   const RetryPolicy &policy);
+
+  /**
+   * Encode a set of columns and supercolumns as batch_mutate arguments
+   * @param[in] columns to insert
+   * @param[in] super_columns to insert
+   * @param[in] level consistency level
+   * @return the encoded batch, which may be sent through any connection
+   */
+  SerializedBatch serializeBatch(const std::vector<ColumnInsertTuple> &columns,
+                                 const std::vector<SuperColumnInsertTuple> &super_columns,
+                                 org::apache::cassandra::ConsistencyLevel::type level);
+
+  /**
+   * Send a previously encoded batch over this connection
+   * @param[in] batch the encoded batch_mutate arguments
+   */
+  void batchMutate(const SerializedBatch &batch);
+
+  /**
+   * Send a previously encoded batch over this connection, retrying on
+   * time outs and transport errors. The connection is re-opened after
+   * a transport error before the next attempt.
+   * @param[in] batch the encoded batch_mutate arguments
+   * @param[in] policy how often and how long to back off between attempts
+   */
+  void batchMutate(const SerializedBatch &batch, const RetryPolicy &policy);
+
+  /**
+   * Send a previously encoded batch, retrying on time outs and transport
+   * errors. After a transport error the same bytes are sent to another
+   * host of the pool; this connection is re-opened and used again only
+   * once every host of the pool has failed.
+   * @param[in] batch the encoded batch_mutate arguments
+   * @param[in] policy how often and how long to back off between attempts
+   * @param[in] pool where connections to other hosts are taken from
+   */
+  void batchMutate(const SerializedBatch &batch,
+                   const RetryPolicy &policy,
+                   util::CassandraPool &pool);
+
+  /**
+   * Close and re-open the underlying transport. The current keyspace is
+   * set again on the new connection; a previous login is not replayed.
+   */
+  void reconnect();
+
+  /**
+   * Serve getColumn, getSliceNames and getSliceRange from the given cache
+   * when possible. Rows written or removed through this object are
+   * dropped from the cache; writes from anywhere else are only bounded
+   * by the cache's staleness limit. The cache may be shared between
+   * connections.
+   * @param[in] cache the cache to use; an empty pointer disables caching
+   */
+  void setColumnCache(const std::tr1::shared_ptr<ColumnCache> &cache);
+
+  /**
+   * @return the cache attached to this connection, if any
+   */
+  std::tr1::shared_ptr<ColumnCache> getColumnCache() const;
+
+  /**
+   * Let getColumn, getSliceNames and getSliceRange share one request with
+   * identical reads (same keyspace, column family, key, path or predicate
+   * and consistency level) made at the same time through any connection
+   * using the same coalescer. A column cache, if attached, is consulted
+   * first.
+   * @param[in] coalescer the coalescer to use; an empty pointer disables it
+   */
+  void setRequestCoalescer(const std::tr1::shared_ptr<RequestCoalescer> &coalescer);
+
+  /**
+   * @return the coalescer attached to this connection, if any
+   */
+  std::tr1::shared_ptr<RequestCoalescer> getRequestCoalescer() const;
+
+  /**
+   * Compress the values of a column family on write and restore them on
+   * read. Values are tagged with the codec that wrote them, so existing
+   * uncompressed values keep reading correctly. The view results
+   * (getSliceView, getRangeSliceView) return values as stored. Codecs
+   * belong to a connection: every connection writing or reading the
+   * column family needs the same codec, which CassandraFactory and
+   * CassandraPool set on the connections they create. Encoded values
+   * are arbitrary bytes, so a codec may only be used on a column family
+   * whose default_validation_class and column_metadata validation
+   * classes are all BytesType; the server refuses anything else. With a
+   * schema cache set the column family is checked and an Exception is
+   * thrown if it is validated otherwise.
+   * @param[in] column_family column family the codec applies to
+   * @param[in] codec the codec to use; an empty pointer disables it
+   */
+  void setValueCodec(const std::string& column_family,
+                     const std::tr1::shared_ptr<ValueCodec> &codec);
+
+  /**
+   * @return the codecs of all column families that have one
+   */
+  const std::map<std::string, std::tr1::shared_ptr<ValueCodec> > &getValueCodecs() const;
+
+  /**
+   * Restore the values of columns read straight through getCassandra()
+   * with the column family's codec, if it has one
+   * @param[in] column_family column family the columns were read from
+   * @param[in,out] columns the columns as read
+   */
+  void decodeValues(const std::string& column_family,
+                    std::vector<org::apache::cassandra::ColumnOrSuperColumn> &columns) const;
+
+  /**
+   * Restore the values of rows read straight through getCassandra()
+   * with the column family's codec, if it has one
+   * @param[in] column_family column family the rows were read from
+   * @param[in,out] rows the rows as read
+   */
+  void decodeValues(const std::string& column_family,
+                    std::vector<org::apache::cassandra::KeySlice> &rows) const;
+
+  /**
+   * @return the codec used for the given column family, if any
+   */
+  std::tr1::shared_ptr<ValueCodec> getValueCodec(const std::string& column_family) const;
+
+  /**
+   * Answer keyspace lookups from a schema cache instead of asking the
+   * server, and check insertColumn, getColumn, tryGetColumn and
+   * getSuperColumn against the cached column family definitions before
+   * sending them; a request the server would refuse is thrown as an
+   * InvalidRequestException without a round trip. A column family the
+   * cache does not know makes it refresh once before the request is
+   * refused. The cache may be shared between connections.
+   * @param[in] cache the cache to use; an empty pointer disables it
+   */
+  void setSchemaCache(const std::tr1::shared_ptr<SchemaCache> &cache);
+
+  /**
+   * @return the schema cache attached to this connection, if any
+   */
+  std::tr1::shared_ptr<SchemaCache> getSchemaCache() const;
  
 private:
   /**
-   * Finds the given keyspace in the list of keyspace definitions
+   * Finds the given keyspace in the schema cache if there is one, or in
+   * the list of keyspace definitions otherwise
    * @return true if found; false otherwise
    */
   bool findKeyspace(const std::string& name);
@@ -506,15 +1031,128 @@ private:
   std::string current_keyspace;
   std::vector<KeyspaceDefinition> key_spaces;
   std::map<std::string, std::string> token_map;
+  std::tr1::shared_ptr<ColumnCache> column_cache;
+  std::tr1::shared_ptr<RequestCoalescer> request_coalescer;
+  std::map<std::string, std::tr1::shared_ptr<ValueCodec> > value_codecs;
+  std::tr1::shared_ptr<SchemaCache> schema_cache;
+
+  /**
+   * @return the validator of a column family of the current keyspace, or
+   *         an empty pointer without a schema cache; throws if the
+   *         column family does not exist. A cache invalidated by a
+   *         schema change is read again first.
+   */
+  std::tr1::shared_ptr<const RequestValidator> findValidator(const std::string& column_family);
+
+  /**
+   * Throw InvalidRequestException unless a prepared request's keyspace is
+   * empty or the one this connection uses
+   */
+  void checkPreparedKeyspace(const std::string& ks_name) const;
+
+  /**
+   * @return the value codec of a column family, or NULL
+   */
+  const ValueCodec *findValueCodec(const std::string& column_family) const;
+
+  /**
+   * Encode the column values of a batch with their column family's codec
+   */
+  void encodeMutations(SerializedBatch::MutationsMap& mutations) const;
+
+  /**
+   * Perform a read through the request coalescer, if there is one, and
+   * restore its values with the column family's value codec
+   */
+  void coalesce(const std::string& column_family,
+                const std::string& key,
+                const std::string& path,
+                org::apache::cassandra::ConsistencyLevel::type level,
+                RequestCoalescer::Fetch& fetch,
+                std::vector<org::apache::cassandra::Column>& result);
+
+  /**
+   * Read one column through the column cache and coalesce()
+   */
+  org::apache::cassandra::Column fetchColumn(const std::string& key,
+                                             const std::string& column_family,
+                                             const std::string& path,
+                                             org::apache::cassandra::ConsistencyLevel::type level,
+                                             RequestCoalescer::Fetch& fetch);
+
+  void coalesceFetch(const std::string& column_family,
+                     const std::string& key,
+                     const std::string& path,
+                     org::apache::cassandra::ConsistencyLevel::type level,
+                     RequestCoalescer::Fetch& fetch,
+                     std::vector<org::apache::cassandra::Column>& result);
+
+  /**
+   * Drop a row from the column cache after it was written to; also after
+   * a failed write, which may still have been applied
+   */
+  void invalidateRow(const std::string& key, const std::string& column_family);
+
+  /**
+   * Drop every row a batch writes to from the column cache
+   */
+  void invalidateRows(const SerializedBatch::MutationsMap& mutations);
+
+  void invalidateRows(const std::vector<std::pair<std::string, std::string> >& rows);
+
+  /**
+   * Make the schema cache read the definitions again after a schema change
+   */
+  void invalidateSchema();
+
+  /**
+   * Read a reply's message header, throwing if it is not the reply to method
+   */
+  void readReplyHeader(const std::string& method);
+
+  /**
+   * Read the header of a get_slice or get_range_slices reply
+   * @param[in] method name the reply has to carry
+   * @param[out] len number of bytes in the reply body
+   * @return the reply body, still held by the transport
+   */
+  const char *beginReply(const std::string& method, uint32_t &len);
+
+  /**
+   * Release a reply body obtained from beginReply
+   */
+  void endReply(uint32_t len);
+
+  /**
+   * Throw the exception carried by a get_slice or get_range_slices reply
+   */
+  void throwReplyError(const std::string& method, const std::string& body, bool range);
+
+  /**
+   * Receive a get_slice or get_range_slices reply into a result
+   */
+  void recvViews(const std::string& method, ColumnViewSet& result, bool range);
+
+  void recvViews(const std::string& method, ArenaSliceResult& result, bool range);
+
+  /**
+   * Receive a get_range_slices or get_indexed_slices reply one row at a
+   * time, restoring values with codec if given; exactly one of the
+   * visitors is given
+   */
+  void recvRows(const std::string& method,
+                const ValueCodec *codec,
+                RowVisitor *visitor,
+                SuperRowVisitor *super_visitor);
 
   Cassandra(const Cassandra&);
   Cassandra &operator=(const Cassandra&);
 
-  typedef std::map<std::string, 
-                   std::map<std::string, 
-                            std::vector<org::apache::cassandra::Mutation> 
-                           > 
-                  > MutationsMap;
+  typedef SerializedBatch::MutationsMap MutationsMap;
+
+  static void buildMutations(const std::vector<ColumnInsertTuple> &columns,
+                             const std::vector<SuperColumnInsertTuple> &super_columns,
+                             MutationsMap &mutations);
 
   static void addToMap(const ColumnInsertTuple &tuple, MutationsMap &mutations); 
 
@@ -9,6 +9,7 @@
 
 #include <string>
 #include <set>
+#include <map>
 #include <sstream>
 
 #include <protocol/TBinaryProtocol.h>
@@ -19,6 +20,8 @@
 
 #include "libcassandra/cassandra.h"
 #include "libcassandra/cassandra_factory.h"
+#include "libcassandra/value_codec.h"
+#include "libcassandra/util/framed_transport.h"
 
 using namespace libcassandra;
 using namespace std;
@@ -33,7 +36,8 @@ CassandraFactory::CassandraFactory(const string& server_list)
   :
     url(server_list),
     host(),
-    port(0)
+    port(0),
+    value_codecs()
 {
   /* get the host name from the server list string */
   string::size_type pos= server_list.find_first_of(':');
@@ -50,7 +54,8 @@ CassandraFactory::CassandraFactory(const string& in_host, int in_port)
   :
     url(),
     host(in_host),
-    port(in_port)
+    port(in_port),
+    value_codecs()
 {
   url.append(host);
   url.append(":");
@@ -67,6 +72,7 @@ tr1::shared_ptr<Cassandra> CassandraFactory::create()
 {
   CassandraClient *thrift_client= createThriftClient(host, port);
   tr1::shared_ptr<Cassandra> ret(new Cassandra(thrift_client, host, port));
+  configure(*ret);
   return ret;
 }
 
@@ -75,6 +81,7 @@ tr1::shared_ptr<Cassandra> CassandraFactory::create(const string& keyspace)
 {
   CassandraClient *thrift_client= createThriftClient(host, port);
   tr1::shared_ptr<Cassandra> ret(new Cassandra(thrift_client, host, port, keyspace));
+  configure(*ret);
   return ret;
 }
 
@@ -83,7 +90,8 @@ CassandraClient *CassandraFactory::createThriftClient(const string& in_host,
                                                       int in_port)
 {
   boost::shared_ptr<TTransport> socket(new TSocket(in_host, in_port));
-  boost::shared_ptr<TTransport> transport= boost::shared_ptr<TTransport>(new TFramedTransport(socket));
+  /* frame buffers come from a process wide pool and are handed back on close */
+  boost::shared_ptr<TTransport> transport= boost::shared_ptr<TTransport>(new util::PooledFramedTransport(socket));
   boost::shared_ptr<TProtocol> protocol(new TBinaryProtocol(transport));
   CassandraClient *client= new(std::nothrow) CassandraClient(protocol);
 
@@ -93,6 +101,43 @@ CassandraClient *CassandraFactory::createThriftClient(const string& in_host,
 }
 
 
+void CassandraFactory::setValueCodec(const string& column_family,
+                                     const tr1::shared_ptr<ValueCodec> &codec)
+{
+  if (codec)
+  {
+    value_codecs[column_family]= codec;
+  }
+  else
+  {
+    value_codecs.erase(column_family);
+  }
+}
+
+
+const map<string, tr1::shared_ptr<ValueCodec> > &CassandraFactory::getValueCodecs() const
+{
+  return value_codecs;
+}
+
+
+void CassandraFactory::setValueCodecs(const map<string, tr1::shared_ptr<ValueCodec> > &codecs)
+{
+  value_codecs= codecs;
+}
+
+
+void CassandraFactory::configure(Cassandra &client) const
+{
+  for (map<string, tr1::shared_ptr<ValueCodec> >::const_iterator it= value_codecs.begin();
+       it != value_codecs.end();
+       ++it)
+  {
+    client.setValueCodec(it->first, it->second);
+  }
+}
+
+
 const string &CassandraFactory::getURL() const
 {
   return url;
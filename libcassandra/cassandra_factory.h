@@ -12,6 +12,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <tr1/memory>
 
 namespace org 
@@ -31,6 +32,7 @@ namespace libcassandra
 {
 
 class Cassandra;
+class ValueCodec;
 
 class CassandraFactory
 {
@@ -52,6 +54,27 @@ public:
    */
   std::tr1::shared_ptr<Cassandra> create(const std::string& keyspace);
 
+  /**
+   * Set a value codec on every connection created from now on (see
+   * Cassandra::setValueCodec)
+   * @param[in] column_family column family the codec applies to
+   * @param[in] codec the codec to use; an empty pointer removes it
+   */
+  void setValueCodec(const std::string& column_family,
+                     const std::tr1::shared_ptr<ValueCodec> &codec);
+
+  /**
+   * @return the codecs set on the connections created
+   */
+  const std::map<std::string, std::tr1::shared_ptr<ValueCodec> > &getValueCodecs() const;
+
+  /**
+   * Set codecs on every connection created from now on, replacing those
+   * set before
+   * @param[in] codecs the codecs by column family
+   */
+  void setValueCodecs(const std::map<std::string, std::tr1::shared_ptr<ValueCodec> > &codecs);
+
   /**
    * @return port number associated with cassandra instances created
    */
@@ -72,12 +95,16 @@ private:
   org::apache::cassandra::CassandraClient *createThriftClient(const std::string& host,
                                                               int port);
 
+  void configure(Cassandra &client) const;
+
   std::string url;
 
   std::string host;
 
   int port;
 
+  std::map<std::string, std::tr1::shared_ptr<ValueCodec> > value_codecs;
+
 };
 
 } /* end namespace libcassandra */
@@ -0,0 +1,427 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <tr1/functional>
+#include <tr1/unordered_map>
+
+#include "libcassandra/column_cache.h"
+#include "libcassandra/util_functions.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+namespace
+{
+
+/* rough per entry cost of the list node, the two map nodes and the Entry */
+static const uint64_t ENTRY_OVERHEAD= 128;
+
+/*
+ * appends a length prefixed field so that keys made of several binary
+ * strings can not collide
+ */
+void appendField(string &out, const string &field)
+{
+  uint32_t len= static_cast<uint32_t>(field.size());
+  out.push_back(static_cast<char>((len >> 24) & 0xff));
+  out.push_back(static_cast<char>((len >> 16) & 0xff));
+  out.push_back(static_cast<char>((len >> 8) & 0xff));
+  out.push_back(static_cast<char>(len & 0xff));
+  out.append(field);
+}
+
+} /* end anonymous namespace */
+
+
+ColumnCache::Shard::Shard()
+  :
+    lru(),
+    entries(),
+    rows(),
+    size(0),
+    hits(0),
+    misses(0),
+    generations(GENERATION_SLOTS, 0),
+    lock()
+{}
+
+
+ColumnCache::ColumnCache(uint64_t in_max_bytes,
+                         uint32_t in_max_staleness_ms,
+                         uint32_t in_num_shards)
+  :
+    max_bytes(in_max_bytes),
+    max_staleness_ms(in_max_staleness_ms),
+    negative_ttl_ms(0),
+    ttl_lock(),
+    shards()
+{
+  uint32_t count= in_num_shards ? in_num_shards : 1;
+  shards.reserve(count);
+  for (uint32_t i= 0; i < count; ++i)
+  {
+    shards.push_back(new Shard());
+  }
+}
+
+
+ColumnCache::~ColumnCache()
+{
+  for (vector<Shard *>::iterator it= shards.begin();
+       it != shards.end();
+       ++it)
+  {
+    delete *it;
+  }
+}
+
+
+bool ColumnCache::get(const string& keyspace,
+                      const string& column_family,
+                      const string& key,
+                      const string& path,
+                      vector<Column>& columns)
+{
+  string row_key= rowKey(keyspace, column_family, key);
+  string cache_key(row_key);
+  appendField(cache_key, path);
+  Shard &shard= getShard(row_key);
+  util::ScopedLock guard(shard.lock);
+  tr1::unordered_map<string, EntryList::iterator>::iterator found= shard.entries.find(cache_key);
+  if (found == shard.entries.end())
+  {
+    ++shard.misses;
+    return false;
+  }
+  EntryList::iterator entry= found->second;
+  if (entry->expires_at <= createTimestamp())
+  {
+    erase(shard, entry);
+    ++shard.misses;
+    return false;
+  }
+  /* move to the front of the recency list */
+  shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+  columns= entry->columns;
+  ++shard.hits;
+  return true;
+}
+
+
+uint64_t ColumnCache::getGeneration(const string& keyspace,
+                                    const string& column_family,
+                                    const string& key)
+{
+  string row_key= rowKey(keyspace, column_family, key);
+  Shard &shard= getShard(row_key);
+  util::ScopedLock guard(shard.lock);
+  return shard.generations[getSlot(row_key)];
+}
+
+
+void ColumnCache::put(const string& keyspace,
+                      const string& column_family,
+                      const string& key,
+                      const string& path,
+                      const vector<Column>& columns,
+                      uint64_t generation)
+{
+  int64_t now= createTimestamp();
+  int64_t expires_at= now + static_cast<int64_t>(max_staleness_ms) * 1000;
+  uint64_t size= ENTRY_OVERHEAD;
+  for (vector<Column>::const_iterator it= columns.begin();
+       it != columns.end();
+       ++it)
+  {
+    /*
+     * a column with a TTL dies ttl seconds after it was written; the
+     * timestamp is taken as the write time in microseconds, which is what
+     * this library writes. Other timestamp units make the column expire
+     * at once (not cached) or fall back on the staleness bound.
+     */
+    if ((*it).__isset.ttl && (*it).ttl > 0)
+    {
+      expires_at= min(expires_at, (*it).timestamp + static_cast<int64_t>((*it).ttl) * 1000000);
+    }
+    size+= sizeof(Column) + (*it).name.size() + (*it).value.size();
+  }
+
+  string row_key= rowKey(keyspace, column_family, key);
+  string cache_key(row_key);
+  appendField(cache_key, path);
+  insert(row_key, cache_key, columns, expires_at, size, generation);
+}
+
+
+void ColumnCache::putAbsent(const string& keyspace,
+                            const string& column_family,
+                            const string& key,
+                            const string& path,
+                            uint64_t generation)
+{
+  uint32_t ttl_ms= min(getNegativeTtl(), max_staleness_ms);
+  if (ttl_ms == 0)
+  {
+    return;
+  }
+  string row_key= rowKey(keyspace, column_family, key);
+  string cache_key(row_key);
+  appendField(cache_key, path);
+  insert(row_key,
+         cache_key,
+         vector<Column>(),
+         createTimestamp() + static_cast<int64_t>(ttl_ms) * 1000,
+         ENTRY_OVERHEAD,
+         generation);
+}
+
+
+void ColumnCache::setNegativeTtl(uint32_t new_ttl_ms)
+{
+  util::ScopedLock guard(ttl_lock);
+  negative_ttl_ms= new_ttl_ms;
+}
+
+
+uint32_t ColumnCache::getNegativeTtl()
+{
+  util::ScopedLock guard(ttl_lock);
+  return negative_ttl_ms;
+}
+
+
+void ColumnCache::insert(const string& row_key,
+                         const string& cache_key,
+                         const vector<Column>& columns,
+                         int64_t expires_at,
+                         uint64_t size,
+                         uint64_t generation)
+{
+  size+= cache_key.size() * 2 + row_key.size();
+  Shard &shard= getShard(row_key);
+  uint64_t shard_budget= max_bytes / shards.size();
+  util::ScopedLock guard(shard.lock);
+  if (shard.generations[getSlot(row_key)] != generation)
+  {
+    /* the row was written while this result was being read */
+    return;
+  }
+  tr1::unordered_map<string, EntryList::iterator>::iterator found= shard.entries.find(cache_key);
+  if (found != shard.entries.end())
+  {
+    erase(shard, found->second);
+  }
+  if (expires_at <= createTimestamp() || size > shard_budget)
+  {
+    return;
+  }
+  while (shard.size + size > shard_budget && ! shard.lru.empty())
+  {
+    erase(shard, --shard.lru.end());
+  }
+
+  shard.lru.push_front(Entry());
+  Entry &entry= shard.lru.front();
+  entry.cache_key= cache_key;
+  entry.row_key= row_key;
+  entry.columns= columns;
+  entry.expires_at= expires_at;
+  entry.size= size;
+  shard.entries[cache_key]= shard.lru.begin();
+  shard.rows[row_key].push_back(cache_key);
+  shard.size+= size;
+}
+
+
+void ColumnCache::invalidate(const string& keyspace,
+                             const string& column_family,
+                             const string& key)
+{
+  string row_key= rowKey(keyspace, column_family, key);
+  Shard &shard= getShard(row_key);
+  util::ScopedLock guard(shard.lock);
+  ++shard.generations[getSlot(row_key)];
+  tr1::unordered_map<string, vector<string> >::iterator row= shard.rows.find(row_key);
+  if (row == shard.rows.end())
+  {
+    return;
+  }
+  vector<string> cache_keys;
+  cache_keys.swap(row->second);
+  shard.rows.erase(row);
+  for (vector<string>::iterator it= cache_keys.begin();
+       it != cache_keys.end();
+       ++it)
+  {
+    tr1::unordered_map<string, EntryList::iterator>::iterator found= shard.entries.find(*it);
+    if (found != shard.entries.end())
+    {
+      shard.size-= found->second->size;
+      shard.lru.erase(found->second);
+      shard.entries.erase(found);
+    }
+  }
+}
+
+
+void ColumnCache::clear()
+{
+  for (vector<Shard *>::iterator it= shards.begin();
+       it != shards.end();
+       ++it)
+  {
+    util::ScopedLock guard((*it)->lock);
+    (*it)->lru.clear();
+    (*it)->entries.clear();
+    (*it)->rows.clear();
+    (*it)->size= 0;
+    for (vector<uint64_t>::iterator gen= (*it)->generations.begin();
+         gen != (*it)->generations.end();
+         ++gen)
+    {
+      ++*gen;
+    }
+  }
+}
+
+
+uint64_t ColumnCache::getHits()
+{
+  uint64_t total= 0;
+  for (vector<Shard *>::iterator it= shards.begin();
+       it != shards.end();
+       ++it)
+  {
+    util::ScopedLock guard((*it)->lock);
+    total+= (*it)->hits;
+  }
+  return total;
+}
+
+
+uint64_t ColumnCache::getMisses()
+{
+  uint64_t total= 0;
+  for (vector<Shard *>::iterator it= shards.begin();
+       it != shards.end();
+       ++it)
+  {
+    util::ScopedLock guard((*it)->lock);
+    total+= (*it)->misses;
+  }
+  return total;
+}
+
+
+uint64_t ColumnCache::getSize()
+{
+  uint64_t total= 0;
+  for (vector<Shard *>::iterator it= shards.begin();
+       it != shards.end();
+       ++it)
+  {
+    util::ScopedLock guard((*it)->lock);
+    total+= (*it)->size;
+  }
+  return total;
+}
+
+
+string ColumnCache::pathKey(const string& super_column_name,
+                            const string& column_name)
+{
+  string ret("P");
+  appendField(ret, super_column_name);
+  appendField(ret, column_name);
+  return ret;
+}
+
+
+string ColumnCache::predicateKey(const ColumnParent& col_parent,
+                                 const SlicePredicate& pred)
+{
+  string ret("S");
+  appendField(ret, col_parent.super_column);
+  if (pred.__isset.column_names)
+  {
+    ret.push_back('N');
+    for (vector<string>::const_iterator it= pred.column_names.begin();
+         it != pred.column_names.end();
+         ++it)
+    {
+      appendField(ret, *it);
+    }
+  }
+  if (pred.__isset.slice_range)
+  {
+    ret.push_back('R');
+    appendField(ret, pred.slice_range.start);
+    appendField(ret, pred.slice_range.finish);
+    ret.push_back(pred.slice_range.reversed ? '1' : '0');
+    appendField(ret, serializeLong(pred.slice_range.count));
+  }
+  return ret;
+}
+
+
+string ColumnCache::rowKey(const string& keyspace,
+                           const string& column_family,
+                           const string& key)
+{
+  string ret;
+  ret.reserve(keyspace.size() + column_family.size() + key.size() + 12);
+  appendField(ret, keyspace);
+  appendField(ret, column_family);
+  appendField(ret, key);
+  return ret;
+}
+
+
+ColumnCache::Shard &ColumnCache::getShard(const string& row_key)
+{
+  tr1::hash<string> hasher;
+  return *shards[hasher(row_key) % shards.size()];
+}
+
+
+size_t ColumnCache::getSlot(const string& row_key) const
+{
+  /* the bits left over once the shard has been picked */
+  tr1::hash<string> hasher;
+  return (hasher(row_key) / shards.size()) % GENERATION_SLOTS;
+}
+
+
+void ColumnCache::erase(Shard &shard, EntryList::iterator entry)
+{
+  tr1::unordered_map<string, vector<string> >::iterator row= shard.rows.find(entry->row_key);
+  if (row != shard.rows.end())
+  {
+    vector<string> &cache_keys= row->second;
+    vector<string>::iterator pos= find(cache_keys.begin(), cache_keys.end(), entry->cache_key);
+    if (pos != cache_keys.end())
+    {
+      pos->swap(cache_keys.back());
+      cache_keys.pop_back();
+    }
+    if (cache_keys.empty())
+    {
+      shard.rows.erase(row);
+    }
+  }
+  shard.entries.erase(entry->cache_key);
+  shard.size-= entry->size;
+  shard.lru.erase(entry);
+}
@@ -0,0 +1,236 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_COLUMN_CACHE_H
+#define __LIBCASSANDRA_COLUMN_CACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <tr1/unordered_map>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/util/mutex.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class ColumnCache
+ * @brief
+ *   A client side, memory bounded LRU cache of read results, keyed by
+ *   keyspace, column family, row key and the column path or slice
+ *   predicate that was read. Entries expire after a configured maximum
+ *   staleness, or earlier when a cached column carries a TTL. The cache
+ *   is split in shards, each with its own lock; every entry of a row
+ *   lives in the same shard so a write can drop them all at once. A
+ *   write also moves the row's generation on, so that a read which was
+ *   in flight during the write does not cache what it saw before it.
+ */
+class ColumnCache
+{
+
+public:
+
+  static const uint32_t DEFAULT_SHARDS= 16;
+
+  /* rows of a shard share this many generation counters */
+  static const uint32_t GENERATION_SLOTS= 64;
+
+  /**
+   * @param[in] in_max_bytes approximate memory budget for all entries
+   * @param[in] in_max_staleness_ms how long an entry may be served for
+   * @param[in] in_num_shards number of independently locked shards
+   */
+  ColumnCache(uint64_t in_max_bytes,
+              uint32_t in_max_staleness_ms,
+              uint32_t in_num_shards);
+  ~ColumnCache();
+
+  /**
+   * Look up a cached read result
+   * @param[in] keyspace keyspace of the row
+   * @param[in] column_family column family of the row
+   * @param[in] key the row key
+   * @param[in] path encoded column path or predicate (see pathKey/predicateKey)
+   * @param[out] columns receives the cached columns on a hit; for a
+   *                     column path no columns means the column is known
+   *                     not to exist (see putAbsent)
+   * @return true on a hit; false otherwise
+   */
+  bool get(const std::string& keyspace,
+           const std::string& column_family,
+           const std::string& key,
+           const std::string& path,
+           std::vector<org::apache::cassandra::Column>& columns);
+
+  /**
+   * Take a row's generation before reading it from the server. Every
+   * invalidate of the row moves the generation on, so a result read
+   * across a write is not cached (see put).
+   * @param[in] keyspace keyspace of the row
+   * @param[in] column_family column family of the row
+   * @param[in] key the row key
+   * @return the row's current generation
+   */
+  uint64_t getGeneration(const std::string& keyspace,
+                         const std::string& column_family,
+                         const std::string& key);
+
+  /**
+   * Remember a read result. Nothing is stored if the row was invalidated
+   * since the generation was taken.
+   * @param[in] keyspace keyspace of the row
+   * @param[in] column_family column family of the row
+   * @param[in] key the row key
+   * @param[in] path encoded column path or predicate (see pathKey/predicateKey)
+   * @param[in] columns the columns that were read
+   * @param[in] generation the row's generation from before the read
+   */
+  void put(const std::string& keyspace,
+           const std::string& column_family,
+           const std::string& key,
+           const std::string& path,
+           const std::vector<org::apache::cassandra::Column>& columns,
+           uint64_t generation);
+
+  /**
+   * Remember that a column path does not exist. Nothing is stored unless
+   * a negative TTL has been set. A later get of the same path is a hit
+   * that returns no columns.
+   * @param[in] keyspace keyspace of the row
+   * @param[in] column_family column family of the row
+   * @param[in] key the row key
+   * @param[in] path encoded column path (see pathKey)
+   * @param[in] generation the row's generation from before the read
+   */
+  void putAbsent(const std::string& keyspace,
+                 const std::string& column_family,
+                 const std::string& key,
+                 const std::string& path,
+                 uint64_t generation);
+
+  /**
+   * @param[in] new_ttl_ms how long a missing column is remembered for;
+   *                       0 (the default) disables negative caching
+   */
+  void setNegativeTtl(uint32_t new_ttl_ms);
+
+  /**
+   * @return how long a missing column is remembered for
+   */
+  uint32_t getNegativeTtl();
+
+  /**
+   * Drop every cached entry for a row
+   * @param[in] keyspace keyspace of the row
+   * @param[in] column_family column family of the row
+   * @param[in] key the row key
+   */
+  void invalidate(const std::string& keyspace,
+                  const std::string& column_family,
+                  const std::string& key);
+
+  /**
+   * Drop every cached entry
+   */
+  void clear();
+
+  /**
+   * @return number of lookups answered from the cache
+   */
+  uint64_t getHits();
+
+  /**
+   * @return number of lookups not answered from the cache
+   */
+  uint64_t getMisses();
+
+  /**
+   * @return approximate number of bytes held by cached entries
+   */
+  uint64_t getSize();
+
+  /**
+   * @return cache path for a single column or super column
+   */
+  static std::string pathKey(const std::string& super_column_name,
+                             const std::string& column_name);
+
+  /**
+   * @return cache path for a slice of a row
+   */
+  static std::string predicateKey(const org::apache::cassandra::ColumnParent& col_parent,
+                                  const org::apache::cassandra::SlicePredicate& pred);
+
+private:
+
+  struct Entry
+  {
+    std::string cache_key;
+    std::string row_key;
+    std::vector<org::apache::cassandra::Column> columns;
+    int64_t expires_at;
+    uint64_t size;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  struct Shard
+  {
+    Shard();
+
+    EntryList lru;
+    std::tr1::unordered_map<std::string, EntryList::iterator> entries;
+    std::tr1::unordered_map<std::string, std::vector<std::string> > rows;
+    uint64_t size;
+    uint64_t hits;
+    uint64_t misses;
+    std::vector<uint64_t> generations;
+    util::Mutex lock;
+  };
+
+  static std::string rowKey(const std::string& keyspace,
+                            const std::string& column_family,
+                            const std::string& key);
+
+  Shard &getShard(const std::string& row_key);
+
+  /* index of the row's counter in its shard's generations */
+  size_t getSlot(const std::string& row_key) const;
+
+  void insert(const std::string& row_key,
+              const std::string& cache_key,
+              const std::vector<org::apache::cassandra::Column>& columns,
+              int64_t expires_at,
+              uint64_t size,
+              uint64_t generation);
+
+  void erase(Shard &shard, EntryList::iterator entry);
+
+  uint64_t max_bytes;
+
+  uint32_t max_staleness_ms;
+
+  uint32_t negative_ttl_ms;
+
+  /* guards negative_ttl_ms, which may change while other threads cache */
+  util::Mutex ttl_lock;
+
+  std::vector<Shard *> shards;
+
+  ColumnCache(const ColumnCache&);
+  ColumnCache &operator=(const ColumnCache&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_COLUMN_CACHE_H */
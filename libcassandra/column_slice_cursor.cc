@@ -0,0 +1,226 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include "libgenthrift/Cassandra.h"
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/column_slice_cursor.h"
+#include "libcassandra/util_functions.h"
+#include "libcassandra/util/parallel.h"
+#include "libcassandra/util/pool.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+ColumnSliceCursor::PageTask::PageTask(ColumnSliceCursor &in_cursor)
+  :
+    start_column(),
+    count(0),
+    columns(),
+    cursor(in_cursor)
+{}
+
+
+void ColumnSliceCursor::PageTask::run(Cassandra &client)
+{
+  SlicePredicate pred;
+  pred.slice_range.start.assign(start_column);
+  pred.slice_range.finish.assign(cursor.finish);
+  pred.slice_range.reversed= cursor.reversed;
+  pred.slice_range.count= count;
+  pred.__isset.slice_range= true;
+  client.getCassandra()->get_slice(columns,
+                                   cursor.key,
+                                   cursor.col_parent,
+                                   pred,
+                                   cursor.level);
+  client.decodeValues(cursor.col_parent.column_family, columns);
+}
+
+
+ColumnSliceCursor::ColumnSliceCursor(Cassandra &in_client,
+                                     const string& in_key,
+                                     const ColumnParent& in_col_parent,
+                                     const string& start,
+                                     const string& in_finish,
+                                     bool in_reversed,
+                                     int32_t in_page_size,
+                                     ConsistencyLevel::type in_level)
+  :
+    client(&in_client),
+    key(in_key),
+    col_parent(in_col_parent),
+    finish(in_finish),
+    reversed(in_reversed),
+    page_bytes(DEFAULT_PAGE_BYTES),
+    level(in_level),
+    prefetch(),
+    pending(*this),
+    current(),
+    position(0),
+    last_column(),
+    first_page(true),
+    exhausted(false),
+    retry_page(false)
+{
+  requestPage(start, in_page_size < 1 ? 1 : in_page_size);
+}
+
+
+ColumnSliceCursor::ColumnSliceCursor(util::CassandraPool &in_pool,
+                                     const string& keyspace,
+                                     const string& in_key,
+                                     const ColumnParent& in_col_parent,
+                                     const string& start,
+                                     const string& in_finish,
+                                     bool in_reversed,
+                                     int32_t in_page_size,
+                                     ConsistencyLevel::type in_level)
+  :
+    client(NULL),
+    key(in_key),
+    col_parent(in_col_parent),
+    finish(in_finish),
+    reversed(in_reversed),
+    page_bytes(DEFAULT_PAGE_BYTES),
+    level(in_level),
+    prefetch(new util::AsyncTask(in_pool, keyspace)),
+    pending(*this),
+    current(),
+    position(0),
+    last_column(),
+    first_page(true),
+    exhausted(false),
+    retry_page(false)
+{
+  requestPage(start, in_page_size < 1 ? 1 : in_page_size);
+}
+
+
+ColumnSliceCursor::~ColumnSliceCursor()
+{
+  /* the background fetch writes into pending so it must finish first */
+  prefetch.reset();
+}
+
+
+void ColumnSliceCursor::setPageBytes(uint32_t new_bytes)
+{
+  page_bytes= new_bytes;
+}
+
+
+uint32_t ColumnSliceCursor::getPageBytes() const
+{
+  return page_bytes;
+}
+
+
+bool ColumnSliceCursor::next(Column& col)
+{
+  while (position >= current.size())
+  {
+    if (exhausted)
+    {
+      return false;
+    }
+    takePage();
+  }
+  moveColumn(current[position++].column, col);
+  return true;
+}
+
+
+void ColumnSliceCursor::requestPage(const string& start, int32_t count)
+{
+  pending.start_column.assign(start);
+  pending.count= count;
+  pending.columns.clear();
+  if (prefetch)
+  {
+    prefetch->start(pending);
+  }
+}
+
+
+void ColumnSliceCursor::takePage()
+{
+  try
+  {
+    if (prefetch)
+    {
+      if (retry_page)
+      {
+        prefetch->start(pending);
+      }
+      prefetch->wait();
+    }
+    else
+    {
+      pending.run(*client);
+    }
+  }
+  catch (...)
+  {
+    /* keep the page's start so a later call reads it instead of ending early */
+    pending.columns.clear();
+    retry_page= true;
+    throw;
+  }
+  retry_page= false;
+  int32_t requested= pending.count;
+  current.swap(pending.columns);
+  pending.columns.clear();
+  position= 0;
+
+  /* a window after the first starts with the column that ended the last one */
+  if (! first_page && ! current.empty() && current.front().column.name == last_column)
+  {
+    position= 1;
+  }
+  first_page= false;
+
+  if (current.size() < static_cast<size_t>(requested))
+  {
+    exhausted= true;
+    return;
+  }
+  last_column= current.back().column.name;
+  if (! finish.empty() && last_column == finish)
+  {
+    exhausted= true;
+    return;
+  }
+
+  /* size the next window from the columns just seen */
+  uint64_t bytes= 0;
+  for (vector<ColumnOrSuperColumn>::iterator it= current.begin();
+       it != current.end();
+       ++it)
+  {
+    bytes+= (*it).column.name.size() + (*it).column.value.size();
+  }
+  uint64_t average= bytes / current.size();
+  uint64_t count= page_bytes / (average ? average : 1);
+  if (count < 1)
+  {
+    count= 1;
+  }
+  if (count > static_cast<uint64_t>(MAX_PAGE_SIZE))
+  {
+    count= MAX_PAGE_SIZE;
+  }
+  /* one extra column to make up for the repeated boundary column */
+  requestPage(last_column, static_cast<int32_t>(count) + 1);
+}
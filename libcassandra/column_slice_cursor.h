@@ -0,0 +1,175 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_COLUMN_SLICE_CURSOR_H
+#define __LIBCASSANDRA_COLUMN_SLICE_CURSOR_H
+
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/util/parallel.h"
+
+namespace libcassandra
+{
+
+class Cassandra;
+
+namespace util
+{
+class CassandraPool;
+}
+
+/**
+ * @class ColumnSliceCursor
+ * @brief
+ *   Walks the columns of a single (possibly very wide) row one
+ *   SliceRange window at a time, forwards or reversed. The last column
+ *   of a window starts the next one and is not returned twice. The
+ *   number of columns asked for is adjusted after every window so that
+ *   a window holds roughly a fixed number of bytes. When built on a
+ *   connection pool the next window is fetched in the background.
+ */
+class ColumnSliceCursor
+{
+
+public:
+
+  static const int32_t DEFAULT_PAGE_SIZE= 100;
+
+  static const int32_t MAX_PAGE_SIZE= 10000;
+
+  static const uint32_t DEFAULT_PAGE_BYTES= 1024 * 1024;
+
+  /**
+   * Page through the row synchronously on the given connection
+   * @param[in] in_client connection to use; must outlive the cursor
+   * @param[in] in_key the row key
+   * @param[in] in_col_parent column family (and super column) of the row
+   * @param[in] start first column name (empty for the first column)
+   * @param[in] in_finish last column name (empty for the last column)
+   * @param[in] in_reversed true to walk the columns in reverse order
+   * @param[in] in_page_size number of columns requested in the first window
+   * @param[in] in_level consistency level
+   */
+  ColumnSliceCursor(Cassandra &in_client,
+                    const std::string& in_key,
+                    const org::apache::cassandra::ColumnParent& in_col_parent,
+                    const std::string& start,
+                    const std::string& in_finish,
+                    bool in_reversed,
+                    int32_t in_page_size,
+                    org::apache::cassandra::ConsistencyLevel::type in_level);
+
+  /**
+   * Page through the row on pooled connections, reading one window ahead
+   * @param[in] in_pool where connections are taken from; must outlive the cursor
+   * @param[in] keyspace keyspace the row lives in
+   * @param[in] in_key the row key
+   * @param[in] in_col_parent column family (and super column) of the row
+   * @param[in] start first column name (empty for the first column)
+   * @param[in] in_finish last column name (empty for the last column)
+   * @param[in] in_reversed true to walk the columns in reverse order
+   * @param[in] in_page_size number of columns requested in the first window
+   * @param[in] in_level consistency level
+   */
+  ColumnSliceCursor(util::CassandraPool &in_pool,
+                    const std::string& keyspace,
+                    const std::string& in_key,
+                    const org::apache::cassandra::ColumnParent& in_col_parent,
+                    const std::string& start,
+                    const std::string& in_finish,
+                    bool in_reversed,
+                    int32_t in_page_size,
+                    org::apache::cassandra::ConsistencyLevel::type in_level);
+
+  ~ColumnSliceCursor();
+
+  /**
+   * @param[in] new_bytes number of bytes a window should roughly hold;
+   *                      applies to windows requested after this call
+   */
+  void setPageBytes(uint32_t new_bytes);
+
+  /**
+   * @return number of bytes a window should roughly hold
+   */
+  uint32_t getPageBytes() const;
+
+  /**
+   * Move to the next column in the row
+   * @param[out] col receives the column
+   * @return true if a column was returned; false once the row is exhausted
+   * @throw the error of a page that could not be read; the next call
+   *        asks for the same page again
+   */
+  bool next(org::apache::cassandra::Column& col);
+
+private:
+
+  /*
+   * fetches one window of columns starting at a given column name
+   */
+  class PageTask : public util::Task
+  {
+  public:
+    PageTask(ColumnSliceCursor &in_cursor);
+    void run(Cassandra &client);
+    std::string start_column;
+    int32_t count;
+    std::vector<org::apache::cassandra::ColumnOrSuperColumn> columns;
+  private:
+    ColumnSliceCursor &cursor;
+  };
+
+  void requestPage(const std::string& start, int32_t count);
+
+  void takePage();
+
+  Cassandra *client;
+
+  std::string key;
+
+  org::apache::cassandra::ColumnParent col_parent;
+
+  std::string finish;
+
+  bool reversed;
+
+  uint32_t page_bytes;
+
+  org::apache::cassandra::ConsistencyLevel::type level;
+
+  std::tr1::shared_ptr<util::AsyncTask> prefetch;
+
+  PageTask pending;
+
+  std::vector<org::apache::cassandra::ColumnOrSuperColumn> current;
+
+  size_t position;
+
+  std::string last_column;
+
+  bool first_page;
+
+  bool exhausted;
+
+  /* the last page could not be read and is asked for again */
+  bool retry_page;
+
+  ColumnSliceCursor(const ColumnSliceCursor&);
+  ColumnSliceCursor &operator=(const ColumnSliceCursor&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_COLUMN_SLICE_CURSOR_H */
@@ -0,0 +1,596 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <protocol/TProtocol.h>
+
+#include "libcassandra/column_view.h"
+#include "libcassandra/util/arena.h"
+#include "libcassandra/util/intern.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace apache::thrift::protocol;
+using namespace org::apache::cassandra;
+
+
+namespace
+{
+
+/* deeper nesting than this is not something cassandra sends */
+static const int MAX_DEPTH= 64;
+
+/*
+ * walks a binary protocol buffer; every read is bounds checked
+ */
+class Reader
+{
+
+public:
+
+  Reader(const char *in_pos, const char *in_end)
+    :
+      pos(in_pos),
+      end(in_end)
+  {}
+
+  int8_t readByte()
+  {
+    need(1);
+    return static_cast<int8_t>(*pos++);
+  }
+
+  int16_t readI16()
+  {
+    need(2);
+    const unsigned char *p= reinterpret_cast<const unsigned char *>(pos);
+    pos+= 2;
+    return static_cast<int16_t>((p[0] << 8) | p[1]);
+  }
+
+  int32_t readI32()
+  {
+    need(4);
+    const unsigned char *p= reinterpret_cast<const unsigned char *>(pos);
+    pos+= 4;
+    return static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 24) |
+                                (static_cast<uint32_t>(p[1]) << 16) |
+                                (static_cast<uint32_t>(p[2]) << 8) |
+                                static_cast<uint32_t>(p[3]));
+  }
+
+  int64_t readI64()
+  {
+    uint64_t high= static_cast<uint32_t>(readI32());
+    uint64_t low= static_cast<uint32_t>(readI32());
+    return static_cast<int64_t>((high << 32) | low);
+  }
+
+  uint32_t readSize()
+  {
+    int32_t size= readI32();
+    if (size < 0)
+    {
+      throw TProtocolException(TProtocolException::NEGATIVE_SIZE, "negative size in reply");
+    }
+    return static_cast<uint32_t>(size);
+  }
+
+  void readBinary(const char *&data, uint32_t &length)
+  {
+    length= readSize();
+    need(length);
+    data= pos;
+    pos+= length;
+  }
+
+  /* every element takes at least one byte, which bounds any reservation */
+  size_t remaining() const
+  {
+    return static_cast<size_t>(end - pos);
+  }
+
+  /* reads a field header; returns false at the end of a struct */
+  bool readField(TType &type, int16_t &id)
+  {
+    type= static_cast<TType>(readByte());
+    if (type == T_STOP)
+    {
+      return false;
+    }
+    id= readI16();
+    return true;
+  }
+
+  void skip(TType type, int depth)
+  {
+    if (depth > MAX_DEPTH)
+    {
+      throw TProtocolException(TProtocolException::INVALID_DATA, "reply nested too deep");
+    }
+    switch (type)
+    {
+    case T_BOOL:
+    case T_BYTE:
+      advance(1);
+      break;
+    case T_I16:
+      advance(2);
+      break;
+    case T_I32:
+      advance(4);
+      break;
+    case T_I64:
+    case T_DOUBLE:
+      advance(8);
+      break;
+    case T_STRING:
+      advance(readSize());
+      break;
+    case T_STRUCT:
+    {
+      TType field_type;
+      int16_t id;
+      while (readField(field_type, id))
+      {
+        skip(field_type, depth + 1);
+      }
+      break;
+    }
+    case T_MAP:
+    {
+      TType key_type= static_cast<TType>(readByte());
+      TType value_type= static_cast<TType>(readByte());
+      uint32_t size= readSize();
+      for (uint32_t i= 0; i < size; ++i)
+      {
+        skip(key_type, depth + 1);
+        skip(value_type, depth + 1);
+      }
+      break;
+    }
+    case T_SET:
+    case T_LIST:
+    {
+      TType elem_type= static_cast<TType>(readByte());
+      uint32_t size= readSize();
+      for (uint32_t i= 0; i < size; ++i)
+      {
+        skip(elem_type, depth + 1);
+      }
+      break;
+    }
+    default:
+      throw TProtocolException(TProtocolException::INVALID_DATA, "unknown type in reply");
+    }
+  }
+
+private:
+
+  void need(uint32_t count)
+  {
+    if (static_cast<uint32_t>(end - pos) < count)
+    {
+      throw TProtocolException(TProtocolException::INVALID_DATA, "truncated reply");
+    }
+  }
+
+  void advance(uint32_t count)
+  {
+    need(count);
+    pos+= count;
+  }
+
+  const char *pos;
+  const char *end;
+
+};
+
+
+/*
+ * leaves decoded strings where they are in the reply buffer
+ */
+class KeepInPlace
+{
+public:
+  void place(const char *&, uint32_t)
+  {}
+
+  void placeName(const char *&, uint32_t)
+  {}
+};
+
+
+/*
+ * copies decoded strings into an arena; column names are pointed at
+ * their interned copy instead when there is a name table. The last few
+ * names found are remembered so that a reply repeating the same names
+ * row after row goes to the table, and takes its shard lock, once per
+ * distinct name rather than once per column.
+ */
+class CopyToArena
+{
+public:
+  CopyToArena(util::Arena &in_arena, util::InternTable *in_names)
+    :
+      arena(in_arena),
+      names(in_names),
+      recent_count(0),
+      next_recent(0)
+  {}
+
+  void place(const char *&data, uint32_t length)
+  {
+    data= arena.copy(data, length);
+  }
+
+  void placeName(const char *&data, uint32_t length)
+  {
+    if (names == NULL)
+    {
+      data= arena.copy(data, length);
+      return;
+    }
+    for (size_t i= 0; i < recent_count; ++i)
+    {
+      const string &name= *recent[i];
+      if (name.size() == length && (length == 0 || memcmp(name.data(), data, length) == 0))
+      {
+        data= name.data();
+        return;
+      }
+    }
+    const string *interned= names->intern(data, length);
+    if (interned == NULL)
+    {
+      data= arena.copy(data, length);
+      return;
+    }
+    recent[next_recent]= interned;
+    next_recent= (next_recent + 1) % RECENT_NAMES;
+    if (recent_count < RECENT_NAMES)
+    {
+      ++recent_count;
+    }
+    data= interned->data();
+  }
+
+private:
+  static const size_t RECENT_NAMES= 8;
+
+  util::Arena &arena;
+  util::InternTable *names;
+  const string *recent[RECENT_NAMES];
+  size_t recent_count;
+  size_t next_recent;
+};
+
+
+/*
+ * Column { 1: binary name, 2: binary value, 3: i64 timestamp, 4: i32 ttl }
+ */
+template <class Store>
+void readColumn(Reader &reader, ColumnView &col, Store &store)
+{
+  col.name= NULL;
+  col.name_length= 0;
+  col.value= NULL;
+  col.value_length= 0;
+  col.timestamp= 0;
+  col.ttl= 0;
+  col.has_ttl= false;
+  TType type;
+  int16_t id;
+  while (reader.readField(type, id))
+  {
+    if (id == 1 && type == T_STRING)
+    {
+      reader.readBinary(col.name, col.name_length);
+      store.placeName(col.name, col.name_length);
+    }
+    else if (id == 2 && type == T_STRING)
+    {
+      reader.readBinary(col.value, col.value_length);
+      store.place(col.value, col.value_length);
+    }
+    else if (id == 3 && type == T_I64)
+    {
+      col.timestamp= reader.readI64();
+    }
+    else if (id == 4 && type == T_I32)
+    {
+      col.ttl= reader.readI32();
+      col.has_ttl= true;
+    }
+    else
+    {
+      reader.skip(type, 1);
+    }
+  }
+}
+
+
+/*
+ * list<ColumnOrSuperColumn>; only field 1 (column) is kept
+ */
+template <class Store>
+void readColumnList(Reader &reader, vector<ColumnView> &columns, Store &store)
+{
+  TType elem_type= static_cast<TType>(reader.readByte());
+  uint32_t size= reader.readSize();
+  if (elem_type != T_STRUCT)
+  {
+    for (uint32_t i= 0; i < size; ++i)
+    {
+      reader.skip(elem_type, 1);
+    }
+    return;
+  }
+  /* reserve for a get_slice result only; ranges grow geometrically */
+  if (columns.empty())
+  {
+    columns.reserve(min(static_cast<size_t>(size), reader.remaining()));
+  }
+  for (uint32_t i= 0; i < size; ++i)
+  {
+    TType type;
+    int16_t id;
+    while (reader.readField(type, id))
+    {
+      if (id == 1 && type == T_STRUCT)
+      {
+        ColumnView col;
+        readColumn(reader, col, store);
+        if (col.name_length > 0)
+        {
+          columns.push_back(col);
+        }
+      }
+      else
+      {
+        reader.skip(type, 1);
+      }
+    }
+  }
+}
+
+
+/*
+ * list<KeySlice>; KeySlice { 1: binary key, 2: list<ColumnOrSuperColumn> columns }
+ */
+template <class Store>
+void readKeySliceList(Reader &reader,
+                      vector<RowView> &rows,
+                      vector<ColumnView> &columns,
+                      Store &store)
+{
+  TType elem_type= static_cast<TType>(reader.readByte());
+  uint32_t size= reader.readSize();
+  if (elem_type != T_STRUCT)
+  {
+    for (uint32_t i= 0; i < size; ++i)
+    {
+      reader.skip(elem_type, 1);
+    }
+    return;
+  }
+  rows.reserve(min(static_cast<size_t>(size), reader.remaining()));
+  for (uint32_t i= 0; i < size; ++i)
+  {
+    RowView row;
+    row.key= NULL;
+    row.key_length= 0;
+    row.first_column= columns.size();
+    TType type;
+    int16_t id;
+    while (reader.readField(type, id))
+    {
+      if (id == 1 && type == T_STRING)
+      {
+        reader.readBinary(row.key, row.key_length);
+        store.place(row.key, row.key_length);
+      }
+      else if (id == 2 && type == T_LIST)
+      {
+        readColumnList(reader, columns, store);
+      }
+      else
+      {
+        reader.skip(type, 1);
+      }
+    }
+    row.column_count= columns.size() - row.first_column;
+    rows.push_back(row);
+  }
+}
+
+
+/*
+ * decodes the result struct of a reply: field 0 is the return value,
+ * any other field is one of the declared exceptions
+ */
+template <class Store>
+bool decodeReply(const char *data,
+                 size_t length,
+                 bool range,
+                 vector<RowView> &rows,
+                 vector<ColumnView> &columns,
+                 Store &store)
+{
+  Reader reader(data, data + length);
+  bool found= false;
+  TType type;
+  int16_t id;
+  while (reader.readField(type, id))
+  {
+    if (id == 0 && type == T_LIST)
+    {
+      if (range)
+      {
+        readKeySliceList(reader, rows, columns, store);
+      }
+      else
+      {
+        readColumnList(reader, columns, store);
+      }
+      found= true;
+    }
+    else if (id != 0)
+    {
+      return false;
+    }
+    else
+    {
+      reader.skip(type, 1);
+    }
+  }
+  return found;
+}
+
+} /* end anonymous namespace */
+
+
+Column ColumnView::toColumn() const
+{
+  Column ret;
+  ret.name.assign(name, name_length);
+  ret.value.assign(value, value_length);
+  ret.timestamp= timestamp;
+  ret.ttl= ttl;
+  ret.__isset.ttl= has_ttl;
+  return ret;
+}
+
+
+ColumnViewSet::ColumnViewSet()
+  :
+    buffer(),
+    columns(),
+    rows()
+{}
+
+
+bool ColumnViewSet::parse(const tr1::shared_ptr<string>& in_buffer, bool range)
+{
+  clear();
+  buffer= in_buffer;
+  KeepInPlace store;
+  if (! decodeReply(buffer->data(), buffer->size(), range, rows, columns, store))
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+
+void ColumnViewSet::clear()
+{
+  columns.clear();
+  rows.clear();
+  buffer.reset();
+}
+
+
+size_t ColumnViewSet::getColumnCount() const
+{
+  return columns.size();
+}
+
+
+const ColumnView &ColumnViewSet::getColumn(size_t index) const
+{
+  return columns[index];
+}
+
+
+size_t ColumnViewSet::getRowCount() const
+{
+  return rows.size();
+}
+
+
+const RowView &ColumnViewSet::getRow(size_t index) const
+{
+  return rows[index];
+}
+
+
+ArenaSliceResult::ArenaSliceResult(size_t block_size)
+  :
+    arena(block_size),
+    columns(),
+    rows(),
+    name_table()
+{}
+
+
+bool ArenaSliceResult::parse(const char *data, size_t length, bool range)
+{
+  clear();
+  CopyToArena store(arena, name_table.get());
+  if (! decodeReply(data, length, range, rows, columns, store))
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+
+void ArenaSliceResult::clear()
+{
+  /* the vectors and the arena keep their memory for the next query */
+  columns.clear();
+  rows.clear();
+  arena.reset();
+}
+
+
+size_t ArenaSliceResult::getColumnCount() const
+{
+  return columns.size();
+}
+
+
+const ColumnView &ArenaSliceResult::getColumn(size_t index) const
+{
+  return columns[index];
+}
+
+
+size_t ArenaSliceResult::getRowCount() const
+{
+  return rows.size();
+}
+
+
+const RowView &ArenaSliceResult::getRow(size_t index) const
+{
+  return rows[index];
+}
+
+
+void ArenaSliceResult::setNameTable(const tr1::shared_ptr<util::InternTable> &names)
+{
+  /* the current names may point into the old table */
+  clear();
+  name_table= names;
+}
+
+
+size_t ArenaSliceResult::getBytesUsed() const
+{
+  return arena.getUsed();
+}
@@ -0,0 +1,233 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_COLUMN_VIEW_H
+#define __LIBCASSANDRA_COLUMN_VIEW_H
+
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/util/arena.h"
+#include "libcassandra/util/intern.h"
+
+namespace libcassandra
+{
+
+/**
+ * A column whose name and value point into the storage of the result it
+ * came from (a ColumnViewSet or an ArenaSliceResult). It is only valid
+ * while that result is alive and unchanged.
+ */
+struct ColumnView
+{
+  const char *name;
+  uint32_t name_length;
+  const char *value;
+  uint32_t value_length;
+  int64_t timestamp;
+  int32_t ttl;
+  bool has_ttl;
+
+  /**
+   * @return a copy of the column name
+   */
+  std::string getName() const
+  {
+    return std::string(name, name_length);
+  }
+
+  /**
+   * @return a copy of the column value
+   */
+  std::string getValue() const
+  {
+    return std::string(value, value_length);
+  }
+
+  /**
+   * @return a thrift Column holding copies of the name and value
+   */
+  org::apache::cassandra::Column toColumn() const;
+};
+
+/**
+ * A row of a range result; its columns are the column_count entries of
+ * the set starting at first_column.
+ */
+struct RowView
+{
+  const char *key;
+  uint32_t key_length;
+  size_t first_column;
+  size_t column_count;
+
+  /**
+   * @return a copy of the row key
+   */
+  std::string getKey() const
+  {
+    return std::string(key, key_length);
+  }
+};
+
+/**
+ * @class ColumnViewSet
+ * @brief
+ *   The result of a get_slice or get_range_slices call decoded in place.
+ *   The body of the reply is kept in one reference counted buffer and
+ *   every key, name and value is a pointer and a length into it, so
+ *   decoding does no allocation per column. Copies of a set share the
+ *   buffer. Super columns are not decoded and are left out of the result.
+ */
+class ColumnViewSet
+{
+
+public:
+
+  ColumnViewSet();
+  ~ColumnViewSet() {}
+
+  /**
+   * Decode the body of a reply, i.e. the bytes following the message
+   * header. Any previous content is dropped.
+   * @param[in] in_buffer the reply body, encoded with the binary protocol
+   * @param[in] range true for a get_range_slices reply; false for get_slice
+   * @return true if the reply held a result; false if it held one of the
+   *         declared exceptions (or nothing), which the caller has to
+   *         decode itself
+   */
+  bool parse(const std::tr1::shared_ptr<std::string>& in_buffer, bool range);
+
+  /**
+   * Drop the content of this set
+   */
+  void clear();
+
+  /**
+   * @return number of columns over all rows
+   */
+  size_t getColumnCount() const;
+
+  /**
+   * @return the column at the given position
+   */
+  const ColumnView &getColumn(size_t index) const;
+
+  /**
+   * @return number of rows (0 for a get_slice result)
+   */
+  size_t getRowCount() const;
+
+  /**
+   * @return the row at the given position
+   */
+  const RowView &getRow(size_t index) const;
+
+private:
+
+  std::tr1::shared_ptr<std::string> buffer;
+
+  std::vector<ColumnView> columns;
+
+  std::vector<RowView> rows;
+
+};
+
+/**
+ * @class ArenaSliceResult
+ * @brief
+ *   The result of a get_slice or get_range_slices call with every key,
+ *   name and value copied into a bump arena owned by the result. The
+ *   strings are decoded straight out of the transport's buffer, and
+ *   clear() hands the arena and the index vectors back for reuse, so a
+ *   result object kept by a worker thread and reused for every query no
+ *   longer allocates once it has grown to the largest result. Super
+ *   columns are not decoded and are left out of the result.
+ */
+class ArenaSliceResult
+{
+
+public:
+
+  explicit ArenaSliceResult(size_t block_size= util::Arena::DEFAULT_BLOCK_SIZE);
+  ~ArenaSliceResult() {}
+
+  /**
+   * Decode the body of a reply, i.e. the bytes following the message
+   * header, copying the strings into the arena. Any previous content is
+   * dropped.
+   * @param[in] data the reply body, encoded with the binary protocol
+   * @param[in] length number of bytes in the body
+   * @param[in] range true for a get_range_slices reply; false for get_slice
+   * @return true if the reply held a result; false if it held one of the
+   *         declared exceptions (or nothing)
+   */
+  bool parse(const char *data, size_t length, bool range);
+
+  /**
+   * Drop the content of this result, keeping its memory for reuse
+   */
+  void clear();
+
+  /**
+   * @return number of columns over all rows
+   */
+  size_t getColumnCount() const;
+
+  /**
+   * @return the column at the given position
+   */
+  const ColumnView &getColumn(size_t index) const;
+
+  /**
+   * @return number of rows (0 for a get_slice result)
+   */
+  size_t getRowCount() const;
+
+  /**
+   * @return the row at the given position
+   */
+  const RowView &getRow(size_t index) const;
+
+  /**
+   * Point the column names of later results at their copies in a name
+   * table rather than copying them into the arena; names the table will
+   * not take are still copied. This is the only place names are
+   * interned. Pass an empty pointer to stop. The current content is
+   * dropped.
+   * @param[in] names the table to intern names in
+   */
+  void setNameTable(const std::tr1::shared_ptr<util::InternTable> &names);
+
+  /**
+   * @return number of arena bytes taken by keys, names and values
+   */
+  size_t getBytesUsed() const;
+
+private:
+
+  util::Arena arena;
+
+  std::vector<ColumnView> columns;
+
+  std::vector<RowView> rows;
+
+  std::tr1::shared_ptr<util::InternTable> name_table;
+
+  ArenaSliceResult(const ArenaSliceResult&);
+  ArenaSliceResult &operator=(const ArenaSliceResult&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_COLUMN_VIEW_H */
@@ -0,0 +1,153 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+
+#include "libcassandra/composite.h"
+#include "libcassandra/exception.h"
+#include "libcassandra/util_functions.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+namespace
+{
+
+/* two length bytes and the end-of-component byte */
+static const size_t COMPONENT_OVERHEAD= 3;
+
+} /* end anonymous namespace */
+
+
+CompositeBuilder::CompositeBuilder(string &in_buffer)
+  :
+    buffer(in_buffer),
+    components(0)
+{
+  buffer.clear();
+}
+
+
+CompositeBuilder &CompositeBuilder::add(const char *data, size_t length)
+{
+  if (length > 0xffff)
+  {
+    throw Exception("composite component longer than 65535 bytes", 0);
+  }
+  buffer.reserve(buffer.size() + length + COMPONENT_OVERHEAD);
+  buffer.push_back(static_cast<char>((length >> 8) & 0xff));
+  buffer.push_back(static_cast<char>(length & 0xff));
+  buffer.append(data, length);
+  buffer.push_back(static_cast<char>(EQUAL));
+  ++components;
+  return *this;
+}
+
+
+CompositeBuilder &CompositeBuilder::add(const string &value)
+{
+  return add(value.data(), value.size());
+}
+
+
+CompositeBuilder &CompositeBuilder::addLong(int64_t value)
+{
+  char raw[8];
+  encodeLong(value, raw);
+  return add(raw, 8);
+}
+
+
+CompositeBuilder &CompositeBuilder::setEndOfComponent(EndOfComponent eoc)
+{
+  if (! buffer.empty())
+  {
+    buffer[buffer.size() - 1]= static_cast<char>(eoc);
+  }
+  return *this;
+}
+
+
+void CompositeBuilder::clear()
+{
+  buffer.clear();
+  components= 0;
+}
+
+
+size_t CompositeBuilder::getComponentCount() const
+{
+  return components;
+}
+
+
+CompositeParser::CompositeParser(const char *in_data, size_t in_length)
+  :
+    pos(in_data),
+    end(in_data + in_length)
+{}
+
+
+CompositeParser::CompositeParser(const string &name)
+  :
+    pos(name.data()),
+    end(name.data() + name.size())
+{}
+
+
+bool CompositeParser::next(ComponentView &component)
+{
+  if (pos == end)
+  {
+    return false;
+  }
+  if (static_cast<size_t>(end - pos) < COMPONENT_OVERHEAD)
+  {
+    throw Exception("truncated composite name", 0);
+  }
+  const unsigned char *p= reinterpret_cast<const unsigned char *>(pos);
+  uint16_t length= static_cast<uint16_t>((p[0] << 8) | p[1]);
+  if (static_cast<size_t>(end - pos) < length + COMPONENT_OVERHEAD)
+  {
+    throw Exception("truncated composite name", 0);
+  }
+  component.data= pos + 2;
+  component.length= length;
+  component.end_of_component= static_cast<int8_t>(pos[2 + length]);
+  pos+= length + COMPONENT_OVERHEAD;
+  return true;
+}
+
+
+namespace libcassandra
+{
+
+void setCompositePrefixRange(const string &prefix, SliceRange &range)
+{
+  /* validates the prefix and finds where its last component ends */
+  CompositeParser parser(prefix);
+  ComponentView component;
+  size_t count= 0;
+  while (parser.next(component))
+  {
+    ++count;
+  }
+  range.start.assign(prefix);
+  range.finish.assign(prefix);
+  if (count > 0)
+  {
+    /* the prefix itself sorts first; GREATER sorts after every extension */
+    range.start[range.start.size() - 1]= static_cast<char>(CompositeBuilder::EQUAL);
+    range.finish[range.finish.size() - 1]= static_cast<char>(CompositeBuilder::GREATER);
+  }
+}
+
+} /* end namespace libcassandra */
@@ -0,0 +1,157 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_COMPOSITE_H
+#define __LIBCASSANDRA_COMPOSITE_H
+
+#include <string>
+
+#include "libgenthrift/cassandra_types.h"
+
+namespace libcassandra
+{
+
+/*
+ * A CompositeType name is a sequence of components, each encoded as a 2
+ * byte big-endian length, the component bytes and an end-of-component
+ * byte. The end-of-component byte of the last component of a slice bound
+ * says where the bound sorts relative to the names sharing its prefix.
+ */
+
+/**
+ * A component of a composite name; data points into the name it was
+ * parsed from and is only valid while that name is alive and unchanged.
+ */
+struct ComponentView
+{
+  const char *data;
+  uint16_t length;
+  int8_t end_of_component;
+
+  /**
+   * @return a copy of the component bytes
+   */
+  std::string getValue() const
+  {
+    return std::string(data, length);
+  }
+};
+
+/**
+ * @class CompositeBuilder
+ * @brief
+ *   Encodes a composite name into a caller supplied string. The string is
+ *   cleared but keeps its capacity, so building many names into the same
+ *   string does not allocate once it has grown.
+ *
+ *   CompositeBuilder builder(name);
+ *   builder.add(user_id).addLong(day);
+ */
+class CompositeBuilder
+{
+
+public:
+
+  enum EndOfComponent
+  {
+    LESS= -1,
+    EQUAL= 0,
+    GREATER= 1
+  };
+
+  explicit CompositeBuilder(std::string &in_buffer);
+  ~CompositeBuilder() {}
+
+  /**
+   * Append a component
+   * @param[in] data component bytes
+   * @param[in] length number of bytes; at most 65535
+   * @return this builder, so that components can be chained
+   */
+  CompositeBuilder &add(const char *data, size_t length);
+
+  CompositeBuilder &add(const std::string &value);
+
+  /**
+   * Append a LongType component
+   */
+  CompositeBuilder &addLong(int64_t value);
+
+  /**
+   * Set the end-of-component byte of the last component added
+   */
+  CompositeBuilder &setEndOfComponent(EndOfComponent eoc);
+
+  /**
+   * Start over with an empty name, keeping the buffer's memory
+   */
+  void clear();
+
+  /**
+   * @return number of components added
+   */
+  size_t getComponentCount() const;
+
+private:
+
+  std::string &buffer;
+
+  size_t components;
+
+  CompositeBuilder(const CompositeBuilder&);
+  CompositeBuilder &operator=(const CompositeBuilder&);
+
+};
+
+/**
+ * @class CompositeParser
+ * @brief
+ *   Walks the components of a composite name without copying them.
+ */
+class CompositeParser
+{
+
+public:
+
+  CompositeParser(const char *in_data, size_t in_length);
+
+  explicit CompositeParser(const std::string &name);
+
+  ~CompositeParser() {}
+
+  /**
+   * Move to the next component
+   * @param[out] component receives the component
+   * @return true if a component was returned; false at the end of the name
+   * @throw Exception if the name is not a valid composite
+   */
+  bool next(ComponentView &component);
+
+private:
+
+  const char *pos;
+
+  const char *end;
+
+};
+
+/**
+ * Set a slice range to cover every column whose name starts with the
+ * given components
+ * @param[in] prefix a composite name made of the leading components
+ * @param[out] range receives the start and finish; the count and
+ *                   reversed flag are left alone
+ * @throw Exception if prefix is not a valid composite
+ */
+void setCompositePrefixRange(const std::string &prefix,
+                             org::apache::cassandra::SliceRange &range);
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_COMPOSITE_H */
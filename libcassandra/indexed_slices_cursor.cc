@@ -0,0 +1,210 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include "libgenthrift/Cassandra.h"
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/indexed_slices_cursor.h"
+#include "libcassandra/indexed_slices_query.h"
+#include "libcassandra/util_functions.h"
+#include "libcassandra/util/parallel.h"
+#include "libcassandra/util/pool.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+IndexedSlicesCursor::PageTask::PageTask(IndexedSlicesCursor &in_cursor)
+  :
+    start_key(),
+    count(0),
+    rows(),
+    cursor(in_cursor)
+{}
+
+
+void IndexedSlicesCursor::PageTask::run(Cassandra &client)
+{
+  IndexClause clause(cursor.index_clause);
+  clause.start_key.assign(start_key);
+  clause.count= count;
+  client.getCassandra()->get_indexed_slices(rows,
+                                            cursor.col_parent,
+                                            clause,
+                                            cursor.pred,
+                                            cursor.level);
+  client.decodeValues(cursor.col_parent.column_family, rows);
+}
+
+
+IndexedSlicesCursor::IndexedSlicesCursor(Cassandra &in_client,
+                                         const IndexedSlicesQuery& query,
+                                         uint64_t in_limit)
+  :
+    client(&in_client),
+    col_parent(),
+    pred(createSlicePredicateObject(query)),
+    index_clause(query.getIndexClause()),
+    page_size(query.getRowCount() < 2 ? 2 : query.getRowCount()),
+    level(query.getConsistencyLevel()),
+    limit(in_limit),
+    returned(0),
+    prefetch(),
+    pending(*this),
+    current(),
+    position(0),
+    last_key(),
+    first_page(true),
+    exhausted(false),
+    retry_page(false)
+{
+  col_parent.column_family.assign(query.getColumnFamily());
+  requestPage(index_clause.start_key);
+}
+
+
+IndexedSlicesCursor::IndexedSlicesCursor(util::CassandraPool &in_pool,
+                                         const string& keyspace,
+                                         const IndexedSlicesQuery& query,
+                                         uint64_t in_limit)
+  :
+    client(NULL),
+    col_parent(),
+    pred(createSlicePredicateObject(query)),
+    index_clause(query.getIndexClause()),
+    page_size(query.getRowCount() < 2 ? 2 : query.getRowCount()),
+    level(query.getConsistencyLevel()),
+    limit(in_limit),
+    returned(0),
+    prefetch(new util::AsyncTask(in_pool, keyspace)),
+    pending(*this),
+    current(),
+    position(0),
+    last_key(),
+    first_page(true),
+    exhausted(false),
+    retry_page(false)
+{
+  col_parent.column_family.assign(query.getColumnFamily());
+  requestPage(index_clause.start_key);
+}
+
+
+IndexedSlicesCursor::~IndexedSlicesCursor()
+{
+  /* the background fetch writes into pending so it must finish first */
+  prefetch.reset();
+}
+
+
+bool IndexedSlicesCursor::next(Row& row)
+{
+  if (limit > 0 && returned >= limit)
+  {
+    return false;
+  }
+  while (position >= current.size())
+  {
+    if (exhausted)
+    {
+      return false;
+    }
+    takePage();
+  }
+  KeySlice &slice= current[position++];
+  row.first.swap(slice.key);
+  row.second.clear();
+  moveColumns(slice.columns, row.second);
+  ++returned;
+  return true;
+}
+
+
+uint64_t IndexedSlicesCursor::getReturned() const
+{
+  return returned;
+}
+
+
+void IndexedSlicesCursor::requestPage(const string& start)
+{
+  pending.start_key.assign(start);
+  pending.count= page_size;
+  if (limit > 0)
+  {
+    /* no point reading rows past the limit; later pages repeat one row */
+    uint64_t wanted= limit - returned + (first_page ? 0 : 1);
+    if (wanted < static_cast<uint64_t>(page_size))
+    {
+      pending.count= static_cast<int32_t>(wanted);
+    }
+  }
+  pending.rows.clear();
+  if (prefetch)
+  {
+    prefetch->start(pending);
+  }
+}
+
+
+void IndexedSlicesCursor::takePage()
+{
+  try
+  {
+    if (prefetch)
+    {
+      if (retry_page)
+      {
+        prefetch->start(pending);
+      }
+      prefetch->wait();
+    }
+    else
+    {
+      pending.run(*client);
+    }
+  }
+  catch (...)
+  {
+    /* keep the page's start so a later call reads it instead of ending early */
+    pending.rows.clear();
+    retry_page= true;
+    throw;
+  }
+  retry_page= false;
+  current.swap(pending.rows);
+  pending.rows.clear();
+  position= 0;
+
+  /* a page after the first starts with the row that ended the last one */
+  if (! first_page && ! current.empty() && current.front().key == last_key)
+  {
+    position= 1;
+  }
+  first_page= false;
+
+  if (current.size() < static_cast<size_t>(pending.count))
+  {
+    exhausted= true;
+    return;
+  }
+  uint64_t in_page= current.size() - position;
+  if (limit > 0 && returned + in_page >= limit)
+  {
+    exhausted= true;
+    return;
+  }
+  last_key= current.back().key;
+  /* start reading the next page while the caller works on this one */
+  requestPage(last_key);
+}
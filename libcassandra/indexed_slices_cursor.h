@@ -0,0 +1,150 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_INDEXED_SLICES_CURSOR_H
+#define __LIBCASSANDRA_INDEXED_SLICES_CURSOR_H
+
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/util/parallel.h"
+
+namespace libcassandra
+{
+
+class Cassandra;
+class IndexedSlicesQuery;
+
+namespace util
+{
+class CassandraPool;
+}
+
+/**
+ * @class IndexedSlicesCursor
+ * @brief
+ *   Walks the rows matching a secondary index query one page of
+ *   get_indexed_slices at a time. The query's row count is the page size;
+ *   the last key of a page becomes the start key of the next one and the
+ *   repeated row is skipped. When built on a connection pool, the next
+ *   page is fetched on a background connection while the caller consumes
+ *   the current one, so at most two pages are held in memory however many
+ *   rows match.
+ */
+class IndexedSlicesCursor
+{
+
+public:
+
+  typedef std::pair<std::string, std::vector<org::apache::cassandra::Column> > Row;
+
+  /**
+   * Page through the matching rows synchronously on the given connection
+   * @param[in] in_client connection to use; must outlive the cursor
+   * @param[in] query the index query; its row count is the page size (at least 2)
+   * @param[in] in_limit most rows to return (0 for no limit)
+   */
+  IndexedSlicesCursor(Cassandra &in_client,
+                      const IndexedSlicesQuery& query,
+                      uint64_t in_limit);
+
+  /**
+   * Page through the matching rows on pooled connections, reading one page ahead
+   * @param[in] in_pool where connections are taken from; must outlive the cursor
+   * @param[in] keyspace keyspace the column family lives in
+   * @param[in] query the index query; its row count is the page size (at least 2)
+   * @param[in] in_limit most rows to return (0 for no limit)
+   */
+  IndexedSlicesCursor(util::CassandraPool &in_pool,
+                      const std::string& keyspace,
+                      const IndexedSlicesQuery& query,
+                      uint64_t in_limit);
+
+  ~IndexedSlicesCursor();
+
+  /**
+   * Move to the next matching row
+   * @param[out] row receives the row key and its columns
+   * @return true if a row was returned; false once no rows are left or
+   *         the limit has been reached
+   * @throw the error of a page that could not be read; the next call
+   *        asks for the same page again
+   */
+  bool next(Row& row);
+
+  /**
+   * @return number of rows returned so far
+   */
+  uint64_t getReturned() const;
+
+private:
+
+  /*
+   * fetches one page of rows starting at a given key
+   */
+  class PageTask : public util::Task
+  {
+  public:
+    PageTask(IndexedSlicesCursor &in_cursor);
+    void run(Cassandra &client);
+    std::string start_key;
+    int32_t count;
+    std::vector<org::apache::cassandra::KeySlice> rows;
+  private:
+    IndexedSlicesCursor &cursor;
+  };
+
+  void requestPage(const std::string& start);
+
+  void takePage();
+
+  Cassandra *client;
+
+  org::apache::cassandra::ColumnParent col_parent;
+
+  org::apache::cassandra::SlicePredicate pred;
+
+  org::apache::cassandra::IndexClause index_clause;
+
+  int32_t page_size;
+
+  org::apache::cassandra::ConsistencyLevel::type level;
+
+  uint64_t limit;
+
+  uint64_t returned;
+
+  std::tr1::shared_ptr<util::AsyncTask> prefetch;
+
+  PageTask pending;
+
+  std::vector<org::apache::cassandra::KeySlice> current;
+
+  size_t position;
+
+  std::string last_key;
+
+  bool first_page;
+
+  bool exhausted;
+
+  /* the last page could not be read and is asked for again */
+  bool retry_page;
+
+  IndexedSlicesCursor(const IndexedSlicesCursor&);
+  IndexedSlicesCursor &operator=(const IndexedSlicesCursor&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_INDEXED_SLICES_CURSOR_H */
@@ -0,0 +1,354 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include "libgenthrift/Cassandra.h"
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/parallel_scan.h"
+#include "libcassandra/row_visitor.h"
+#include "libcassandra/token.h"
+#include "libcassandra/util_functions.h"
+#include "libcassandra/util/mutex.h"
+#include "libcassandra/util/parallel.h"
+#include "libcassandra/util/pool.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+namespace
+{
+
+/*
+ * reads the token ring and the partitioner in use
+ */
+class RingTask : public util::Task
+{
+
+public:
+
+  RingTask(const string &in_keyspace)
+    :
+      keyspace(in_keyspace),
+      ring(),
+      partitioner()
+  {}
+
+  void run(Cassandra &client)
+  {
+    ring= client.describeRing(keyspace);
+    partitioner= client.describePartitioner();
+  }
+
+  const string &keyspace;
+  vector<TokenRange> ring;
+  string partitioner;
+
+};
+
+
+/*
+ * cuts one token range into splits; describe_splits looks at the data
+ * held locally so it has to run on a replica of the range
+ */
+class SplitsTask : public util::Task
+{
+
+public:
+
+  SplitsTask(const TokenRange &in_range,
+             const string &in_column_family,
+             int32_t in_keys_per_split)
+    :
+      range(in_range),
+      column_family(in_column_family),
+      keys_per_split(in_keys_per_split),
+      tokens()
+  {}
+
+  string getHost() const
+  {
+    return range.endpoints.empty() ? string() : range.endpoints.front();
+  }
+
+  void run(Cassandra &client)
+  {
+    tokens= client.describeSplits(column_family,
+                                  range.start_token,
+                                  range.end_token,
+                                  keys_per_split);
+  }
+
+  TokenRange range;
+  string column_family;
+  int32_t keys_per_split;
+  vector<string> tokens;
+
+};
+
+
+/*
+ * state shared by every split of one scan
+ */
+struct ScanState
+{
+  ScanState(const ColumnParent &in_col_parent,
+            const SlicePredicate &in_pred,
+            const string &in_partitioner,
+            int32_t in_page_size,
+            ConsistencyLevel::type in_level,
+            RowVisitor &in_visitor)
+    :
+      col_parent(in_col_parent),
+      pred(in_pred),
+      partitioner(in_partitioner),
+      page_size(in_page_size),
+      level(in_level),
+      visitor(in_visitor),
+      stopped(false),
+      lock()
+  {}
+
+  bool isStopped()
+  {
+    util::ScopedLock guard(lock);
+    return stopped;
+  }
+
+  void stop()
+  {
+    util::ScopedLock guard(lock);
+    stopped= true;
+  }
+
+  const ColumnParent &col_parent;
+  const SlicePredicate &pred;
+  const string &partitioner;
+  int32_t page_size;
+  ConsistencyLevel::type level;
+  RowVisitor &visitor;
+  bool stopped;
+  util::Mutex lock;
+};
+
+
+/*
+ * pages through the rows of one split, by token
+ */
+class ScanSplitTask : public util::Task
+{
+
+public:
+
+  ScanSplitTask(ScanState &in_state,
+                const string &in_start_token,
+                const string &in_end_token,
+                const string &in_host)
+    :
+      state(in_state),
+      start_token(in_start_token),
+      end_token(in_end_token),
+      host(in_host)
+  {}
+
+  string getHost() const
+  {
+    return host;
+  }
+
+  void run(Cassandra &client)
+  {
+    KeyRange key_range;
+    key_range.start_token.assign(start_token);
+    key_range.end_token.assign(end_token);
+    key_range.count= state.page_size;
+    key_range.__isset.start_token= true;
+    key_range.__isset.end_token= true;
+    vector<KeySlice> key_slices;
+    vector<Column> columns;
+    while (! state.isStopped())
+    {
+      key_slices.clear();
+      client.getCassandra()->get_range_slices(key_slices,
+                                              state.col_parent,
+                                              state.pred,
+                                              key_range,
+                                              state.level);
+      client.decodeValues(state.col_parent.column_family, key_slices);
+      for (vector<KeySlice>::iterator it= key_slices.begin();
+           it != key_slices.end();
+           ++it)
+      {
+        columns.clear();
+        moveColumns((*it).columns, columns);
+        if (! state.visitor.visit((*it).key, columns))
+        {
+          state.stop();
+          return;
+        }
+      }
+      if (key_slices.size() < static_cast<size_t>(state.page_size))
+      {
+        return;
+      }
+      /* ranges are open at the start so the last row is not seen twice */
+      key_range.start_token= computeToken(state.partitioner, key_slices.back().key);
+      if (key_range.start_token == end_token)
+      {
+        return;
+      }
+    }
+  }
+
+private:
+
+  ScanState &state;
+  string start_token;
+  string end_token;
+  string host;
+
+};
+
+
+template <class TaskType>
+void runTaskList(util::CassandraPool &pool,
+                 vector<TaskType> &tasks,
+                 uint32_t max_threads,
+                 const string &keyspace)
+{
+  vector<util::Task *> work;
+  work.reserve(tasks.size());
+  for (typename vector<TaskType>::iterator it= tasks.begin();
+       it != tasks.end();
+       ++it)
+  {
+    work.push_back(&(*it));
+  }
+  util::runTasks(pool, work, max_threads, keyspace);
+}
+
+} /* end anonymous namespace */
+
+
+ParallelScan::ParallelScan(util::CassandraPool &in_pool,
+                           const string& in_keyspace,
+                           const ColumnParent& in_col_parent,
+                           const SlicePredicate& in_pred)
+  :
+    pool(in_pool),
+    keyspace(in_keyspace),
+    col_parent(in_col_parent),
+    pred(in_pred),
+    page_size(DEFAULT_PAGE_SIZE),
+    keys_per_split(DEFAULT_KEYS_PER_SPLIT),
+    max_threads(in_pool.getMaxSize()),
+    level(ConsistencyLevel::ONE)
+{}
+
+
+void ParallelScan::setPageSize(int32_t new_size)
+{
+  page_size= new_size;
+}
+
+
+int32_t ParallelScan::getPageSize() const
+{
+  return page_size;
+}
+
+
+void ParallelScan::setKeysPerSplit(int32_t new_count)
+{
+  keys_per_split= new_count;
+}
+
+
+int32_t ParallelScan::getKeysPerSplit() const
+{
+  return keys_per_split;
+}
+
+
+void ParallelScan::setMaxThreads(uint32_t new_max)
+{
+  max_threads= new_max;
+}
+
+
+uint32_t ParallelScan::getMaxThreads() const
+{
+  return max_threads;
+}
+
+
+void ParallelScan::setConsistencyLevel(ConsistencyLevel::type new_level)
+{
+  level= new_level;
+}
+
+
+ConsistencyLevel::type ParallelScan::getConsistencyLevel() const
+{
+  return level;
+}
+
+
+void ParallelScan::run(RowVisitor &visitor)
+{
+  vector<RingTask> ring_task(1, RingTask(keyspace));
+  runTaskList(pool, ring_task, 1, keyspace);
+  const vector<TokenRange> &ring= ring_task.front().ring;
+
+  vector<SplitsTask> splits_tasks;
+  splits_tasks.reserve(ring.size());
+  for (vector<TokenRange>::const_iterator it= ring.begin();
+       it != ring.end();
+       ++it)
+  {
+    splits_tasks.push_back(SplitsTask(*it, col_parent.column_family, keys_per_split));
+  }
+  runTaskList(pool, splits_tasks, max_threads, keyspace);
+
+  ScanState state(col_parent,
+                  pred,
+                  ring_task.front().partitioner,
+                  page_size,
+                  level,
+                  visitor);
+  vector<ScanSplitTask> scan_tasks;
+  for (vector<SplitsTask>::iterator it= splits_tasks.begin();
+       it != splits_tasks.end();
+       ++it)
+  {
+    const TokenRange &range= it->range;
+    vector<string> tokens= it->tokens;
+    if (tokens.size() < 2)
+    {
+      tokens.clear();
+      tokens.push_back(range.start_token);
+      tokens.push_back(range.end_token);
+    }
+    for (size_t i= 0; i + 1 < tokens.size(); ++i)
+    {
+      /* spread the splits of a range over all of its replicas */
+      string host;
+      if (! range.endpoints.empty())
+      {
+        host= range.endpoints[i % range.endpoints.size()];
+      }
+      scan_tasks.push_back(ScanSplitTask(state, tokens[i], tokens[i + 1], host));
+    }
+  }
+  runTaskList(pool, scan_tasks, max_threads, keyspace);
+}
@@ -0,0 +1,125 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_PARALLEL_SCAN_H
+#define __LIBCASSANDRA_PARALLEL_SCAN_H
+
+#include <string>
+#include <vector>
+
+#include "libgenthrift/cassandra_types.h"
+
+namespace libcassandra
+{
+
+class RowVisitor;
+
+namespace util
+{
+class CassandraPool;
+}
+
+/**
+ * @class ParallelScan
+ * @brief
+ *   Scans a whole column family in parallel. The token ring is read with
+ *   describe_ring, every token range is cut into splits with
+ *   describe_splits on one of its replicas, and each split is then paged
+ *   through by token on a pooled connection to a replica that owns it.
+ */
+class ParallelScan
+{
+
+public:
+
+  static const int32_t DEFAULT_PAGE_SIZE= 100;
+
+  static const int32_t DEFAULT_KEYS_PER_SPLIT= 65536;
+
+  ParallelScan(util::CassandraPool &in_pool,
+               const std::string& in_keyspace,
+               const org::apache::cassandra::ColumnParent& in_col_parent,
+               const org::apache::cassandra::SlicePredicate& in_pred);
+  ~ParallelScan() {}
+
+  /**
+   * @param[in] new_size number of rows requested per page
+   */
+  void setPageSize(int32_t new_size);
+
+  /**
+   * @return number of rows requested per page
+   */
+  int32_t getPageSize() const;
+
+  /**
+   * @param[in] new_count approximate number of keys in each split
+   */
+  void setKeysPerSplit(int32_t new_count);
+
+  /**
+   * @return approximate number of keys in each split
+   */
+  int32_t getKeysPerSplit() const;
+
+  /**
+   * @param[in] new_max maximum number of splits scanned at once
+   */
+  void setMaxThreads(uint32_t new_max);
+
+  /**
+   * @return maximum number of splits scanned at once
+   */
+  uint32_t getMaxThreads() const;
+
+  /**
+   * @param[in] new_level consistency level used for reads
+   */
+  void setConsistencyLevel(org::apache::cassandra::ConsistencyLevel::type new_level);
+
+  /**
+   * @return consistency level used for reads
+   */
+  org::apache::cassandra::ConsistencyLevel::type getConsistencyLevel() const;
+
+  /**
+   * Scan every row in the column family. The visitor is called from
+   * several threads at once and must synchronize any shared state. Rows
+   * are delivered in no particular order. If the visitor returns false
+   * no further pages are requested.
+   * @param[in] visitor receives each row
+   */
+  void run(RowVisitor &visitor);
+
+private:
+
+  util::CassandraPool &pool;
+
+  std::string keyspace;
+
+  org::apache::cassandra::ColumnParent col_parent;
+
+  org::apache::cassandra::SlicePredicate pred;
+
+  int32_t page_size;
+
+  int32_t keys_per_split;
+
+  uint32_t max_threads;
+
+  org::apache::cassandra::ConsistencyLevel::type level;
+
+  ParallelScan(const ParallelScan&);
+  ParallelScan &operator=(const ParallelScan&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_PARALLEL_SCAN_H */
@@ -0,0 +1,283 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+
+#include <protocol/TBinaryProtocol.h>
+#include <transport/TTransportUtils.h>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/column_cache.h"
+#include "libcassandra/prepared_request.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using namespace org::apache::cassandra;
+
+
+namespace
+{
+
+void writeBytes(TProtocol *protocol, const string& bytes)
+{
+  protocol->getTransport()->write(reinterpret_cast<const uint8_t *>(bytes.data()),
+                                  static_cast<uint32_t>(bytes.size()));
+}
+
+} /* end anonymous namespace */
+
+
+PreparedGet::PreparedGet()
+  :
+    column_family(),
+    super_column_name(),
+    column_name(),
+    level(ConsistencyLevel::QUORUM),
+    keyspace(),
+    cache_path(),
+    suffix()
+{}
+
+
+PreparedGet::PreparedGet(const string& in_column_family,
+                         const string& in_super_column_name,
+                         const string& in_column_name,
+                         ConsistencyLevel::type in_level)
+  :
+    column_family(in_column_family),
+    super_column_name(in_super_column_name),
+    column_name(in_column_name),
+    level(in_level),
+    keyspace(),
+    cache_path(ColumnCache::pathKey(in_super_column_name, in_column_name)),
+    suffix()
+{
+  ColumnPath col_path;
+  col_path.column_family.assign(column_family);
+  if (! super_column_name.empty())
+  {
+    col_path.super_column.assign(super_column_name);
+    col_path.__isset.super_column= true;
+  }
+  col_path.column.assign(column_name);
+  col_path.__isset.column= true;
+
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  /* the fields Cassandra_get_pargs::write puts after the key */
+  protocol.writeFieldBegin("column_path", T_STRUCT, 2);
+  col_path.write(&protocol);
+  protocol.writeFieldEnd();
+  protocol.writeFieldBegin("consistency_level", T_I32, 3);
+  protocol.writeI32(static_cast<int32_t>(level));
+  protocol.writeFieldEnd();
+  protocol.writeFieldStop();
+  protocol.writeStructEnd();
+  buffer->appendBufferToString(suffix);
+}
+
+
+void PreparedGet::write(TProtocol *protocol, const string& key) const
+{
+  protocol->writeStructBegin("Cassandra_get_pargs");
+  protocol->writeFieldBegin("key", T_STRING, 1);
+  protocol->writeBinary(key);
+  protocol->writeFieldEnd();
+  writeBytes(protocol, suffix);
+}
+
+
+const string& PreparedGet::getColumnFamily() const
+{
+  return column_family;
+}
+
+
+const string& PreparedGet::getSuperColumnName() const
+{
+  return super_column_name;
+}
+
+
+const string& PreparedGet::getColumnName() const
+{
+  return column_name;
+}
+
+
+ConsistencyLevel::type PreparedGet::getConsistencyLevel() const
+{
+  return level;
+}
+
+
+void PreparedGet::setKeyspace(const string& ks_name)
+{
+  keyspace.assign(ks_name);
+}
+
+
+const string& PreparedGet::getKeyspace() const
+{
+  return keyspace;
+}
+
+
+const string& PreparedGet::getCachePath() const
+{
+  return cache_path;
+}
+
+
+bool PreparedGet::empty() const
+{
+  return suffix.empty();
+}
+
+
+PreparedInsert::PreparedInsert()
+  :
+    column_family(),
+    super_column_name(),
+    column_name(),
+    level(ConsistencyLevel::QUORUM),
+    ttl(0),
+    keyspace(),
+    middle(),
+    trailer()
+{}
+
+
+PreparedInsert::PreparedInsert(const string& in_column_family,
+                               const string& in_super_column_name,
+                               const string& in_column_name,
+                               ConsistencyLevel::type in_level,
+                               int32_t in_ttl)
+  :
+    column_family(in_column_family),
+    super_column_name(in_super_column_name),
+    column_name(in_column_name),
+    level(in_level),
+    ttl(in_ttl),
+    keyspace(),
+    middle(),
+    trailer()
+{
+  ColumnParent col_parent;
+  col_parent.column_family.assign(column_family);
+  if (! super_column_name.empty())
+  {
+    col_parent.super_column.assign(super_column_name);
+    col_parent.__isset.super_column= true;
+  }
+
+  /*
+   * Cassandra_insert_pargs::write and Column::write split around the
+   * value and the timestamp, the only fields that change between calls
+   */
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  protocol.writeFieldBegin("column_parent", T_STRUCT, 2);
+  col_parent.write(&protocol);
+  protocol.writeFieldEnd();
+  protocol.writeFieldBegin("column", T_STRUCT, 3);
+  protocol.writeStructBegin("Column");
+  protocol.writeFieldBegin("name", T_STRING, 1);
+  protocol.writeBinary(column_name);
+  protocol.writeFieldEnd();
+  protocol.writeFieldBegin("value", T_STRING, 2);
+  buffer->appendBufferToString(middle);
+
+  buffer->resetBuffer();
+  protocol.writeFieldEnd();
+  if (ttl)
+  {
+    protocol.writeFieldBegin("ttl", T_I32, 4);
+    protocol.writeI32(ttl);
+    protocol.writeFieldEnd();
+  }
+  protocol.writeFieldStop();
+  protocol.writeStructEnd();
+  protocol.writeFieldEnd();
+  protocol.writeFieldBegin("consistency_level", T_I32, 4);
+  protocol.writeI32(static_cast<int32_t>(level));
+  protocol.writeFieldEnd();
+  protocol.writeFieldStop();
+  protocol.writeStructEnd();
+  buffer->appendBufferToString(trailer);
+}
+
+
+void PreparedInsert::write(TProtocol *protocol,
+                           const string& key,
+                           const string& value,
+                           int64_t timestamp) const
+{
+  protocol->writeStructBegin("Cassandra_insert_pargs");
+  protocol->writeFieldBegin("key", T_STRING, 1);
+  protocol->writeBinary(key);
+  protocol->writeFieldEnd();
+  writeBytes(protocol, middle);
+  protocol->writeBinary(value);
+  protocol->writeFieldEnd();
+  protocol->writeFieldBegin("timestamp", T_I64, 3);
+  protocol->writeI64(timestamp);
+  writeBytes(protocol, trailer);
+}
+
+
+const string& PreparedInsert::getColumnFamily() const
+{
+  return column_family;
+}
+
+
+const string& PreparedInsert::getSuperColumnName() const
+{
+  return super_column_name;
+}
+
+
+const string& PreparedInsert::getColumnName() const
+{
+  return column_name;
+}
+
+
+ConsistencyLevel::type PreparedInsert::getConsistencyLevel() const
+{
+  return level;
+}
+
+
+int32_t PreparedInsert::getTtl() const
+{
+  return ttl;
+}
+
+
+void PreparedInsert::setKeyspace(const string& ks_name)
+{
+  keyspace.assign(ks_name);
+}
+
+
+const string& PreparedInsert::getKeyspace() const
+{
+  return keyspace;
+}
+
+
+bool PreparedInsert::empty() const
+{
+  return middle.empty();
+}
@@ -0,0 +1,197 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_PREPARED_REQUEST_H
+#define __LIBCASSANDRA_PREPARED_REQUEST_H
+
+#include <stdint.h>
+#include <string>
+
+#include "libgenthrift/cassandra_types.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class PreparedGet
+ * @brief
+ *   A get of one column whose column family, column and consistency
+ *   level are fixed. Everything in the get arguments but the row key is
+ *   encoded with the binary protocol when the object is built, so a call
+ *   only writes the key and copies the stored bytes. Like SerializedBatch
+ *   the bytes do not depend on a connection; one object can be shared by
+ *   any number of connections and threads. Column family names are only
+ *   meaningful within a keyspace, though, so an object made by
+ *   Cassandra::prepareGet remembers the keyspace it was checked against
+ *   and is refused by connections using another one.
+ */
+class PreparedGet
+{
+
+public:
+
+  PreparedGet();
+
+  /**
+   * @param[in] column_family the column family read
+   * @param[in] super_column_name super column, or empty for none
+   * @param[in] column_name the column read
+   * @param[in] level consistency level of every read
+   */
+  PreparedGet(const std::string& column_family,
+              const std::string& super_column_name,
+              const std::string& column_name,
+              org::apache::cassandra::ConsistencyLevel::type level);
+  ~PreparedGet() {}
+
+  /**
+   * Write the arguments of a get call, as Cassandra_get_pargs::write does
+   * @param[in] protocol the binary protocol of the connection
+   * @param[in] key the row read
+   */
+  void write(apache::thrift::protocol::TProtocol *protocol, const std::string& key) const;
+
+  const std::string& getColumnFamily() const;
+
+  const std::string& getSuperColumnName() const;
+
+  const std::string& getColumnName() const;
+
+  org::apache::cassandra::ConsistencyLevel::type getConsistencyLevel() const;
+
+  /**
+   * @param[in] ks_name the keyspace the column family belongs to; empty
+   *            to allow any
+   */
+  void setKeyspace(const std::string& ks_name);
+
+  const std::string& getKeyspace() const;
+
+  /**
+   * @return the column's path as the column cache knows it
+   */
+  const std::string& getCachePath() const;
+
+  /**
+   * @return true if nothing has been prepared; false otherwise
+   */
+  bool empty() const;
+
+private:
+
+  std::string column_family;
+
+  std::string super_column_name;
+
+  std::string column_name;
+
+  org::apache::cassandra::ConsistencyLevel::type level;
+
+  std::string keyspace;
+
+  std::string cache_path;
+
+  /* the column_path and consistency_level fields and the struct's end */
+  std::string suffix;
+
+};
+
+
+/**
+ * @class PreparedInsert
+ * @brief
+ *   An insert into one column whose column family, column, consistency
+ *   level and time to live are fixed. The column parent and the column
+ *   name are encoded once; a call writes the row key, the value and the
+ *   timestamp between the stored bytes. The object may be shared by any
+ *   number of connections and threads that use the keyspace it was
+ *   prepared for (see PreparedGet).
+ */
+class PreparedInsert
+{
+
+public:
+
+  PreparedInsert();
+
+  /**
+   * @param[in] column_family the column family written
+   * @param[in] super_column_name super column, or empty for none
+   * @param[in] column_name the column written
+   * @param[in] level consistency level of every write
+   * @param[in] ttl time to live of the written values, 0 for none
+   */
+  PreparedInsert(const std::string& column_family,
+                 const std::string& super_column_name,
+                 const std::string& column_name,
+                 org::apache::cassandra::ConsistencyLevel::type level,
+                 int32_t ttl= 0);
+  ~PreparedInsert() {}
+
+  /**
+   * Write the arguments of an insert call, as Cassandra_insert_pargs::write
+   * does
+   * @param[in] protocol the binary protocol of the connection
+   * @param[in] key the row written
+   * @param[in] value the value, already encoded by any value codec
+   * @param[in] timestamp the column's timestamp
+   */
+  void write(apache::thrift::protocol::TProtocol *protocol,
+             const std::string& key,
+             const std::string& value,
+             int64_t timestamp) const;
+
+  const std::string& getColumnFamily() const;
+
+  const std::string& getSuperColumnName() const;
+
+  const std::string& getColumnName() const;
+
+  org::apache::cassandra::ConsistencyLevel::type getConsistencyLevel() const;
+
+  int32_t getTtl() const;
+
+  /**
+   * @param[in] ks_name the keyspace the column family belongs to; empty
+   *            to allow any
+   */
+  void setKeyspace(const std::string& ks_name);
+
+  const std::string& getKeyspace() const;
+
+  /**
+   * @return true if nothing has been prepared; false otherwise
+   */
+  bool empty() const;
+
+private:
+
+  std::string column_family;
+
+  std::string super_column_name;
+
+  std::string column_name;
+
+  org::apache::cassandra::ConsistencyLevel::type level;
+
+  int32_t ttl;
+
+  std::string keyspace;
+
+  /* from the column_parent field up to the header of the value field */
+  std::string middle;
+
+  /* the ttl, the ends of the column, the consistency_level field */
+  std::string trailer;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_PREPARED_REQUEST_H */
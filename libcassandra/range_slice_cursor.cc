@@ -0,0 +1,191 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include "libgenthrift/Cassandra.h"
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/range_slice_cursor.h"
+#include "libcassandra/util_functions.h"
+#include "libcassandra/util/parallel.h"
+#include "libcassandra/util/pool.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+RangeSliceCursor::PageTask::PageTask(RangeSliceCursor &in_cursor)
+  :
+    start_key(),
+    rows(),
+    cursor(in_cursor)
+{}
+
+
+void RangeSliceCursor::PageTask::run(Cassandra &client)
+{
+  KeyRange key_range;
+  key_range.start_key.assign(start_key);
+  key_range.end_key.assign(cursor.finish);
+  key_range.count= cursor.page_size;
+  key_range.__isset.start_key= true;
+  key_range.__isset.end_key= true;
+  client.getCassandra()->get_range_slices(rows,
+                                          cursor.col_parent,
+                                          cursor.pred,
+                                          key_range,
+                                          cursor.level);
+  client.decodeValues(cursor.col_parent.column_family, rows);
+}
+
+
+RangeSliceCursor::RangeSliceCursor(Cassandra &in_client,
+                                   const ColumnParent& in_col_parent,
+                                   const SlicePredicate& in_pred,
+                                   const string& start,
+                                   const string& in_finish,
+                                   int32_t in_page_size,
+                                   ConsistencyLevel::type in_level)
+  :
+    client(&in_client),
+    col_parent(in_col_parent),
+    pred(in_pred),
+    finish(in_finish),
+    page_size(in_page_size < 2 ? 2 : in_page_size),
+    level(in_level),
+    prefetch(),
+    pending(*this),
+    current(),
+    position(0),
+    last_key(),
+    first_page(true),
+    exhausted(false),
+    retry_page(false)
+{
+  requestPage(start);
+}
+
+
+RangeSliceCursor::RangeSliceCursor(util::CassandraPool &in_pool,
+                                   const string& keyspace,
+                                   const ColumnParent& in_col_parent,
+                                   const SlicePredicate& in_pred,
+                                   const string& start,
+                                   const string& in_finish,
+                                   int32_t in_page_size,
+                                   ConsistencyLevel::type in_level)
+  :
+    client(NULL),
+    col_parent(in_col_parent),
+    pred(in_pred),
+    finish(in_finish),
+    page_size(in_page_size < 2 ? 2 : in_page_size),
+    level(in_level),
+    prefetch(new util::AsyncTask(in_pool, keyspace)),
+    pending(*this),
+    current(),
+    position(0),
+    last_key(),
+    first_page(true),
+    exhausted(false),
+    retry_page(false)
+{
+  requestPage(start);
+}
+
+
+RangeSliceCursor::~RangeSliceCursor()
+{
+  /* the background fetch writes into pending so it must finish first */
+  prefetch.reset();
+}
+
+
+bool RangeSliceCursor::next(Row& row)
+{
+  while (position >= current.size())
+  {
+    if (exhausted)
+    {
+      return false;
+    }
+    takePage();
+  }
+  KeySlice &slice= current[position++];
+  row.first.swap(slice.key);
+  row.second.clear();
+  moveColumns(slice.columns, row.second);
+  return true;
+}
+
+
+void RangeSliceCursor::requestPage(const string& start)
+{
+  pending.start_key.assign(start);
+  pending.rows.clear();
+  if (prefetch)
+  {
+    prefetch->start(pending);
+  }
+}
+
+
+void RangeSliceCursor::takePage()
+{
+  try
+  {
+    if (prefetch)
+    {
+      if (retry_page)
+      {
+        prefetch->start(pending);
+      }
+      prefetch->wait();
+    }
+    else
+    {
+      pending.run(*client);
+    }
+  }
+  catch (...)
+  {
+    /* keep the page's start so a later call reads it instead of ending early */
+    pending.rows.clear();
+    retry_page= true;
+    throw;
+  }
+  retry_page= false;
+  current.swap(pending.rows);
+  pending.rows.clear();
+  position= 0;
+
+  /* a page after the first starts with the row that ended the last one */
+  if (! first_page && ! current.empty() && current.front().key == last_key)
+  {
+    position= 1;
+  }
+  first_page= false;
+
+  if (current.size() < static_cast<size_t>(page_size))
+  {
+    exhausted= true;
+    return;
+  }
+  last_key= current.back().key;
+  if (! finish.empty() && last_key == finish)
+  {
+    exhausted= true;
+    return;
+  }
+  /* start reading the next page while the caller works on this one */
+  requestPage(last_key);
+}
@@ -0,0 +1,154 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_RANGE_SLICE_CURSOR_H
+#define __LIBCASSANDRA_RANGE_SLICE_CURSOR_H
+
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/util/parallel.h"
+
+namespace libcassandra
+{
+
+class Cassandra;
+
+namespace util
+{
+class CassandraPool;
+}
+
+/**
+ * @class RangeSliceCursor
+ * @brief
+ *   Walks all the rows in a key range one page of get_range_slices at a
+ *   time. The last key of a page becomes the start of the next one and
+ *   the repeated row is skipped. When built on a connection pool, the
+ *   next page is fetched on a background connection while the caller
+ *   consumes the current one; at most two pages are held in memory.
+ */
+class RangeSliceCursor
+{
+
+public:
+
+  typedef std::pair<std::string, std::vector<org::apache::cassandra::Column> > Row;
+
+  static const int32_t DEFAULT_PAGE_SIZE= 100;
+
+  /**
+   * Page through the range synchronously on the given connection
+   * @param[in] in_client connection to use; must outlive the cursor
+   * @param[in] in_col_parent column family (and super column) to scan
+   * @param[in] in_pred the slice to read from each row
+   * @param[in] start first key of the range (empty for the beginning)
+   * @param[in] in_finish last key of the range (empty for the end)
+   * @param[in] in_page_size number of rows requested per page (at least 2)
+   * @param[in] in_level consistency level
+   */
+  RangeSliceCursor(Cassandra &in_client,
+                   const org::apache::cassandra::ColumnParent& in_col_parent,
+                   const org::apache::cassandra::SlicePredicate& in_pred,
+                   const std::string& start,
+                   const std::string& in_finish,
+                   int32_t in_page_size,
+                   org::apache::cassandra::ConsistencyLevel::type in_level);
+
+  /**
+   * Page through the range on pooled connections, reading one page ahead
+   * @param[in] in_pool where connections are taken from; must outlive the cursor
+   * @param[in] keyspace keyspace the range lives in
+   * @param[in] in_col_parent column family (and super column) to scan
+   * @param[in] in_pred the slice to read from each row
+   * @param[in] start first key of the range (empty for the beginning)
+   * @param[in] in_finish last key of the range (empty for the end)
+   * @param[in] in_page_size number of rows requested per page (at least 2)
+   * @param[in] in_level consistency level
+   */
+  RangeSliceCursor(util::CassandraPool &in_pool,
+                   const std::string& keyspace,
+                   const org::apache::cassandra::ColumnParent& in_col_parent,
+                   const org::apache::cassandra::SlicePredicate& in_pred,
+                   const std::string& start,
+                   const std::string& in_finish,
+                   int32_t in_page_size,
+                   org::apache::cassandra::ConsistencyLevel::type in_level);
+
+  ~RangeSliceCursor();
+
+  /**
+   * Move to the next row in the range
+   * @param[out] row receives the row key and its columns
+   * @return true if a row was returned; false once the range is exhausted
+   * @throw the error of a page that could not be read; the next call
+   *        asks for the same page again
+   */
+  bool next(Row& row);
+
+private:
+
+  /*
+   * fetches one page of rows starting at a given key
+   */
+  class PageTask : public util::Task
+  {
+  public:
+    PageTask(RangeSliceCursor &in_cursor);
+    void run(Cassandra &client);
+    std::string start_key;
+    std::vector<org::apache::cassandra::KeySlice> rows;
+  private:
+    RangeSliceCursor &cursor;
+  };
+
+  void requestPage(const std::string& start);
+
+  void takePage();
+
+  Cassandra *client;
+
+  org::apache::cassandra::ColumnParent col_parent;
+
+  org::apache::cassandra::SlicePredicate pred;
+
+  std::string finish;
+
+  int32_t page_size;
+
+  org::apache::cassandra::ConsistencyLevel::type level;
+
+  std::tr1::shared_ptr<util::AsyncTask> prefetch;
+
+  PageTask pending;
+
+  std::vector<org::apache::cassandra::KeySlice> current;
+
+  size_t position;
+
+  std::string last_key;
+
+  bool first_page;
+
+  bool exhausted;
+
+  /* the last page could not be read and is asked for again */
+  bool retry_page;
+
+  RangeSliceCursor(const RangeSliceCursor&);
+  RangeSliceCursor &operator=(const RangeSliceCursor&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_RANGE_SLICE_CURSOR_H */
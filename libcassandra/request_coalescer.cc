@@ -0,0 +1,138 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include "libcassandra/request_coalescer.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+RequestCoalescer::Flight::Flight()
+  :
+    result(),
+    error(),
+    done(false),
+    waiters(0),
+    finished()
+{}
+
+
+RequestCoalescer::RequestCoalescer()
+  :
+    lock(),
+    flights(),
+    coalesced(0),
+    issued(0)
+{}
+
+
+void RequestCoalescer::run(const string& request_key,
+                           Fetch& fetch,
+                           vector<Column>& result)
+{
+  tr1::shared_ptr<Flight> flight;
+  bool leader= false;
+  {
+    util::ScopedLock guard(lock);
+    tr1::unordered_map<string, tr1::shared_ptr<Flight> >::iterator it= flights.find(request_key);
+    if (it != flights.end())
+    {
+      flight= it->second;
+      ++flight->waiters;
+      ++coalesced;
+      while (! flight->done)
+      {
+        flight->finished.wait(lock);
+      }
+    }
+    else
+    {
+      flight.reset(new Flight());
+      flights[request_key]= flight;
+      leader= true;
+      ++issued;
+    }
+  }
+
+  if (! leader)
+  {
+    if (flight->error.isTransportError())
+    {
+      /* the leader's connection failed, which says nothing about this one */
+      fetch.fetch(result);
+      return;
+    }
+    /* the result no longer changes once done is set */
+    flight->error.rethrow();
+    result= flight->result;
+    return;
+  }
+
+  try
+  {
+    fetch.fetch(flight->result);
+  }
+  catch (...)
+  {
+    flight->error.capture();
+  }
+
+  bool shared;
+  {
+    util::ScopedLock guard(lock);
+    flight->done= true;
+    flights.erase(request_key);
+    shared= flight->waiters > 0;
+    flight->finished.broadcast();
+  }
+  flight->error.rethrow();
+  if (shared)
+  {
+    result= flight->result;
+  }
+  else
+  {
+    /* nobody joined and nobody can any more */
+    result.swap(flight->result);
+  }
+}
+
+
+uint64_t RequestCoalescer::getCoalesced()
+{
+  util::ScopedLock guard(lock);
+  return coalesced;
+}
+
+
+uint64_t RequestCoalescer::getIssued()
+{
+  util::ScopedLock guard(lock);
+  return issued;
+}
+
+
+string RequestCoalescer::requestKey(const string& keyspace,
+                                    const string& column_family,
+                                    const string& key,
+                                    const string& path,
+                                    ConsistencyLevel::type level)
+{
+  /* lengths up front keep keys made of different fields apart */
+  ostringstream ret;
+  ret << keyspace.size() << ':' << column_family.size() << ':'
+      << key.size() << ':' << path.size() << ':' << level << ':'
+      << keyspace << column_family << key << path;
+  return ret.str();
+}
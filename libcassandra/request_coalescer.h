@@ -0,0 +1,119 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_REQUEST_COALESCER_H
+#define __LIBCASSANDRA_REQUEST_COALESCER_H
+
+#include <string>
+#include <vector>
+#include <tr1/memory>
+#include <tr1/unordered_map>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/util/mutex.h"
+#include "libcassandra/util/parallel.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class RequestCoalescer
+ * @brief
+ *   Lets identical reads issued at the same time share one request. The
+ *   first caller for a given request key performs the read; callers that
+ *   arrive with the same key while it is in flight wait for it and get a
+ *   copy of its result, or the same exception (see util::TaskError). When
+ *   the first caller's connection fails with a transport error the others
+ *   perform the read on their own connections instead. A coalescer is
+ *   meant to be shared by all connections of a process (see
+ *   Cassandra::setRequestCoalescer).
+ *
+ *   A caller that joins a read may be answered by a request sent before
+ *   its own last write, so coalesced reads do not always see the
+ *   caller's writes. Reads that must should not go through a coalescer.
+ */
+class RequestCoalescer
+{
+
+public:
+
+  /**
+   * @class Fetch
+   * @brief the read to perform when no identical read is in flight
+   */
+  class Fetch
+  {
+  public:
+    virtual ~Fetch() {}
+    virtual void fetch(std::vector<org::apache::cassandra::Column>& result)= 0;
+  };
+
+  RequestCoalescer();
+  ~RequestCoalescer() {}
+
+  /**
+   * Perform a read, or join an identical one that is already in flight
+   * @param[in] request_key identifies the read (see requestKey)
+   * @param[in] fetch performs the read if this caller goes first, or
+   *            if the read it joined failed with a transport error
+   * @param[out] result receives the columns read
+   */
+  void run(const std::string& request_key,
+           Fetch& fetch,
+           std::vector<org::apache::cassandra::Column>& result);
+
+  /**
+   * @return number of calls answered by another caller's request
+   */
+  uint64_t getCoalesced();
+
+  /**
+   * @return number of requests actually performed
+   */
+  uint64_t getIssued();
+
+  /**
+   * @return a key identifying a read of the given path or predicate
+   */
+  static std::string requestKey(const std::string& keyspace,
+                                const std::string& column_family,
+                                const std::string& key,
+                                const std::string& path,
+                                org::apache::cassandra::ConsistencyLevel::type level);
+
+private:
+
+  struct Flight
+  {
+    Flight();
+
+    std::vector<org::apache::cassandra::Column> result;
+    util::TaskError error;
+    bool done;
+    uint32_t waiters;
+    util::Condition finished;
+  };
+
+  util::Mutex lock;
+
+  std::tr1::unordered_map<std::string, std::tr1::shared_ptr<Flight> > flights;
+
+  uint64_t coalesced;
+
+  uint64_t issued;
+
+  RequestCoalescer(const RequestCoalescer&);
+  RequestCoalescer &operator=(const RequestCoalescer&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_REQUEST_COALESCER_H */
@@ -0,0 +1,309 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/column_definition.h"
+#include "libcassandra/request_validator.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+const size_t RequestValidator::MAX_NAME_LENGTH;
+
+
+namespace
+{
+
+const char *checkUtf8(const unsigned char *data, size_t length)
+{
+  size_t i= 0;
+  while (i < length)
+  {
+    unsigned char c= data[i];
+    if (c < 0x80)
+    {
+      ++i;
+      continue;
+    }
+    size_t extra;
+    uint32_t min;
+    uint32_t code;
+    if ((c & 0xe0) == 0xc0)
+    {
+      extra= 1;
+      min= 0x80;
+      code= c & 0x1f;
+    }
+    else if ((c & 0xf0) == 0xe0)
+    {
+      extra= 2;
+      min= 0x800;
+      code= c & 0x0f;
+    }
+    else if ((c & 0xf8) == 0xf0)
+    {
+      extra= 3;
+      min= 0x10000;
+      code= c & 0x07;
+    }
+    else
+    {
+      return "String didn't validate.";
+    }
+    if (length - i <= extra)
+    {
+      return "String didn't validate.";
+    }
+    for (size_t j= 1; j <= extra; ++j)
+    {
+      if ((data[i + j] & 0xc0) != 0x80)
+      {
+        return "String didn't validate.";
+      }
+      code= (code << 6) | (data[i + j] & 0x3f);
+    }
+    /* overlong forms, surrogates and code points past the last plane */
+    if (code < min || (code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff)
+    {
+      return "String didn't validate.";
+    }
+    i+= extra + 1;
+  }
+  return NULL;
+}
+
+} /* end anonymous namespace */
+
+
+RequestValidator::RequestValidator(const ColumnFamilyDefinition& cf_def)
+  :
+    column_family(cf_def.getName()),
+    super(cf_def.isColumnTypeSet() && cf_def.getColumnType() == "Super"),
+    comparator(parseType(cf_def.getComparatorType())),
+    sub_comparator(parseType(cf_def.getSubComparatorType())),
+    default_validation(parseType(cf_def.getDefaultValidationClass())),
+    column_validation()
+{
+  vector<ColumnDefinition> metadata= cf_def.getColumnMetadata();
+  for (vector<ColumnDefinition>::iterator it= metadata.begin();
+       it != metadata.end();
+       ++it)
+  {
+    column_validation[it->getName()]= parseType(it->getValidationClass());
+  }
+}
+
+
+void RequestValidator::validatePath(const string& super_column_name,
+                                    const string& column_name) const
+{
+  if (! super)
+  {
+    if (! super_column_name.empty())
+    {
+      fail("supercolumn parameter is invalid for standard CF " + column_family);
+    }
+    if (column_name.empty())
+    {
+      fail("column parameter is not optional for standard CF " + column_family);
+    }
+    validateName(comparator, column_name, "column");
+    return;
+  }
+  if (super_column_name.empty())
+  {
+    fail("supercolumn parameter is not optional for super CF " + column_family);
+  }
+  validateName(comparator, super_column_name, "supercolumn");
+  if (! column_name.empty())
+  {
+    validateName(sub_comparator, column_name, "column");
+  }
+}
+
+
+void RequestValidator::validateInsertPath(const string& super_column_name,
+                                          const string& column_name) const
+{
+  if (column_name.empty())
+  {
+    fail("column name must not be empty");
+  }
+  validatePath(super_column_name, column_name);
+}
+
+
+void RequestValidator::validateValue(const string& column_name,
+                                     const string& value) const
+{
+  DataType type= default_validation;
+  if (! column_validation.empty())
+  {
+    tr1::unordered_map<string, DataType>::const_iterator it= column_validation.find(column_name);
+    if (it != column_validation.end())
+    {
+      type= it->second;
+    }
+  }
+  const char *reason= check(type, value.data(), value.size());
+  if (reason)
+  {
+    fail("value of column " + column_name + " is not valid: " + reason);
+  }
+}
+
+
+void RequestValidator::validateInsert(const string& super_column_name,
+                                      const string& column_name,
+                                      const string& value) const
+{
+  validateInsertPath(super_column_name, column_name);
+  validateValue(column_name, value);
+}
+
+
+bool RequestValidator::acceptsAnyValue() const
+{
+  if (default_validation != BYTES)
+  {
+    return false;
+  }
+  for (tr1::unordered_map<string, DataType>::const_iterator it= column_validation.begin();
+       it != column_validation.end();
+       ++it)
+  {
+    if (it->second != BYTES)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool RequestValidator::isSuper() const
+{
+  return super;
+}
+
+
+RequestValidator::DataType RequestValidator::parseType(const string& class_name)
+{
+  /* the short name is enough; the server accepts both forms */
+  string::size_type pos= class_name.find_last_of('.');
+  string name= pos == string::npos ? class_name : class_name.substr(pos + 1);
+  if (name == "AsciiType")
+  {
+    return ASCII;
+  }
+  if (name == "UTF8Type")
+  {
+    return UTF8;
+  }
+  if (name == "LongType")
+  {
+    return LONG;
+  }
+  if (name == "IntegerType")
+  {
+    return INTEGER;
+  }
+  if (name == "LexicalUUIDType")
+  {
+    return LEXICAL_UUID;
+  }
+  if (name == "TimeUUIDType")
+  {
+    return TIME_UUID;
+  }
+  return BYTES;
+}
+
+
+const char *RequestValidator::check(DataType type, const char *data, size_t length)
+{
+  const unsigned char *bytes= reinterpret_cast<const unsigned char *>(data);
+  switch (type)
+  {
+  case ASCII:
+    for (size_t i= 0; i < length; ++i)
+    {
+      if (bytes[i] > 0x7f)
+      {
+        return "Invalid byte for ascii";
+      }
+    }
+    return NULL;
+  case UTF8:
+    return checkUtf8(bytes, length);
+  case LONG:
+    if (length != 0 && length != 8)
+    {
+      return "Expected 8 or 0 byte long";
+    }
+    return NULL;
+  case LEXICAL_UUID:
+    if (length != 0 && length != 16)
+    {
+      return "UUIDs must be exactly 16 bytes";
+    }
+    return NULL;
+  case TIME_UUID:
+    if (length != 0 && length != 16)
+    {
+      return "UUIDs must be exactly 16 bytes";
+    }
+    if (length != 0 && (bytes[6] & 0xf0) != 0x10)
+    {
+      return "Invalid version for TimeUUID type.";
+    }
+    return NULL;
+  case BYTES:
+  case INTEGER:
+  default:
+    return NULL;
+  }
+}
+
+
+void RequestValidator::validateName(DataType type,
+                                    const string& name,
+                                    const char *what) const
+{
+  if (name.empty())
+  {
+    fail(string(what) + " name must not be empty");
+  }
+  if (name.size() > MAX_NAME_LENGTH)
+  {
+    fail(string(what) + " name length must not be greater than 65535");
+  }
+  const char *reason= check(type, name.data(), name.size());
+  if (reason)
+  {
+    fail(string(what) + " name is not valid for the comparator of " +
+         column_family + ": " + reason);
+  }
+}
+
+
+void RequestValidator::fail(const string& why) const
+{
+  InvalidRequestException ire;
+  ire.why= why;
+  throw ire;
+}
@@ -0,0 +1,141 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_REQUEST_VALIDATOR_H
+#define __LIBCASSANDRA_REQUEST_VALIDATOR_H
+
+#include <stddef.h>
+#include <string>
+#include <tr1/unordered_map>
+
+#include "libcassandra/column_family_definition.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class RequestValidator
+ * @brief
+ *   Checks requests against the definition of one column family the way
+ *   the server would, so that a malformed request fails on the client
+ *   without a round trip. The comparators and validation classes are
+ *   resolved once, when the validator is built; checking a request only
+ *   looks at the bytes of its names and value. Failures are thrown as
+ *   InvalidRequestException with the reason in why. Types the validator
+ *   does not know, such as custom comparators, accept anything and are
+ *   left for the server to check.
+ */
+class RequestValidator
+{
+
+public:
+
+  enum DataType
+  {
+    BYTES= 0,
+    ASCII,
+    UTF8,
+    LONG,
+    INTEGER,
+    LEXICAL_UUID,
+    TIME_UUID
+  };
+
+  /* longest column name the server accepts */
+  static const size_t MAX_NAME_LENGTH= 0xffff;
+
+  explicit RequestValidator(const ColumnFamilyDefinition& cf_def);
+  ~RequestValidator() {}
+
+  /**
+   * Check the target of a read or removal
+   * @param[in] super_column_name super column, or empty for none
+   * @param[in] column_name column, or empty to address a whole super
+   *            column
+   */
+  void validatePath(const std::string& super_column_name,
+                    const std::string& column_name) const;
+
+  /**
+   * Check the target of an insertion, which has to name a column
+   * @param[in] super_column_name super column, or empty for none
+   * @param[in] column_name the column
+   */
+  void validateInsertPath(const std::string& super_column_name,
+                          const std::string& column_name) const;
+
+  /**
+   * Check a value against the validation class of its column
+   * @param[in] column_name the column
+   * @param[in] value the value written
+   */
+  void validateValue(const std::string& column_name,
+                     const std::string& value) const;
+
+  /**
+   * Check an insertion; validateInsertPath and validateValue together
+   * @param[in] super_column_name super column, or empty for none
+   * @param[in] column_name the column
+   * @param[in] value the value written
+   */
+  void validateInsert(const std::string& super_column_name,
+                      const std::string& column_name,
+                      const std::string& value) const;
+
+  /**
+   * @return true if every value is valid, as when the default and all
+   *         column validation classes are BytesType
+   */
+  bool acceptsAnyValue() const;
+
+  /**
+   * @return true if the column family holds super columns
+   */
+  bool isSuper() const;
+
+  /**
+   * @return the type named by a comparator or validation class, with or
+   *         without its package; BYTES for types not known here
+   */
+  static DataType parseType(const std::string& class_name);
+
+  /**
+   * @param[in] type the type the bytes should hold
+   * @param[in] data the bytes
+   * @param[in] length number of bytes
+   * @return NULL if the bytes are valid; the reason otherwise
+   */
+  static const char *check(DataType type, const char *data, size_t length);
+
+private:
+
+  void validateName(DataType type,
+                    const std::string& name,
+                    const char *what) const;
+
+  void fail(const std::string& why) const;
+
+  std::string column_family;
+
+  bool super;
+
+  DataType comparator;
+
+  DataType sub_comparator;
+
+  DataType default_validation;
+
+  /* validation classes of the columns described by column_metadata */
+  std::tr1::unordered_map<std::string, DataType> column_validation;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_REQUEST_VALIDATOR_H */
@@ -0,0 +1,117 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libcassandra/retry_policy.h"
+
+using namespace libcassandra;
+
+
+RetryPolicy::RetryPolicy()
+  :
+    max_attempts(DEFAULT_MAX_ATTEMPTS),
+    initial_backoff_ms(DEFAULT_INITIAL_BACKOFF_MS),
+    max_backoff_ms(DEFAULT_MAX_BACKOFF_MS),
+    jitter(true)
+{}
+
+
+RetryPolicy::RetryPolicy(uint32_t in_max_attempts,
+                         uint32_t in_initial_backoff_ms,
+                         uint32_t in_max_backoff_ms)
+  :
+    max_attempts(in_max_attempts),
+    initial_backoff_ms(in_initial_backoff_ms),
+    max_backoff_ms(in_max_backoff_ms),
+    jitter(true)
+{}
+
+
+uint32_t RetryPolicy::getMaxAttempts() const
+{
+  return max_attempts;
+}
+
+
+void RetryPolicy::setMaxAttempts(uint32_t attempts)
+{
+  max_attempts= attempts;
+}
+
+
+uint32_t RetryPolicy::getInitialBackoff() const
+{
+  return initial_backoff_ms;
+}
+
+
+void RetryPolicy::setInitialBackoff(uint32_t backoff_ms)
+{
+  initial_backoff_ms= backoff_ms;
+}
+
+
+uint32_t RetryPolicy::getMaxBackoff() const
+{
+  return max_backoff_ms;
+}
+
+
+void RetryPolicy::setMaxBackoff(uint32_t backoff_ms)
+{
+  max_backoff_ms= backoff_ms;
+}
+
+
+bool RetryPolicy::isJitterEnabled() const
+{
+  return jitter;
+}
+
+
+void RetryPolicy::setJitter(bool enable)
+{
+  jitter= enable;
+}
+
+
+uint32_t RetryPolicy::getBackoff(uint32_t attempt, unsigned int *seed) const
+{
+  uint64_t ret= initial_backoff_ms;
+  for (uint32_t i= 1; i < attempt && ret < max_backoff_ms; ++i)
+  {
+    ret<<= 1;
+  }
+  if (ret > max_backoff_ms)
+  {
+    ret= max_backoff_ms;
+  }
+  if (jitter && ret > 1)
+  {
+    uint64_t half= ret / 2;
+    ret= half + (rand_r(seed) % (ret - half + 1));
+  }
+  return static_cast<uint32_t>(ret);
+}
+
+
+void RetryPolicy::backoff(uint32_t attempt, unsigned int *seed) const
+{
+  uint32_t wait_ms= getBackoff(attempt, seed);
+  struct timespec ts;
+  ts.tv_sec= wait_ms / 1000;
+  ts.tv_nsec= (wait_ms % 1000) * 1000000L;
+  while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+  {
+    /* interrupted by a signal; sleep for whatever is left */
+  }
+}
@@ -0,0 +1,113 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_RETRY_POLICY_H
+#define __LIBCASSANDRA_RETRY_POLICY_H
+
+#include <stdint.h>
+
+namespace libcassandra
+{
+
+/**
+ * @class RetryPolicy
+ * @brief
+ *   Describes how many times a failed request is re-attempted and how
+ *   long to back off between attempts. The back off grows exponentially
+ *   from the initial value up to the maximum and is jittered so that
+ *   many clients failing at once do not retry in lock step.
+ */
+class RetryPolicy
+{
+
+public:
+
+  static const uint32_t DEFAULT_MAX_ATTEMPTS= 3;
+
+  static const uint32_t DEFAULT_INITIAL_BACKOFF_MS= 10;
+
+  static const uint32_t DEFAULT_MAX_BACKOFF_MS= 1000;
+
+  RetryPolicy();
+  RetryPolicy(uint32_t in_max_attempts,
+              uint32_t in_initial_backoff_ms,
+              uint32_t in_max_backoff_ms);
+  ~RetryPolicy() {}
+
+  /**
+   * @return total number of attempts, including the first one
+   */
+  uint32_t getMaxAttempts() const;
+
+  /**
+   * @param[in] attempts total number of attempts, including the first one
+   */
+  void setMaxAttempts(uint32_t attempts);
+
+  /**
+   * @return back off in milli-seconds before the first retry
+   */
+  uint32_t getInitialBackoff() const;
+
+  /**
+   * @param[in] backoff_ms back off in milli-seconds before the first retry
+   */
+  void setInitialBackoff(uint32_t backoff_ms);
+
+  /**
+   * @return upper bound in milli-seconds for any single back off
+   */
+  uint32_t getMaxBackoff() const;
+
+  /**
+   * @param[in] backoff_ms upper bound in milli-seconds for any single back off
+   */
+  void setMaxBackoff(uint32_t backoff_ms);
+
+  /**
+   * @return true if back off values are randomized; false otherwise
+   */
+  bool isJitterEnabled() const;
+
+  /**
+   * @param[in] enable whether back off values should be randomized
+   */
+  void setJitter(bool enable);
+
+  /**
+   * Compute the back off to apply after the given failed attempt. With
+   * jitter enabled the result lies in [backoff / 2, backoff].
+   * @param[in] attempt number of attempts made so far (starting at 1)
+   * @param[in,out] seed state for rand_r; callers keep one per thread
+   * @return number of milli-seconds to wait before the next attempt
+   */
+  uint32_t getBackoff(uint32_t attempt, unsigned int *seed) const;
+
+  /**
+   * Sleep for the back off associated with the given failed attempt
+   * @param[in] attempt number of attempts made so far (starting at 1)
+   * @param[in,out] seed state for rand_r; callers keep one per thread
+   */
+  void backoff(uint32_t attempt, unsigned int *seed) const;
+
+private:
+
+  uint32_t max_attempts;
+
+  uint32_t initial_backoff_ms;
+
+  uint32_t max_backoff_ms;
+
+  bool jitter;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_RETRY_POLICY_H */
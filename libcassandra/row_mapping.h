@@ -0,0 +1,403 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_ROW_MAPPING_H
+#define __LIBCASSANDRA_ROW_MAPPING_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <tr1/tuple>
+
+#include "libgenthrift/cassandra_types.h"
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/column_view.h"
+#include "libcassandra/util_functions.h"
+
+namespace libcassandra
+{
+
+/*
+ * Codecs convert between a member type and the bytes stored in a column.
+ * A codec names the member type it handles as value_type and provides
+ *
+ *   static bool decode(const char *data, size_t length, value_type &out);
+ *   static void encode(const value_type &in, std::string &out);
+ *
+ * decode returns false when the bytes do not hold a valid value, in which
+ * case the member is left alone.
+ */
+
+/**
+ * Column value stored as is (BytesType, AsciiType, UTF8Type)
+ */
+struct StringCodec
+{
+  typedef std::string value_type;
+
+  static bool decode(const char *data, size_t length, std::string &out)
+  {
+    out.assign(data, length);
+    return true;
+  }
+
+  static void encode(const std::string &in, std::string &out)
+  {
+    out.assign(in);
+  }
+};
+
+/**
+ * 64 bit big-endian integer (LongType)
+ */
+struct LongCodec
+{
+  typedef int64_t value_type;
+
+  static bool decode(const char *data, size_t length, int64_t &out)
+  {
+    if (length != 8)
+    {
+      return false;
+    }
+    out= decodeLong(data);
+    return true;
+  }
+
+  static void encode(const int64_t &in, std::string &out)
+  {
+    out.resize(8);
+    encodeLong(in, &out[0]);
+  }
+};
+
+/**
+ * 32 bit big-endian integer
+ */
+struct IntCodec
+{
+  typedef int32_t value_type;
+
+  static bool decode(const char *data, size_t length, int32_t &out)
+  {
+    if (length != 4)
+    {
+      return false;
+    }
+    out= decodeInt(data);
+    return true;
+  }
+
+  static void encode(const int32_t &in, std::string &out)
+  {
+    out.resize(4);
+    encodeInt(in, &out[0]);
+  }
+};
+
+/**
+ * @class RowMapping
+ * @brief
+ *   Maps the columns of a row onto the members of a struct. Each field is
+ *   described once by its column name, the codec of its values and the
+ *   member, the last two as template arguments of add(). The mapping
+ *   keeps a table of the field names, sorted when the fields are added
+ *   (C++98 cannot sort them at compile time), each with a pointer to a
+ *   function instantiated for its codec and member, so decoding a column
+ *   is one indirect call that writes straight into the member. Since
+ *   Cassandra returns the columns of a slice in comparator order, matching
+ *   a row's columns is normally a single forward walk over the table with
+ *   no intermediate strings. Columns not described by the mapping are
+ *   ignored.
+ *
+ *   struct User { std::string name; int64_t born; };
+ *   RowMapping<User> mapping("users");
+ *   mapping.add<StringCodec, &User::name>("full_name")
+ *          .add<LongCodec, &User::born>("birth_date");
+ */
+template <class T>
+class RowMapping
+{
+
+public:
+
+  explicit RowMapping(const std::string& in_column_family)
+    :
+      column_family(in_column_family),
+      fields()
+  {}
+
+  ~RowMapping() {}
+
+  /**
+   * Describe one field; a field added with an existing name replaces it.
+   * Codec is the codec of the column's values and Member the member they
+   * are decoded into.
+   * @param[in] name the column name
+   * @return this mapping, so that fields can be chained
+   */
+  template <class Codec, typename Codec::value_type T::*Member>
+  RowMapping& add(const std::string& name)
+  {
+    Field field(name, &decodeField<Codec, Member>, &encodeField<Codec, Member>);
+    typename std::vector<Field>::iterator it=
+      std::lower_bound(fields.begin(), fields.end(), field, lessByName);
+    if (it != fields.end() && it->name == name)
+    {
+      *it= field;
+    }
+    else
+    {
+      fields.insert(it, field);
+    }
+    return *this;
+  }
+
+  /**
+   * @return the column family this mapping reads and writes
+   */
+  const std::string& getColumnFamily() const
+  {
+    return column_family;
+  }
+
+  /**
+   * @return the mapped column names, in byte order
+   */
+  std::vector<std::string> getColumnNames() const
+  {
+    std::vector<std::string> ret;
+    ret.reserve(fields.size());
+    for (size_t i= 0; i < fields.size(); ++i)
+    {
+      ret.push_back(fields[i].name);
+    }
+    return ret;
+  }
+
+  /**
+   * @return a predicate reading exactly the mapped columns
+   */
+  org::apache::cassandra::SlicePredicate getSlicePredicate() const
+  {
+    org::apache::cassandra::SlicePredicate ret;
+    ret.column_names= getColumnNames();
+    ret.__isset.column_names= true;
+    return ret;
+  }
+
+  /**
+   * Decode a row into a struct
+   * @param[in] columns the row's columns
+   * @param[out] out struct whose mapped members are set
+   * @return number of members set
+   */
+  size_t decode(const std::vector<org::apache::cassandra::Column>& columns, T& out) const
+  {
+    size_t hint= 0;
+    size_t ret= 0;
+    for (size_t i= 0; i < columns.size(); ++i)
+    {
+      const org::apache::cassandra::Column &col= columns[i];
+      if (decodeColumn(col.name.data(), col.name.size(),
+                       col.value.data(), col.value.size(),
+                       hint, out))
+      {
+        ++ret;
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * Decode the columns of a get_slice result held as views
+   * @param[in] result a ColumnViewSet or an ArenaSliceResult
+   * @param[out] out struct whose mapped members are set
+   * @return number of members set
+   */
+  template <class Result>
+  size_t decodeSlice(const Result& result, T& out) const
+  {
+    return decodeViews(result, 0, result.getColumnCount(), out);
+  }
+
+  /**
+   * Decode one row of a range result held as views
+   * @param[in] result a ColumnViewSet or an ArenaSliceResult
+   * @param[in] row a row of that result
+   * @param[out] out struct whose mapped members are set
+   * @return number of members set
+   */
+  template <class Result>
+  size_t decodeRow(const Result& result, const RowView& row, T& out) const
+  {
+    return decodeViews(result, row.first_column, row.column_count, out);
+  }
+
+  /**
+   * Encode a struct as one insertion per mapped field
+   * @param[in] key the row key
+   * @param[in] in struct to encode
+   * @param[out] out vector the insertions are appended to
+   */
+  void encode(const std::string& key,
+              const T& in,
+              std::vector<Cassandra::ColumnInsertTuple>& out) const
+  {
+    out.reserve(out.size() + fields.size());
+    for (size_t i= 0; i < fields.size(); ++i)
+    {
+      out.push_back(Cassandra::ColumnInsertTuple());
+      Cassandra::ColumnInsertTuple &tuple= out.back();
+      std::tr1::get<0>(tuple).assign(column_family);
+      std::tr1::get<1>(tuple).assign(key);
+      std::tr1::get<2>(tuple).assign(fields[i].name);
+      fields[i].encode(in, std::tr1::get<3>(tuple));
+    }
+  }
+
+private:
+
+  typedef bool (*DecodeFunction)(const char *data, size_t length, T& out);
+  typedef void (*EncodeFunction)(const T& in, std::string& out);
+
+  struct Field
+  {
+    Field(const std::string& in_name, DecodeFunction in_decode, EncodeFunction in_encode)
+      :
+        name(in_name),
+        decode(in_decode),
+        encode(in_encode)
+    {}
+    std::string name;
+    DecodeFunction decode;
+    EncodeFunction encode;
+  };
+
+  template <class Codec, typename Codec::value_type T::*Member>
+  static bool decodeField(const char *data, size_t length, T& out)
+  {
+    return Codec::decode(data, length, out.*Member);
+  }
+
+  template <class Codec, typename Codec::value_type T::*Member>
+  static void encodeField(const T& in, std::string& out)
+  {
+    Codec::encode(in.*Member, out);
+  }
+
+  static bool lessByName(const Field& a, const Field& b)
+  {
+    return a.name < b.name;
+  }
+
+  /* orders a field name against raw column name bytes, like std::string::compare */
+  static int compareName(const std::string& field_name, const char *name, size_t length)
+  {
+    size_t common= std::min(field_name.size(), length);
+    int ret= common ? std::memcmp(field_name.data(), name, common) : 0;
+    if (ret != 0)
+    {
+      return ret;
+    }
+    if (field_name.size() < length)
+    {
+      return -1;
+    }
+    return field_name.size() > length ? 1 : 0;
+  }
+
+  /*
+   * finds the field for a column name; hint is where the previous column
+   * matched, so columns arriving in order are found by a forward walk
+   */
+  const Field *findField(const char *name, size_t length, size_t& hint) const
+  {
+    while (hint < fields.size())
+    {
+      int cmp= compareName(fields[hint].name, name, length);
+      if (cmp == 0)
+      {
+        return &fields[hint++];
+      }
+      if (cmp > 0)
+      {
+        break;
+      }
+      ++hint;
+    }
+    if (hint == 0 || compareName(fields[hint - 1].name, name, length) < 0)
+    {
+      /* the name sorts between two neighbouring fields, so it is not mapped */
+      return NULL;
+    }
+    /* out of order (a non byte order comparator); search all fields */
+    size_t low= 0;
+    size_t high= fields.size();
+    while (low < high)
+    {
+      size_t mid= low + (high - low) / 2;
+      int cmp= compareName(fields[mid].name, name, length);
+      if (cmp == 0)
+      {
+        hint= mid + 1;
+        return &fields[mid];
+      }
+      if (cmp < 0)
+      {
+        low= mid + 1;
+      }
+      else
+      {
+        high= mid;
+      }
+    }
+    return NULL;
+  }
+
+  bool decodeColumn(const char *name,
+                    size_t name_length,
+                    const char *value,
+                    size_t value_length,
+                    size_t& hint,
+                    T& out) const
+  {
+    const Field *field= findField(name, name_length, hint);
+    return field != NULL && field->decode(value, value_length, out);
+  }
+
+  template <class Result>
+  size_t decodeViews(const Result& result, size_t first, size_t count, T& out) const
+  {
+    size_t hint= 0;
+    size_t ret= 0;
+    for (size_t i= first; i < first + count; ++i)
+    {
+      const ColumnView &col= result.getColumn(i);
+      if (decodeColumn(col.name, col.name_length,
+                       col.value, col.value_length,
+                       hint, out))
+      {
+        ++ret;
+      }
+    }
+    return ret;
+  }
+
+  std::string column_family;
+
+  std::vector<Field> fields;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_ROW_MAPPING_H */
@@ -0,0 +1,70 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_ROW_VISITOR_H
+#define __LIBCASSANDRA_ROW_VISITOR_H
+
+#include <string>
+#include <vector>
+
+#include "libgenthrift/cassandra_types.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class RowVisitor
+ * @brief
+ *   Receives rows one at a time from a scan instead of having the whole
+ *   result built up in memory.
+ */
+class RowVisitor
+{
+
+public:
+
+  virtual ~RowVisitor() {}
+
+  /**
+   * Called once for every row
+   * @param[in] key the row key
+   * @param[in] columns columns of the row; may be modified or swapped out
+   * @return true to continue the scan; false to stop it
+   */
+  virtual bool visit(const std::string& key,
+                     std::vector<org::apache::cassandra::Column>& columns)= 0;
+
+};
+
+/**
+ * @class SuperRowVisitor
+ * @brief
+ *   Receives the rows of a super column family one at a time.
+ */
+class SuperRowVisitor
+{
+
+public:
+
+  virtual ~SuperRowVisitor() {}
+
+  /**
+   * Called once for every row
+   * @param[in] key the row key
+   * @param[in] super_columns super columns of the row; may be modified or swapped out
+   * @return true to continue; false to skip the remaining rows
+   */
+  virtual bool visit(const std::string& key,
+                     std::vector<org::apache::cassandra::SuperColumn>& super_columns)= 0;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_ROW_VISITOR_H */
@@ -0,0 +1,219 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/schema_batch.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+namespace
+{
+
+/*
+ * a node refuses schema changes while the cluster disagrees on the
+ * schema, with "Cluster schema does not yet agree"
+ */
+bool isDisagreement(const InvalidRequestException& ire)
+{
+  return ire.why.find("schema") != string::npos &&
+         ire.why.find("agree") != string::npos;
+}
+
+} /* end anonymous namespace */
+
+
+const uint32_t SchemaBatch::MAX_ATTEMPTS;
+
+
+SchemaBatch::SchemaBatch()
+  :
+    changes(),
+    applied(0)
+{}
+
+
+void SchemaBatch::addKeyspace(const KeyspaceDefinition& ks_def)
+{
+  changes.push_back(Change());
+  changes.back().type= ADD_KEYSPACE;
+  changes.back().keyspace= ks_def.getName();
+  changes.back().ks_def= ks_def;
+}
+
+
+void SchemaBatch::updateKeyspace(const KeyspaceDefinition& ks_def)
+{
+  changes.push_back(Change());
+  changes.back().type= UPDATE_KEYSPACE;
+  changes.back().keyspace= ks_def.getName();
+  changes.back().ks_def= ks_def;
+}
+
+
+void SchemaBatch::dropKeyspace(const string& ks_name)
+{
+  changes.push_back(Change());
+  changes.back().type= DROP_KEYSPACE;
+  changes.back().keyspace= ks_name;
+}
+
+
+void SchemaBatch::addColumnFamily(const ColumnFamilyDefinition& cf_def)
+{
+  changes.push_back(Change());
+  changes.back().type= ADD_COLUMN_FAMILY;
+  changes.back().keyspace= cf_def.getKeyspaceName();
+  changes.back().cf_def= cf_def;
+}
+
+
+void SchemaBatch::updateColumnFamily(const ColumnFamilyDefinition& cf_def)
+{
+  changes.push_back(Change());
+  changes.back().type= UPDATE_COLUMN_FAMILY;
+  changes.back().keyspace= cf_def.getKeyspaceName();
+  changes.back().cf_def= cf_def;
+}
+
+
+void SchemaBatch::dropColumnFamily(const string& ks_name, const string& cf_name)
+{
+  changes.push_back(Change());
+  changes.back().type= DROP_COLUMN_FAMILY;
+  changes.back().keyspace= ks_name;
+  changes.back().column_family= cf_name;
+}
+
+
+bool SchemaBatch::apply(Cassandra &client, uint32_t timeout_ms)
+{
+  applied= 0;
+  const string original= client.getCurrentKeyspace();
+  bool original_dropped= false;
+  try
+  {
+    for (vector<Change>::const_iterator it= changes.begin();
+         it != changes.end();
+         ++it)
+    {
+      applyChange(client, *it, timeout_ms);
+      if (it->type == DROP_KEYSPACE && it->keyspace == original)
+      {
+        original_dropped= true;
+      }
+      ++applied;
+    }
+  }
+  catch (...)
+  {
+    if (! original.empty() && ! original_dropped &&
+        client.getCurrentKeyspace() != original)
+    {
+      try
+      {
+        client.setKeyspace(original);
+      }
+      catch (...)
+      {
+        /* the change's own error is the one worth reporting */
+      }
+    }
+    throw;
+  }
+  if (! original.empty() && ! original_dropped &&
+      client.getCurrentKeyspace() != original)
+  {
+    client.setKeyspace(original);
+  }
+  return client.waitForSchemaAgreement(timeout_ms);
+}
+
+
+size_t SchemaBatch::getApplied() const
+{
+  return applied;
+}
+
+
+size_t SchemaBatch::size() const
+{
+  return changes.size();
+}
+
+
+bool SchemaBatch::empty() const
+{
+  return changes.empty();
+}
+
+
+void SchemaBatch::clear()
+{
+  changes.clear();
+  applied= 0;
+}
+
+
+void SchemaBatch::applyChange(Cassandra &client, const Change& change, uint32_t timeout_ms)
+{
+  for (uint32_t attempt= 1; ; ++attempt)
+  {
+    try
+    {
+      sendChange(client, change);
+      return;
+    }
+    catch (InvalidRequestException &ire)
+    {
+      if (! isDisagreement(ire) ||
+          attempt >= MAX_ATTEMPTS ||
+          ! client.waitForSchemaAgreement(timeout_ms))
+      {
+        throw;
+      }
+    }
+  }
+}
+
+
+void SchemaBatch::sendChange(Cassandra &client, const Change& change)
+{
+  switch (change.type)
+  {
+  case ADD_KEYSPACE:
+    client.createKeyspace(change.ks_def);
+    break;
+  case UPDATE_KEYSPACE:
+    client.updateKeyspace(change.ks_def);
+    break;
+  case DROP_KEYSPACE:
+    client.dropKeyspace(change.keyspace);
+    break;
+  case ADD_COLUMN_FAMILY:
+    client.createColumnFamily(change.cf_def);
+    break;
+  case UPDATE_COLUMN_FAMILY:
+    client.updateColumnFamily(change.cf_def);
+    break;
+  case DROP_COLUMN_FAMILY:
+    /* the server drops column families of the connection's keyspace */
+    if (client.getCurrentKeyspace() != change.keyspace)
+    {
+      client.setKeyspace(change.keyspace);
+    }
+    client.dropColumnFamily(change.column_family);
+    break;
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_SCHEMA_BATCH_H
+#define __LIBCASSANDRA_SCHEMA_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/column_family_definition.h"
+#include "libcassandra/keyspace_definition.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class SchemaBatch
+ * @brief
+ *   A list of keyspace and column family changes that are sent one after
+ *   the other over a single connection, followed by one wait for the
+ *   cluster to agree on the resulting schema. The node the changes go to
+ *   applies each before answering, so later changes may depend on earlier
+ *   ones (a column family in a keyspace created by the same batch, say).
+ *   On a cluster of several nodes that node may refuse a change until
+ *   the others have caught up with the previous one; the batch then
+ *   waits for agreement and sends the change again.
+ */
+class SchemaBatch
+{
+
+public:
+
+  /* times a change is sent while the cluster disagrees on the schema */
+  static const uint32_t MAX_ATTEMPTS= 5;
+
+  SchemaBatch();
+  ~SchemaBatch() {}
+
+  void addKeyspace(const KeyspaceDefinition& ks_def);
+
+  void updateKeyspace(const KeyspaceDefinition& ks_def);
+
+  void dropKeyspace(const std::string& ks_name);
+
+  void addColumnFamily(const ColumnFamilyDefinition& cf_def);
+
+  void updateColumnFamily(const ColumnFamilyDefinition& cf_def);
+
+  /**
+   * @param[in] ks_name the keyspace holding the column family; the
+   *            connection switches to it for the drop
+   * @param[in] cf_name the column family to drop
+   */
+  void dropColumnFamily(const std::string& ks_name, const std::string& cf_name);
+
+  /**
+   * Send the changes in the order they were added and wait once for
+   * schema agreement. A change refused because the cluster does not yet
+   * agree on the schema is sent again once it does, up to MAX_ATTEMPTS
+   * times. If a change fails its exception is passed on; the changes
+   * before it stay applied (see getApplied). The connection's
+   * keyspace is set back to what it was unless the batch dropped it.
+   * @param[in] client connection the changes are sent over
+   * @param[in] timeout_ms how long to wait for agreement at most, for
+   *            each wait
+   * @return true if the cluster agreed on the schema in time
+   */
+  bool apply(Cassandra &client,
+             uint32_t timeout_ms= Cassandra::DEFAULT_SCHEMA_AGREEMENT_TIMEOUT_MS);
+
+  /**
+   * @return number of changes the last apply sent successfully
+   */
+  size_t getApplied() const;
+
+  /**
+   * @return number of changes in the batch
+   */
+  size_t size() const;
+
+  /**
+   * @return true if the batch has no changes; false otherwise
+   */
+  bool empty() const;
+
+  /**
+   * Remove all changes
+   */
+  void clear();
+
+private:
+
+  enum ChangeType
+  {
+    ADD_KEYSPACE= 0,
+    UPDATE_KEYSPACE,
+    DROP_KEYSPACE,
+    ADD_COLUMN_FAMILY,
+    UPDATE_COLUMN_FAMILY,
+    DROP_COLUMN_FAMILY
+  };
+
+  struct Change
+  {
+    ChangeType type;
+    /* keyspace name for keyspace changes and column family drops */
+    std::string keyspace;
+    /* column family name for drops */
+    std::string column_family;
+    KeyspaceDefinition ks_def;
+    ColumnFamilyDefinition cf_def;
+  };
+
+  /**
+   * Send a change, waiting for schema agreement and sending it again
+   * when it is refused for disagreement
+   */
+  void applyChange(Cassandra &client, const Change& change, uint32_t timeout_ms);
+
+  void sendChange(Cassandra &client, const Change& change);
+
+  std::vector<Change> changes;
+
+  size_t applied;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_SCHEMA_BATCH_H */
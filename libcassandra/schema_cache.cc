@@ -0,0 +1,363 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/exception.h"
+#include "libcassandra/schema_cache.h"
+#include "libcassandra/util/parallel.h"
+
+using namespace libcassandra;
+using namespace std;
+
+
+const uint32_t SchemaCache::DEFAULT_POLL_INTERVAL_MS;
+
+
+namespace
+{
+
+/* describe_schema_versions lists nodes it could not ask under this version */
+static const char *UNREACHABLE= "UNREACHABLE";
+
+
+/*
+ * refreshes a cache from the connection it is given
+ */
+class RefreshTask : public util::Task
+{
+
+public:
+
+  explicit RefreshTask(SchemaCache &in_cache)
+    :
+      cache(in_cache)
+  {}
+
+  void run(Cassandra &client)
+  {
+    cache.refresh(client);
+  }
+
+private:
+
+  SchemaCache &cache;
+
+};
+
+} /* end anonymous namespace */
+
+
+SchemaCache::SchemaCache()
+  :
+    lock(),
+    snapshot(),
+    stale(false),
+    invalidations(0),
+    loads(0),
+    poll_pool(NULL),
+    poll_interval_ms(DEFAULT_POLL_INTERVAL_MS),
+    polling(false),
+    stopping(false),
+    poll_thread(),
+    wakeup()
+{}
+
+
+SchemaCache::~SchemaCache()
+{
+  stopPolling();
+}
+
+
+bool SchemaCache::refresh(Cassandra &client)
+{
+  uint64_t started;
+  {
+    util::ScopedLock guard(lock);
+    started= invalidations;
+  }
+  string version= versionOf(client.getSchemaVersions());
+  {
+    util::ScopedLock guard(lock);
+    if (snapshot && ! stale && snapshot->version == version)
+    {
+      return false;
+    }
+  }
+  install(client.describeKeyspaces(), version, started);
+  return true;
+}
+
+
+void SchemaCache::load(const vector<KeyspaceDefinition>& keyspaces,
+                       const string& version)
+{
+  uint64_t started;
+  {
+    util::ScopedLock guard(lock);
+    started= invalidations;
+  }
+  install(keyspaces, version, started);
+}
+
+
+void SchemaCache::install(const vector<KeyspaceDefinition>& keyspaces,
+                          const string& version,
+                          uint64_t started)
+{
+  /* built outside the lock; readers keep using the old snapshot meanwhile */
+  tr1::shared_ptr<Snapshot> fresh(new Snapshot());
+  fresh->version= version;
+  fresh->keyspaces= keyspaces;
+  for (vector<KeyspaceDefinition>::const_iterator it= keyspaces.begin();
+       it != keyspaces.end();
+       ++it)
+  {
+    KeyspaceEntry &entry= fresh->by_name[it->getName()];
+    entry.definition.reset(new KeyspaceDefinition(*it));
+    vector<ColumnFamilyDefinition> column_families= it->getColumnFamilies();
+    for (vector<ColumnFamilyDefinition>::iterator cf_it= column_families.begin();
+         cf_it != column_families.end();
+         ++cf_it)
+    {
+      ColumnFamilyEntry &cf_entry= entry.column_families[cf_it->getName()];
+      cf_entry.definition.reset(new ColumnFamilyDefinition(*cf_it));
+      cf_entry.validator.reset(new RequestValidator(*cf_it));
+    }
+  }
+
+  util::ScopedLock guard(lock);
+  snapshot= fresh;
+  /* definitions read before the last invalidate may already be out of date */
+  stale= (invalidations != started);
+  ++loads;
+}
+
+
+void SchemaCache::invalidate()
+{
+  util::ScopedLock guard(lock);
+  stale= true;
+  ++invalidations;
+}
+
+
+void SchemaCache::startPolling(util::CassandraPool &pool, uint32_t interval_ms)
+{
+  stopPolling();
+  util::ScopedLock guard(lock);
+  poll_pool= &pool;
+  poll_interval_ms= interval_ms;
+  stopping= false;
+  if (pthread_create(&poll_thread, NULL, SchemaCache::poll, this) != 0)
+  {
+    throw Exception("could not start the schema polling thread", 0);
+  }
+  polling= true;
+}
+
+
+void SchemaCache::stopPolling()
+{
+  {
+    util::ScopedLock guard(lock);
+    if (! polling)
+    {
+      return;
+    }
+    stopping= true;
+    wakeup.broadcast();
+  }
+  pthread_join(poll_thread, NULL);
+  util::ScopedLock guard(lock);
+  polling= false;
+  stopping= false;
+}
+
+
+bool SchemaCache::isPolling()
+{
+  util::ScopedLock guard(lock);
+  return polling;
+}
+
+
+bool SchemaCache::isLoaded()
+{
+  util::ScopedLock guard(lock);
+  return snapshot.get() != NULL;
+}
+
+
+bool SchemaCache::isStale()
+{
+  util::ScopedLock guard(lock);
+  return snapshot && stale;
+}
+
+
+tr1::shared_ptr<const KeyspaceDefinition> SchemaCache::findKeyspace(const string& name)
+{
+  tr1::shared_ptr<const Snapshot> current= getSnapshot();
+  if (! current)
+  {
+    return tr1::shared_ptr<const KeyspaceDefinition>();
+  }
+  KeyspaceMap::const_iterator it= current->by_name.find(name);
+  if (it == current->by_name.end())
+  {
+    return tr1::shared_ptr<const KeyspaceDefinition>();
+  }
+  return it->second.definition;
+}
+
+
+tr1::shared_ptr<const ColumnFamilyDefinition>
+SchemaCache::findColumnFamily(const string& keyspace, const string& column_family)
+{
+  tr1::shared_ptr<const Snapshot> current= getSnapshot();
+  const ColumnFamilyEntry *entry= current ? findEntry(*current, keyspace, column_family) : NULL;
+  if (entry == NULL)
+  {
+    return tr1::shared_ptr<const ColumnFamilyDefinition>();
+  }
+  return entry->definition;
+}
+
+
+tr1::shared_ptr<const RequestValidator>
+SchemaCache::findValidator(const string& keyspace, const string& column_family)
+{
+  tr1::shared_ptr<const Snapshot> current= getSnapshot();
+  const ColumnFamilyEntry *entry= current ? findEntry(*current, keyspace, column_family) : NULL;
+  if (entry == NULL)
+  {
+    return tr1::shared_ptr<const RequestValidator>();
+  }
+  return entry->validator;
+}
+
+
+vector<KeyspaceDefinition> SchemaCache::getKeyspaces()
+{
+  tr1::shared_ptr<const Snapshot> current= getSnapshot();
+  if (! current)
+  {
+    return vector<KeyspaceDefinition>();
+  }
+  return current->keyspaces;
+}
+
+
+string SchemaCache::getVersion()
+{
+  tr1::shared_ptr<const Snapshot> current= getSnapshot();
+  if (! current)
+  {
+    return string();
+  }
+  return current->version;
+}
+
+
+uint64_t SchemaCache::getLoads()
+{
+  util::ScopedLock guard(lock);
+  return loads;
+}
+
+
+string SchemaCache::versionOf(const map<string, vector<string> >& versions)
+{
+  /* the map is ordered, so the same versions always give the same string */
+  string ret;
+  for (map<string, vector<string> >::const_iterator it= versions.begin();
+       it != versions.end();
+       ++it)
+  {
+    if (it->first == UNREACHABLE)
+    {
+      continue;
+    }
+    if (! ret.empty())
+    {
+      ret.push_back(',');
+    }
+    ret.append(it->first);
+  }
+  return ret;
+}
+
+
+bool SchemaCache::isAgreement(const map<string, vector<string> >& versions)
+{
+  size_t reachable= versions.size();
+  if (versions.find(UNREACHABLE) != versions.end())
+  {
+    --reachable;
+  }
+  return reachable == 1;
+}
+
+
+tr1::shared_ptr<const SchemaCache::Snapshot> SchemaCache::getSnapshot()
+{
+  util::ScopedLock guard(lock);
+  return snapshot;
+}
+
+
+const SchemaCache::ColumnFamilyEntry *SchemaCache::findEntry(const Snapshot& current,
+                                                             const string& keyspace,
+                                                             const string& column_family) const
+{
+  KeyspaceMap::const_iterator ks_it= current.by_name.find(keyspace);
+  if (ks_it == current.by_name.end())
+  {
+    return NULL;
+  }
+  ColumnFamilyMap::const_iterator it= ks_it->second.column_families.find(column_family);
+  if (it == ks_it->second.column_families.end())
+  {
+    return NULL;
+  }
+  return &it->second;
+}
+
+
+void *SchemaCache::poll(void *arg)
+{
+  SchemaCache *cache= static_cast<SchemaCache *>(arg);
+  RefreshTask task(*cache);
+  vector<util::Task *> tasks(1, &task);
+  util::ScopedLock guard(cache->lock);
+  while (! cache->stopping)
+  {
+    cache->wakeup.timedWait(cache->lock, cache->poll_interval_ms);
+    if (cache->stopping)
+    {
+      break;
+    }
+    cache->lock.unlock();
+    try
+    {
+      util::runTasks(*cache->poll_pool, tasks, 1, string());
+    }
+    catch (...)
+    {
+      /* tried again at the next interval */
+    }
+    cache->lock.lock();
+  }
+  return NULL;
+}
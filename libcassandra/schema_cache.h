@@ -0,0 +1,234 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_SCHEMA_CACHE_H
+#define __LIBCASSANDRA_SCHEMA_CACHE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <tr1/memory>
+#include <tr1/unordered_map>
+
+#include "libcassandra/column_family_definition.h"
+#include "libcassandra/keyspace_definition.h"
+#include "libcassandra/request_validator.h"
+#include "libcassandra/util/mutex.h"
+
+namespace libcassandra
+{
+
+class Cassandra;
+
+namespace util
+{
+class CassandraPool;
+}
+
+/**
+ * @class SchemaCache
+ * @brief
+ *   The keyspace and column family definitions of a cluster, held in
+ *   hash tables keyed by name so that lookups need no request. refresh()
+ *   asks a server for the schema versions and only reads the definitions
+ *   again when those have changed; startPolling() does that in the
+ *   background. A reload builds a new snapshot and swaps it in, so the
+ *   definitions handed out are never modified and lookups only hold a
+ *   lock long enough to take a reference to the current snapshot. A
+ *   cache is meant to be shared by all connections of a process (see
+ *   Cassandra::setSchemaCache).
+ */
+class SchemaCache
+{
+
+public:
+
+  static const uint32_t DEFAULT_POLL_INTERVAL_MS= 10000;
+
+  SchemaCache();
+
+  /**
+   * Stops polling, if started
+   */
+  ~SchemaCache();
+
+  /**
+   * Read the definitions again if the schema changed since the last load
+   * @param[in] client connection the schema is read from
+   * @return true if the definitions were read again
+   */
+  bool refresh(Cassandra &client);
+
+  /**
+   * Replace the cached definitions. The cache stays stale if invalidate()
+   * is called while this runs.
+   * @param[in] keyspaces the definitions
+   * @param[in] version the schema version they belong to
+   */
+  void load(const std::vector<KeyspaceDefinition>& keyspaces,
+            const std::string& version);
+
+  /**
+   * Make the next refresh read the definitions whatever the schema
+   * version. The current definitions are served until then.
+   */
+  void invalidate();
+
+  /**
+   * Refresh from a pooled connection every interval_ms on a thread of
+   * the cache's own. Failed refreshes are retried at the next interval.
+   * The pool has to outlive polling.
+   * @param[in] pool where connections are taken from
+   * @param[in] interval_ms time between two refreshes
+   */
+  void startPolling(util::CassandraPool &pool,
+                    uint32_t interval_ms= DEFAULT_POLL_INTERVAL_MS);
+
+  /**
+   * Stop polling and wait for the polling thread to finish
+   */
+  void stopPolling();
+
+  /**
+   * @return true if a polling thread is running
+   */
+  bool isPolling();
+
+  /**
+   * @return true once definitions have been loaded
+   */
+  bool isLoaded();
+
+  /**
+   * @return true if the loaded definitions were invalidated and have not
+   *         been read again yet
+   */
+  bool isStale();
+
+  /**
+   * @return the definition of a keyspace, or an empty pointer if the
+   *         keyspace is not known
+   */
+  std::tr1::shared_ptr<const KeyspaceDefinition> findKeyspace(const std::string& name);
+
+  /**
+   * @return the definition of a column family, or an empty pointer if
+   *         the column family is not known
+   */
+  std::tr1::shared_ptr<const ColumnFamilyDefinition> findColumnFamily(const std::string& keyspace,
+                                                                      const std::string& column_family);
+
+  /**
+   * @return the validator built from a column family's definition, or an
+   *         empty pointer if the column family is not known
+   */
+  std::tr1::shared_ptr<const RequestValidator> findValidator(const std::string& keyspace,
+                                                             const std::string& column_family);
+
+  /**
+   * @return copies of all keyspace definitions
+   */
+  std::vector<KeyspaceDefinition> getKeyspaces();
+
+  /**
+   * @return the schema version of the cached definitions; versions of a
+   *         cluster that disagrees are joined with commas
+   */
+  std::string getVersion();
+
+  /**
+   * @return number of times the definitions were read
+   */
+  uint64_t getLoads();
+
+  /**
+   * @return the schema version reported by a describe_schema_versions
+   *         reply, leaving out unreachable nodes
+   */
+  static std::string versionOf(const std::map<std::string, std::vector<std::string> >& versions);
+
+  /**
+   * @return true if every node a describe_schema_versions reply could
+   *         reach has the same schema version
+   */
+  static bool isAgreement(const std::map<std::string, std::vector<std::string> >& versions);
+
+private:
+
+  struct ColumnFamilyEntry
+  {
+    std::tr1::shared_ptr<const ColumnFamilyDefinition> definition;
+    std::tr1::shared_ptr<const RequestValidator> validator;
+  };
+
+  typedef std::tr1::unordered_map<std::string, ColumnFamilyEntry> ColumnFamilyMap;
+
+  struct KeyspaceEntry
+  {
+    std::tr1::shared_ptr<const KeyspaceDefinition> definition;
+    ColumnFamilyMap column_families;
+  };
+
+  typedef std::tr1::unordered_map<std::string, KeyspaceEntry> KeyspaceMap;
+
+  /* never changed once built */
+  struct Snapshot
+  {
+    std::string version;
+    std::vector<KeyspaceDefinition> keyspaces;
+    KeyspaceMap by_name;
+  };
+
+  std::tr1::shared_ptr<const Snapshot> getSnapshot();
+
+  /* swaps in new definitions; started is invalidations when reading them began */
+  void install(const std::vector<KeyspaceDefinition>& keyspaces,
+               const std::string& version,
+               uint64_t started);
+
+  const ColumnFamilyEntry *findEntry(const Snapshot& current,
+                                     const std::string& keyspace,
+                                     const std::string& column_family) const;
+
+  static void *poll(void *arg);
+
+  util::Mutex lock;
+
+  std::tr1::shared_ptr<const Snapshot> snapshot;
+
+  bool stale;
+
+  /* number of invalidate() calls, so a load can tell if one came during it */
+  uint64_t invalidations;
+
+  uint64_t loads;
+
+  /* polling state */
+  util::CassandraPool *poll_pool;
+
+  uint32_t poll_interval_ms;
+
+  bool polling;
+
+  bool stopping;
+
+  pthread_t poll_thread;
+
+  util::Condition wakeup;
+
+  SchemaCache(const SchemaCache&);
+  SchemaCache &operator=(const SchemaCache&);
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_SCHEMA_CACHE_H */
@@ -0,0 +1,94 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+
+#include <protocol/TBinaryProtocol.h>
+#include <transport/TTransportUtils.h>
+
+#include "libgenthrift/Cassandra.h"
+
+#include "libcassandra/serialized_batch.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using namespace org::apache::cassandra;
+
+
+SerializedBatch::SerializedBatch()
+  :
+    payload(),
+    rows(),
+    level(ConsistencyLevel::QUORUM)
+{}
+
+
+SerializedBatch::SerializedBatch(const MutationsMap& mutations,
+                                 ConsistencyLevel::type in_level)
+  :
+    payload(),
+    rows(),
+    level(in_level)
+{
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  /*
+   * the pargs struct is exactly what CassandraClient::send_batch_mutate
+   * writes between the message header and trailer
+   */
+  Cassandra_batch_mutate_pargs args;
+  args.mutation_map= &mutations;
+  args.consistency_level= &level;
+  args.write(&protocol);
+  buffer->appendBufferToString(payload);
+
+  for (MutationsMap::const_iterator key_it= mutations.begin();
+       key_it != mutations.end();
+       ++key_it)
+  {
+    for (map<string, vector<Mutation> >::const_iterator cf_it= key_it->second.begin();
+         cf_it != key_it->second.end();
+         ++cf_it)
+    {
+      rows.push_back(make_pair(key_it->first, cf_it->first));
+    }
+  }
+}
+
+
+const uint8_t *SerializedBatch::getData() const
+{
+  return reinterpret_cast<const uint8_t *>(payload.data());
+}
+
+
+uint32_t SerializedBatch::size() const
+{
+  return static_cast<uint32_t>(payload.size());
+}
+
+
+bool SerializedBatch::empty() const
+{
+  return payload.empty();
+}
+
+
+ConsistencyLevel::type SerializedBatch::getConsistencyLevel() const
+{
+  return level;
+}
+
+
+const vector<pair<string, string> > &SerializedBatch::getRows() const
+{
+  return rows;
+}
@@ -0,0 +1,84 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_SERIALIZED_BATCH_H
+#define __LIBCASSANDRA_SERIALIZED_BATCH_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+#include "libgenthrift/cassandra_types.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class SerializedBatch
+ * @brief
+ *   The arguments of a batch_mutate call encoded once with the binary
+ *   protocol. The encoded bytes do not depend on the connection they are
+ *   sent over, so a batch that failed on one host can be resent verbatim
+ *   to the same host or to any other without walking the mutations again.
+ */
+class SerializedBatch
+{
+
+public:
+
+  typedef std::map<std::string,
+                   std::map<std::string,
+                            std::vector<org::apache::cassandra::Mutation>
+                           >
+                  > MutationsMap;
+
+  SerializedBatch();
+  SerializedBatch(const MutationsMap& mutations,
+                  org::apache::cassandra::ConsistencyLevel::type in_level);
+  ~SerializedBatch() {}
+
+  /**
+   * @return pointer to the encoded batch_mutate arguments
+   */
+  const uint8_t *getData() const;
+
+  /**
+   * @return number of bytes in the encoded arguments
+   */
+  uint32_t size() const;
+
+  /**
+   * @return true if no batch has been encoded; false otherwise
+   */
+  bool empty() const;
+
+  /**
+   * @return the consistency level encoded in this batch
+   */
+  org::apache::cassandra::ConsistencyLevel::type getConsistencyLevel() const;
+
+  /**
+   * @return the (row key, column family) pairs the batch writes to
+   */
+  const std::vector<std::pair<std::string, std::string> > &getRows() const;
+
+private:
+
+  std::string payload;
+
+  std::vector<std::pair<std::string, std::string> > rows;
+
+  org::apache::cassandra::ConsistencyLevel::type level;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_SERIALIZED_BATCH_H */
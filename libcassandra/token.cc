@@ -0,0 +1,282 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <algorithm>
+
+#include "libcassandra/exception.h"
+#include "libcassandra/token.h"
+
+using namespace std;
+using namespace org::apache::cassandra;
+
+namespace libcassandra
+{
+
+
+namespace
+{
+
+/* per round shift amounts and sine derived constants from RFC 1321 */
+const uint32_t md5_shifts[64]=
+{
+  7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+  5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+  4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+  6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+const uint32_t md5_constants[64]=
+{
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+  0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+  0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+  0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+  0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+  0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+
+void md5Block(uint32_t state[4], const unsigned char block[64])
+{
+  uint32_t words[16];
+  for (int i= 0; i < 16; ++i)
+  {
+    words[i]= static_cast<uint32_t>(block[i * 4]) |
+              (static_cast<uint32_t>(block[i * 4 + 1]) << 8) |
+              (static_cast<uint32_t>(block[i * 4 + 2]) << 16) |
+              (static_cast<uint32_t>(block[i * 4 + 3]) << 24);
+  }
+  uint32_t a= state[0];
+  uint32_t b= state[1];
+  uint32_t c= state[2];
+  uint32_t d= state[3];
+  for (int i= 0; i < 64; ++i)
+  {
+    uint32_t f;
+    int g;
+    if (i < 16)
+    {
+      f= (b & c) | (~b & d);
+      g= i;
+    }
+    else if (i < 32)
+    {
+      f= (d & b) | (~d & c);
+      g= (5 * i + 1) % 16;
+    }
+    else if (i < 48)
+    {
+      f= b ^ c ^ d;
+      g= (3 * i + 5) % 16;
+    }
+    else
+    {
+      f= c ^ (b | ~d);
+      g= (7 * i) % 16;
+    }
+    uint32_t tmp= d;
+    d= c;
+    c= b;
+    uint32_t sum= a + f + md5_constants[i] + words[g];
+    b= b + ((sum << md5_shifts[i]) | (sum >> (32 - md5_shifts[i])));
+    a= tmp;
+  }
+  state[0]+= a;
+  state[1]+= b;
+  state[2]+= c;
+  state[3]+= d;
+}
+
+
+/*
+ * the random partitioner's token is the absolute value of the MD5
+ * digest read as a signed big-endian 128 bit integer, in decimal
+ */
+string randomToken(const string &key)
+{
+  unsigned char digest[16];
+  computeMD5(key, digest);
+  if (digest[0] & 0x80)
+  {
+    /* two's complement negation */
+    int carry= 1;
+    for (int i= 15; i >= 0; --i)
+    {
+      int value= static_cast<unsigned char>(~digest[i]) + carry;
+      digest[i]= static_cast<unsigned char>(value & 0xff);
+      carry= value >> 8;
+    }
+  }
+  uint32_t limbs[4];
+  for (int i= 0; i < 4; ++i)
+  {
+    limbs[i]= (static_cast<uint32_t>(digest[i * 4]) << 24) |
+              (static_cast<uint32_t>(digest[i * 4 + 1]) << 16) |
+              (static_cast<uint32_t>(digest[i * 4 + 2]) << 8) |
+              static_cast<uint32_t>(digest[i * 4 + 3]);
+  }
+  string ret;
+  for (;;)
+  {
+    uint64_t remainder= 0;
+    bool zero= true;
+    for (int i= 0; i < 4; ++i)
+    {
+      uint64_t value= (remainder << 32) | limbs[i];
+      limbs[i]= static_cast<uint32_t>(value / 10);
+      remainder= value % 10;
+      zero= zero && (limbs[i] == 0);
+    }
+    ret.push_back(static_cast<char>('0' + remainder));
+    if (zero)
+    {
+      break;
+    }
+  }
+  reverse(ret.begin(), ret.end());
+  return ret;
+}
+
+
+string hexToken(const string &key)
+{
+  static const char digits[]= "0123456789abcdef";
+  string ret;
+  ret.reserve(key.size() * 2);
+  for (string::const_iterator it= key.begin(); it != key.end(); ++it)
+  {
+    unsigned char byte= static_cast<unsigned char>(*it);
+    ret.push_back(digits[byte >> 4]);
+    ret.push_back(digits[byte & 0x0f]);
+  }
+  return ret;
+}
+
+
+bool endsWith(const string &str, const char *suffix)
+{
+  size_t len= strlen(suffix);
+  return (str.size() >= len && str.compare(str.size() - len, len, suffix) == 0);
+}
+
+} /* end anonymous namespace */
+
+
+void computeMD5(const string &data, unsigned char digest[16])
+{
+  uint32_t state[4]= { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+  const unsigned char *bytes= reinterpret_cast<const unsigned char *>(data.data());
+  size_t len= data.size();
+  size_t offset= 0;
+  for (; offset + 64 <= len; offset+= 64)
+  {
+    md5Block(state, bytes + offset);
+  }
+  /* pad with a single 1 bit, zeros, then the message length in bits */
+  unsigned char tail[128];
+  size_t rest= len - offset;
+  memset(tail, 0, sizeof(tail));
+  memcpy(tail, bytes + offset, rest);
+  tail[rest]= 0x80;
+  size_t tail_len= (rest < 56) ? 64 : 128;
+  uint64_t bits= static_cast<uint64_t>(len) * 8;
+  for (int i= 0; i < 8; ++i)
+  {
+    tail[tail_len - 8 + i]= static_cast<unsigned char>((bits >> (8 * i)) & 0xff);
+  }
+  md5Block(state, tail);
+  if (tail_len == 128)
+  {
+    md5Block(state, tail + 64);
+  }
+  for (int i= 0; i < 4; ++i)
+  {
+    digest[i * 4]= static_cast<unsigned char>(state[i] & 0xff);
+    digest[i * 4 + 1]= static_cast<unsigned char>((state[i] >> 8) & 0xff);
+    digest[i * 4 + 2]= static_cast<unsigned char>((state[i] >> 16) & 0xff);
+    digest[i * 4 + 3]= static_cast<unsigned char>((state[i] >> 24) & 0xff);
+  }
+}
+
+
+string computeToken(const string &partitioner, const string &key)
+{
+  if (endsWith(partitioner, "RandomPartitioner"))
+  {
+    return randomToken(key);
+  }
+  if (endsWith(partitioner, "ByteOrderedPartitioner"))
+  {
+    return hexToken(key);
+  }
+  if (endsWith(partitioner, "OrderPreservingPartitioner"))
+  {
+    return key;
+  }
+  throw Exception("unsupported partitioner: " + partitioner, 0);
+}
+
+
+int compareTokens(const string &partitioner, const string &a, const string &b)
+{
+  if (endsWith(partitioner, "RandomPartitioner"))
+  {
+    /* decimal numbers without leading zeros */
+    if (a.size() != b.size())
+    {
+      return a.size() < b.size() ? -1 : 1;
+    }
+    return a.compare(b);
+  }
+  if (endsWith(partitioner, "ByteOrderedPartitioner") ||
+      (endsWith(partitioner, "OrderPreservingPartitioner") &&
+       ! endsWith(partitioner, "CollatingOrderPreservingPartitioner")))
+  {
+    /* hex digits of the key, or the key itself; byte order either way */
+    return a.compare(b);
+  }
+  throw Exception("unsupported partitioner: " + partitioner, 0);
+}
+
+
+size_t findOwningRange(const string &partitioner,
+                       const vector<TokenRange> &ring,
+                       const string &token)
+{
+  for (size_t i= 0; i < ring.size(); ++i)
+  {
+    const TokenRange &range= ring[i];
+    int start_cmp= compareTokens(partitioner, token, range.start_token);
+    int end_cmp= compareTokens(partitioner, token, range.end_token);
+    if (compareTokens(partitioner, range.start_token, range.end_token) < 0)
+    {
+      if (start_cmp > 0 && end_cmp <= 0)
+      {
+        return i;
+      }
+    }
+    else if (start_cmp > 0 || end_cmp <= 0)
+    {
+      return i;
+    }
+  }
+  return ring.size();
+}
+
+
+} /* end namespace libcassandra */
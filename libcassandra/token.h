@@ -0,0 +1,66 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_TOKEN_H
+#define __LIBCASSANDRA_TOKEN_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "libgenthrift/cassandra_types.h"
+
+namespace libcassandra
+{
+
+/**
+ * Compute the token a row key maps to, in the string form used by
+ * describe_ring and by the token bounds of a KeyRange. The random,
+ * byte ordered and order preserving partitioners are supported.
+ * @param[in] partitioner class name as returned by describe_partitioner
+ * @param[in] key the row key
+ * @return the token for the given key
+ */
+std::string computeToken(const std::string &partitioner, const std::string &key);
+
+/**
+ * Order two tokens of a partitioner. The random, byte ordered and order
+ * preserving partitioners are supported; collating ones are not, since
+ * their order depends on the server's locale.
+ * @param[in] partitioner class name as returned by describe_partitioner
+ * @param[in] a a token
+ * @param[in] b another token
+ * @return less than, equal to or greater than 0 as a sorts before, with
+ *         or after b
+ */
+int compareTokens(const std::string &partitioner, const std::string &a, const std::string &b);
+
+/**
+ * Find the range of a token ring that owns a token. A range owns the
+ * tokens after its start token up to and including its end token, and
+ * wraps around the end of the ring when its start is not below its end.
+ * @param[in] partitioner class name as returned by describe_partitioner
+ * @param[in] ring the ranges, as returned by describe_ring
+ * @param[in] token the token to look for
+ * @return index of the owning range, or ring.size() if no range owns it
+ */
+size_t findOwningRange(const std::string &partitioner,
+                       const std::vector<org::apache::cassandra::TokenRange> &ring,
+                       const std::string &token);
+
+/**
+ * Compute the MD5 digest of the given data
+ * @param[in] data bytes to hash
+ * @param[out] digest receives the 16 byte digest
+ */
+void computeMD5(const std::string &data, unsigned char digest[16]);
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_TOKEN_H */
@@ -0,0 +1,153 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string.h>
+
+#include <vector>
+#include <new>
+
+#include "libcassandra/util/arena.h"
+
+using namespace libcassandra;
+using namespace std;
+
+
+util::Arena::Arena(size_t in_block_size)
+  :
+    block_size(in_block_size ? in_block_size : DEFAULT_BLOCK_SIZE),
+    blocks(),
+    current(0),
+    offset(0),
+    used(0)
+{}
+
+
+util::Arena::~Arena()
+{
+  for (vector<Block>::iterator it= blocks.begin();
+       it != blocks.end();
+       ++it)
+  {
+    delete [] (*it).data;
+  }
+}
+
+
+char *util::Arena::allocate(size_t size)
+{
+  if (current < blocks.size() && blocks[current].size - offset >= size)
+  {
+    char *ret= blocks[current].data + offset;
+    offset+= size;
+    used+= size;
+    return ret;
+  }
+  return allocateSlow(size);
+}
+
+
+char *util::Arena::copy(const char *data, size_t size)
+{
+  char *ret= allocate(size);
+  if (size > 0)
+  {
+    memcpy(ret, data, size);
+  }
+  return ret;
+}
+
+
+void util::Arena::reset()
+{
+  vector<Block> kept;
+  kept.reserve(blocks.size());
+  for (vector<Block>::iterator it= blocks.begin();
+       it != blocks.end();
+       ++it)
+  {
+    if ((*it).size == block_size)
+    {
+      kept.push_back(*it);
+    }
+    else
+    {
+      delete [] (*it).data;
+    }
+  }
+  blocks.swap(kept);
+  current= 0;
+  offset= 0;
+  used= 0;
+}
+
+
+size_t util::Arena::getUsed() const
+{
+  return used;
+}
+
+
+size_t util::Arena::getReserved() const
+{
+  size_t total= 0;
+  for (vector<Block>::const_iterator it= blocks.begin();
+       it != blocks.end();
+       ++it)
+  {
+    total+= (*it).size;
+  }
+  return total;
+}
+
+
+char *util::Arena::allocateSlow(size_t size)
+{
+  if (size > block_size / 4)
+  {
+    /*
+     * a big request gets a block of its own, placed before the current
+     * one so the space left there is still used
+     */
+    Block block;
+    block.data= new char[size];
+    block.size= size;
+    size_t pos= current < blocks.size() ? current : blocks.size();
+    blocks.insert(blocks.begin() + pos, block);
+    if (current < blocks.size() - 1)
+    {
+      ++current;
+    }
+    else
+    {
+      /* there was no current block; start the next request on a fresh one */
+      current= blocks.size();
+      offset= 0;
+    }
+    used+= size;
+    return block.data;
+  }
+  /* move on to the next kept block, or make a new one */
+  if (current < blocks.size())
+  {
+    ++current;
+  }
+  offset= 0;
+  if (current >= blocks.size())
+  {
+    Block block;
+    block.data= new char[block_size];
+    block.size= block_size;
+    blocks.push_back(block);
+    current= blocks.size() - 1;
+  }
+  char *ret= blocks[current].data;
+  offset= size;
+  used+= size;
+  return ret;
+}
@@ -0,0 +1,103 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_UTIL_ARENA_H
+#define __LIBCASSANDRA_UTIL_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace libcassandra
+{
+
+namespace util
+{
+
+/**
+ * @class Arena
+ * @brief
+ *   A bump allocator for byte strings. Memory is carved out of fixed size
+ *   blocks and is only given back all at once by reset() or when the
+ *   arena is destroyed. reset() keeps the regular blocks for reuse, so an
+ *   arena that is reset between queries stops calling malloc once it has
+ *   grown to the size of the largest result.
+ */
+class Arena
+{
+
+public:
+
+  static const size_t DEFAULT_BLOCK_SIZE= 64 * 1024;
+
+  explicit Arena(size_t in_block_size= DEFAULT_BLOCK_SIZE);
+  ~Arena();
+
+  /**
+   * @param[in] size number of bytes wanted
+   * @return pointer to size bytes, valid until the next reset; the
+   *         memory is not aligned
+   */
+  char *allocate(size_t size);
+
+  /**
+   * @param[in] data bytes to copy
+   * @param[in] size number of bytes to copy
+   * @return pointer to the copy in the arena
+   */
+  char *copy(const char *data, size_t size);
+
+  /**
+   * Forget everything handed out so far. Regular blocks are kept for
+   * reuse; blocks made for oversized requests are freed.
+   */
+  void reset();
+
+  /**
+   * @return number of bytes handed out since the last reset
+   */
+  size_t getUsed() const;
+
+  /**
+   * @return number of bytes held in blocks
+   */
+  size_t getReserved() const;
+
+private:
+
+  struct Block
+  {
+    char *data;
+    size_t size;
+  };
+
+  char *allocateSlow(size_t size);
+
+  size_t block_size;
+
+  std::vector<Block> blocks;
+
+  /* index of the block being carved up */
+  size_t current;
+
+  /* first free byte in the current block */
+  size_t offset;
+
+  size_t used;
+
+  Arena(const Arena&);
+  Arena &operator=(const Arena&);
+
+};
+
+} /* end namespace util */
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_UTIL_ARENA_H */
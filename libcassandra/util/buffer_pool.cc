@@ -0,0 +1,262 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "libcassandra/util/buffer_pool.h"
+#include "libcassandra/util/mutex.h"
+
+using namespace libcassandra;
+using namespace std;
+
+
+const uint32_t util::BufferPool::MIN_CLASS_SIZE;
+const uint32_t util::BufferPool::MAX_CLASS_SIZE;
+const uint32_t util::BufferPool::THREAD_CACHE_DEPTH;
+const uint32_t util::BufferPool::THREAD_CACHE_MAX_SIZE;
+const size_t util::BufferPool::SHARED_BYTES;
+
+
+namespace
+{
+
+/* MIN_CLASS_SIZE is 1 << 9, MAX_CLASS_SIZE is 1 << 22 */
+static const uint32_t MIN_CLASS_SHIFT= 9;
+static const uint32_t NUM_CLASSES= 14;
+
+/* bounds the shared list of the small classes */
+static const size_t MAX_SHARED_DEPTH= 256;
+
+struct ThreadCache
+{
+  bool registered;
+  uint32_t counts[NUM_CLASSES];
+  uint8_t *buffers[NUM_CLASSES][util::BufferPool::THREAD_CACHE_DEPTH];
+};
+
+/* zero initialised for every thread */
+static __thread ThreadCache thread_cache;
+
+/*
+ * created once and never destroyed, so that threads still running at
+ * exit can hand their buffers back
+ */
+struct SharedLists
+{
+  SharedLists()
+    :
+      lock(),
+      bytes(0)
+  {}
+
+  util::Mutex lock;
+  vector<uint8_t *> lists[NUM_CLASSES];
+  size_t bytes;
+};
+
+static pthread_once_t shared_once= PTHREAD_ONCE_INIT;
+static SharedLists *shared= NULL;
+
+/* its destructor empties the cache of an exiting thread */
+static pthread_key_t cache_key;
+
+
+uint32_t classIndex(uint32_t capacity)
+{
+  return static_cast<uint32_t>(__builtin_ctz(capacity)) - MIN_CLASS_SHIFT;
+}
+
+
+uint32_t classSize(uint32_t index)
+{
+  return util::BufferPool::MIN_CLASS_SIZE << index;
+}
+
+
+/*
+ * keeps the buffer on the shared list if there is room, freeing buffers
+ * of larger classes to make some; frees the buffer otherwise
+ */
+void releaseShared(uint8_t *buffer, uint32_t index)
+{
+  const size_t size= classSize(index);
+  vector<uint8_t *> evicted;
+  {
+    util::ScopedLock guard(shared->lock);
+    vector<uint8_t *> &list= shared->lists[index];
+    if (list.size() < MAX_SHARED_DEPTH)
+    {
+      for (uint32_t larger= NUM_CLASSES - 1;
+           larger > index && shared->bytes + size > util::BufferPool::SHARED_BYTES;
+           --larger)
+      {
+        vector<uint8_t *> &victims= shared->lists[larger];
+        while (! victims.empty() && shared->bytes + size > util::BufferPool::SHARED_BYTES)
+        {
+          evicted.push_back(victims.back());
+          victims.pop_back();
+          shared->bytes-= classSize(larger);
+        }
+      }
+      if (shared->bytes + size <= util::BufferPool::SHARED_BYTES)
+      {
+        list.push_back(buffer);
+        shared->bytes+= size;
+        buffer= NULL;
+      }
+    }
+  }
+  /* freed without holding the lock */
+  for (vector<uint8_t *>::iterator it= evicted.begin();
+       it != evicted.end();
+       ++it)
+  {
+    delete [] *it;
+  }
+  delete [] buffer;
+}
+
+
+void flushThreadCache(void *arg)
+{
+  ThreadCache *cache= static_cast<ThreadCache *>(arg);
+  for (uint32_t index= 0; index < NUM_CLASSES; ++index)
+  {
+    while (cache->counts[index] > 0)
+    {
+      releaseShared(cache->buffers[index][--cache->counts[index]], index);
+    }
+  }
+  cache->registered= false;
+}
+
+
+void initShared()
+{
+  shared= new SharedLists();
+  pthread_key_create(&cache_key, flushThreadCache);
+}
+
+} /* end anonymous namespace */
+
+
+uint8_t *util::BufferPool::acquire(uint32_t size, uint32_t &capacity)
+{
+  capacity= getCapacity(size);
+  if (capacity > MAX_CLASS_SIZE)
+  {
+    return new uint8_t[capacity];
+  }
+  uint32_t index= classIndex(capacity);
+  ThreadCache &cache= thread_cache;
+  if (cache.counts[index] > 0)
+  {
+    return cache.buffers[index][--cache.counts[index]];
+  }
+  pthread_once(&shared_once, initShared);
+  {
+    ScopedLock guard(shared->lock);
+    vector<uint8_t *> &list= shared->lists[index];
+    if (! list.empty())
+    {
+      uint8_t *ret= list.back();
+      list.pop_back();
+      shared->bytes-= capacity;
+      return ret;
+    }
+  }
+  return new uint8_t[capacity];
+}
+
+
+void util::BufferPool::release(uint8_t *buffer, uint32_t capacity)
+{
+  if (buffer == NULL)
+  {
+    return;
+  }
+  if (capacity > MAX_CLASS_SIZE || capacity != getCapacity(capacity))
+  {
+    /* not one of ours */
+    delete [] buffer;
+    return;
+  }
+  uint32_t index= classIndex(capacity);
+  pthread_once(&shared_once, initShared);
+  ThreadCache &cache= thread_cache;
+  if (capacity <= THREAD_CACHE_MAX_SIZE && cache.counts[index] < THREAD_CACHE_DEPTH)
+  {
+    if (! cache.registered)
+    {
+      pthread_setspecific(cache_key, &cache);
+      cache.registered= true;
+    }
+    cache.buffers[index][cache.counts[index]++]= buffer;
+    return;
+  }
+  releaseShared(buffer, index);
+}
+
+
+uint32_t util::BufferPool::getCapacity(uint32_t size)
+{
+  if (size > MAX_CLASS_SIZE)
+  {
+    return size;
+  }
+  uint32_t ret= MIN_CLASS_SIZE;
+  while (ret < size)
+  {
+    ret<<= 1;
+  }
+  return ret;
+}
+
+
+size_t util::BufferPool::getCachedBytes()
+{
+  size_t ret= 0;
+  ThreadCache &cache= thread_cache;
+  for (uint32_t index= 0; index < NUM_CLASSES; ++index)
+  {
+    ret+= static_cast<size_t>(cache.counts[index]) * classSize(index);
+  }
+  pthread_once(&shared_once, initShared);
+  ScopedLock guard(shared->lock);
+  return ret + shared->bytes;
+}
+
+
+void util::BufferPool::trim()
+{
+  ThreadCache &cache= thread_cache;
+  for (uint32_t index= 0; index < NUM_CLASSES; ++index)
+  {
+    while (cache.counts[index] > 0)
+    {
+      delete [] cache.buffers[index][--cache.counts[index]];
+    }
+  }
+  pthread_once(&shared_once, initShared);
+  ScopedLock guard(shared->lock);
+  for (uint32_t index= 0; index < NUM_CLASSES; ++index)
+  {
+    vector<uint8_t *> &list= shared->lists[index];
+    for (vector<uint8_t *>::iterator it= list.begin();
+         it != list.end();
+         ++it)
+    {
+      delete [] *it;
+    }
+    list.clear();
+  }
+  shared->bytes= 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_UTIL_BUFFER_POOL_H
+#define __LIBCASSANDRA_UTIL_BUFFER_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace libcassandra
+{
+
+namespace util
+{
+
+/**
+ * @class BufferPool
+ * @brief
+ *   A process wide pool of byte buffers for transport frames. Sizes are
+ *   rounded up to a power of two between MIN_CLASS_SIZE and MAX_CLASS_SIZE
+ *   and every size class keeps its own free lists: a small cache per
+ *   thread, taken without locking, backed by a shared list behind a mutex
+ *   that a thread's cache spills into and refills from. Only classes up
+ *   to THREAD_CACHE_MAX_SIZE are cached per thread. The shared lists hold
+ *   at most SHARED_BYTES together; buffers of larger classes are freed to
+ *   make room for smaller ones. Requests above MAX_CLASS_SIZE are
+ *   allocated and freed as they come. A buffer may be released by a
+ *   different thread than the one that acquired it.
+ */
+class BufferPool
+{
+
+public:
+
+  static const uint32_t MIN_CLASS_SIZE= 512;
+  static const uint32_t MAX_CLASS_SIZE= 4 * 1024 * 1024;
+
+  /* buffers of one size class cached per thread */
+  static const uint32_t THREAD_CACHE_DEPTH= 4;
+
+  /* largest size class cached per thread, the transport's default max_retained */
+  static const uint32_t THREAD_CACHE_MAX_SIZE= 64 * 1024;
+
+  /* bytes kept on the shared lists of all size classes together */
+  static const size_t SHARED_BYTES= 16 * 1024 * 1024;
+
+  /**
+   * @param[in] size number of bytes wanted
+   * @param[out] capacity actual size of the returned buffer, to be passed
+   *             back to release()
+   * @return a buffer of at least size bytes; its content is undefined
+   */
+  static uint8_t *acquire(uint32_t size, uint32_t &capacity);
+
+  /**
+   * Give a buffer back to the pool
+   * @param[in] buffer a buffer from acquire(), or NULL
+   * @param[in] capacity the capacity acquire() returned for it
+   */
+  static void release(uint8_t *buffer, uint32_t capacity);
+
+  /**
+   * @return the capacity acquire() hands out for the given size
+   */
+  static uint32_t getCapacity(uint32_t size);
+
+  /**
+   * @return number of bytes held in free buffers by the calling thread's
+   *         cache and the shared lists
+   */
+  static size_t getCachedBytes();
+
+  /**
+   * Free the buffers held by the calling thread's cache and the shared lists
+   */
+  static void trim();
+
+private:
+
+  BufferPool();
+
+};
+
+} /* end namespace util */
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_UTIL_BUFFER_POOL_H */
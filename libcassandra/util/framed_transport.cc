@@ -0,0 +1,195 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <arpa/inet.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "libcassandra/util/buffer_pool.h"
+#include "libcassandra/util/framed_transport.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace apache::thrift::transport;
+
+
+const uint32_t util::PooledFramedTransport::DEFAULT_BUFFER_SIZE;
+const uint32_t util::PooledFramedTransport::DEFAULT_MAX_RETAINED;
+
+
+util::PooledFramedTransport::PooledFramedTransport(boost::shared_ptr<TTransport> in_transport,
+                                                   uint32_t in_max_retained)
+  :
+    transport(in_transport),
+    max_retained(max(in_max_retained, DEFAULT_BUFFER_SIZE)),
+    read_buffer(NULL),
+    read_capacity(0),
+    write_buffer(NULL),
+    write_capacity(0)
+{
+  write_buffer= BufferPool::acquire(DEFAULT_BUFFER_SIZE, write_capacity);
+  resetWriteBuffer();
+}
+
+
+util::PooledFramedTransport::~PooledFramedTransport()
+{
+  BufferPool::release(read_buffer, read_capacity);
+  BufferPool::release(write_buffer, write_capacity);
+}
+
+
+void util::PooledFramedTransport::flush()
+{
+  uint32_t size= static_cast<uint32_t>(wBase_ - write_buffer) - sizeof(uint32_t);
+  uint32_t size_net= htonl(size);
+  memcpy(write_buffer, &size_net, sizeof(size_net));
+  /* start the next frame first, so a failed write does not resend this one */
+  resetWriteBuffer();
+  if (size > 0)
+  {
+    transport->write(write_buffer, size + sizeof(uint32_t));
+  }
+  transport->flush();
+
+  if (write_capacity > max_retained)
+  {
+    BufferPool::release(write_buffer, write_capacity);
+    write_buffer= NULL;
+    write_capacity= 0;
+    write_buffer= BufferPool::acquire(DEFAULT_BUFFER_SIZE, write_capacity);
+    resetWriteBuffer();
+  }
+}
+
+
+uint32_t util::PooledFramedTransport::readEnd()
+{
+  uint32_t ret= static_cast<uint32_t>(rBound_ - read_buffer) + sizeof(uint32_t);
+  if (rBase_ == rBound_ && read_capacity > max_retained)
+  {
+    BufferPool::release(read_buffer, read_capacity);
+    read_buffer= NULL;
+    read_capacity= 0;
+    setReadBuffer(NULL, 0);
+  }
+  return ret;
+}
+
+
+uint32_t util::PooledFramedTransport::writeEnd()
+{
+  return static_cast<uint32_t>(wBase_ - write_buffer);
+}
+
+
+uint32_t util::PooledFramedTransport::readSlow(uint8_t *buf, uint32_t len)
+{
+  uint32_t want= len;
+  uint32_t have= static_cast<uint32_t>(rBound_ - rBase_);
+
+  /* the read runs past the end of the frame; hand out what is left first */
+  if (have > 0)
+  {
+    memcpy(buf, rBase_, have);
+    setReadBuffer(rBound_, 0);
+    buf+= have;
+    want-= have;
+  }
+
+  if (! readFrame())
+  {
+    return len - want;
+  }
+
+  uint32_t give= min(want, static_cast<uint32_t>(rBound_ - rBase_));
+  memcpy(buf, rBase_, give);
+  rBase_+= give;
+  want-= give;
+  return len - want;
+}
+
+
+void util::PooledFramedTransport::writeSlow(const uint8_t *buf, uint32_t len)
+{
+  uint32_t have= static_cast<uint32_t>(wBase_ - write_buffer);
+  if (len + have < have || len + have > 0x7fffffff)
+  {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "Attempted to write over 2 GB to PooledFramedTransport.");
+  }
+  /* at least double, so frames above the largest size class grow geometrically */
+  uint32_t wanted= max(len + have, min(write_capacity * 2, static_cast<uint32_t>(0x7fffffff)));
+  uint32_t new_capacity= 0;
+  uint8_t *new_buffer= BufferPool::acquire(wanted, new_capacity);
+  memcpy(new_buffer, write_buffer, have);
+  BufferPool::release(write_buffer, write_capacity);
+  write_buffer= new_buffer;
+  write_capacity= new_capacity;
+  setWriteBuffer(write_buffer, write_capacity);
+  wBase_= write_buffer + have;
+
+  memcpy(wBase_, buf, len);
+  wBase_+= len;
+}
+
+
+const uint8_t *util::PooledFramedTransport::borrowSlow(uint8_t *, uint32_t *)
+{
+  /* like TFramedTransport, only what is left of the current frame is lent */
+  return NULL;
+}
+
+
+bool util::PooledFramedTransport::readFrame()
+{
+  uint32_t size_net= 0;
+  uint32_t size_bytes_read= 0;
+  while (size_bytes_read < sizeof(size_net))
+  {
+    uint8_t *dest= reinterpret_cast<uint8_t *>(&size_net) + size_bytes_read;
+    uint32_t bytes_read= transport->read(dest, sizeof(size_net) - size_bytes_read);
+    if (bytes_read == 0)
+    {
+      if (size_bytes_read == 0)
+      {
+        return false;
+      }
+      throw TTransportException(TTransportException::END_OF_FILE,
+                                "No more data to read after partial frame header.");
+    }
+    size_bytes_read+= bytes_read;
+  }
+
+  int32_t size= static_cast<int32_t>(ntohl(size_net));
+  if (size < 0)
+  {
+    throw TTransportException("Frame size has negative value");
+  }
+
+  if (static_cast<uint32_t>(size) > read_capacity)
+  {
+    BufferPool::release(read_buffer, read_capacity);
+    read_buffer= NULL;
+    read_capacity= 0;
+    setReadBuffer(NULL, 0);
+    read_buffer= BufferPool::acquire(static_cast<uint32_t>(size), read_capacity);
+  }
+  transport->readAll(read_buffer, static_cast<uint32_t>(size));
+  setReadBuffer(read_buffer, static_cast<uint32_t>(size));
+  return true;
+}
+
+
+void util::PooledFramedTransport::resetWriteBuffer()
+{
+  setWriteBuffer(write_buffer, write_capacity);
+  wBase_+= sizeof(uint32_t);
+}
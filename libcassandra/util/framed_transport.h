@@ -0,0 +1,150 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_UTIL_FRAMED_TRANSPORT_H
+#define __LIBCASSANDRA_UTIL_FRAMED_TRANSPORT_H
+
+#include <stdint.h>
+
+#include <transport/TBufferTransports.h>
+
+namespace libcassandra
+{
+
+namespace util
+{
+
+/**
+ * @class PooledFramedTransport
+ * @brief
+ *   A framed transport, wire compatible with thrift's TFramedTransport,
+ *   whose read and write buffers come from the BufferPool. A buffer that
+ *   has grown past max_retained for a large frame goes back to the pool
+ *   once that frame has been read or sent, so a connection that served a
+ *   big scan does not keep megabytes around for the small requests that
+ *   follow, and a connection that is closed hands its buffers to the next
+ *   one instead of to the allocator.
+ */
+class PooledFramedTransport
+  : public apache::thrift::transport::TVirtualTransport<PooledFramedTransport,
+                                                        apache::thrift::transport::TBufferBase>
+{
+
+public:
+
+  static const uint32_t DEFAULT_BUFFER_SIZE= 4096;
+  static const uint32_t DEFAULT_MAX_RETAINED= 64 * 1024;
+
+  /**
+   * @param[in] in_transport the transport frames are sent over
+   * @param[in] in_max_retained largest buffer kept between frames; it is
+   *            never less than DEFAULT_BUFFER_SIZE
+   */
+  explicit PooledFramedTransport(boost::shared_ptr<apache::thrift::transport::TTransport> in_transport,
+                                 uint32_t in_max_retained= DEFAULT_MAX_RETAINED);
+  ~PooledFramedTransport();
+
+  void open()
+  {
+    transport->open();
+  }
+
+  bool isOpen()
+  {
+    return transport->isOpen();
+  }
+
+  bool peek()
+  {
+    return (rBase_ < rBound_) || transport->peek();
+  }
+
+  void close()
+  {
+    transport->close();
+  }
+
+  /**
+   * Send the frame written so far
+   */
+  void flush();
+
+  /**
+   * @return size of the frame just read, including its length; a read
+   *         buffer above max_retained is given back if the frame is done
+   */
+  uint32_t readEnd();
+
+  /**
+   * @return number of bytes written to the current frame, including its
+   *         length
+   */
+  uint32_t writeEnd();
+
+  boost::shared_ptr<apache::thrift::transport::TTransport> getUnderlyingTransport()
+  {
+    return transport;
+  }
+
+  /**
+   * @return capacity of the buffer frames are read into (0 if none is held)
+   */
+  uint32_t getReadCapacity() const
+  {
+    return read_capacity;
+  }
+
+  /**
+   * @return capacity of the buffer frames are written into
+   */
+  uint32_t getWriteCapacity() const
+  {
+    return write_capacity;
+  }
+
+  using apache::thrift::transport::TBufferBase::readAll;
+
+protected:
+
+  uint32_t readSlow(uint8_t *buf, uint32_t len);
+
+  void writeSlow(const uint8_t *buf, uint32_t len);
+
+  const uint8_t *borrowSlow(uint8_t *buf, uint32_t *len);
+
+private:
+
+  /* reads the next frame; false on a clean end of file */
+  bool readFrame();
+
+  /* resets the write pointers past the room kept for the frame length */
+  void resetWriteBuffer();
+
+  boost::shared_ptr<apache::thrift::transport::TTransport> transport;
+
+  uint32_t max_retained;
+
+  uint8_t *read_buffer;
+
+  uint32_t read_capacity;
+
+  uint8_t *write_buffer;
+
+  uint32_t write_capacity;
+
+  PooledFramedTransport(const PooledFramedTransport&);
+  PooledFramedTransport &operator=(const PooledFramedTransport&);
+
+};
+
+} /* end namespace util */
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_UTIL_FRAMED_TRANSPORT_H */
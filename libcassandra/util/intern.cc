@@ -0,0 +1,90 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string.h>
+
+#include <string>
+#include <utility>
+
+#include "libcassandra/util/intern.h"
+
+using namespace libcassandra;
+using namespace std;
+
+
+const size_t util::InternTable::DEFAULT_MAX_NAMES;
+const size_t util::InternTable::SHARD_COUNT;
+
+
+util::InternTable::InternTable(size_t in_max_names)
+  :
+    max_names(in_max_names),
+    max_shard_names((in_max_names + SHARD_COUNT - 1) / SHARD_COUNT)
+{}
+
+
+const string *util::InternTable::intern(const char *data, size_t length)
+{
+  uint64_t key= hash(data, length);
+  Shard &shard= shards[(key >> 32) % SHARD_COUNT];
+  ScopedLock guard(shard.lock);
+  pair<NameMap::iterator, NameMap::iterator> range= shard.names.equal_range(key);
+  for (NameMap::iterator it= range.first; it != range.second; ++it)
+  {
+    const string &name= it->second;
+    if (name.size() == length && (length == 0 || memcmp(name.data(), data, length) == 0))
+    {
+      return &name;
+    }
+  }
+  if (shard.names.size() >= max_shard_names)
+  {
+    return NULL;
+  }
+  NameMap::iterator it= shard.names.insert(NameMap::value_type(key, string(data, length)));
+  return &it->second;
+}
+
+
+const string *util::InternTable::intern(const string& name)
+{
+  return intern(name.data(), name.size());
+}
+
+
+size_t util::InternTable::size()
+{
+  size_t ret= 0;
+  for (size_t i= 0; i < SHARD_COUNT; ++i)
+  {
+    ScopedLock guard(shards[i].lock);
+    ret+= shards[i].names.size();
+  }
+  return ret;
+}
+
+
+size_t util::InternTable::getMaxNames() const
+{
+  return max_names;
+}
+
+
+uint64_t util::InternTable::hash(const char *data, size_t length)
+{
+  /* 64 bit FNV-1a */
+  uint64_t ret= 0xcbf29ce484222325ULL;
+  const unsigned char *bytes= reinterpret_cast<const unsigned char *>(data);
+  for (size_t i= 0; i < length; ++i)
+  {
+    ret^= bytes[i];
+    ret*= 0x100000001b3ULL;
+  }
+  return ret;
+}
@@ -0,0 +1,105 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_UTIL_INTERN_H
+#define __LIBCASSANDRA_UTIL_INTERN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <tr1/unordered_map>
+
+#include "libcassandra/util/mutex.h"
+
+namespace libcassandra
+{
+
+namespace util
+{
+
+/**
+ * @class InternTable
+ * @brief
+ *   The column names of arena results: only an ArenaSliceResult given a
+ *   table through setNameTable interns names, so that its column views
+ *   point at one shared copy of each name instead of copying it into the
+ *   arena. Nothing else in the library uses the table; results held as
+ *   std::string keep names of their own. intern() returns a pointer that
+ *   stays valid, and keeps its address, for as long as the table lives.
+ *   The table is split into shards with a lock each, so the results of
+ *   several threads can share it. It holds at most max_names names; once
+ *   full, names it does not know are not interned, which keeps a stream
+ *   of distinct names (a time series, say) from growing it without bound.
+ */
+class InternTable
+{
+
+public:
+
+  static const size_t DEFAULT_MAX_NAMES= 64 * 1024;
+
+  explicit InternTable(size_t in_max_names= DEFAULT_MAX_NAMES);
+  ~InternTable() {}
+
+  /**
+   * @param[in] data the name's bytes
+   * @param[in] length number of bytes in the name
+   * @return the interned copy of the name, or NULL if the table is full
+   *         and does not hold it
+   */
+  const std::string *intern(const char *data, size_t length);
+
+  /**
+   * @param[in] name the name
+   * @return the interned copy of the name, or NULL if the table is full
+   *         and does not hold it
+   */
+  const std::string *intern(const std::string& name);
+
+  /**
+   * @return number of names held
+   */
+  size_t size();
+
+  /**
+   * @return the largest number of names the table holds
+   */
+  size_t getMaxNames() const;
+
+private:
+
+  static const size_t SHARD_COUNT= 16;
+
+  /* names keyed by their hash; the nodes never move */
+  typedef std::tr1::unordered_multimap<uint64_t, std::string> NameMap;
+
+  struct Shard
+  {
+    Mutex lock;
+    NameMap names;
+  };
+
+  static uint64_t hash(const char *data, size_t length);
+
+  Shard shards[SHARD_COUNT];
+
+  size_t max_names;
+
+  size_t max_shard_names;
+
+  InternTable(const InternTable&);
+  InternTable &operator=(const InternTable&);
+
+};
+
+} /* end namespace util */
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_UTIL_INTERN_H */
@@ -0,0 +1,163 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_UTIL_MUTEX_H
+#define __LIBCASSANDRA_UTIL_MUTEX_H
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+namespace libcassandra
+{
+
+namespace util
+{
+
+/**
+ * @class Mutex
+ * @brief thin wrapper around a pthread mutex
+ */
+class Mutex
+{
+
+public:
+
+  Mutex()
+  {
+    pthread_mutex_init(&mutex, NULL);
+  }
+
+  ~Mutex()
+  {
+    pthread_mutex_destroy(&mutex);
+  }
+
+  void lock()
+  {
+    pthread_mutex_lock(&mutex);
+  }
+
+  void unlock()
+  {
+    pthread_mutex_unlock(&mutex);
+  }
+
+  pthread_mutex_t *getNativeHandle()
+  {
+    return &mutex;
+  }
+
+private:
+
+  pthread_mutex_t mutex;
+
+  Mutex(const Mutex&);
+  Mutex &operator=(const Mutex&);
+
+};
+
+/**
+ * @class ScopedLock
+ * @brief holds a mutex for the lifetime of the object
+ */
+class ScopedLock
+{
+
+public:
+
+  explicit ScopedLock(Mutex &in_mutex)
+    :
+      mutex(in_mutex)
+  {
+    mutex.lock();
+  }
+
+  ~ScopedLock()
+  {
+    mutex.unlock();
+  }
+
+private:
+
+  Mutex &mutex;
+
+  ScopedLock(const ScopedLock&);
+  ScopedLock &operator=(const ScopedLock&);
+
+};
+
+/**
+ * @class Condition
+ * @brief thin wrapper around a pthread condition variable
+ */
+class Condition
+{
+
+public:
+
+  Condition()
+  {
+    pthread_cond_init(&cond, NULL);
+  }
+
+  ~Condition()
+  {
+    pthread_cond_destroy(&cond);
+  }
+
+  /**
+   * Wait on this condition; the given mutex must be held by the caller
+   */
+  void wait(Mutex &mutex)
+  {
+    pthread_cond_wait(&cond, mutex.getNativeHandle());
+  }
+
+  /**
+   * Wait on this condition for at most the given number of milli-seconds
+   * @return false if the wait timed out; true otherwise
+   */
+  bool timedWait(Mutex &mutex, uint32_t timeout_ms)
+  {
+    struct timeval now;
+    struct timespec deadline;
+    gettimeofday(&now, NULL);
+    uint64_t nsec= static_cast<uint64_t>(now.tv_usec) * 1000 +
+                   static_cast<uint64_t>(timeout_ms % 1000) * 1000000;
+    deadline.tv_sec= now.tv_sec + (timeout_ms / 1000) + (nsec / 1000000000);
+    deadline.tv_nsec= nsec % 1000000000;
+    return (pthread_cond_timedwait(&cond, mutex.getNativeHandle(), &deadline) != ETIMEDOUT);
+  }
+
+  void signal()
+  {
+    pthread_cond_signal(&cond);
+  }
+
+  void broadcast()
+  {
+    pthread_cond_broadcast(&cond);
+  }
+
+private:
+
+  pthread_cond_t cond;
+
+  Condition(const Condition&);
+  Condition &operator=(const Condition&);
+
+};
+
+} /* end namespace util */
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_UTIL_MUTEX_H */
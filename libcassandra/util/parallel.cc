@@ -0,0 +1,411 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+#include <TApplicationException.h>
+#include <protocol/TProtocol.h>
+#include <transport/TTransportException.h>
+
+#include "libgenthrift/Cassandra.h"
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/exception.h"
+#include "libcassandra/util/mutex.h"
+#include "libcassandra/util/parallel.h"
+#include "libcassandra/util/pool.h"
+
+using namespace std;
+using namespace apache::thrift;
+using namespace apache::thrift::transport;
+using namespace org::apache::cassandra;
+using namespace libcassandra;
+
+namespace libcassandra
+{
+
+
+util::TaskError::TaskError()
+  :
+    type(NONE),
+    code(0),
+    message()
+{}
+
+
+void util::TaskError::capture()
+{
+  try
+  {
+    throw;
+  }
+  catch (InvalidRequestException &ire)
+  {
+    type= INVALID_REQUEST;
+    message= ire.why;
+  }
+  catch (NotFoundException &)
+  {
+    type= NOT_FOUND;
+  }
+  catch (UnavailableException &)
+  {
+    type= UNAVAILABLE;
+  }
+  catch (TimedOutException &)
+  {
+    type= TIMED_OUT;
+  }
+  catch (AuthenticationException &ae)
+  {
+    type= AUTHENTICATION;
+    message= ae.why;
+  }
+  catch (AuthorizationException &ae)
+  {
+    type= AUTHORIZATION;
+    message= ae.why;
+  }
+  catch (TTransportException &te)
+  {
+    type= TRANSPORT;
+    code= te.getType();
+    message= te.what();
+  }
+  catch (protocol::TProtocolException &pe)
+  {
+    type= PROTOCOL;
+    code= pe.getType();
+    message= pe.what();
+  }
+  catch (TApplicationException &ae)
+  {
+    type= APPLICATION;
+    code= ae.getType();
+    message= ae.what();
+  }
+  catch (TException &te)
+  {
+    type= THRIFT;
+    message= te.what();
+  }
+  catch (Error &e)
+  {
+    type= LIBRARY_ERROR;
+    code= e.getErrno();
+    message= e.what();
+  }
+  catch (Exception &e)
+  {
+    type= LIBRARY_EXCEPTION;
+    code= e.getErrno();
+    message= e.what();
+  }
+  catch (std::exception &e)
+  {
+    type= OTHER;
+    message= e.what();
+  }
+  catch (...)
+  {
+    type= OTHER;
+    message= "unknown error";
+  }
+}
+
+
+bool util::TaskError::isSet() const
+{
+  return (type != NONE);
+}
+
+
+bool util::TaskError::isTransportError() const
+{
+  return (type == TRANSPORT);
+}
+
+
+void util::TaskError::rethrow() const
+{
+  switch (type)
+  {
+  case NONE:
+    return;
+  case INVALID_REQUEST:
+    {
+      InvalidRequestException ire;
+      ire.why= message;
+      throw ire;
+    }
+  case NOT_FOUND:
+    throw NotFoundException();
+  case UNAVAILABLE:
+    throw UnavailableException();
+  case TIMED_OUT:
+    throw TimedOutException();
+  case AUTHENTICATION:
+    {
+      AuthenticationException ae;
+      ae.why= message;
+      throw ae;
+    }
+  case AUTHORIZATION:
+    {
+      AuthorizationException ae;
+      ae.why= message;
+      throw ae;
+    }
+  case TRANSPORT:
+    throw TTransportException(static_cast<TTransportException::TTransportExceptionType>(code),
+                              message);
+  case PROTOCOL:
+    throw protocol::TProtocolException(
+      static_cast<protocol::TProtocolException::TProtocolExceptionType>(code),
+      message);
+  case APPLICATION:
+    throw TApplicationException(
+      static_cast<TApplicationException::TApplicationExceptionType>(code),
+      message);
+  case THRIFT:
+    throw TException(message);
+  case LIBRARY_EXCEPTION:
+    throw Exception(message, code);
+  case LIBRARY_ERROR:
+    throw Error(message, code);
+  case OTHER:
+    throw Exception(message, 0);
+  }
+}
+
+
+namespace
+{
+
+/*
+ * state shared between all the threads working through one set of tasks
+ */
+struct TaskQueue
+{
+  TaskQueue(util::CassandraPool &in_pool,
+            const vector<util::Task *> &in_tasks,
+            const string &in_keyspace)
+    :
+      pool(in_pool),
+      tasks(in_tasks),
+      keyspace(in_keyspace),
+      next(0),
+      error(),
+      lock()
+  {}
+
+  util::CassandraPool &pool;
+  const vector<util::Task *> &tasks;
+  const string &keyspace;
+  size_t next;
+  util::TaskError error;
+  util::Mutex lock;
+};
+
+
+void runTaskOn(util::CassandraPool &pool,
+               const string &keyspace,
+               util::Task *task,
+               const string &host)
+{
+  tr1::shared_ptr<Cassandra> client= host.empty() ?
+                                     pool.getConnection() :
+                                     pool.getConnection(host);
+  util::TaskError error;
+  try
+  {
+    if (! keyspace.empty() && client->getCurrentKeyspace() != keyspace)
+    {
+      client->setKeyspace(keyspace);
+    }
+    task->run(*client);
+  }
+  catch (...)
+  {
+    error.capture();
+  }
+  if (error.isTransportError())
+  {
+    pool.discardConnection(client);
+  }
+  else
+  {
+    pool.releaseConnection(client);
+  }
+  error.rethrow();
+}
+
+
+void runTask(util::CassandraPool &pool, const string &keyspace, util::Task *task)
+{
+  vector<string> hosts(1, task->getHost());
+  vector<string> fallback= task->getFallbackHosts();
+  hosts.insert(hosts.end(), fallback.begin(), fallback.end());
+  for (size_t i= 0; ; ++i)
+  {
+    try
+    {
+      runTaskOn(pool, keyspace, task, hosts[i]);
+      return;
+    }
+    catch (TTransportException &)
+    {
+      /* the host could not be reached or dropped the connection */
+      if (i + 1 >= hosts.size())
+      {
+        throw;
+      }
+    }
+  }
+}
+
+
+void *runTaskQueue(void *arg)
+{
+  TaskQueue *queue= static_cast<TaskQueue *>(arg);
+  for (;;)
+  {
+    util::Task *task= NULL;
+    {
+      util::ScopedLock guard(queue->lock);
+      if (queue->error.isSet() || queue->next >= queue->tasks.size())
+      {
+        break;
+      }
+      task= queue->tasks[queue->next++];
+    }
+    try
+    {
+      runTask(queue->pool, queue->keyspace, task);
+    }
+    catch (...)
+    {
+      util::ScopedLock guard(queue->lock);
+      if (! queue->error.isSet())
+      {
+        queue->error.capture();
+      }
+    }
+  }
+  return NULL;
+}
+
+} /* end anonymous namespace */
+
+
+util::AsyncTask::AsyncTask(CassandraPool &in_pool, const string &in_keyspace)
+  :
+    pool(in_pool),
+    keyspace(in_keyspace),
+    task(NULL),
+    thread(),
+    running(false),
+    error()
+{}
+
+
+util::AsyncTask::~AsyncTask()
+{
+  if (running)
+  {
+    pthread_join(thread, NULL);
+  }
+}
+
+
+void util::AsyncTask::start(Task &in_task)
+{
+  task= &in_task;
+  error= TaskError();
+  if (pthread_create(&thread, NULL, AsyncTask::run, this) != 0)
+  {
+    /* no thread available; do the work right away instead */
+    run(this);
+    return;
+  }
+  running= true;
+}
+
+
+void util::AsyncTask::wait()
+{
+  if (running)
+  {
+    pthread_join(thread, NULL);
+    running= false;
+  }
+  TaskError ret= error;
+  error= TaskError();
+  ret.rethrow();
+}
+
+
+bool util::AsyncTask::isRunning() const
+{
+  return running;
+}
+
+
+void *util::AsyncTask::run(void *arg)
+{
+  AsyncTask *async= static_cast<AsyncTask *>(arg);
+  try
+  {
+    runTask(async->pool, async->keyspace, async->task);
+  }
+  catch (...)
+  {
+    async->error.capture();
+  }
+  return NULL;
+}
+
+
+void util::runTasks(CassandraPool &pool,
+                    const vector<Task *> &tasks,
+                    uint32_t max_threads,
+                    const string &keyspace)
+{
+  TaskQueue queue(pool, tasks, keyspace);
+  size_t num_threads= tasks.size();
+  if (num_threads > max_threads)
+  {
+    num_threads= max_threads;
+  }
+  vector<pthread_t> threads;
+  for (size_t i= 1; i < num_threads; ++i)
+  {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, runTaskQueue, &queue) != 0)
+    {
+      /* carry on with the threads we managed to start */
+      break;
+    }
+    threads.push_back(thread);
+  }
+  runTaskQueue(&queue);
+  for (vector<pthread_t>::iterator it= threads.begin();
+       it != threads.end();
+       ++it)
+  {
+    pthread_join(*it, NULL);
+  }
+  queue.error.rethrow();
+}
+
+
+} /* end namespace libcassandra */
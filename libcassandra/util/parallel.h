@@ -0,0 +1,215 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_UTIL_PARALLEL_H
+#define __LIBCASSANDRA_UTIL_PARALLEL_H
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+namespace libcassandra
+{
+
+class Cassandra;
+
+namespace util
+{
+
+class CassandraPool;
+
+/**
+ * @class Task
+ * @brief a unit of work to be run against a pooled connection
+ */
+class Task
+{
+
+public:
+
+  virtual ~Task() {}
+
+  /**
+   * @return the host this task should run on; empty if any host will do
+   */
+  virtual std::string getHost() const
+  {
+    return std::string();
+  }
+
+  /**
+   * @return hosts to move to, in order, when the task's host cannot be
+   *         reached or its connection fails; an empty name stands for
+   *         any pooled connection. The task is run again from the start
+   *         on each of them, so only tasks that only read should list any.
+   */
+  virtual std::vector<std::string> getFallbackHosts() const
+  {
+    return std::vector<std::string>();
+  }
+
+  /**
+   * Perform the work using the given connection
+   * @param[in] client connection to use; it is only valid for this call
+   */
+  virtual void run(Cassandra &client)= 0;
+
+};
+
+/**
+ * @class TaskError
+ * @brief
+ *   Remembers an exception raised on a worker thread so that it can be
+ *   thrown again on the thread that waits for the work to finish. The
+ *   Cassandra exceptions, the thrift transport, protocol and application
+ *   exceptions (with their type) and libcassandra::Exception and Error
+ *   (with their errno) are thrown again as the same type; anything else
+ *   comes back as a libcassandra::Exception with the same message.
+ */
+class TaskError
+{
+
+public:
+
+  TaskError();
+  ~TaskError() {}
+
+  /**
+   * Record the exception currently being handled. Must be called from
+   * within a catch block.
+   */
+  void capture();
+
+  /**
+   * @return true if an exception has been recorded; false otherwise
+   */
+  bool isSet() const;
+
+  /**
+   * @return true if the recorded exception was a transport error
+   */
+  bool isTransportError() const;
+
+  /**
+   * Throw the recorded exception, if any
+   */
+  void rethrow() const;
+
+private:
+
+  enum ErrorType
+  {
+    NONE= 0,
+    INVALID_REQUEST,
+    NOT_FOUND,
+    UNAVAILABLE,
+    TIMED_OUT,
+    AUTHENTICATION,
+    AUTHORIZATION,
+    TRANSPORT,
+    PROTOCOL,
+    APPLICATION,
+    THRIFT,
+    LIBRARY_EXCEPTION,
+    LIBRARY_ERROR,
+    OTHER
+  };
+
+  ErrorType type;
+
+  /* the thrift exception's type or the libcassandra exception's errno */
+  int code;
+
+  std::string message;
+
+};
+
+/**
+ * @class AsyncTask
+ * @brief
+ *   Runs a single task on its own thread using a pooled connection so
+ *   that the caller can keep working while the request is in flight.
+ */
+class AsyncTask
+{
+
+public:
+
+  /**
+   * @param[in] in_pool where the connection is taken from
+   * @param[in] in_keyspace keyspace the connection is switched to (optional)
+   */
+  AsyncTask(CassandraPool &in_pool, const std::string &in_keyspace);
+
+  /**
+   * Waits for a running task to finish; any error it raised is dropped
+   */
+  ~AsyncTask();
+
+  /**
+   * Start running the given task. A previously started task must have
+   * been waited for.
+   * @param[in] in_task work to perform; must outlive the call to wait()
+   */
+  void start(Task &in_task);
+
+  /**
+   * Wait for the running task to finish and throw the error it raised,
+   * if any. Does nothing if no task is running.
+   */
+  void wait();
+
+  /**
+   * @return true if a task has been started and not yet waited for
+   */
+  bool isRunning() const;
+
+private:
+
+  static void *run(void *arg);
+
+  CassandraPool &pool;
+
+  std::string keyspace;
+
+  Task *task;
+
+  pthread_t thread;
+
+  bool running;
+
+  TaskError error;
+
+  AsyncTask(const AsyncTask&);
+  AsyncTask &operator=(const AsyncTask&);
+
+};
+
+/**
+ * Run the given tasks concurrently using connections from the pool. The
+ * calling thread takes part in the work. A task whose connection fails
+ * with a transport error moves on to its fallback hosts. If any task
+ * fails otherwise, or runs out of hosts, no further tasks are started
+ * and the first failure is thrown once all running tasks have finished.
+ * @param[in] pool where connections are taken from
+ * @param[in] tasks work to perform; ownership stays with the caller
+ * @param[in] max_threads maximum number of tasks running at once
+ * @param[in] keyspace keyspace each connection is switched to (optional)
+ */
+void runTasks(CassandraPool &pool,
+              const std::vector<Task *> &tasks,
+              uint32_t max_threads,
+              const std::string &keyspace);
+
+} /* end namespace util */
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_UTIL_PARALLEL_H */
@@ -0,0 +1,376 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <sstream>
+
+#include "libcassandra/cassandra.h"
+#include "libcassandra/cassandra_factory.h"
+#include "libcassandra/schema_cache.h"
+#include "libcassandra/util/pool.h"
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+namespace libcassandra
+{
+
+
+static string createServerURL(const string& hostname, int port)
+{
+  ostringstream url;
+  url << hostname << ":" << port;
+  return url.str();
+}
+
+
+util::CassandraPool::CassandraPool(const string& hostname,
+                                   int port,
+                                   uint32_t initial,
+                                   uint32_t max)
+  :
+    max_size(max),
+    current_size(0),
+    default_port(port),
+    next_server(0),
+    unique_hosts(),
+    servers(),
+    clients(),
+    value_codecs(),
+    rings(),
+    ring_partitioner(),
+    ring_generation(0),
+    lock(),
+    available()
+{
+  addServer(hostname, port, initial);
+}
+
+
+bool util::CassandraPool::addServer(const string& hostname, int port, uint32_t count)
+{
+  {
+    ScopedLock guard(lock);
+    if (unique_hosts.insert(createServerURL(hostname, port)).second)
+    {
+      servers.push_back(make_pair(hostname, port));
+    }
+  }
+  for (uint32_t i= 0; i < count; ++i)
+  {
+    tr1::shared_ptr<Cassandra> client;
+    try
+    {
+      client= createConnection(hostname, port);
+    }
+    catch (std::exception&)
+    {
+      return false;
+    }
+    if (! addConnection(client))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool util::CassandraPool::addConnection(tr1::shared_ptr<Cassandra> client)
+{
+  ScopedLock guard(lock);
+  if (current_size >= max_size)
+  {
+    return false;
+  }
+  ++current_size;
+  configure(*client);
+  clients.push_back(client);
+  available.signal();
+  return true;
+}
+
+
+tr1::shared_ptr<Cassandra> util::CassandraPool::getConnection()
+{
+  string hostname;
+  int port= 0;
+  {
+    ScopedLock guard(lock);
+    while (clients.empty() && current_size >= max_size)
+    {
+      available.wait(lock);
+    }
+    if (! clients.empty())
+    {
+      tr1::shared_ptr<Cassandra> ret= clients.back();
+      clients.pop_back();
+      return ret;
+    }
+    ++current_size;
+    hostname= servers[next_server].first;
+    port= servers[next_server].second;
+    next_server= (next_server + 1) % servers.size();
+  }
+  try
+  {
+    return createConnection(hostname, port);
+  }
+  catch (...)
+  {
+    ScopedLock guard(lock);
+    --current_size;
+    dropRings();
+    available.signal();
+    throw;
+  }
+}
+
+
+tr1::shared_ptr<Cassandra> util::CassandraPool::getConnection(const string& hostname)
+{
+  int port= default_port;
+  {
+    ScopedLock guard(lock);
+    for (;;)
+    {
+      tr1::shared_ptr<Cassandra> ret= takeIdle(hostname);
+      if (ret)
+      {
+        return ret;
+      }
+      if (current_size < max_size)
+      {
+        break;
+      }
+      if (! clients.empty())
+      {
+        /* close an idle connection to some other host; its slot is reused */
+        clients.pop_back();
+        --current_size;
+        break;
+      }
+      available.wait(lock);
+    }
+    ++current_size;
+    for (vector<pair<string, int> >::iterator it= servers.begin();
+         it != servers.end();
+         ++it)
+    {
+      if (it->first == hostname)
+      {
+        port= it->second;
+        break;
+      }
+    }
+  }
+  try
+  {
+    return createConnection(hostname, port);
+  }
+  catch (...)
+  {
+    ScopedLock guard(lock);
+    --current_size;
+    dropRings();
+    available.signal();
+    throw;
+  }
+}
+
+
+void util::CassandraPool::releaseConnection(tr1::shared_ptr<Cassandra> client)
+{
+  ScopedLock guard(lock);
+  if (client->getValueCodecs() != value_codecs)
+  {
+    configure(*client);
+  }
+  clients.push_back(client);
+  available.signal();
+}
+
+
+void util::CassandraPool::discardConnection(tr1::shared_ptr<Cassandra>)
+{
+  ScopedLock guard(lock);
+  --current_size;
+  dropRings();
+  available.signal();
+}
+
+
+void util::CassandraPool::setValueCodec(const string& column_family,
+                                        const tr1::shared_ptr<ValueCodec> &codec)
+{
+  ScopedLock guard(lock);
+  if (codec)
+  {
+    value_codecs[column_family]= codec;
+  }
+  else
+  {
+    value_codecs.erase(column_family);
+  }
+  for (vector<tr1::shared_ptr<Cassandra> >::iterator it= clients.begin();
+       it != clients.end();
+       ++it)
+  {
+    (*it)->setValueCodec(column_family, codec);
+  }
+}
+
+
+uint32_t util::CassandraPool::getMaxSize() const
+{
+  return max_size;
+}
+
+
+uint32_t util::CassandraPool::getSize()
+{
+  ScopedLock guard(lock);
+  return current_size;
+}
+
+
+vector<string> util::CassandraPool::getHosts()
+{
+  ScopedLock guard(lock);
+  vector<string> ret;
+  set<string> seen;
+  for (vector<pair<string, int> >::iterator it= servers.begin();
+       it != servers.end();
+       ++it)
+  {
+    if (seen.insert(it->first).second)
+    {
+      ret.push_back(it->first);
+    }
+  }
+  for (vector<tr1::shared_ptr<Cassandra> >::iterator it= clients.begin();
+       it != clients.end();
+       ++it)
+  {
+    if (seen.insert((*it)->getHost()).second)
+    {
+      ret.push_back((*it)->getHost());
+    }
+  }
+  return ret;
+}
+
+
+void util::CassandraPool::getRing(Cassandra &client,
+                                  const string& keyspace,
+                                  vector<TokenRange>& ring,
+                                  string& partitioner)
+{
+  string schema_version;
+  bool schema_stale= false;
+  tr1::shared_ptr<SchemaCache> schema_cache= client.getSchemaCache();
+  if (schema_cache)
+  {
+    schema_stale= schema_cache->isStale();
+    schema_version= schema_cache->getVersion();
+  }
+  uint64_t started;
+  {
+    ScopedLock guard(lock);
+    map<string, RingEntry>::iterator it= rings.find(keyspace);
+    if (it != rings.end() &&
+        ! schema_stale &&
+        it->second.schema_version == schema_version)
+    {
+      ring= it->second.ring;
+      partitioner= ring_partitioner;
+      return;
+    }
+    started= ring_generation;
+  }
+  ring= client.describeRing(keyspace);
+  partitioner= client.describePartitioner();
+  ScopedLock guard(lock);
+  if (ring_generation == started)
+  {
+    RingEntry &entry= rings[keyspace];
+    entry.ring= ring;
+    entry.schema_version= schema_version;
+    ring_partitioner= partitioner;
+  }
+}
+
+
+void util::CassandraPool::invalidateRing()
+{
+  ScopedLock guard(lock);
+  dropRings();
+}
+
+
+void util::CassandraPool::dropRings()
+{
+  rings.clear();
+  ++ring_generation;
+}
+
+
+tr1::shared_ptr<Cassandra> util::CassandraPool::createConnection(const string& hostname,
+                                                                 int port)
+{
+  CassandraFactory factory(hostname, port);
+  {
+    ScopedLock guard(lock);
+    factory.setValueCodecs(value_codecs);
+  }
+  return factory.create();
+}
+
+
+void util::CassandraPool::configure(Cassandra &client) const
+{
+  /* drop codecs the pool no longer has, then set the pool's */
+  map<string, tr1::shared_ptr<ValueCodec> > stale= client.getValueCodecs();
+  for (map<string, tr1::shared_ptr<ValueCodec> >::iterator it= stale.begin();
+       it != stale.end();
+       ++it)
+  {
+    if (value_codecs.find(it->first) == value_codecs.end())
+    {
+      client.setValueCodec(it->first, tr1::shared_ptr<ValueCodec>());
+    }
+  }
+  for (map<string, tr1::shared_ptr<ValueCodec> >::const_iterator it= value_codecs.begin();
+       it != value_codecs.end();
+       ++it)
+  {
+    client.setValueCodec(it->first, it->second);
+  }
+}
+
+
+tr1::shared_ptr<Cassandra> util::CassandraPool::takeIdle(const string& hostname)
+{
+  for (vector<tr1::shared_ptr<Cassandra> >::iterator it= clients.begin();
+       it != clients.end();
+       ++it)
+  {
+    if ((*it)->getHost() == hostname)
+    {
+      tr1::shared_ptr<Cassandra> ret= *it;
+      clients.erase(it);
+      return ret;
+    }
+  }
+  return tr1::shared_ptr<Cassandra>();
+}
+
+
+} /* end namespace libcassandra */
@@ -12,10 +12,12 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <set>
 #include <tr1/memory>
 
 #include "libcassandra/cassandra.h"
+#include "libcassandra/util/mutex.h"
 
 namespace libcassandra
 {
@@ -23,9 +25,18 @@ namespace libcassandra
 namespace util
 {
 
+/**
+ * @class CassandraPool
+ * @brief
+ *   A thread safe pool of connections to one or more cassandra servers.
+ *   At most max connections are open at any time; callers asking for a
+ *   connection when all of them are in use block until one is released.
+ */
 class CassandraPool
 {
 
+public:
+
   CassandraPool(const std::string& hostname,
                 int port,
                 uint32_t initial,
@@ -47,24 +58,134 @@ class CassandraPool
    * @param[in] client an instance of a Cassandra client
    * @return true on sucess; false otherwise
    */
-  bool addConnection(tr1::shared_ptr<Cassandra> client);
+  bool addConnection(std::tr1::shared_ptr<Cassandra> client);
 
   /**
    * This function returns a Cassandra connection object
    * and removes it from the pool of connections
    * @return a connection from the pool of connections
    */
-  tr1::shared_ptr<Cassandra> getConnection();
+  std::tr1::shared_ptr<Cassandra> getConnection();
+
+  /**
+   * Returns a connection to the given host, opening one on the pool's
+   * port if none is idle. Idle connections to other hosts are closed to
+   * make room when the pool is full.
+   * @param[in] hostname host the connection should be made to
+   * @return a connection from the pool of connections
+   */
+  std::tr1::shared_ptr<Cassandra> getConnection(const std::string& hostname);
+
+  /**
+   * Give a connection obtained through getConnection back to the pool
+   * @param[in] client the connection to return
+   */
+  void releaseConnection(std::tr1::shared_ptr<Cassandra> client);
+
+  /**
+   * Drop a connection obtained through getConnection that is no longer
+   * usable, for instance after a transport error
+   * @param[in] client the connection to drop
+   */
+  void discardConnection(std::tr1::shared_ptr<Cassandra> client);
+
+  /**
+   * Set a value codec on the pool's connections (see
+   * Cassandra::setValueCodec). Idle connections and connections opened
+   * later get it at once; a connection that is out gets it when it is
+   * released.
+   * @param[in] column_family column family the codec applies to
+   * @param[in] codec the codec to use; an empty pointer removes it
+   */
+  void setValueCodec(const std::string& column_family,
+                     const std::tr1::shared_ptr<ValueCodec> &codec);
+
+  /**
+   * @return maximum number of connections this pool keeps open
+   */
+  uint32_t getMaxSize() const;
+
+  /**
+   * @return number of connections open, whether idle or handed out
+   */
+  uint32_t getSize();
+
+  /**
+   * @return the hosts of the pool's servers and of its idle connections,
+   *         each once
+   */
+  std::vector<std::string> getHosts();
+
+  /**
+   * Look up the token ring of a keyspace and the cluster's partitioner.
+   * They are described through the given connection the first time and
+   * kept until a connection of the pool is discarded or fails to open,
+   * as the ring may have changed, or until the client's schema cache
+   * holds another schema version.
+   * @param[in] client connection the ring is described through
+   * @param[in] keyspace keyspace whose ring is wanted
+   * @param[out] ring the token ranges of the keyspace
+   * @param[out] partitioner class name of the cluster's partitioner
+   */
+  void getRing(Cassandra &client,
+               const std::string& keyspace,
+               std::vector<org::apache::cassandra::TokenRange>& ring,
+               std::string& partitioner);
+
+  /**
+   * Make the next getRing describe the ring again
+   */
+  void invalidateRing();
 
 private:
 
+  struct RingEntry
+  {
+    std::vector<org::apache::cassandra::TokenRange> ring;
+    /* version of the client's schema cache when described, if any */
+    std::string schema_version;
+  };
+
+  /* must be called with the lock held */
+  void dropRings();
+
+  std::tr1::shared_ptr<Cassandra> createConnection(const std::string& hostname,
+                                                   int port);
+
+  std::tr1::shared_ptr<Cassandra> takeIdle(const std::string& hostname);
+
+  /* brings a connection's codecs in line with the pool's */
+  void configure(Cassandra &client) const;
+
   uint32_t max_size;
 
   uint32_t current_size;
 
+  int default_port;
+
+  size_t next_server;
+
   std::set<std::string> unique_hosts;
 
-  std::vector<tr1::shared_ptr<Cassandra> > clients;
+  std::vector<std::pair<std::string, int> > servers;
+
+  std::vector<std::tr1::shared_ptr<Cassandra> > clients;
+
+  std::map<std::string, std::tr1::shared_ptr<ValueCodec> > value_codecs;
+
+  std::map<std::string, RingEntry> rings;
+
+  std::string ring_partitioner;
+
+  /* bumped whenever the rings are dropped, so a describe racing it is not kept */
+  uint64_t ring_generation;
+
+  Mutex lock;
+
+  Condition available;
+
+  CassandraPool(const CassandraPool&);
+  CassandraPool &operator=(const CassandraPool&);
 
 };
 
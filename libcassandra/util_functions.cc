@@ -8,6 +8,9 @@
  */
 
 #include <sys/time.h>
+#include <time.h>
+#include <endian.h>
+#include <string.h>
 
 #include <string>
 #include <sstream>
@@ -19,6 +22,71 @@
 using namespace std;
 using namespace org::apache::cassandra;
 
+namespace
+{
+
+inline uint64_t toBigEndian64(uint64_t v)
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+  return v;
+#else
+  return __builtin_bswap64(v);
+#endif
+}
+
+
+inline uint32_t toBigEndian32(uint32_t v)
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+  return v;
+#else
+  return __builtin_bswap32(v);
+#endif
+}
+
+
+/*
+ * byte swaps count 8 byte values; the same operation encodes and decodes.
+ * The loop is simple enough for the compiler to vectorize where the
+ * target allows it.
+ */
+void swapBytes64(const char *in, size_t count, char *out)
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+  memcpy(out, in, count * 8);
+#else
+  for (size_t i= 0; i < count; ++i)
+  {
+    uint64_t v;
+    memcpy(&v, in + i * 8, 8);
+    v= __builtin_bswap64(v);
+    memcpy(out + i * 8, &v, 8);
+  }
+#endif
+}
+
+
+/*
+ * byte swaps count 4 byte values
+ */
+void swapBytes32(const char *in, size_t count, char *out)
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+  memcpy(out, in, count * 4);
+#else
+  for (size_t i= 0; i < count; ++i)
+  {
+    uint32_t v;
+    memcpy(&v, in + i * 4, 4);
+    v= __builtin_bswap32(v);
+    memcpy(out + i * 4, &v, 4);
+  }
+#endif
+}
+
+} /* end anonymous namespace */
+
+
 namespace libcassandra
 {
 
@@ -223,28 +291,62 @@ SlicePredicate createSlicePredicateObject(const IndexedSlicesQuery& query)
 }
 
 
-vector<Column> getColumnList(vector<ColumnOrSuperColumn>& cols)
+void moveColumn(Column& from, Column& to)
 {
-  vector<Column> ret(cols.size());
+  to.name.swap(from.name);
+  to.value.swap(from.value);
+  to.timestamp= from.timestamp;
+  to.ttl= from.ttl;
+  to.__isset= from.__isset;
+}
+
+
+void moveColumns(vector<ColumnOrSuperColumn>& cols, vector<Column>& ret)
+{
+  ret.reserve(ret.size() + cols.size());
   for (vector<ColumnOrSuperColumn>::iterator it= cols.begin();
        it != cols.end();
        ++it)
   {
-    ret.push_back((*it).column);
+    if (! (*it).column.name.empty())
+    {
+      ret.push_back(Column());
+      moveColumn((*it).column, ret.back());
+    }
   }
-  return ret;
 }
 
 
-vector<SuperColumn> getSuperColumnList(vector<ColumnOrSuperColumn>& cols)
+void moveSuperColumns(vector<ColumnOrSuperColumn>& cols, vector<SuperColumn>& ret)
 {
-  vector<SuperColumn> ret(cols.size());
+  ret.reserve(ret.size() + cols.size());
   for (vector<ColumnOrSuperColumn>::iterator it= cols.begin();
        it != cols.end();
        ++it)
   {
-    ret.push_back((*it).super_column);
-  } return ret;
+    if (! (*it).super_column.name.empty())
+    {
+      ret.push_back(SuperColumn());
+      ret.back().name.swap((*it).super_column.name);
+      ret.back().columns.swap((*it).super_column.columns);
+    }
+  }
+}
+
+
+vector<Column> getColumnList(vector<ColumnOrSuperColumn>& cols)
+{
+  vector<Column> ret;
+  moveColumns(cols, ret);
+  return ret;
+}
+
+
+vector<SuperColumn> getSuperColumnList(vector<ColumnOrSuperColumn>& cols)
+{
+  vector<SuperColumn> ret;
+  moveSuperColumns(cols, ret);
+  return ret;
 }
 
 
@@ -256,42 +358,123 @@ int64_t createTimestamp()
 }
 
 
+int64_t createMonotonicTimestamp()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000 + (int64_t) ts.tv_nsec / 1000;
+}
+
+
 string serializeLong(int64_t t)
 {
-  unsigned char raw_array[8];
-  raw_array[0]= (t >> 56) & 0xff;
-  raw_array[1]= (t >> 48) & 0xff;
-  raw_array[2]= (t >> 40) & 0xff;
-  raw_array[3]= (t >> 32) & 0xff;
-  raw_array[4]= (t >> 24) & 0xff;
-  raw_array[5]= (t >> 16) & 0xff;
-  raw_array[6]= (t >> 8) & 0xff;
-  raw_array[7]= t & 0xff;
-  return string(reinterpret_cast<const char *>(raw_array), 8);
+  char raw_array[8];
+  encodeLong(t, raw_array);
+  return string(raw_array, 8);
 }
 
 
 int64_t deserializeLong(string& t)
 {
-  int64_t ret= 0;
-  int64_t tmp= 0;
-  unsigned char *raw_array= reinterpret_cast<unsigned char *>(const_cast<char *>(t.c_str()));
-  ret|= raw_array[7];
-  tmp= raw_array[6];
-  ret|= (tmp << 8);
-  tmp= raw_array[5];
-  ret|= (tmp << 16);
-  tmp= raw_array[4];
-  ret|= (tmp << 24);
-  tmp= raw_array[3];
-  ret|= (tmp << 32);
-  tmp= raw_array[2];
-  ret|= (tmp << 40);
-  tmp= raw_array[1];
-  ret|= (tmp << 48);
-  tmp= raw_array[0];
-  ret|= (tmp << 56);
+  return decodeLong(t.data());
+}
+
+
+void encodeLong(int64_t value, char *out)
+{
+  uint64_t v= toBigEndian64(static_cast<uint64_t>(value));
+  memcpy(out, &v, 8);
+}
+
+
+int64_t decodeLong(const char *in)
+{
+  uint64_t v;
+  memcpy(&v, in, 8);
+  return static_cast<int64_t>(toBigEndian64(v));
+}
+
+
+void encodeInt(int32_t value, char *out)
+{
+  uint32_t v= toBigEndian32(static_cast<uint32_t>(value));
+  memcpy(out, &v, 4);
+}
+
+
+int32_t decodeInt(const char *in)
+{
+  uint32_t v;
+  memcpy(&v, in, 4);
+  return static_cast<int32_t>(toBigEndian32(v));
+}
+
+
+void encodeDouble(double value, char *out)
+{
+  uint64_t v;
+  memcpy(&v, &value, 8);
+  v= toBigEndian64(v);
+  memcpy(out, &v, 8);
+}
+
+
+double decodeDouble(const char *in)
+{
+  uint64_t v;
+  memcpy(&v, in, 8);
+  v= toBigEndian64(v);
+  double ret;
+  memcpy(&ret, &v, 8);
   return ret;
 }
 
+
+void encodeLongs(const int64_t *in, size_t count, char *out)
+{
+  swapBytes64(reinterpret_cast<const char *>(in), count, out);
+}
+
+
+void decodeLongs(const char *in, size_t count, int64_t *out)
+{
+  swapBytes64(in, count, reinterpret_cast<char *>(out));
+}
+
+
+void encodeInts(const int32_t *in, size_t count, char *out)
+{
+  swapBytes32(reinterpret_cast<const char *>(in), count, out);
+}
+
+
+void decodeInts(const char *in, size_t count, int32_t *out)
+{
+  swapBytes32(in, count, reinterpret_cast<char *>(out));
+}
+
+
+void encodeDoubles(const double *in, size_t count, char *out)
+{
+  swapBytes64(reinterpret_cast<const char *>(in), count, out);
+}
+
+
+void decodeDoubles(const char *in, size_t count, double *out)
+{
+  swapBytes64(in, count, reinterpret_cast<char *>(out));
+}
+
+
+void encodeUUIDs(const uint64_t *in, size_t count, char *out)
+{
+  swapBytes64(reinterpret_cast<const char *>(in), count * 2, out);
+}
+
+
+void decodeUUIDs(const char *in, size_t count, uint64_t *out)
+{
+  swapBytes64(in, count * 2, reinterpret_cast<char *>(out));
+}
+
 } /* end namespace libcassandra */
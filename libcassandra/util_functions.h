@@ -68,9 +68,36 @@ org::apache::cassandra::CfDef createCfDefObject(const ColumnFamilyDefinition& ks
  */
 org::apache::cassandra::SlicePredicate createSlicePredicateObject(const IndexedSlicesQuery& query);
 
+/**
+ * Hand the contents of one column over to another without copying the
+ * name and value
+ * @param[in] from column to take the contents of; left with empty strings
+ * @param[out] to column receiving the contents
+ */
+void moveColumn(org::apache::cassandra::Column& from,
+                org::apache::cassandra::Column& to);
+
+/**
+ * Move the columns out of a vector of columns or super columns, skipping
+ * entries that hold no column
+ * @param[in] cols vector to process; its column names and values are taken
+ * @param[out] ret vector the columns are appended to
+ */
+void moveColumns(std::vector<org::apache::cassandra::ColumnOrSuperColumn>& cols,
+                 std::vector<org::apache::cassandra::Column>& ret);
+
+/**
+ * Move the super columns out of a vector of columns or super columns,
+ * skipping entries that hold no super column
+ * @param[in] cols vector to process; its super columns are taken
+ * @param[out] ret vector the super columns are appended to
+ */
+void moveSuperColumns(std::vector<org::apache::cassandra::ColumnOrSuperColumn>& cols,
+                      std::vector<org::apache::cassandra::SuperColumn>& ret);
+
 /**
  * Extract the columns from the vector of columns or super columns
- * @param[in] cols vector to process
+ * @param[in] cols vector to process; its columns are moved out
  * @return vector of Column objects
  */
 std::vector<org::apache::cassandra::Column>
@@ -78,7 +105,7 @@ getColumnList(std::vector<org::apache::cassandra::ColumnOrSuperColumn>& cols);
 
 /**
  * Extract the super columns from the vector of columns or super columns
- * @param[in] cols vector to process
+ * @param[in] cols vector to process; its super columns are moved out
  * @return vector of SuperColumn objects
  */
 std::vector<org::apache::cassandra::SuperColumn>
@@ -89,6 +116,12 @@ getSuperColumnList(std::vector<org::apache::cassandra::ColumnOrSuperColumn>& col
  */
 int64_t createTimestamp();
 
+/**
+ * @return micro-seconds since an unspecified point, from a clock that is
+ *         not stepped when the system time is set; for measuring waits
+ */
+int64_t createMonotonicTimestamp();
+
 /**
  * Convert given 64 bit integer to big-endian
  * format and place these raw bytes in a std::string
@@ -106,6 +139,107 @@ std::string serializeLong(int64_t t);
  */
 int64_t deserializeLong(std::string& t);
 
+/**
+ * Write a 64 bit integer in big-endian format
+ * @param[in] value integer to encode
+ * @param[out] out receives 8 bytes
+ */
+void encodeLong(int64_t value, char *out);
+
+/**
+ * @param[in] in 8 bytes holding a big-endian 64 bit integer
+ * @return the decoded integer
+ */
+int64_t decodeLong(const char *in);
+
+/**
+ * Write a 32 bit integer in big-endian format
+ * @param[in] value integer to encode
+ * @param[out] out receives 4 bytes
+ */
+void encodeInt(int32_t value, char *out);
+
+/**
+ * @param[in] in 4 bytes holding a big-endian 32 bit integer
+ * @return the decoded integer
+ */
+int32_t decodeInt(const char *in);
+
+/**
+ * Write a double in big-endian IEEE 754 format
+ * @param[in] value double to encode
+ * @param[out] out receives 8 bytes
+ */
+void encodeDouble(double value, char *out);
+
+/**
+ * @param[in] in 8 bytes holding a big-endian IEEE 754 double
+ * @return the decoded double
+ */
+double decodeDouble(const char *in);
+
+/*
+ * The bulk versions below convert whole arrays at once in one tight
+ * loop, which the compiler can vectorize; in and out must not overlap.
+ */
+
+/**
+ * @param[in] in integers to encode
+ * @param[in] count number of integers
+ * @param[out] out receives 8 * count bytes
+ */
+void encodeLongs(const int64_t *in, size_t count, char *out);
+
+/**
+ * @param[in] in 8 * count bytes of big-endian 64 bit integers
+ * @param[in] count number of integers
+ * @param[out] out receives the integers
+ */
+void decodeLongs(const char *in, size_t count, int64_t *out);
+
+/**
+ * @param[in] in integers to encode
+ * @param[in] count number of integers
+ * @param[out] out receives 4 * count bytes
+ */
+void encodeInts(const int32_t *in, size_t count, char *out);
+
+/**
+ * @param[in] in 4 * count bytes of big-endian 32 bit integers
+ * @param[in] count number of integers
+ * @param[out] out receives the integers
+ */
+void decodeInts(const char *in, size_t count, int32_t *out);
+
+/**
+ * @param[in] in doubles to encode
+ * @param[in] count number of doubles
+ * @param[out] out receives 8 * count bytes
+ */
+void encodeDoubles(const double *in, size_t count, char *out);
+
+/**
+ * @param[in] in 8 * count bytes of big-endian doubles
+ * @param[in] count number of doubles
+ * @param[out] out receives the doubles
+ */
+void decodeDoubles(const char *in, size_t count, double *out);
+
+/**
+ * Encode UUIDs given as pairs of 64 bit halves, most significant first
+ * @param[in] in 2 * count halves
+ * @param[in] count number of UUIDs
+ * @param[out] out receives 16 * count bytes
+ */
+void encodeUUIDs(const uint64_t *in, size_t count, char *out);
+
+/**
+ * @param[in] in 16 * count bytes of UUIDs
+ * @param[in] count number of UUIDs
+ * @param[out] out receives 2 * count halves, most significant first
+ */
+void decodeUUIDs(const char *in, size_t count, uint64_t *out);
+
 } /* end namespace libcassandra */
 
 #endif /* __LIBCASSANDRA_UTIL_FUNCTIONS_H */
@@ -0,0 +1,159 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <sys/time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "libcassandra/util_functions.h"
+#include "libcassandra/uuid.h"
+
+using namespace libcassandra;
+using namespace std;
+
+
+namespace
+{
+
+/* 100ns intervals between 1582-10-15 and 1970-01-01 */
+static const int64_t UUID_EPOCH_OFFSET= 0x01B21DD213814000LL;
+
+static pthread_once_t process_once= PTHREAD_ONCE_INIT;
+
+/* random node and clock sequence of this process */
+static uint64_t process_node= 0;
+static uint32_t process_clock_seq= 0;
+
+/* hands every thread its own index */
+static uint32_t next_thread= 0;
+
+/* per thread state; thread_low is 0 until the thread's first UUID */
+static __thread int64_t thread_last_ticks= 0;
+static __thread uint64_t thread_low= 0;
+
+
+void initProcess()
+{
+  uint64_t seed[2]= { 0, 0 };
+  int fd= open("/dev/urandom", O_RDONLY);
+  if (fd >= 0)
+  {
+    if (read(fd, seed, sizeof(seed)) != static_cast<ssize_t>(sizeof(seed)))
+    {
+      seed[0]= 0;
+    }
+    close(fd);
+  }
+  if (seed[0] == 0)
+  {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    seed[0]= (static_cast<uint64_t>(tv.tv_sec) << 20) ^ tv.tv_usec ^
+             (static_cast<uint64_t>(getpid()) << 40);
+    seed[1]= seed[0] * 0x9E3779B97F4A7C15ULL;
+  }
+  /* a random node has the multicast bit set so it cannot be a real MAC */
+  process_node= (seed[0] & 0xffffffffffffULL) | 0x010000000000ULL;
+  process_clock_seq= static_cast<uint32_t>(seed[1] & 0x3fff);
+}
+
+
+/*
+ * the low half holds the variant, the clock sequence and the node; every
+ * thread gets a different clock sequence and node
+ */
+void initThread()
+{
+  pthread_once(&process_once, initProcess);
+  uint32_t index= __sync_fetch_and_add(&next_thread, 1);
+  uint64_t clock_seq= (process_clock_seq + index) & 0x3fff;
+  uint64_t node= process_node ^ (static_cast<uint64_t>(index) << 16);
+  thread_low= (static_cast<uint64_t>(0x8000 | clock_seq) << 48) | (node & 0xffffffffffffULL);
+}
+
+} /* end anonymous namespace */
+
+
+const size_t TimeUUID::SIZE;
+
+
+void TimeUUID::generate(char *out)
+{
+  if (thread_low == 0)
+  {
+    initThread();
+  }
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  int64_t ticks= (static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec) * 10 +
+                 UUID_EPOCH_OFFSET;
+  /* several UUIDs in one tick, or a clock going back, take the next tick */
+  if (ticks <= thread_last_ticks)
+  {
+    ticks= thread_last_ticks + 1;
+  }
+  thread_last_ticks= ticks;
+
+  uint64_t t= static_cast<uint64_t>(ticks);
+  uint64_t halves[2];
+  halves[0]= ((t & 0xffffffffULL) << 32) |           /* time_low */
+             (((t >> 32) & 0xffffULL) << 16) |       /* time_mid */
+             0x1000 | ((t >> 48) & 0x0fffULL);       /* version and time_hi */
+  halves[1]= thread_low;
+  encodeUUIDs(halves, 1, out);
+}
+
+
+string TimeUUID::generate()
+{
+  char raw[SIZE];
+  generate(raw);
+  return string(raw, SIZE);
+}
+
+
+int64_t TimeUUID::getTimestamp(const char *uuid)
+{
+  uint64_t high= static_cast<uint64_t>(decodeLong(uuid));
+  uint64_t ret= ((high & 0x0fffULL) << 48) |
+                (((high >> 16) & 0xffffULL) << 32) |
+                (high >> 32);
+  return static_cast<int64_t>(ret);
+}
+
+
+int64_t TimeUUID::getUnixMicros(const char *uuid)
+{
+  return (getTimestamp(uuid) - UUID_EPOCH_OFFSET) / 10;
+}
+
+
+int TimeUUID::compare(const char *a, const char *b)
+{
+  int64_t ta= getTimestamp(a);
+  int64_t tb= getTimestamp(b);
+  if (ta != tb)
+  {
+    return ta < tb ? -1 : 1;
+  }
+  /* TimeUUIDType falls back to ByteBuffer.compareTo, which compares signed bytes */
+  for (size_t i= 0; i < SIZE; ++i)
+  {
+    signed char ca= static_cast<signed char>(a[i]);
+    signed char cb= static_cast<signed char>(b[i]);
+    if (ca != cb)
+    {
+      return ca < cb ? -1 : 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_UUID_H
+#define __LIBCASSANDRA_UUID_H
+
+#include <string>
+
+#include <stdint.h>
+
+namespace libcassandra
+{
+
+/**
+ * @class TimeUUID
+ * @brief
+ *   Version 1 (time based) UUIDs as used by TimeUUIDType column names.
+ *   Every thread generates from its own state, so generation takes no
+ *   lock: the timestamp of a thread's UUIDs always increases, and two
+ *   threads never share a node and clock sequence, so UUIDs are unique
+ *   within the process. UUIDs are handled as their 16 byte binary form,
+ *   which is what Cassandra stores.
+ */
+class TimeUUID
+{
+
+public:
+
+  /**
+   * size of a UUID in bytes
+   */
+  static const size_t SIZE= 16;
+
+  /**
+   * Write a new UUID
+   * @param[out] out receives SIZE bytes
+   */
+  static void generate(char *out);
+
+  /**
+   * @return a new UUID
+   */
+  static std::string generate();
+
+  /**
+   * @param[in] uuid SIZE bytes holding a time based UUID
+   * @return its timestamp, in 100ns intervals since 1582-10-15
+   */
+  static int64_t getTimestamp(const char *uuid);
+
+  /**
+   * @param[in] uuid SIZE bytes holding a time based UUID
+   * @return its timestamp in micro-seconds since the unix epoch, the unit
+   *         of column timestamps (see createTimestamp)
+   */
+  static int64_t getUnixMicros(const char *uuid);
+
+  /**
+   * Order two UUIDs the way TimeUUIDType does: by timestamp, then by
+   * their bytes taken as signed values
+   * @return less than, equal to or greater than 0 as a sorts before,
+   *         with or after b
+   */
+  static int compare(const char *a, const char *b);
+
+  /**
+   * Comparison functor over UUIDs held in strings, for sorting and maps
+   */
+  struct Less
+  {
+    bool operator()(const std::string& a, const std::string& b) const
+    {
+      return compare(a.data(), b.data()) < 0;
+    }
+  };
+
+private:
+
+  TimeUUID();
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_UUID_H */
@@ -0,0 +1,199 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+
+#include "libcassandra/exception.h"
+#include "libcassandra/util_functions.h"
+#include "libcassandra/value_codec.h"
+
+using namespace libcassandra;
+using namespace std;
+using namespace org::apache::cassandra;
+
+
+namespace
+{
+
+/* deflate never shrinks data by more than this */
+static const size_t MAX_DEFLATE_RATIO= 1032;
+
+/* where the fields of the header start */
+static const size_t ID_OFFSET= 4;
+static const size_t LENGTH_OFFSET= 5;
+static const size_t CHECKSUM_OFFSET= 9;
+
+
+bool hasMagic(const string &value)
+{
+  return value.size() >= 4 &&
+         static_cast<uint32_t>(decodeInt(value.data())) == ValueCodec::MAGIC;
+}
+
+
+/* covers the id, the original length and the payload */
+uint32_t checksum(const string &value)
+{
+  uLong crc= crc32(0L, Z_NULL, 0);
+  crc= crc32(crc,
+             reinterpret_cast<const Bytef *>(value.data() + ID_OFFSET),
+             static_cast<uInt>(CHECKSUM_OFFSET - ID_OFFSET));
+  crc= crc32(crc,
+             reinterpret_cast<const Bytef *>(value.data() + ValueCodec::HEADER_SIZE),
+             static_cast<uInt>(value.size() - ValueCodec::HEADER_SIZE));
+  return static_cast<uint32_t>(crc);
+}
+
+} /* end anonymous namespace */
+
+
+const uint32_t ValueCodec::MAGIC;
+const unsigned char ValueCodec::RAW_ID;
+const size_t ValueCodec::HEADER_SIZE;
+const unsigned char ZlibCodec::ID;
+const size_t ZlibCodec::DEFAULT_MIN_SIZE;
+
+
+void ValueCodec::encode(const string &value, string &out) const
+{
+  out.clear();
+  out.reserve(value.size() + HEADER_SIZE);
+  out.append(HEADER_SIZE, '\0');
+  unsigned char id= getId();
+  if (value.size() > 0xffffffffU || ! compress(value.data(), value.size(), out))
+  {
+    if (! hasMagic(value))
+    {
+      /* no header needed; decode cannot mistake it for a tagged value */
+      out.assign(value);
+      return;
+    }
+    out.resize(HEADER_SIZE);
+    out.append(value);
+    id= RAW_ID;
+  }
+  encodeInt(static_cast<int32_t>(MAGIC), &out[0]);
+  out[ID_OFFSET]= static_cast<char>(id);
+  encodeInt(static_cast<int32_t>(value.size()), &out[LENGTH_OFFSET]);
+  encodeInt(static_cast<int32_t>(checksum(out)), &out[CHECKSUM_OFFSET]);
+}
+
+
+bool ValueCodec::decode(string &value) const
+{
+  if (value.size() < HEADER_SIZE || ! hasMagic(value))
+  {
+    return false;
+  }
+  uint32_t stored= static_cast<uint32_t>(decodeInt(value.data() + CHECKSUM_OFFSET));
+  if (stored != checksum(value))
+  {
+    /* a value written without a header that starts like one */
+    return false;
+  }
+  unsigned char id= static_cast<unsigned char>(value[ID_OFFSET]);
+  size_t original_length= static_cast<uint32_t>(decodeInt(value.data() + LENGTH_OFFSET));
+  const char *payload= value.data() + HEADER_SIZE;
+  size_t payload_length= value.size() - HEADER_SIZE;
+  if (id == RAW_ID)
+  {
+    if (original_length != payload_length)
+    {
+      return false;
+    }
+    value.erase(0, HEADER_SIZE);
+    return true;
+  }
+  string out;
+  if (id == getId())
+  {
+    decompress(payload, payload_length, original_length, out);
+  }
+  else if (id == ZlibCodec::ID)
+  {
+    ZlibCodec().decompress(payload, payload_length, original_length, out);
+  }
+  else
+  {
+    throw Exception("value compressed with an unknown codec", 0);
+  }
+  value.swap(out);
+  return true;
+}
+
+
+void ValueCodec::decode(vector<Column> &columns) const
+{
+  for (vector<Column>::iterator it= columns.begin(); it != columns.end(); ++it)
+  {
+    decode(it->value);
+  }
+}
+
+
+ZlibCodec::ZlibCodec(int in_level, size_t in_min_size)
+  :
+    level(in_level),
+    min_size(in_min_size)
+{}
+
+
+unsigned char ZlibCodec::getId() const
+{
+  return ID;
+}
+
+
+bool ZlibCodec::compress(const char *data, size_t length, string &out) const
+{
+  if (length < min_size)
+  {
+    return false;
+  }
+  size_t start= out.size();
+  uLongf bound= compressBound(static_cast<uLong>(length));
+  out.resize(start + bound);
+  uLongf compressed= bound;
+  int rc= compress2(reinterpret_cast<Bytef *>(&out[start]), &compressed,
+                    reinterpret_cast<const Bytef *>(data), static_cast<uLong>(length),
+                    level);
+  /* not worth it unless the header is paid for */
+  if (rc != Z_OK || compressed + HEADER_SIZE >= length)
+  {
+    out.resize(start);
+    return false;
+  }
+  out.resize(start + compressed);
+  return true;
+}
+
+
+void ZlibCodec::decompress(const char *data,
+                           size_t length,
+                           size_t original_length,
+                           string &out) const
+{
+  if (original_length > length * MAX_DEFLATE_RATIO)
+  {
+    throw Exception("corrupt compressed value", 0);
+  }
+  size_t start= out.size();
+  out.resize(start + original_length);
+  uLongf restored= static_cast<uLongf>(original_length);
+  int rc= uncompress(reinterpret_cast<Bytef *>(&out[start]), &restored,
+                     reinterpret_cast<const Bytef *>(data), static_cast<uLong>(length));
+  if (rc != Z_OK || restored != original_length)
+  {
+    out.resize(start);
+    throw Exception("corrupt compressed value", 0);
+  }
+}
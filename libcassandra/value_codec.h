@@ -0,0 +1,152 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#ifndef __LIBCASSANDRA_VALUE_CODEC_H
+#define __LIBCASSANDRA_VALUE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "libgenthrift/cassandra_types.h"
+
+namespace libcassandra
+{
+
+/**
+ * @class ValueCodec
+ * @brief
+ *   Compresses column values on their way to Cassandra and restores them
+ *   on the way back (see Cassandra::setValueCodec). A compressed value
+ *   starts with a header naming the codec that produced it; values too
+ *   small or too random to be worth compressing are stored as they are.
+ *   Values written before a codec was configured, stored values and
+ *   values written with another codec can therefore live side by side in
+ *   one column family.
+ *
+ *   header: MAGIC as a 4 byte big-endian integer, the codec id, the length
+ *   of the original value and the CRC-32 of the id, the length and the
+ *   bytes following the header, both as 4 byte big-endian integers. A
+ *   value is only taken to carry a header if the magic and the checksum
+ *   match, so a value written without one is returned untouched whatever
+ *   its first bytes are. Id 0 marks a value stored as is; it is only used
+ *   for values that would otherwise start with the magic.
+ *
+ *   Encoded values are arbitrary bytes, so codecs only suit column
+ *   families validated as BytesType.
+ */
+class ValueCodec
+{
+
+public:
+
+  static const uint32_t MAGIC= 0xc74c4356;
+
+  static const unsigned char RAW_ID= 0;
+
+  /* magic, id, original length and checksum */
+  static const size_t HEADER_SIZE= 13;
+
+  virtual ~ValueCodec() {}
+
+  /**
+   * @return the id written in the header of values this codec compressed;
+   *         never RAW_ID
+   */
+  virtual unsigned char getId() const= 0;
+
+  /**
+   * Compress a value
+   * @param[in] data value to compress
+   * @param[in] length number of bytes in the value
+   * @param[out] out the compressed bytes are appended to it
+   * @return false if the value is better stored as is
+   */
+  virtual bool compress(const char *data, size_t length, std::string &out) const= 0;
+
+  /**
+   * Restore a value
+   * @param[in] data compressed bytes
+   * @param[in] length number of compressed bytes
+   * @param[in] original_length length of the value before compression
+   * @param[out] out the value is appended to it
+   * @throw Exception if the bytes cannot be decompressed
+   */
+  virtual void decompress(const char *data,
+                          size_t length,
+                          size_t original_length,
+                          std::string &out) const= 0;
+
+  /**
+   * Encode a value for writing, with its header
+   */
+  void encode(const std::string &value, std::string &out) const;
+
+  /**
+   * Restore a value read from Cassandra. Values without a valid header are
+   * left alone; values compressed by another codec are restored if that
+   * codec is built in (zlib).
+   * @param[in,out] value the value as read; replaced by the original
+   * @return true if the value carried a header
+   * @throw Exception if a valid header names an unknown codec
+   */
+  bool decode(std::string &value) const;
+
+  /**
+   * Restore the values of a list of columns in place
+   */
+  void decode(std::vector<org::apache::cassandra::Column> &columns) const;
+
+};
+
+/**
+ * @class ZlibCodec
+ * @brief compresses values with zlib (deflate)
+ */
+class ZlibCodec : public ValueCodec
+{
+
+public:
+
+  static const unsigned char ID= 1;
+
+  /**
+   * values shorter than this are stored as is by default
+   */
+  static const size_t DEFAULT_MIN_SIZE= 256;
+
+  /**
+   * @param[in] in_level zlib compression level, 1 (fastest) to 9 (best)
+   * @param[in] in_min_size values shorter than this are stored as is
+   */
+  explicit ZlibCodec(int in_level= 6, size_t in_min_size= DEFAULT_MIN_SIZE);
+
+  ~ZlibCodec() {}
+
+  unsigned char getId() const;
+
+  bool compress(const char *data, size_t length, std::string &out) const;
+
+  void decompress(const char *data,
+                  size_t length,
+                  size_t original_length,
+                  std::string &out) const;
+
+private:
+
+  int level;
+
+  size_t min_size;
+
+};
+
+} /* end namespace libcassandra */
+
+#endif /* __LIBCASSANDRA_VALUE_CODEC_H */
@@ -0,0 +1,68 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/util/arena.h>
+
+using namespace std;
+using namespace libcassandra;
+
+
+TEST(Arena, CopiesAreIndependent)
+{
+  util::Arena arena(64);
+  char *first= arena.copy("hello", 5);
+  char *second= arena.copy("world", 5);
+  EXPECT_EQ(0, memcmp(first, "hello", 5));
+  EXPECT_EQ(0, memcmp(second, "world", 5));
+  EXPECT_EQ(first + 5, second);
+  EXPECT_EQ(10u, arena.getUsed());
+}
+
+
+TEST(Arena, GrowsAndReusesBlocks)
+{
+  util::Arena arena(64);
+  for (int i= 0; i < 100; ++i)
+  {
+    arena.copy("0123456789", 10);
+  }
+  EXPECT_EQ(1000u, arena.getUsed());
+  size_t reserved= arena.getReserved();
+  EXPECT_GE(reserved, 1000u);
+  arena.reset();
+  EXPECT_EQ(0u, arena.getUsed());
+  for (int i= 0; i < 100; ++i)
+  {
+    arena.copy("0123456789", 10);
+  }
+  /* the same blocks were used again */
+  EXPECT_EQ(reserved, arena.getReserved());
+}
+
+
+TEST(Arena, LargeAllocations)
+{
+  util::Arena arena(64);
+  char *small= arena.copy("abc", 3);
+  const string big(1000, 'x');
+  char *large= arena.copy(big.data(), big.size());
+  char *after= arena.copy("def", 3);
+  EXPECT_EQ(0, memcmp(large, big.data(), big.size()));
+  /* the current block is still used after an oversized request */
+  EXPECT_EQ(small + 3, after);
+  EXPECT_EQ(0, memcmp(small, "abcdef", 6));
+  arena.reset();
+  EXPECT_EQ(64u, arena.getReserved());
+}
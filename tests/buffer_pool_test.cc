@@ -0,0 +1,241 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <transport/TBufferTransports.h>
+
+#include <libcassandra/util/buffer_pool.h>
+#include <libcassandra/util/framed_transport.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace apache::thrift::transport;
+
+
+/*
+ * writes go to sent, reads come from incoming
+ */
+class LoopbackTransport : public TVirtualTransport<LoopbackTransport>
+{
+public:
+  LoopbackTransport()
+    :
+      sent(),
+      incoming(),
+      offset(0)
+  {}
+
+  uint32_t read(uint8_t *buf, uint32_t len)
+  {
+    uint32_t give= static_cast<uint32_t>(min(static_cast<size_t>(len), incoming.size() - offset));
+    memcpy(buf, incoming.data() + offset, give);
+    offset+= give;
+    return give;
+  }
+
+  void write(const uint8_t *buf, uint32_t len)
+  {
+    sent.append(reinterpret_cast<const char *>(buf), len);
+  }
+
+  string sent;
+  string incoming;
+  size_t offset;
+};
+
+
+TEST(BufferPool, CapacityClasses)
+{
+  EXPECT_EQ(util::BufferPool::MIN_CLASS_SIZE, util::BufferPool::getCapacity(1));
+  EXPECT_EQ(1024u, util::BufferPool::getCapacity(513));
+  EXPECT_EQ(4096u, util::BufferPool::getCapacity(4096));
+  EXPECT_EQ(util::BufferPool::MAX_CLASS_SIZE + 1,
+            util::BufferPool::getCapacity(util::BufferPool::MAX_CLASS_SIZE + 1));
+}
+
+
+TEST(BufferPool, ReusesReleasedBuffers)
+{
+  util::BufferPool::trim();
+  EXPECT_EQ(0u, util::BufferPool::getCachedBytes());
+
+  uint32_t capacity= 0;
+  uint8_t *first= util::BufferPool::acquire(3000, capacity);
+  EXPECT_EQ(4096u, capacity);
+  util::BufferPool::release(first, capacity);
+  EXPECT_EQ(4096u, util::BufferPool::getCachedBytes());
+
+  uint32_t again= 0;
+  uint8_t *second= util::BufferPool::acquire(4000, again);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(4096u, again);
+  EXPECT_EQ(0u, util::BufferPool::getCachedBytes());
+  util::BufferPool::release(second, again);
+
+  /* oversized buffers are not kept */
+  uint8_t *big= util::BufferPool::acquire(util::BufferPool::MAX_CLASS_SIZE + 1, capacity);
+  util::BufferPool::release(big, capacity);
+  EXPECT_EQ(4096u, util::BufferPool::getCachedBytes());
+
+  util::BufferPool::trim();
+  EXPECT_EQ(0u, util::BufferPool::getCachedBytes());
+}
+
+
+TEST(BufferPool, SpillsToSharedList)
+{
+  util::BufferPool::trim();
+  const uint32_t count= util::BufferPool::THREAD_CACHE_DEPTH + 3;
+  uint8_t *buffers[count];
+  uint32_t capacity= 0;
+  for (uint32_t i= 0; i < count; ++i)
+  {
+    buffers[i]= util::BufferPool::acquire(512, capacity);
+  }
+  for (uint32_t i= 0; i < count; ++i)
+  {
+    util::BufferPool::release(buffers[i], capacity);
+  }
+  EXPECT_EQ(static_cast<size_t>(count) * 512, util::BufferPool::getCachedBytes());
+  util::BufferPool::trim();
+}
+
+
+TEST(BufferPool, LargeBuffersMakeRoomForSmallOnes)
+{
+  util::BufferPool::trim();
+  const uint32_t count= util::BufferPool::SHARED_BYTES / util::BufferPool::MAX_CLASS_SIZE;
+  uint8_t *buffers[count];
+  uint32_t capacity= 0;
+  for (uint32_t i= 0; i < count; ++i)
+  {
+    buffers[i]= util::BufferPool::acquire(util::BufferPool::MAX_CLASS_SIZE, capacity);
+  }
+  for (uint32_t i= 0; i < count; ++i)
+  {
+    util::BufferPool::release(buffers[i], capacity);
+  }
+  EXPECT_EQ(util::BufferPool::SHARED_BYTES, util::BufferPool::getCachedBytes());
+
+  /* too big for the thread cache, so it goes on the full shared lists */
+  uint32_t medium_capacity= 0;
+  uint8_t *medium= util::BufferPool::acquire(util::BufferPool::THREAD_CACHE_MAX_SIZE * 2, medium_capacity);
+  util::BufferPool::release(medium, medium_capacity);
+  EXPECT_LE(util::BufferPool::getCachedBytes(), util::BufferPool::SHARED_BYTES);
+  uint32_t again= 0;
+  EXPECT_EQ(medium, util::BufferPool::acquire(medium_capacity, again));
+  util::BufferPool::release(medium, again);
+  util::BufferPool::trim();
+}
+
+
+TEST(PooledFramedTransport, RoundTrip)
+{
+  boost::shared_ptr<LoopbackTransport> loopback(new LoopbackTransport());
+  util::PooledFramedTransport transport(loopback);
+
+  transport.write(reinterpret_cast<const uint8_t *>("hello"), 5);
+  EXPECT_EQ(9u, transport.writeEnd());
+  transport.flush();
+  ASSERT_EQ(9u, loopback->sent.size());
+  EXPECT_EQ(string("\0\0\0\5hello", 9), loopback->sent);
+
+  loopback->incoming= loopback->sent + loopback->sent;
+  uint8_t buf[5];
+  EXPECT_EQ(5u, transport.readAll(buf, 5));
+  EXPECT_EQ(0, memcmp(buf, "hello", 5));
+  EXPECT_EQ(9u, transport.readEnd());
+
+  /* a read running past the end of one frame continues in the next */
+  uint8_t wide[8];
+  memset(wide, 0, sizeof(wide));
+  EXPECT_EQ(5u, transport.read(wide, sizeof(wide)));
+  EXPECT_EQ(0, memcmp(wide, "hello", 5));
+  EXPECT_EQ(0u, transport.read(wide, sizeof(wide)));
+}
+
+
+TEST(PooledFramedTransport, BorrowsTheWholeFrame)
+{
+  boost::shared_ptr<LoopbackTransport> loopback(new LoopbackTransport());
+  util::PooledFramedTransport transport(loopback);
+  loopback->incoming= string("\0\0\0\6abcdef", 10);
+
+  uint8_t first;
+  EXPECT_EQ(1u, transport.read(&first, 1));
+  uint32_t len= 0;
+  const uint8_t *rest= transport.borrow(NULL, &len);
+  ASSERT_TRUE(rest != NULL);
+  EXPECT_EQ(5u, len);
+  EXPECT_EQ(0, memcmp(rest, "bcdef", 5));
+  transport.consume(len);
+  EXPECT_EQ(10u, transport.readEnd());
+}
+
+
+TEST(PooledFramedTransport, ReleasesLargeBuffers)
+{
+  boost::shared_ptr<LoopbackTransport> loopback(new LoopbackTransport());
+  util::PooledFramedTransport transport(loopback, 8192);
+  EXPECT_EQ(util::PooledFramedTransport::DEFAULT_BUFFER_SIZE, transport.getWriteCapacity());
+
+  string big(100000, 'x');
+  transport.write(reinterpret_cast<const uint8_t *>(big.data()), static_cast<uint32_t>(big.size()));
+  EXPECT_GE(transport.getWriteCapacity(), 100004u);
+  transport.flush();
+  EXPECT_EQ(util::PooledFramedTransport::DEFAULT_BUFFER_SIZE, transport.getWriteCapacity());
+  ASSERT_EQ(100004u, loopback->sent.size());
+
+  loopback->incoming= loopback->sent;
+  loopback->incoming.append(string("\0\0\0\2ok", 6));
+  string got(big.size(), '\0');
+  transport.readAll(reinterpret_cast<uint8_t *>(&got[0]), static_cast<uint32_t>(got.size()));
+  EXPECT_EQ(big, got);
+  EXPECT_GE(transport.getReadCapacity(), 100000u);
+  transport.readEnd();
+  EXPECT_EQ(0u, transport.getReadCapacity());
+
+  /* small frames keep their buffer */
+  uint8_t ok[2];
+  transport.readAll(ok, 2);
+  EXPECT_EQ(0, memcmp(ok, "ok", 2));
+  transport.readEnd();
+  EXPECT_EQ(util::BufferPool::MIN_CLASS_SIZE, transport.getReadCapacity());
+}
+
+
+TEST(PooledFramedTransport, BurstOfLargeFramesIsBounded)
+{
+  util::BufferPool::trim();
+  /* more large frames in flight at once than the pool keeps */
+  const size_t count= 2 * util::BufferPool::SHARED_BYTES / util::BufferPool::MAX_CLASS_SIZE;
+  string big(util::BufferPool::MAX_CLASS_SIZE - 16, 'x');
+  vector<boost::shared_ptr<util::PooledFramedTransport> > transports;
+  for (size_t i= 0; i < count; ++i)
+  {
+    boost::shared_ptr<LoopbackTransport> loopback(new LoopbackTransport());
+    transports.push_back(boost::shared_ptr<util::PooledFramedTransport>(new util::PooledFramedTransport(loopback)));
+    transports.back()->write(reinterpret_cast<const uint8_t *>(big.data()), static_cast<uint32_t>(big.size()));
+  }
+  for (size_t i= 0; i < count; ++i)
+  {
+    transports[i]->flush();
+  }
+  transports.clear();
+  EXPECT_LE(util::BufferPool::getCachedBytes(),
+            util::BufferPool::SHARED_BYTES +
+            static_cast<size_t>(util::BufferPool::THREAD_CACHE_DEPTH) * 2 * util::BufferPool::THREAD_CACHE_MAX_SIZE);
+  util::BufferPool::trim();
+}
@@ -21,10 +21,18 @@
 #include <libgenthrift/Cassandra.h>
 #include <libcassandra/cassandra.h>
 #include <libcassandra/cassandra_factory.h>
+#include <libcassandra/column_cache.h>
 #include <libcassandra/column_family_definition.h>
+#include <libcassandra/column_slice_cursor.h>
+#include <libcassandra/indexed_slices_cursor.h>
 #include <libcassandra/indexed_slices_query.h>
 #include <libcassandra/keyspace.h>
 #include <libcassandra/keyspace_definition.h>
+#include <libcassandra/range_slice_cursor.h>
+#include <libcassandra/row_visitor.h>
+#include <libcassandra/schema_batch.h>
+#include <libcassandra/value_codec.h>
+#include <libcassandra/util/pool.h>
 
 using namespace std;
 using namespace libcassandra;
@@ -297,3 +305,358 @@ TEST_F(ClientTest, SecondaryIndexes)
   c->dropColumnFamily("users");
   c->dropKeyspace("unittest");
 }
+
+
+TEST_F(ClientTest, MultigetSlice)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("padraig");
+  cf_def.setKeyspaceName(ks_def.getName());
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  vector<string> keys;
+  for (int i= 0; i < 25; ++i)
+  {
+    ostringstream key;
+    key << "row" << i;
+    keys.push_back(key.str());
+    c->insertColumn(key.str(), "padraig", "third", key.str());
+  }
+  ColumnParent col_parent;
+  col_parent.column_family.assign("padraig");
+  SlicePredicate pred;
+  pred.column_names.push_back("third");
+  pred.__isset.column_names= true;
+  map<string, vector<Column> > res= c->multigetSlice(keys, col_parent, pred, ConsistencyLevel::QUORUM, 10);
+  EXPECT_EQ(keys.size(), res.size());
+  EXPECT_EQ("row7", res["row7"][0].value);
+  util::CassandraPool pool("localhost", 9160, 0, 4);
+  res= c->multigetSlice(pool, keys, col_parent, pred, ConsistencyLevel::QUORUM, 10, 4);
+  EXPECT_EQ(keys.size(), res.size());
+  EXPECT_EQ("row24", res["row24"][0].value);
+  c->dropColumnFamily("padraig");
+  c->dropKeyspace("unittest");
+}
+
+
+TEST_F(ClientTest, MultigetCount)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("padraig");
+  cf_def.setKeyspaceName(ks_def.getName());
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  vector<string> keys;
+  keys.push_back("sarah");
+  keys.push_back("teeny");
+  c->insertColumn("sarah", "padraig", "first", "1");
+  c->insertColumn("sarah", "padraig", "second", "2");
+  c->insertColumn("teeny", "padraig", "first", "1");
+  ColumnParent col_parent;
+  col_parent.column_family.assign("padraig");
+  SlicePredicate pred;
+  pred.slice_range.count= 100;
+  pred.__isset.slice_range= true;
+  util::CassandraPool pool("localhost", 9160, 0, 2);
+  map<string, int32_t> res= c->multigetCount(pool, keys, col_parent, pred, ConsistencyLevel::QUORUM, 1, 2);
+  EXPECT_EQ(2, res["sarah"]);
+  EXPECT_EQ(1, res["teeny"]);
+  c->dropColumnFamily("padraig");
+  c->dropKeyspace("unittest");
+}
+
+
+TEST_F(ClientTest, RangeSliceCursor)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("padraig");
+  cf_def.setKeyspaceName(ks_def.getName());
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  for (int i= 0; i < 25; ++i)
+  {
+    ostringstream key;
+    key << "row" << i;
+    c->insertColumn(key.str(), "padraig", "third", key.str());
+  }
+  ColumnParent col_parent;
+  col_parent.column_family.assign("padraig");
+  SlicePredicate pred;
+  pred.slice_range.count= 100;
+  pred.__isset.slice_range= true;
+  util::CassandraPool pool("localhost", 9160, 0, 2);
+  RangeSliceCursor cursor(pool, ks_def.getName(), col_parent, pred, "", "", 7, ConsistencyLevel::QUORUM);
+  RangeSliceCursor::Row row;
+  set<string> seen;
+  while (cursor.next(row))
+  {
+    EXPECT_TRUE(seen.insert(row.first).second);
+    EXPECT_EQ(row.first, row.second[0].value);
+  }
+  EXPECT_EQ(25, seen.size());
+  c->dropColumnFamily("padraig");
+  c->dropKeyspace("unittest");
+}
+
+
+TEST(Cassandra, DecodeValues)
+{
+  Cassandra client;
+  tr1::shared_ptr<ValueCodec> codec(new ZlibCodec(6, 0));
+  client.setValueCodec("padraig", codec);
+  const string value(1000, 'x');
+  vector<KeySlice> rows(1);
+  rows[0].key= "sarah";
+  rows[0].columns.resize(1);
+  rows[0].columns[0].column.name= "third";
+  codec->encode(value, rows[0].columns[0].column.value);
+  rows[0].columns[0].__isset.column= true;
+  client.decodeValues("other", rows);
+  EXPECT_NE(value, rows[0].columns[0].column.value);
+  client.decodeValues("padraig", rows);
+  EXPECT_EQ(value, rows[0].columns[0].column.value);
+}
+
+
+TEST_F(ClientTest, CodecThroughCursors)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("padraig");
+  cf_def.setKeyspaceName(ks_def.getName());
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  tr1::shared_ptr<ValueCodec> codec(new ZlibCodec());
+  c->setValueCodec("padraig", codec);
+  const string value(4096, 'x');
+  c->insertColumn("sarah", "padraig", "third", value);
+
+  ColumnParent col_parent;
+  col_parent.column_family.assign("padraig");
+  ColumnSliceCursor columns(*c, "sarah", col_parent, "", "", false, 7, ConsistencyLevel::QUORUM);
+  Column col;
+  ASSERT_TRUE(columns.next(col));
+  EXPECT_EQ(value, col.value);
+
+  /* pooled connections get the codec from the pool */
+  util::CassandraPool pool("localhost", 9160, 0, 2);
+  pool.setValueCodec("padraig", codec);
+  SlicePredicate pred;
+  pred.slice_range.count= 100;
+  pred.__isset.slice_range= true;
+  RangeSliceCursor rows(pool, ks_def.getName(), col_parent, pred, "", "", 7, ConsistencyLevel::QUORUM);
+  RangeSliceCursor::Row row;
+  ASSERT_TRUE(rows.next(row));
+  EXPECT_EQ(value, row.second[0].value);
+  c->setValueCodec("padraig", tr1::shared_ptr<ValueCodec>());
+  c->dropColumnFamily("padraig");
+  c->dropKeyspace("unittest");
+}
+
+
+TEST_F(ClientTest, IndexedSlicesCursor)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("users");
+  cf_def.setKeyspaceName(ks_def.getName());
+  ColumnDefinition state_col;
+  state_col.setName("state");
+  state_col.setValidationClass("UTF8Type");
+  state_col.setIndexType(IndexType::KEYS);
+  cf_def.addColumnMetadata(state_col);
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  for (int i= 0; i < 25; ++i)
+  {
+    ostringstream key;
+    key << "user" << i;
+    c->insertColumn(key.str(), "users", "state", (i % 5) ? "UT" : "WI");
+  }
+  IndexedSlicesQuery query;
+  vector<string> column_names;
+  column_names.push_back("state");
+  query.setColumns(column_names);
+  query.addEqualsExpression("state", "UT");
+  query.setColumnFamily("users");
+  query.setRowCount(3);
+  util::CassandraPool pool("localhost", 9160, 0, 2);
+  IndexedSlicesCursor cursor(pool, ks_def.getName(), query, 0);
+  IndexedSlicesCursor::Row row;
+  set<string> seen;
+  while (cursor.next(row))
+  {
+    EXPECT_TRUE(seen.insert(row.first).second);
+    EXPECT_EQ("UT", row.second[0].value);
+  }
+  EXPECT_EQ(20, seen.size());
+  IndexedSlicesCursor limited(*c, query, 7);
+  int count= 0;
+  while (limited.next(row))
+  {
+    ++count;
+  }
+  EXPECT_EQ(7, count);
+  EXPECT_EQ(7u, limited.getReturned());
+  c->dropColumnFamily("users");
+  c->dropKeyspace("unittest");
+}
+
+
+class CountingVisitor : public RowVisitor
+{
+public:
+  CountingVisitor(size_t in_stop_after)
+    :
+      seen(),
+      stop_after(in_stop_after)
+  {}
+  bool visit(const string& key, vector<Column>& columns)
+  {
+    EXPECT_EQ(key, columns[0].value);
+    seen.insert(key);
+    return seen.size() < stop_after;
+  }
+  set<string> seen;
+  size_t stop_after;
+};
+
+
+TEST_F(ClientTest, RangeSliceVisitor)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("padraig");
+  cf_def.setKeyspaceName(ks_def.getName());
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  for (int i= 0; i < 25; ++i)
+  {
+    ostringstream key;
+    key << "row" << i;
+    c->insertColumn(key.str(), "padraig", "third", key.str());
+  }
+  ColumnParent col_parent;
+  col_parent.column_family.assign("padraig");
+  SlicePredicate pred;
+  pred.slice_range.count= 100;
+  pred.__isset.slice_range= true;
+  CountingVisitor all(100);
+  c->getRangeSlice(all, col_parent, pred, "", "", 100, ConsistencyLevel::QUORUM);
+  EXPECT_EQ(25, all.seen.size());
+  /* stopping early leaves the connection ready for the next request */
+  CountingVisitor some(5);
+  c->getRangeSlice(some, col_parent, pred, "", "", 100, ConsistencyLevel::QUORUM);
+  EXPECT_EQ(5, some.seen.size());
+  EXPECT_EQ("row3", c->getColumnValue("row3", "padraig", "third"));
+  c->dropColumnFamily("padraig");
+  c->dropKeyspace("unittest");
+}
+
+
+TEST_F(ClientTest, ColumnSliceCursor)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("padraig");
+  cf_def.setKeyspaceName(ks_def.getName());
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  for (int i= 0; i < 50; ++i)
+  {
+    ostringstream name;
+    name << "col" << (10 + i);
+    c->insertColumn("sarah", "padraig", name.str(), name.str());
+  }
+  ColumnParent col_parent;
+  col_parent.column_family.assign("padraig");
+  ColumnSliceCursor cursor(*c, "sarah", col_parent, "", "", true, 7, ConsistencyLevel::QUORUM);
+  Column col;
+  string previous;
+  int count= 0;
+  while (cursor.next(col))
+  {
+    if (count > 0)
+    {
+      EXPECT_GT(previous, col.name);
+    }
+    previous= col.name;
+    ++count;
+  }
+  EXPECT_EQ(50, count);
+  c->dropColumnFamily("padraig");
+  c->dropKeyspace("unittest");
+}
+
+TEST_F(ClientTest, TryGetColumn)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  c->createKeyspace(ks_def);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("padraig");
+  cf_def.setKeyspaceName(ks_def.getName());
+  c->setKeyspace(ks_def.getName());
+  c->createColumnFamily(cf_def);
+  tr1::shared_ptr<ColumnCache> cache(new ColumnCache(1024 * 1024, 60000, 4));
+  cache->setNegativeTtl(1000);
+  c->setColumnCache(cache);
+  Column col;
+  EXPECT_FALSE(c->tryGetColumn("sarah", "padraig", "third", col));
+  EXPECT_FALSE(c->tryGetColumn("sarah", "padraig", "third", col));
+  EXPECT_EQ(1u, cache->getHits());
+  c->insertColumn("sarah", "padraig", "third", "this is data being inserted!");
+  ASSERT_TRUE(c->tryGetColumn("sarah", "padraig", "third", col));
+  EXPECT_EQ("this is data being inserted!", col.value);
+  EXPECT_EQ("this is data being inserted!", c->getColumnValue("sarah", "padraig", "third"));
+  EXPECT_EQ(2u, cache->getHits());
+  c->setColumnCache(tr1::shared_ptr<ColumnCache>());
+  c->dropColumnFamily("padraig");
+  c->dropKeyspace("unittest");
+}
+
+TEST_F(ClientTest, SchemaBatch)
+{
+  KeyspaceDefinition ks_def;
+  ks_def.setName("unittest");
+  SchemaBatch batch;
+  batch.addKeyspace(ks_def);
+  for (int i= 0; i < 10; ++i)
+  {
+    ostringstream name;
+    name << "padraig" << i;
+    ColumnFamilyDefinition cf_def;
+    cf_def.setName(name.str());
+    cf_def.setKeyspaceName(ks_def.getName());
+    batch.addColumnFamily(cf_def);
+  }
+  EXPECT_EQ(11u, batch.size());
+  EXPECT_TRUE(batch.apply(*c));
+  EXPECT_EQ(11u, batch.getApplied());
+  c->setKeyspace(ks_def.getName());
+  c->insertColumn("sarah", "padraig9", "third", "this is data being inserted!");
+  EXPECT_EQ("this is data being inserted!", c->getColumnValue("sarah", "padraig9", "third"));
+
+  batch.clear();
+  batch.dropColumnFamily(ks_def.getName(), "padraig0");
+  batch.dropKeyspace(ks_def.getName());
+  EXPECT_TRUE(batch.apply(*c));
+  EXPECT_TRUE(c->waitForSchemaAgreement());
+}
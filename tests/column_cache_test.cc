@@ -0,0 +1,224 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/column_cache.h>
+#include <libcassandra/util_functions.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+static vector<Column> makeColumns(const string& name, const string& value)
+{
+  Column col;
+  col.name.assign(name);
+  col.value.assign(value);
+  col.timestamp= createTimestamp();
+  return vector<Column>(1, col);
+}
+
+
+TEST(ColumnCache, HitAndMiss)
+{
+  ColumnCache cache(1024 * 1024, 60000, 4);
+  vector<Column> out;
+  const string path= ColumnCache::pathKey("", "name");
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+  cache.put("ks", "cf", "row", path, makeColumns("name", "value"), cache.getGeneration("ks", "cf", "row"));
+  ASSERT_TRUE(cache.get("ks", "cf", "row", path, out));
+  ASSERT_EQ(1u, out.size());
+  EXPECT_EQ("value", out.front().value);
+  EXPECT_FALSE(cache.get("ks", "cf", "other", path, out));
+  EXPECT_FALSE(cache.get("ks2", "cf", "row", path, out));
+  EXPECT_EQ(1u, cache.getHits());
+  EXPECT_EQ(3u, cache.getMisses());
+}
+
+
+TEST(ColumnCache, InvalidateDropsWholeRow)
+{
+  ColumnCache cache(1024 * 1024, 60000, 4);
+  vector<Column> out;
+  const string first= ColumnCache::pathKey("", "a");
+  const string second= ColumnCache::pathKey("", "b");
+  cache.put("ks", "cf", "row", first, makeColumns("a", "1"), cache.getGeneration("ks", "cf", "row"));
+  cache.put("ks", "cf", "row", second, makeColumns("b", "2"), cache.getGeneration("ks", "cf", "row"));
+  cache.put("ks", "cf", "keep", first, makeColumns("a", "3"), cache.getGeneration("ks", "cf", "keep"));
+  cache.invalidate("ks", "cf", "row");
+  EXPECT_FALSE(cache.get("ks", "cf", "row", first, out));
+  EXPECT_FALSE(cache.get("ks", "cf", "row", second, out));
+  EXPECT_TRUE(cache.get("ks", "cf", "keep", first, out));
+}
+
+
+TEST(ColumnCache, ExpiredTTLIsNotCached)
+{
+  ColumnCache cache(1024 * 1024, 60000, 1);
+  vector<Column> out;
+  vector<Column> cols= makeColumns("a", "1");
+  cols.front().ttl= 10;
+  cols.front().__isset.ttl= true;
+  cols.front().timestamp-= 20 * 1000000LL;
+  const string path= ColumnCache::pathKey("", "a");
+  cache.put("ks", "cf", "row", path, cols, cache.getGeneration("ks", "cf", "row"));
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+
+  cols.front().timestamp= createTimestamp();
+  cache.put("ks", "cf", "row", path, cols, cache.getGeneration("ks", "cf", "row"));
+  EXPECT_TRUE(cache.get("ks", "cf", "row", path, out));
+}
+
+
+TEST(ColumnCache, ZeroStalenessDisablesCaching)
+{
+  ColumnCache cache(1024 * 1024, 0, 1);
+  vector<Column> out;
+  const string path= ColumnCache::pathKey("", "a");
+  cache.put("ks", "cf", "row", path, makeColumns("a", "1"), cache.getGeneration("ks", "cf", "row"));
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+}
+
+
+TEST(ColumnCache, EvictsLeastRecentlyUsed)
+{
+  ColumnCache cache(4096, 60000, 1);
+  vector<Column> out;
+  const string value(1000, 'v');
+  cache.put("ks", "cf", "r1", "p", makeColumns("a", value), cache.getGeneration("ks", "cf", "r1"));
+  cache.put("ks", "cf", "r2", "p", makeColumns("a", value), cache.getGeneration("ks", "cf", "r2"));
+  /* touch r1 so that r2 is the oldest */
+  EXPECT_TRUE(cache.get("ks", "cf", "r1", "p", out));
+  cache.put("ks", "cf", "r3", "p", makeColumns("a", value), cache.getGeneration("ks", "cf", "r3"));
+  cache.put("ks", "cf", "r4", "p", makeColumns("a", value), cache.getGeneration("ks", "cf", "r4"));
+  EXPECT_LE(cache.getSize(), 4096u);
+  EXPECT_TRUE(cache.get("ks", "cf", "r1", "p", out));
+  EXPECT_FALSE(cache.get("ks", "cf", "r2", "p", out));
+  EXPECT_TRUE(cache.get("ks", "cf", "r4", "p", out));
+}
+
+
+TEST(ColumnCache, PredicateKeysDiffer)
+{
+  ColumnParent parent;
+  parent.column_family.assign("cf");
+  SlicePredicate names;
+  names.column_names.push_back("a");
+  names.__isset.column_names= true;
+  SlicePredicate range;
+  range.slice_range.start.assign("a");
+  range.slice_range.count= 10;
+  range.__isset.slice_range= true;
+  EXPECT_NE(ColumnCache::predicateKey(parent, names), ColumnCache::predicateKey(parent, range));
+  SlicePredicate reversed(range);
+  reversed.slice_range.reversed= true;
+  EXPECT_NE(ColumnCache::predicateKey(parent, range), ColumnCache::predicateKey(parent, reversed));
+  EXPECT_NE(ColumnCache::pathKey("ab", "c"), ColumnCache::pathKey("a", "bc"));
+}
+
+
+TEST(ColumnCache, NegativeEntries)
+{
+  ColumnCache cache(1024 * 1024, 60000, 2);
+  vector<Column> out;
+  const string path= ColumnCache::pathKey("", "missing");
+  cache.putAbsent("ks", "cf", "row", path, cache.getGeneration("ks", "cf", "row"));
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+
+  cache.setNegativeTtl(1000);
+  cache.putAbsent("ks", "cf", "row", path, cache.getGeneration("ks", "cf", "row"));
+  out= makeColumns("stale", "value");
+  ASSERT_TRUE(cache.get("ks", "cf", "row", path, out));
+  EXPECT_TRUE(out.empty());
+  cache.invalidate("ks", "cf", "row");
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+}
+
+
+TEST(ColumnCache, ReadAcrossAWriteIsNotCached)
+{
+  ColumnCache cache(1024 * 1024, 60000, 2);
+  cache.setNegativeTtl(1000);
+  vector<Column> out;
+  const string path= ColumnCache::pathKey("", "a");
+
+  /* the read started before the write and finishes after it */
+  uint64_t generation= cache.getGeneration("ks", "cf", "row");
+  cache.invalidate("ks", "cf", "row");
+  cache.put("ks", "cf", "row", path, makeColumns("a", "old"), generation);
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+  cache.putAbsent("ks", "cf", "row", path, generation);
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+
+  generation= cache.getGeneration("ks", "cf", "row");
+  cache.clear();
+  cache.put("ks", "cf", "row", path, makeColumns("a", "old"), generation);
+  EXPECT_FALSE(cache.get("ks", "cf", "row", path, out));
+
+  /* other rows are not held back */
+  generation= cache.getGeneration("ks", "cf", "other");
+  cache.put("ks", "cf", "other", path, makeColumns("a", "new"), generation);
+  EXPECT_TRUE(cache.get("ks", "cf", "other", path, out));
+}
+
+
+/*
+ * a node whose writes time out, possibly after being applied
+ */
+class TimingOutClient : public CassandraClient
+{
+public:
+  TimingOutClient()
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>())
+  {}
+
+  void insert(const string&, const ColumnParent&, const Column&, const ConsistencyLevel::type)
+  {
+    throw TimedOutException();
+  }
+
+  void remove(const string&, const ColumnPath&, const int64_t, const ConsistencyLevel::type)
+  {
+    throw TimedOutException();
+  }
+};
+
+
+TEST(ColumnCache, FailedWritesInvalidate)
+{
+  tr1::shared_ptr<ColumnCache> cache(new ColumnCache(1024 * 1024, 60000, 2));
+  Cassandra client(new TimingOutClient(), "localhost", 9160, "Keyspace1");
+  client.setColumnCache(cache);
+  vector<Column> out;
+  const string path= ColumnCache::pathKey("", "a");
+
+  cache->put("Keyspace1", "Standard1", "row", path, makeColumns("a", "old"),
+             cache->getGeneration("Keyspace1", "Standard1", "row"));
+  EXPECT_THROW(client.insertColumn("row", "Standard1", "a", "new"), TimedOutException);
+  EXPECT_FALSE(cache->get("Keyspace1", "Standard1", "row", path, out));
+
+  cache->put("Keyspace1", "Standard1", "row", path, makeColumns("a", "old"),
+             cache->getGeneration("Keyspace1", "Standard1", "row"));
+  ColumnPath col_path;
+  col_path.column_family= "Standard1";
+  col_path.column= "a";
+  col_path.__isset.column= true;
+  EXPECT_THROW(client.remove("row", col_path), TimedOutException);
+  EXPECT_FALSE(cache->get("Keyspace1", "Standard1", "row", path, out));
+}
@@ -0,0 +1,107 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/column_slice_cursor.h>
+#include <libcassandra/util/pool.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+/*
+ * serves a row with the columns "c0" to "c9" and times out on one
+ * chosen call
+ */
+class WideRowClient : public CassandraClient
+{
+public:
+  WideRowClient(int in_fail_call)
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>()),
+      names(),
+      fail_call(in_fail_call),
+      calls(0)
+  {
+    for (char c= '0'; c <= '9'; ++c)
+    {
+      names.insert(string("c") + c);
+    }
+  }
+
+  void get_slice(vector<ColumnOrSuperColumn>& ret,
+                 const string&,
+                 const ColumnParent&,
+                 const SlicePredicate& pred,
+                 const ConsistencyLevel::type)
+  {
+    if (++calls == fail_call)
+    {
+      throw TimedOutException();
+    }
+    ret.clear();
+    for (set<string>::iterator it= names.lower_bound(pred.slice_range.start);
+         it != names.end() && static_cast<int32_t>(ret.size()) < pred.slice_range.count;
+         ++it)
+    {
+      ret.push_back(ColumnOrSuperColumn());
+      ret.back().column.name= *it;
+      ret.back().column.value= "value";
+      ret.back().__isset.column= true;
+    }
+  }
+
+  set<string> names;
+  int fail_call;
+  int calls;
+};
+
+
+TEST(ColumnSliceCursor, FailedPrefetchIsReadAgain)
+{
+  WideRowClient *thrift_client= new WideRowClient(3);
+  util::CassandraPool pool("localhost", 9160, 0, 1);
+  pool.addConnection(tr1::shared_ptr<Cassandra>(new Cassandra(thrift_client, "localhost", 9160, "Keyspace1")));
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+  ColumnSliceCursor cursor(pool, "Keyspace1", "row1", col_parent, "", "", false, 3, ConsistencyLevel::ONE);
+  /* tiny windows so that every window asks for a few columns only */
+  cursor.setPageBytes(30);
+
+  vector<string> names;
+  int failures= 0;
+  Column col;
+  for (;;)
+  {
+    try
+    {
+      if (! cursor.next(col))
+      {
+        break;
+      }
+      names.push_back(col.name);
+    }
+    catch (TimedOutException &)
+    {
+      ++failures;
+    }
+  }
+  EXPECT_EQ(1, failures);
+  EXPECT_EQ(vector<string>(thrift_client->names.begin(), thrift_client->names.end()), names);
+}
@@ -0,0 +1,217 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <protocol/TProtocol.h>
+
+#include <libcassandra/column_view.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace apache::thrift::protocol;
+
+
+/*
+ * minimal binary protocol encoder for building replies by hand
+ */
+static void putI16(string &out, int16_t v)
+{
+  out.push_back(static_cast<char>((v >> 8) & 0xff));
+  out.push_back(static_cast<char>(v & 0xff));
+}
+
+static void putI32(string &out, int32_t v)
+{
+  for (int shift= 24; shift >= 0; shift-= 8)
+  {
+    out.push_back(static_cast<char>((v >> shift) & 0xff));
+  }
+}
+
+static void putI64(string &out, int64_t v)
+{
+  putI32(out, static_cast<int32_t>(v >> 32));
+  putI32(out, static_cast<int32_t>(v & 0xffffffff));
+}
+
+static void putField(string &out, TType type, int16_t id)
+{
+  out.push_back(static_cast<char>(type));
+  putI16(out, id);
+}
+
+static void putBinary(string &out, const string &value)
+{
+  putI32(out, static_cast<int32_t>(value.size()));
+  out.append(value);
+}
+
+static void putColumnOrSuperColumn(string &out, const string &name, const string &value, int32_t ttl)
+{
+  putField(out, T_STRUCT, 1);
+  putField(out, T_STRING, 1);
+  putBinary(out, name);
+  putField(out, T_STRING, 2);
+  putBinary(out, value);
+  putField(out, T_I64, 3);
+  putI64(out, 1234567890123LL);
+  if (ttl)
+  {
+    putField(out, T_I32, 4);
+    putI32(out, ttl);
+  }
+  out.push_back(T_STOP);
+  out.push_back(T_STOP);
+}
+
+static void putSuperColumn(string &out)
+{
+  putField(out, T_STRUCT, 2);
+  putField(out, T_STRING, 1);
+  putBinary(out, "super");
+  putField(out, T_LIST, 2);
+  out.push_back(T_STRUCT);
+  putI32(out, 0);
+  out.push_back(T_STOP);
+  out.push_back(T_STOP);
+}
+
+
+TEST(ColumnViewSet, Slice)
+{
+  tr1::shared_ptr<string> body(new string());
+  putField(*body, T_LIST, 0);
+  body->push_back(T_STRUCT);
+  putI32(*body, 3);
+  putColumnOrSuperColumn(*body, "first", "one", 0);
+  putSuperColumn(*body);
+  putColumnOrSuperColumn(*body, "second", string("t\0o", 3), 60);
+  body->push_back(T_STOP);
+
+  ColumnViewSet result;
+  ASSERT_TRUE(result.parse(body, false));
+  ASSERT_EQ(2u, result.getColumnCount());
+  EXPECT_EQ(0u, result.getRowCount());
+  EXPECT_EQ("first", result.getColumn(0).getName());
+  EXPECT_EQ("one", result.getColumn(0).getValue());
+  EXPECT_FALSE(result.getColumn(0).has_ttl);
+  EXPECT_EQ(1234567890123LL, result.getColumn(0).timestamp);
+  EXPECT_EQ(string("t\0o", 3), result.getColumn(1).getValue());
+  EXPECT_EQ(60, result.getColumn(1).toColumn().ttl);
+  EXPECT_TRUE(result.getColumn(1).toColumn().__isset.ttl);
+  /* the views point into the shared buffer */
+  EXPECT_GE(result.getColumn(0).name, body->data());
+  EXPECT_LT(result.getColumn(0).name, body->data() + body->size());
+}
+
+
+TEST(ColumnViewSet, Range)
+{
+  tr1::shared_ptr<string> body(new string());
+  putField(*body, T_LIST, 0);
+  body->push_back(T_STRUCT);
+  putI32(*body, 2);
+  putField(*body, T_STRING, 1);
+  putBinary(*body, "row1");
+  putField(*body, T_LIST, 2);
+  body->push_back(T_STRUCT);
+  putI32(*body, 2);
+  putColumnOrSuperColumn(*body, "a", "1", 0);
+  putColumnOrSuperColumn(*body, "b", "2", 0);
+  body->push_back(T_STOP);
+  putField(*body, T_STRING, 1);
+  putBinary(*body, "row2");
+  putField(*body, T_LIST, 2);
+  body->push_back(T_STRUCT);
+  putI32(*body, 0);
+  body->push_back(T_STOP);
+  body->push_back(T_STOP);
+
+  ColumnViewSet result;
+  ASSERT_TRUE(result.parse(body, true));
+  ASSERT_EQ(2u, result.getRowCount());
+  EXPECT_EQ("row1", result.getRow(0).getKey());
+  EXPECT_EQ(0u, result.getRow(0).first_column);
+  EXPECT_EQ(2u, result.getRow(0).column_count);
+  EXPECT_EQ("b", result.getColumn(1).getName());
+  EXPECT_EQ("row2", result.getRow(1).getKey());
+  EXPECT_EQ(0u, result.getRow(1).column_count);
+
+  /* a copy shares the buffer and outlives the original */
+  ColumnViewSet copy(result);
+  body.reset();
+  result.clear();
+  EXPECT_EQ("2", copy.getColumn(1).getValue());
+}
+
+
+TEST(ColumnViewSet, ExceptionReply)
+{
+  tr1::shared_ptr<string> body(new string());
+  putField(*body, T_STRUCT, 1);
+  putField(*body, T_STRING, 1);
+  putBinary(*body, "bad request");
+  body->push_back(T_STOP);
+  body->push_back(T_STOP);
+  ColumnViewSet result;
+  EXPECT_FALSE(result.parse(body, false));
+  EXPECT_EQ(0u, result.getColumnCount());
+}
+
+
+TEST(ColumnViewSet, TruncatedReply)
+{
+  tr1::shared_ptr<string> body(new string());
+  putField(*body, T_LIST, 0);
+  body->push_back(T_STRUCT);
+  putI32(*body, 1);
+  putField(*body, T_STRUCT, 1);
+  putField(*body, T_STRING, 1);
+  putI32(*body, 100);
+  body->append("short");
+  ColumnViewSet result;
+  EXPECT_THROW(result.parse(body, false), TProtocolException);
+}
+
+
+TEST(ArenaSliceResult, RangeAndReuse)
+{
+  string body;
+  putField(body, T_LIST, 0);
+  body.push_back(T_STRUCT);
+  putI32(body, 1);
+  putField(body, T_STRING, 1);
+  putBinary(body, "row1");
+  putField(body, T_LIST, 2);
+  body.push_back(T_STRUCT);
+  putI32(body, 2);
+  putColumnOrSuperColumn(body, "a", "1", 0);
+  putColumnOrSuperColumn(body, "b", string(300, 'v'), 0);
+  body.push_back(T_STOP);
+  body.push_back(T_STOP);
+
+  ArenaSliceResult result(256);
+  ASSERT_TRUE(result.parse(body.data(), body.size(), true));
+  /* the reply buffer may go away once decoded */
+  body.assign(body.size(), '\0');
+  ASSERT_EQ(1u, result.getRowCount());
+  EXPECT_EQ("row1", result.getRow(0).getKey());
+  ASSERT_EQ(2u, result.getColumnCount());
+  EXPECT_EQ("a", result.getColumn(0).getName());
+  EXPECT_EQ(string(300, 'v'), result.getColumn(1).getValue());
+  EXPECT_EQ(4u + 1 + 1 + 1 + 300, result.getBytesUsed());
+
+  result.clear();
+  EXPECT_EQ(0u, result.getRowCount());
+  EXPECT_EQ(0u, result.getBytesUsed());
+}
@@ -0,0 +1,86 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/composite.h>
+#include <libcassandra/exception.h>
+#include <libcassandra/util_functions.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+TEST(Composite, BuildAndParse)
+{
+  string name;
+  CompositeBuilder builder(name);
+  builder.add("user42").addLong(20110301).add(string());
+  EXPECT_EQ(3u, builder.getComponentCount());
+  EXPECT_EQ(string("\0\6user42\0\0\10", 11) + serializeLong(20110301) + string("\0\0\0\0", 4),
+            name);
+
+  CompositeParser parser(name);
+  ComponentView component;
+  ASSERT_TRUE(parser.next(component));
+  EXPECT_EQ("user42", component.getValue());
+  EXPECT_EQ(0, component.end_of_component);
+  /* components point into the name */
+  EXPECT_EQ(name.data() + 2, component.data);
+  ASSERT_TRUE(parser.next(component));
+  EXPECT_EQ(8u, component.length);
+  EXPECT_EQ(20110301, decodeLong(component.data));
+  ASSERT_TRUE(parser.next(component));
+  EXPECT_EQ(0u, component.length);
+  EXPECT_FALSE(parser.next(component));
+}
+
+
+TEST(Composite, ClearKeepsBuffer)
+{
+  string name;
+  CompositeBuilder builder(name);
+  builder.add(string(100, 'x'));
+  const char *data= name.data();
+  builder.clear();
+  EXPECT_TRUE(name.empty());
+  EXPECT_EQ(0u, builder.getComponentCount());
+  builder.add(string(50, 'y'));
+  EXPECT_EQ(data, name.data());
+}
+
+
+TEST(Composite, Truncated)
+{
+  const string name("\0\5abc", 5);
+  CompositeParser parser(name);
+  ComponentView component;
+  EXPECT_THROW(parser.next(component), Exception);
+}
+
+
+TEST(Composite, PrefixRange)
+{
+  string prefix;
+  CompositeBuilder builder(prefix);
+  builder.add("user42").setEndOfComponent(CompositeBuilder::LESS);
+  SliceRange range;
+  range.count= 10;
+  setCompositePrefixRange(prefix, range);
+  EXPECT_EQ(string("\0\6user42\0", 9), range.start);
+  EXPECT_EQ(string("\0\6user42\1", 9), range.finish);
+  EXPECT_EQ(10, range.count);
+
+  setCompositePrefixRange(string(), range);
+  EXPECT_TRUE(range.start.empty());
+  EXPECT_TRUE(range.finish.empty());
+}
@@ -0,0 +1,105 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/indexed_slices_cursor.h>
+#include <libcassandra/indexed_slices_query.h>
+#include <libcassandra/util/pool.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+/*
+ * answers index queries with the rows "k0" to "k9" and times out on one
+ * chosen call
+ */
+class IndexClient : public CassandraClient
+{
+public:
+  IndexClient(int in_fail_call)
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>()),
+      keys(),
+      fail_call(in_fail_call),
+      calls(0)
+  {
+    for (char c= '0'; c <= '9'; ++c)
+    {
+      keys.insert(string("k") + c);
+    }
+  }
+
+  void get_indexed_slices(vector<KeySlice>& ret,
+                          const ColumnParent&,
+                          const IndexClause& clause,
+                          const SlicePredicate&,
+                          const ConsistencyLevel::type)
+  {
+    if (++calls == fail_call)
+    {
+      throw TimedOutException();
+    }
+    ret.clear();
+    for (set<string>::iterator it= keys.lower_bound(clause.start_key);
+         it != keys.end() && static_cast<int32_t>(ret.size()) < clause.count;
+         ++it)
+    {
+      ret.push_back(KeySlice());
+      ret.back().key= *it;
+    }
+  }
+
+  set<string> keys;
+  int fail_call;
+  int calls;
+};
+
+
+TEST(IndexedSlicesCursor, FailedPrefetchIsReadAgain)
+{
+  IndexClient *thrift_client= new IndexClient(3);
+  util::CassandraPool pool("localhost", 9160, 0, 1);
+  pool.addConnection(tr1::shared_ptr<Cassandra>(new Cassandra(thrift_client, "localhost", 9160, "Keyspace1")));
+  IndexedSlicesQuery query;
+  query.setColumnFamily("Indexed1");
+  query.setRowCount(3);
+  IndexedSlicesCursor cursor(pool, "Keyspace1", query, 0);
+
+  vector<string> keys;
+  int failures= 0;
+  IndexedSlicesCursor::Row row;
+  for (;;)
+  {
+    try
+    {
+      if (! cursor.next(row))
+      {
+        break;
+      }
+      keys.push_back(row.first);
+    }
+    catch (TimedOutException &)
+    {
+      ++failures;
+    }
+  }
+  EXPECT_EQ(1, failures);
+  EXPECT_EQ(vector<string>(thrift_client->keys.begin(), thrift_client->keys.end()), keys);
+}
@@ -0,0 +1,120 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <stdio.h>
+
+#include <string>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <protocol/TProtocol.h>
+
+#include <libcassandra/column_view.h>
+#include <libcassandra/util/intern.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace apache::thrift::protocol;
+
+
+TEST(InternTable, SameNameSameEntry)
+{
+  util::InternTable table;
+  const string *first= table.intern("first_name");
+  ASSERT_TRUE(first != NULL);
+  EXPECT_EQ("first_name", *first);
+  string name("first_name");
+  EXPECT_EQ(first, table.intern(name.data(), name.size()));
+  EXPECT_NE(first, table.intern("last_name"));
+  EXPECT_EQ(2u, table.size());
+
+  /* names differing only past an embedded zero stay apart */
+  const string *a= table.intern(string("n\0a", 3));
+  const string *b= table.intern(string("n\0b", 3));
+  EXPECT_NE(a, b);
+  EXPECT_EQ(string("n\0b", 3), *b);
+
+  EXPECT_TRUE(table.intern(string()) != NULL);
+}
+
+
+TEST(InternTable, EntriesDoNotMove)
+{
+  util::InternTable table;
+  const string *first= table.intern("column");
+  for (int i= 0; i < 5000; ++i)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "c%d", i);
+    table.intern(name);
+  }
+  EXPECT_EQ(first, table.intern("column"));
+  EXPECT_EQ("column", *first);
+}
+
+
+TEST(InternTable, StopsGrowingWhenFull)
+{
+  util::InternTable table(16);
+  size_t interned= 0;
+  for (int i= 0; i < 100; ++i)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "c%d", i);
+    if (table.intern(name) != NULL)
+    {
+      ++interned;
+    }
+  }
+  EXPECT_EQ(interned, table.size());
+  EXPECT_GT(interned, 0u);
+  EXPECT_LE(interned, 16u);
+
+  /* names already held are still found */
+  const string *held= table.intern("c0");
+  if (held != NULL)
+  {
+    EXPECT_EQ(held, table.intern("c0"));
+  }
+}
+
+
+TEST(InternTable, ArenaResultSharesNames)
+{
+  /* a get_slice reply body holding the same column name twice */
+  string body;
+  body.push_back(T_LIST);
+  body.append(string("\0\0", 2));
+  body.push_back(T_STRUCT);
+  body.append(string("\0\0\0\2", 4));
+  for (int i= 0; i < 2; ++i)
+  {
+    body.push_back(T_STRUCT);
+    body.append(string("\0\1", 2));
+    body.push_back(T_STRING);
+    body.append(string("\0\1\0\0\0\4name", 10));
+    body.push_back(T_STRING);
+    body.append(string("\0\2\0\0\0\1v", 7));
+    body.push_back(T_STOP);
+    body.push_back(T_STOP);
+  }
+  body.push_back(T_STOP);
+
+  tr1::shared_ptr<util::InternTable> table(new util::InternTable());
+  ArenaSliceResult result;
+  result.setNameTable(table);
+  ASSERT_TRUE(result.parse(body.data(), body.size(), false));
+  ASSERT_EQ(2u, result.getColumnCount());
+  EXPECT_EQ("name", result.getColumn(0).getName());
+  EXPECT_EQ(result.getColumn(0).name, result.getColumn(1).name);
+  EXPECT_EQ(table->intern("name")->data(), result.getColumn(0).name);
+  /* only the values went into the arena */
+  EXPECT_EQ(2u, result.getBytesUsed());
+}
@@ -0,0 +1,237 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/parallel_scan.h>
+#include <libcassandra/row_visitor.h>
+#include <libcassandra/token.h>
+#include <libcassandra/util/pool.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+static const char *PARTITIONER= "org.apache.cassandra.dht.ByteOrderedPartitioner";
+
+
+/*
+ * rows held by a two node ring: 10.0.0.1 owns ("30", "6d"] and
+ * 10.0.0.2 owns ("6d", "30"], which wraps around the end of the ring
+ */
+struct Ring
+{
+  Ring()
+    :
+      rows(),
+      served(),
+      fail_host()
+  {}
+
+  /* rows by token */
+  map<string, string> rows;
+  /* host that served each get_range_slices, with its start token */
+  vector<pair<string, string> > served;
+  string fail_host;
+};
+
+
+class RingClient : public CassandraClient
+{
+public:
+  RingClient(Ring &in_ring, const string& in_host)
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>()),
+      ring(in_ring),
+      host(in_host)
+  {}
+
+  void describe_ring(vector<TokenRange>& ret, const string&)
+  {
+    ret.push_back(makeRange("30", "6d", "10.0.0.1"));
+    ret.push_back(makeRange("6d", "30", "10.0.0.2"));
+  }
+
+  void describe_partitioner(string& ret)
+  {
+    ret= PARTITIONER;
+  }
+
+  void describe_splits(vector<string>& ret,
+                       const string&,
+                       const string& start_token,
+                       const string& end_token,
+                       const int32_t)
+  {
+    /* the first range is cut in two; the second is left whole */
+    if (start_token == "30")
+    {
+      ret.push_back(start_token);
+      ret.push_back("66");
+      ret.push_back(end_token);
+    }
+  }
+
+  void get_range_slices(vector<KeySlice>& ret,
+                        const ColumnParent&,
+                        const SlicePredicate&,
+                        const KeyRange& range,
+                        const ConsistencyLevel::type)
+  {
+    ring.served.push_back(make_pair(host, range.start_token));
+    if (host == ring.fail_host)
+    {
+      throw TimedOutException();
+    }
+    vector<TokenRange> one(1, makeRange(range.start_token, range.end_token, host));
+    /* in ring order from the start token, wrapping at the end */
+    map<string, string>::const_iterator start= ring.rows.upper_bound(range.start_token);
+    vector<map<string, string>::const_iterator> order;
+    for (map<string, string>::const_iterator it= start; it != ring.rows.end(); ++it)
+    {
+      order.push_back(it);
+    }
+    for (map<string, string>::const_iterator it= ring.rows.begin(); it != start; ++it)
+    {
+      order.push_back(it);
+    }
+    for (size_t i= 0; i < order.size() && static_cast<int32_t>(ret.size()) < range.count; ++i)
+    {
+      if (findOwningRange(PARTITIONER, one, order[i]->first) == 0)
+      {
+        ret.push_back(KeySlice());
+        ret.back().key= order[i]->second;
+        ret.back().columns.resize(1);
+        ret.back().columns[0].column.name= "host";
+        ret.back().columns[0].column.value= host;
+        ret.back().columns[0].__isset.column= true;
+      }
+    }
+  }
+
+  static TokenRange makeRange(const string& start, const string& end, const string& endpoint)
+  {
+    TokenRange ret;
+    ret.start_token= start;
+    ret.end_token= end;
+    ret.endpoints.push_back(endpoint);
+    return ret;
+  }
+
+  Ring &ring;
+  string host;
+};
+
+
+class CollectRows : public RowVisitor
+{
+public:
+  bool visit(const string& key, vector<Column>& columns)
+  {
+    ++seen[key];
+    if (! columns.empty())
+    {
+      hosts[key]= columns.front().value;
+    }
+    return true;
+  }
+
+  map<string, int> seen;
+  map<string, string> hosts;
+};
+
+
+static void addRingConnections(util::CassandraPool &pool, Ring &ring)
+{
+  const char *hosts[]= { "10.0.0.1", "10.0.0.2" };
+  for (int i= 0; i < 2; ++i)
+  {
+    tr1::shared_ptr<Cassandra> client(new Cassandra(new RingClient(ring, hosts[i]),
+                                                    hosts[i],
+                                                    9160,
+                                                    "Keyspace1"));
+    ASSERT_TRUE(pool.addConnection(client));
+  }
+}
+
+
+static void addRows(Ring &ring)
+{
+  const char *keys[]= { "0", "5", "9", "a", "c", "e", "f", "g", "k", "m", "n", "t", "z", "~" };
+  for (size_t i= 0; i < sizeof(keys) / sizeof(keys[0]); ++i)
+  {
+    ring.rows[computeToken(PARTITIONER, keys[i])]= keys[i];
+  }
+}
+
+
+TEST(ParallelScan, VisitsEveryRowOnceOnItsReplica)
+{
+  Ring ring;
+  addRows(ring);
+  util::CassandraPool pool("10.0.0.1", 9160, 0, 2);
+  addRingConnections(pool, ring);
+
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+  SlicePredicate pred;
+  ParallelScan scan(pool, "Keyspace1", col_parent, pred);
+  /* one split at a time, so each host's only connection is free */
+  scan.setMaxThreads(1);
+  scan.setPageSize(2);
+  CollectRows visitor;
+  scan.run(visitor);
+
+  ASSERT_EQ(ring.rows.size(), visitor.seen.size());
+  for (map<string, string>::iterator it= ring.rows.begin(); it != ring.rows.end(); ++it)
+  {
+    EXPECT_EQ(1, visitor.seen[it->second]) << it->second;
+  }
+  /* ("30", "6d"] is "1" up to "m" */
+  EXPECT_EQ("10.0.0.1", visitor.hosts["5"]);
+  EXPECT_EQ("10.0.0.1", visitor.hosts["m"]);
+  EXPECT_EQ("10.0.0.2", visitor.hosts["0"]);
+  EXPECT_EQ("10.0.0.2", visitor.hosts["n"]);
+  EXPECT_EQ("10.0.0.2", visitor.hosts["~"]);
+
+  /* the first range was read as its two splits */
+  bool split_start= false;
+  for (size_t i= 0; i < ring.served.size(); ++i)
+  {
+    split_start= split_start || (ring.served[i].second == "66");
+  }
+  EXPECT_TRUE(split_start);
+}
+
+
+TEST(ParallelScan, PassesOnErrors)
+{
+  Ring ring;
+  addRows(ring);
+  ring.fail_host= "10.0.0.2";
+  util::CassandraPool pool("10.0.0.1", 9160, 0, 2);
+  addRingConnections(pool, ring);
+
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+  SlicePredicate pred;
+  ParallelScan scan(pool, "Keyspace1", col_parent, pred);
+  scan.setMaxThreads(1);
+  CollectRows visitor;
+  EXPECT_THROW(scan.run(visitor), TimedOutException);
+}
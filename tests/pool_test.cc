@@ -0,0 +1,319 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <transport/TTransportException.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/util/mutex.h>
+#include <libcassandra/util/pool.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace apache::thrift::transport;
+using namespace org::apache::cassandra;
+
+
+/* nothing listens on port 1, so connections the pool opens itself fail */
+static const int CLOSED_PORT= 1;
+
+
+struct Waiter
+{
+  Waiter(util::CassandraPool &in_pool, const string& in_host)
+    :
+      pool(in_pool),
+      host(in_host),
+      client(),
+      done(false),
+      lock()
+  {}
+
+  bool isDone()
+  {
+    util::ScopedLock guard(lock);
+    return done;
+  }
+
+  util::CassandraPool &pool;
+  string host;
+  tr1::shared_ptr<Cassandra> client;
+  bool done;
+  util::Mutex lock;
+};
+
+
+static void *waitForConnection(void *arg)
+{
+  Waiter *waiter= static_cast<Waiter *>(arg);
+  tr1::shared_ptr<Cassandra> client;
+  try
+  {
+    client= waiter->pool.getConnection(waiter->host);
+  }
+  catch (...)
+  {
+    /* failing to connect still means the waiter was woken */
+  }
+  util::ScopedLock guard(waiter->lock);
+  waiter->client= client;
+  waiter->done= true;
+  return NULL;
+}
+
+
+/* gives a waiter up to five seconds to return */
+static bool joinWaiter(pthread_t thread, Waiter &waiter)
+{
+  for (int i= 0; i < 500 && ! waiter.isDone(); ++i)
+  {
+    usleep(10000);
+  }
+  if (! waiter.isDone())
+  {
+    /* wake it with a spare connection so the test can end */
+    waiter.pool.releaseConnection(tr1::shared_ptr<Cassandra>(new Cassandra(NULL, waiter.host, CLOSED_PORT)));
+    pthread_join(thread, NULL);
+    return false;
+  }
+  pthread_join(thread, NULL);
+  return true;
+}
+
+
+TEST(CassandraPool, EvictionReusesTheSlot)
+{
+  util::CassandraPool pool("127.0.0.1", CLOSED_PORT, 0, 1);
+  ASSERT_TRUE(pool.addConnection(tr1::shared_ptr<Cassandra>(new Cassandra(NULL, "10.0.0.1", CLOSED_PORT))));
+  EXPECT_EQ(1u, pool.getSize());
+  tr1::shared_ptr<Cassandra> first= pool.getConnection("10.0.0.1");
+  ASSERT_TRUE(first.get() != NULL);
+
+  /* a full pool makes a caller for another host wait */
+  Waiter waiter(pool, "127.0.0.1");
+  pthread_t thread;
+  pthread_create(&thread, NULL, waitForConnection, &waiter);
+  usleep(50000);
+  EXPECT_FALSE(waiter.isDone());
+
+  /* the released connection is evicted to make room for the waiter's host */
+  pool.releaseConnection(first);
+  ASSERT_TRUE(joinWaiter(thread, waiter));
+  EXPECT_EQ(waiter.client ? 1u : 0u, pool.getSize());
+
+  if (waiter.client)
+  {
+    /* dropping the only connection wakes the next waiter */
+    Waiter next(pool, "127.0.0.1");
+    pthread_create(&thread, NULL, waitForConnection, &next);
+    usleep(50000);
+    pool.discardConnection(waiter.client);
+    EXPECT_TRUE(joinWaiter(thread, next));
+    EXPECT_LE(pool.getSize(), pool.getMaxSize());
+  }
+}
+
+
+/*
+ * a one range ring replicated on the given hosts; reads on the down host
+ * fail as if it had gone away
+ */
+struct ReplicaSet
+{
+  ReplicaSet()
+    :
+      endpoints(),
+      down(),
+      served(),
+      ring_requests(0),
+      partitioner_requests(0)
+  {}
+
+  vector<string> endpoints;
+  string down;
+  /* host that served each read */
+  vector<string> served;
+  int ring_requests;
+  int partitioner_requests;
+};
+
+
+class ReplicaClient : public CassandraClient
+{
+public:
+  ReplicaClient(ReplicaSet &in_replicas, const string& in_host)
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>()),
+      replicas(in_replicas),
+      host(in_host)
+  {}
+
+  void set_keyspace(const string&)
+  {}
+
+  void describe_ring(vector<TokenRange>& ret, const string&)
+  {
+    ++replicas.ring_requests;
+    TokenRange range;
+    range.start_token= "00";
+    range.end_token= "00";
+    range.endpoints= replicas.endpoints;
+    ret.push_back(range);
+  }
+
+  void describe_partitioner(string& ret)
+  {
+    ++replicas.partitioner_requests;
+    ret= "org.apache.cassandra.dht.ByteOrderedPartitioner";
+  }
+
+  void multiget_slice(map<string, vector<ColumnOrSuperColumn> >& ret,
+                      const vector<string>& keys,
+                      const ColumnParent&,
+                      const SlicePredicate&,
+                      const ConsistencyLevel::type)
+  {
+    serve();
+    for (vector<string>::const_iterator it= keys.begin(); it != keys.end(); ++it)
+    {
+      ret[*it].push_back(ColumnOrSuperColumn());
+      ret[*it].back().column.name= "host";
+      ret[*it].back().column.value= host;
+      ret[*it].back().__isset.column= true;
+    }
+  }
+
+  void multiget_count(map<string, int32_t>& ret,
+                      const vector<string>& keys,
+                      const ColumnParent&,
+                      const SlicePredicate&,
+                      const ConsistencyLevel::type)
+  {
+    serve();
+    for (vector<string>::const_iterator it= keys.begin(); it != keys.end(); ++it)
+    {
+      ret[*it]= 1;
+    }
+  }
+
+  void serve()
+  {
+    replicas.served.push_back(host);
+    if (host == replicas.down)
+    {
+      throw TTransportException(TTransportException::END_OF_FILE, "connection reset");
+    }
+  }
+
+  ReplicaSet &replicas;
+  string host;
+};
+
+
+static void addReplica(util::CassandraPool &pool, ReplicaSet &replicas, const string& host)
+{
+  ASSERT_TRUE(pool.addConnection(tr1::shared_ptr<Cassandra>(new Cassandra(new ReplicaClient(replicas, host), host, CLOSED_PORT, "Keyspace1"))));
+}
+
+
+static vector<string> makeKeys()
+{
+  vector<string> ret;
+  ret.push_back("k1");
+  ret.push_back("k2");
+  ret.push_back("k3");
+  return ret;
+}
+
+
+TEST(CassandraPool, RingIsDescribedOnce)
+{
+  ReplicaSet replicas;
+  replicas.endpoints.push_back("10.0.0.1");
+  util::CassandraPool pool("10.0.0.1", CLOSED_PORT, 0, 1);
+  addReplica(pool, replicas, "10.0.0.1");
+  Cassandra client(new ReplicaClient(replicas, "10.0.0.1"), "10.0.0.1", CLOSED_PORT, "Keyspace1");
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+
+  EXPECT_EQ(3u, client.multigetSlice(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1).size());
+  EXPECT_EQ(3u, client.multigetSlice(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1).size());
+  EXPECT_EQ(1, replicas.ring_requests);
+  EXPECT_EQ(1, replicas.partitioner_requests);
+
+  pool.invalidateRing();
+  client.multigetSlice(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1);
+  EXPECT_EQ(2, replicas.ring_requests);
+}
+
+
+TEST(CassandraPool, ChunkMovesToAnotherReplica)
+{
+  ReplicaSet replicas;
+  replicas.endpoints.push_back("10.0.0.1");
+  replicas.endpoints.push_back("10.0.0.2");
+  replicas.down= "10.0.0.1";
+  util::CassandraPool pool("10.0.0.1", CLOSED_PORT, 0, 2);
+  addReplica(pool, replicas, "10.0.0.1");
+  addReplica(pool, replicas, "10.0.0.2");
+  Cassandra client(new ReplicaClient(replicas, "10.0.0.2"), "10.0.0.2", CLOSED_PORT, "Keyspace1");
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+
+  map<string, vector<Column> > ret= client.multigetSlice(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1);
+  ASSERT_EQ(3u, ret.size());
+  EXPECT_EQ("10.0.0.2", ret["k1"].front().value);
+  ASSERT_EQ(2u, replicas.served.size());
+  EXPECT_EQ("10.0.0.1", replicas.served[0]);
+  EXPECT_EQ("10.0.0.2", replicas.served[1]);
+
+  /* the dropped connection may mean the ring changed */
+  EXPECT_EQ(1, replicas.ring_requests);
+  client.multigetSlice(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1);
+  EXPECT_EQ(2, replicas.ring_requests);
+}
+
+
+TEST(CassandraPool, CountChunkMovesToAnotherReplica)
+{
+  ReplicaSet replicas;
+  replicas.endpoints.push_back("10.0.0.1");
+  replicas.endpoints.push_back("10.0.0.2");
+  replicas.down= "10.0.0.1";
+  util::CassandraPool pool("10.0.0.1", CLOSED_PORT, 0, 2);
+  addReplica(pool, replicas, "10.0.0.1");
+  addReplica(pool, replicas, "10.0.0.2");
+  Cassandra client(new ReplicaClient(replicas, "10.0.0.2"), "10.0.0.2", CLOSED_PORT, "Keyspace1");
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+
+  map<string, int32_t> ret= client.multigetCount(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1);
+  EXPECT_EQ(3u, ret.size());
+  ASSERT_EQ(2u, replicas.served.size());
+  EXPECT_EQ("10.0.0.2", replicas.served[1]);
+
+  /* the ring stays cached while no connection fails */
+  replicas.down.clear();
+  addReplica(pool, replicas, "10.0.0.1");
+  client.multigetCount(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1);
+  client.multigetCount(pool, makeKeys(), col_parent, SlicePredicate(), ConsistencyLevel::ONE, 10, 1);
+  EXPECT_EQ(2, replicas.ring_requests);
+  EXPECT_EQ(2, replicas.partitioner_requests);
+}
@@ -0,0 +1,141 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <protocol/TBinaryProtocol.h>
+#include <transport/TTransportUtils.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/prepared_request.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using namespace org::apache::cassandra;
+
+
+static string encodeGet(const string& key, const ColumnPath& col_path, ConsistencyLevel::type level)
+{
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  Cassandra_get_pargs args;
+  args.key= &key;
+  args.column_path= &col_path;
+  args.consistency_level= &level;
+  args.write(&protocol);
+  return buffer->getBufferAsString();
+}
+
+
+static string encodeInsert(const string& key,
+                           const ColumnParent& col_parent,
+                           const Column& col,
+                           ConsistencyLevel::type level)
+{
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  Cassandra_insert_pargs args;
+  args.key= &key;
+  args.column_parent= &col_parent;
+  args.column= &col;
+  args.consistency_level= &level;
+  args.write(&protocol);
+  return buffer->getBufferAsString();
+}
+
+
+TEST(PreparedRequest, GetMatchesGeneratedArgs)
+{
+  PreparedGet get("Super1", "sc", "name", ConsistencyLevel::ONE);
+  EXPECT_FALSE(get.empty());
+  EXPECT_TRUE(PreparedGet().empty());
+  EXPECT_EQ("Super1", get.getColumnFamily());
+  EXPECT_EQ(ConsistencyLevel::ONE, get.getConsistencyLevel());
+
+  ColumnPath col_path;
+  col_path.column_family= "Super1";
+  col_path.super_column= "sc";
+  col_path.__isset.super_column= true;
+  col_path.column= "name";
+  col_path.__isset.column= true;
+
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  get.write(&protocol, "row1");
+  EXPECT_EQ(encodeGet("row1", col_path, ConsistencyLevel::ONE), buffer->getBufferAsString());
+
+  /* the same object serves any key */
+  buffer->resetBuffer();
+  get.write(&protocol, "another row");
+  EXPECT_EQ(encodeGet("another row", col_path, ConsistencyLevel::ONE), buffer->getBufferAsString());
+
+  PreparedGet standard("Standard1", "", "name", ConsistencyLevel::QUORUM);
+  col_path.column_family= "Standard1";
+  col_path.super_column.clear();
+  col_path.__isset.super_column= false;
+  buffer->resetBuffer();
+  standard.write(&protocol, "row1");
+  EXPECT_EQ(encodeGet("row1", col_path, ConsistencyLevel::QUORUM), buffer->getBufferAsString());
+}
+
+
+TEST(PreparedRequest, InsertMatchesGeneratedArgs)
+{
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+  Column col;
+  col.name= "name";
+  col.value= "value";
+  col.timestamp= 1234567890123LL;
+
+  PreparedInsert insert("Standard1", "", "name", ConsistencyLevel::QUORUM);
+  EXPECT_FALSE(insert.empty());
+  EXPECT_TRUE(PreparedInsert().empty());
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  insert.write(&protocol, "row1", "value", col.timestamp);
+  EXPECT_EQ(encodeInsert("row1", col_parent, col, ConsistencyLevel::QUORUM),
+            buffer->getBufferAsString());
+
+  col_parent.column_family= "Super1";
+  col_parent.super_column= "sc";
+  col_parent.__isset.super_column= true;
+  col.value= "";
+  col.ttl= 3600;
+  col.__isset.ttl= true;
+  PreparedInsert with_ttl("Super1", "sc", "name", ConsistencyLevel::ALL, 3600);
+  EXPECT_EQ(3600, with_ttl.getTtl());
+  buffer->resetBuffer();
+  with_ttl.write(&protocol, "row2", "", col.timestamp);
+  EXPECT_EQ(encodeInsert("row2", col_parent, col, ConsistencyLevel::ALL),
+            buffer->getBufferAsString());
+}
+
+
+TEST(PreparedRequest, TiedToTheKeyspace)
+{
+  EXPECT_TRUE(PreparedGet("Standard1", "", "name", ConsistencyLevel::ONE).getKeyspace().empty());
+
+  /* no request is sent before the keyspace is checked */
+  Cassandra first(NULL, "localhost", 9160, "Keyspace1");
+  Cassandra second(NULL, "localhost", 9160, "Keyspace2");
+  PreparedGet get= first.prepareGet("Standard1", "", "name", ConsistencyLevel::ONE);
+  EXPECT_EQ("Keyspace1", get.getKeyspace());
+  EXPECT_THROW(second.getColumn("row1", get), InvalidRequestException);
+
+  PreparedInsert insert= first.prepareInsert("Standard1", "", "name", ConsistencyLevel::ONE);
+  EXPECT_EQ("Keyspace1", insert.getKeyspace());
+  EXPECT_THROW(second.insertColumn("row1", insert, "value"), InvalidRequestException);
+}
@@ -0,0 +1,121 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/range_slice_cursor.h>
+#include <libcassandra/util/pool.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+/*
+ * serves the rows "k0" to "k9" and times out on one chosen call
+ */
+class RowsClient : public CassandraClient
+{
+public:
+  RowsClient(int in_fail_call)
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>()),
+      keys(),
+      fail_call(in_fail_call),
+      calls(0)
+  {
+    for (char c= '0'; c <= '9'; ++c)
+    {
+      keys.insert(string("k") + c);
+    }
+  }
+
+  void get_range_slices(vector<KeySlice>& ret,
+                        const ColumnParent&,
+                        const SlicePredicate&,
+                        const KeyRange& range,
+                        const ConsistencyLevel::type)
+  {
+    if (++calls == fail_call)
+    {
+      throw TimedOutException();
+    }
+    ret.clear();
+    for (set<string>::iterator it= keys.lower_bound(range.start_key);
+         it != keys.end() && static_cast<int32_t>(ret.size()) < range.count;
+         ++it)
+    {
+      ret.push_back(KeySlice());
+      ret.back().key= *it;
+    }
+  }
+
+  set<string> keys;
+  int fail_call;
+  int calls;
+};
+
+
+static vector<string> readAll(RangeSliceCursor &cursor, int &failures)
+{
+  vector<string> ret;
+  RangeSliceCursor::Row row;
+  for (;;)
+  {
+    try
+    {
+      if (! cursor.next(row))
+      {
+        return ret;
+      }
+      ret.push_back(row.first);
+    }
+    catch (TimedOutException &)
+    {
+      ++failures;
+    }
+  }
+}
+
+
+TEST(RangeSliceCursor, FailedPageIsReadAgain)
+{
+  RowsClient *thrift_client= new RowsClient(2);
+  Cassandra client(thrift_client, "localhost", 9160, "Keyspace1");
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+  RangeSliceCursor cursor(client, col_parent, SlicePredicate(), "", "", 3, ConsistencyLevel::ONE);
+  int failures= 0;
+  vector<string> keys= readAll(cursor, failures);
+  EXPECT_EQ(1, failures);
+  EXPECT_EQ(vector<string>(thrift_client->keys.begin(), thrift_client->keys.end()), keys);
+}
+
+
+TEST(RangeSliceCursor, FailedPrefetchIsReadAgain)
+{
+  RowsClient *thrift_client= new RowsClient(3);
+  util::CassandraPool pool("localhost", 9160, 0, 1);
+  pool.addConnection(tr1::shared_ptr<Cassandra>(new Cassandra(thrift_client, "localhost", 9160, "Keyspace1")));
+  ColumnParent col_parent;
+  col_parent.column_family= "Standard1";
+  RangeSliceCursor cursor(pool, "Keyspace1", col_parent, SlicePredicate(), "", "", 3, ConsistencyLevel::ONE);
+  int failures= 0;
+  vector<string> keys= readAll(cursor, failures);
+  EXPECT_EQ(1, failures);
+  EXPECT_EQ(vector<string>(thrift_client->keys.begin(), thrift_client->keys.end()), keys);
+}
@@ -0,0 +1,247 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <TApplicationException.h>
+#include <transport/TTransportException.h>
+
+#include <libcassandra/exception.h>
+#include <libcassandra/request_coalescer.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace apache::thrift;
+using namespace apache::thrift::transport;
+using namespace org::apache::cassandra;
+
+
+/*
+ * a read that stays in flight until the expected number of callers
+ * have joined it
+ */
+class SlowFetch : public RequestCoalescer::Fetch
+{
+public:
+  SlowFetch(RequestCoalescer &in_coalescer, uint64_t in_joiners, bool in_fail)
+    :
+      coalescer(in_coalescer),
+      joiners(in_joiners),
+      fail(in_fail),
+      fail_transport(false),
+      calls(0)
+  {}
+
+  void fetch(vector<Column>& result)
+  {
+    int call= __sync_add_and_fetch(&calls, 1);
+    if (fail_transport && call > 1)
+    {
+      /* the callers that joined retry on their own connections */
+      result.push_back(Column());
+      return;
+    }
+    for (int i= 0; i < 2000 && coalescer.getCoalesced() < joiners; ++i)
+    {
+      usleep(1000);
+    }
+    if (fail_transport)
+    {
+      throw TTransportException(TTransportException::END_OF_FILE, "connection closed");
+    }
+    if (fail)
+    {
+      NotFoundException nfe;
+      throw nfe;
+    }
+    Column col;
+    col.name.assign("name");
+    col.value.assign("value");
+    result.push_back(col);
+  }
+
+  RequestCoalescer &coalescer;
+  uint64_t joiners;
+  bool fail;
+  bool fail_transport;
+  int calls;
+};
+
+
+struct Caller
+{
+  RequestCoalescer *coalescer;
+  SlowFetch *fetch;
+  string request_key;
+  vector<Column> result;
+  bool not_found;
+  bool transport_error;
+};
+
+
+static void *runCaller(void *arg)
+{
+  Caller *caller= static_cast<Caller *>(arg);
+  try
+  {
+    caller->coalescer->run(caller->request_key, *caller->fetch, caller->result);
+  }
+  catch (NotFoundException &)
+  {
+    caller->not_found= true;
+  }
+  catch (TTransportException &)
+  {
+    caller->transport_error= true;
+  }
+  return NULL;
+}
+
+
+static void runCallers(RequestCoalescer &coalescer, SlowFetch &fetch, vector<Caller> &callers)
+{
+  vector<pthread_t> threads(callers.size());
+  for (size_t i= 0; i < callers.size(); ++i)
+  {
+    callers[i].coalescer= &coalescer;
+    callers[i].fetch= &fetch;
+    callers[i].request_key= RequestCoalescer::requestKey("ks", "cf", "key", "path", ConsistencyLevel::ONE);
+    callers[i].not_found= false;
+    callers[i].transport_error= false;
+    pthread_create(&threads[i], NULL, runCaller, &callers[i]);
+  }
+  for (size_t i= 0; i < threads.size(); ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+
+TEST(RequestCoalescer, SharesOneRequest)
+{
+  RequestCoalescer coalescer;
+  SlowFetch fetch(coalescer, 7, false);
+  vector<Caller> callers(8);
+  runCallers(coalescer, fetch, callers);
+  EXPECT_EQ(1, fetch.calls);
+  EXPECT_EQ(1u, coalescer.getIssued());
+  EXPECT_EQ(7u, coalescer.getCoalesced());
+  for (size_t i= 0; i < callers.size(); ++i)
+  {
+    ASSERT_EQ(1u, callers[i].result.size());
+    EXPECT_EQ("value", callers[i].result[0].value);
+  }
+}
+
+
+TEST(RequestCoalescer, SharesErrors)
+{
+  RequestCoalescer coalescer;
+  SlowFetch fetch(coalescer, 3, true);
+  vector<Caller> callers(4);
+  runCallers(coalescer, fetch, callers);
+  EXPECT_EQ(1, fetch.calls);
+  for (size_t i= 0; i < callers.size(); ++i)
+  {
+    EXPECT_TRUE(callers[i].not_found);
+  }
+}
+
+
+TEST(RequestCoalescer, RetriesAfterTransportErrors)
+{
+  RequestCoalescer coalescer;
+  SlowFetch fetch(coalescer, 3, false);
+  fetch.fail_transport= true;
+  vector<Caller> callers(4);
+  runCallers(coalescer, fetch, callers);
+  EXPECT_EQ(4, fetch.calls);
+  size_t failed= 0;
+  for (size_t i= 0; i < callers.size(); ++i)
+  {
+    if (callers[i].transport_error)
+    {
+      ++failed;
+    }
+    else
+    {
+      EXPECT_EQ(1u, callers[i].result.size());
+    }
+  }
+  /* only the caller whose connection failed sees the error */
+  EXPECT_EQ(1u, failed);
+}
+
+
+/*
+ * captures whatever is thrown and throws it again
+ */
+template <class E>
+static void captureAndRethrow(const E& e)
+{
+  util::TaskError error;
+  try
+  {
+    throw e;
+  }
+  catch (...)
+  {
+    error.capture();
+  }
+  error.rethrow();
+}
+
+
+TEST(RequestCoalescer, ErrorsKeepTheirType)
+{
+  try
+  {
+    captureAndRethrow(TTransportException(TTransportException::TIMED_OUT, "timed out"));
+    ADD_FAILURE();
+  }
+  catch (TTransportException &te)
+  {
+    EXPECT_EQ(TTransportException::TIMED_OUT, te.getType());
+    EXPECT_STREQ("timed out", te.what());
+  }
+  try
+  {
+    captureAndRethrow(TApplicationException(TApplicationException::MISSING_RESULT, "no result"));
+    ADD_FAILURE();
+  }
+  catch (TApplicationException &ae)
+  {
+    EXPECT_EQ(TApplicationException::MISSING_RESULT, ae.getType());
+  }
+  try
+  {
+    captureAndRethrow(Error("pool exhausted", 11));
+    ADD_FAILURE();
+  }
+  catch (Error &e)
+  {
+    EXPECT_EQ(11, e.getErrno());
+    EXPECT_STREQ("pool exhausted", e.what());
+  }
+}
+
+
+TEST(RequestCoalescer, KeysDiffer)
+{
+  EXPECT_NE(RequestCoalescer::requestKey("ks", "cf", "key", "path", ConsistencyLevel::ONE),
+            RequestCoalescer::requestKey("ks", "cf", "key", "path", ConsistencyLevel::QUORUM));
+  EXPECT_NE(RequestCoalescer::requestKey("ks", "cf", "ab", "c", ConsistencyLevel::ONE),
+            RequestCoalescer::requestKey("ks", "cf", "a", "bc", ConsistencyLevel::ONE));
+}
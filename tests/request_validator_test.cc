@@ -0,0 +1,134 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/column_definition.h>
+#include <libcassandra/request_validator.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+TEST(RequestValidator, ParseType)
+{
+  EXPECT_EQ(RequestValidator::UTF8,
+            RequestValidator::parseType("org.apache.cassandra.db.marshal.UTF8Type"));
+  EXPECT_EQ(RequestValidator::ASCII, RequestValidator::parseType("AsciiType"));
+  EXPECT_EQ(RequestValidator::LONG, RequestValidator::parseType("LongType"));
+  EXPECT_EQ(RequestValidator::TIME_UUID, RequestValidator::parseType("TimeUUIDType"));
+  EXPECT_EQ(RequestValidator::BYTES, RequestValidator::parseType("BytesType"));
+  EXPECT_EQ(RequestValidator::BYTES, RequestValidator::parseType("com.example.CustomType"));
+  EXPECT_EQ(RequestValidator::BYTES, RequestValidator::parseType(""));
+}
+
+
+TEST(RequestValidator, Check)
+{
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::UTF8, "caf\xc3\xa9", 5) == NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::UTF8, "\xc3", 1) != NULL);
+  /* overlong encoding of '/' */
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::UTF8, "\xc0\xaf", 2) != NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::ASCII, "plain", 5) == NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::ASCII, "\xc3\xa9", 2) != NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::LONG, "12345678", 8) == NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::LONG, "1234", 4) != NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::LONG, "", 0) == NULL);
+
+  string uuid(16, '\0');
+  uuid[6]= '\x11';
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::TIME_UUID, uuid.data(), uuid.size()) == NULL);
+  uuid[6]= '\x41';
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::TIME_UUID, uuid.data(), uuid.size()) != NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::LEXICAL_UUID, uuid.data(), uuid.size()) == NULL);
+  EXPECT_TRUE(RequestValidator::check(RequestValidator::TIME_UUID, "short", 5) != NULL);
+}
+
+
+TEST(RequestValidator, StandardPaths)
+{
+  ColumnFamilyDefinition cf;
+  cf.setName("Standard1");
+  cf.setColumnType("Standard");
+  cf.setComparatorType("UTF8Type");
+  RequestValidator validator(cf);
+  EXPECT_FALSE(validator.isSuper());
+
+  EXPECT_NO_THROW(validator.validatePath("", "name"));
+  EXPECT_THROW(validator.validatePath("sc", "name"), InvalidRequestException);
+  EXPECT_THROW(validator.validatePath("", ""), InvalidRequestException);
+  EXPECT_THROW(validator.validatePath("", "\xff"), InvalidRequestException);
+  EXPECT_THROW(validator.validatePath("", string(RequestValidator::MAX_NAME_LENGTH + 1, 'a')),
+               InvalidRequestException);
+  try
+  {
+    validator.validatePath("sc", "name");
+  }
+  catch (InvalidRequestException &ire)
+  {
+    EXPECT_EQ("supercolumn parameter is invalid for standard CF Standard1", ire.why);
+  }
+}
+
+
+TEST(RequestValidator, SuperPaths)
+{
+  ColumnFamilyDefinition cf;
+  cf.setName("Super1");
+  cf.setColumnType("Super");
+  cf.setComparatorType("LongType");
+  cf.setSubComparatorType("AsciiType");
+  RequestValidator validator(cf);
+  EXPECT_TRUE(validator.isSuper());
+
+  EXPECT_NO_THROW(validator.validatePath("12345678", "name"));
+  EXPECT_NO_THROW(validator.validatePath("12345678", ""));
+  EXPECT_THROW(validator.validatePath("", "name"), InvalidRequestException);
+  EXPECT_THROW(validator.validatePath("1234", "name"), InvalidRequestException);
+  EXPECT_THROW(validator.validatePath("12345678", "\xc3\xa9"), InvalidRequestException);
+}
+
+
+TEST(RequestValidator, Values)
+{
+  ColumnFamilyDefinition cf;
+  cf.setName("Standard1");
+  cf.setColumnType("Standard");
+  cf.setDefaultValidationClass("AsciiType");
+  ColumnDefinition age;
+  age.setName("age");
+  age.setValidationClass("LongType");
+  cf.addColumnMetadata(age);
+  RequestValidator validator(cf);
+
+  EXPECT_NO_THROW(validator.validateInsert("", "age", "12345678"));
+  EXPECT_THROW(validator.validateInsert("", "age", "42"), InvalidRequestException);
+  EXPECT_NO_THROW(validator.validateInsert("", "name", "42"));
+  EXPECT_THROW(validator.validateInsert("", "name", "\xc3\xa9"), InvalidRequestException);
+  EXPECT_THROW(validator.validateInsert("", "", "42"), InvalidRequestException);
+  EXPECT_FALSE(validator.acceptsAnyValue());
+}
+
+
+TEST(RequestValidator, AcceptsAnyValue)
+{
+  ColumnFamilyDefinition cf;
+  cf.setName("Standard1");
+  cf.setDefaultValidationClass("BytesType");
+  EXPECT_TRUE(RequestValidator(cf).acceptsAnyValue());
+  ColumnDefinition age;
+  age.setName("age");
+  age.setValidationClass("LongType");
+  cf.addColumnMetadata(age);
+  EXPECT_FALSE(RequestValidator(cf).acceptsAnyValue());
+}
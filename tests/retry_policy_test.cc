@@ -0,0 +1,39 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/retry_policy.h>
+
+using namespace libcassandra;
+
+
+TEST(RetryPolicy, ExponentialBackoff)
+{
+  RetryPolicy policy(5, 10, 1000);
+  policy.setJitter(false);
+  unsigned int seed= 1;
+  EXPECT_EQ(10, policy.getBackoff(1, &seed));
+  EXPECT_EQ(20, policy.getBackoff(2, &seed));
+  EXPECT_EQ(40, policy.getBackoff(3, &seed));
+  EXPECT_EQ(1000, policy.getBackoff(20, &seed));
+}
+
+
+TEST(RetryPolicy, JitteredBackoff)
+{
+  RetryPolicy policy(5, 100, 1000);
+  unsigned int seed= 42;
+  for (int i= 0; i < 100; ++i)
+  {
+    uint32_t wait_ms= policy.getBackoff(2, &seed);
+    EXPECT_LE(100, wait_ms);
+    EXPECT_GE(200, wait_ms);
+  }
+}
@@ -0,0 +1,121 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/row_mapping.h>
+#include <libcassandra/util_functions.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+struct User
+{
+  User() : name(), born(0), visits(0) {}
+  string name;
+  int64_t born;
+  int32_t visits;
+};
+
+
+static void addColumn(vector<Column> &cols, const string &name, const string &value)
+{
+  cols.push_back(Column());
+  cols.back().name.assign(name);
+  cols.back().value.assign(value);
+}
+
+
+static RowMapping<User> userMapping()
+{
+  RowMapping<User> mapping("users");
+  mapping.add<StringCodec, &User::name>("full_name")
+         .add<LongCodec, &User::born>("birth_date")
+         .add<IntCodec, &User::visits>("visits");
+  return mapping;
+}
+
+
+TEST(RowMapping, ColumnNamesAreSorted)
+{
+  RowMapping<User> mapping= userMapping();
+  vector<string> names= mapping.getColumnNames();
+  ASSERT_EQ(3u, names.size());
+  EXPECT_EQ("birth_date", names[0]);
+  EXPECT_EQ("full_name", names[1]);
+  EXPECT_EQ("visits", names[2]);
+  EXPECT_TRUE(mapping.getSlicePredicate().__isset.column_names);
+}
+
+
+TEST(RowMapping, DecodeInOrder)
+{
+  RowMapping<User> mapping= userMapping();
+  vector<Column> cols;
+  addColumn(cols, "age", "ignored");
+  addColumn(cols, "birth_date", serializeLong(1975));
+  addColumn(cols, "email", "ignored");
+  addColumn(cols, "full_name", "Brandon Sanderson");
+  addColumn(cols, "visits", string("\0\0\1\2", 4));
+  addColumn(cols, "zone", "ignored");
+  User user;
+  EXPECT_EQ(3u, mapping.decode(cols, user));
+  EXPECT_EQ("Brandon Sanderson", user.name);
+  EXPECT_EQ(1975, user.born);
+  EXPECT_EQ(258, user.visits);
+}
+
+
+TEST(RowMapping, DecodeOutOfOrderAndBadValues)
+{
+  RowMapping<User> mapping= userMapping();
+  vector<Column> cols;
+  addColumn(cols, "visits", "bad");
+  addColumn(cols, "full_name", "Howard Tayler");
+  addColumn(cols, "birth_date", serializeLong(-1968));
+  User user;
+  user.visits= 7;
+  EXPECT_EQ(2u, mapping.decode(cols, user));
+  EXPECT_EQ("Howard Tayler", user.name);
+  EXPECT_EQ(-1968, user.born);
+  EXPECT_EQ(7, user.visits);
+}
+
+
+TEST(RowMapping, EncodeRoundTrip)
+{
+  RowMapping<User> mapping= userMapping();
+  User user;
+  user.name.assign("Patrick Rothfuss");
+  user.born= 1973;
+  user.visits= -3;
+  vector<Cassandra::ColumnInsertTuple> tuples;
+  mapping.encode("prothfuss", user, tuples);
+  ASSERT_EQ(3u, tuples.size());
+  EXPECT_EQ("users", tr1::get<0>(tuples[0]));
+  EXPECT_EQ("prothfuss", tr1::get<1>(tuples[0]));
+  EXPECT_EQ("birth_date", tr1::get<2>(tuples[0]));
+  EXPECT_EQ(serializeLong(1973), tr1::get<3>(tuples[0]));
+
+  vector<Column> cols;
+  for (size_t i= 0; i < tuples.size(); ++i)
+  {
+    addColumn(cols, tr1::get<2>(tuples[i]), tr1::get<3>(tuples[i]));
+  }
+  User copy;
+  EXPECT_EQ(3u, mapping.decode(cols, copy));
+  EXPECT_EQ(user.name, copy.name);
+  EXPECT_EQ(user.born, copy.born);
+  EXPECT_EQ(user.visits, copy.visits);
+}
@@ -0,0 +1,113 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/column_family_definition.h>
+#include <libcassandra/schema_batch.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+/*
+ * a node that refuses the first few column family changes as if the
+ * cluster had not yet agreed on the schema
+ */
+class DisagreeingClient : public CassandraClient
+{
+public:
+  DisagreeingClient(int in_refusals, const string& in_why)
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>()),
+      refusals(in_refusals),
+      why(in_why),
+      adds(0),
+      version_calls(0)
+  {}
+
+  void system_add_column_family(string& ret, const CfDef&)
+  {
+    ++adds;
+    if (refusals > 0)
+    {
+      --refusals;
+      InvalidRequestException ire;
+      ire.why= why;
+      throw ire;
+    }
+    ret= "schema-id";
+  }
+
+  void describe_schema_versions(map<string, vector<string> >& ret)
+  {
+    ++version_calls;
+    ret["schema-id"].push_back("127.0.0.1");
+  }
+
+  int refusals;
+  string why;
+  int adds;
+  int version_calls;
+};
+
+
+TEST(SchemaBatch, RetriesChangesRefusedForDisagreement)
+{
+  DisagreeingClient *thrift_client= new DisagreeingClient(2, "Cluster schema does not yet agree");
+  Cassandra client(thrift_client, "localhost", 9160);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("Standard1");
+  cf_def.setKeyspaceName("Keyspace1");
+  SchemaBatch batch;
+  batch.addColumnFamily(cf_def);
+  EXPECT_TRUE(batch.apply(client, 1000));
+  EXPECT_EQ(1u, batch.getApplied());
+  EXPECT_EQ(3, thrift_client->adds);
+  /* one wait per refusal and the one after the batch */
+  EXPECT_EQ(3, thrift_client->version_calls);
+}
+
+
+TEST(SchemaBatch, OtherRefusalsArePassedOn)
+{
+  DisagreeingClient *thrift_client= new DisagreeingClient(1, "Keyspace1 already exists");
+  Cassandra client(thrift_client, "localhost", 9160);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("Standard1");
+  cf_def.setKeyspaceName("Keyspace1");
+  SchemaBatch batch;
+  batch.addColumnFamily(cf_def);
+  EXPECT_THROW(batch.apply(client, 1000), InvalidRequestException);
+  EXPECT_EQ(0u, batch.getApplied());
+  EXPECT_EQ(1, thrift_client->adds);
+  EXPECT_EQ(0, thrift_client->version_calls);
+}
+
+
+TEST(SchemaBatch, GivesUpAfterMaxAttempts)
+{
+  DisagreeingClient *thrift_client= new DisagreeingClient(100, "Cluster schema does not yet agree");
+  Cassandra client(thrift_client, "localhost", 9160);
+  ColumnFamilyDefinition cf_def;
+  cf_def.setName("Standard1");
+  cf_def.setKeyspaceName("Keyspace1");
+  SchemaBatch batch;
+  batch.addColumnFamily(cf_def);
+  EXPECT_THROW(batch.apply(client, 1000), InvalidRequestException);
+  EXPECT_EQ(static_cast<int>(SchemaBatch::MAX_ATTEMPTS), thrift_client->adds);
+}
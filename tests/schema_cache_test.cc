@@ -0,0 +1,238 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/schema_cache.h>
+#include <libcassandra/util/pool.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+static KeyspaceDefinition makeKeyspace(const string& name, const string& cf_name)
+{
+  KeyspaceDefinition ret;
+  ret.setName(name);
+  ColumnFamilyDefinition cf;
+  cf.setKeyspaceName(name);
+  cf.setName(cf_name);
+  cf.setColumnType("Super");
+  vector<ColumnFamilyDefinition> cfs(1, cf);
+  ret.setColumnFamilies(cfs);
+  return ret;
+}
+
+
+TEST(SchemaCache, Lookups)
+{
+  SchemaCache cache;
+  EXPECT_FALSE(cache.isLoaded());
+  EXPECT_FALSE(cache.findKeyspace("Keyspace1"));
+
+  vector<KeyspaceDefinition> keyspaces;
+  keyspaces.push_back(makeKeyspace("Keyspace1", "Super1"));
+  keyspaces.push_back(makeKeyspace("Keyspace2", "Standard1"));
+  cache.load(keyspaces, "v1");
+  EXPECT_TRUE(cache.isLoaded());
+  EXPECT_EQ("v1", cache.getVersion());
+  EXPECT_EQ(1u, cache.getLoads());
+  EXPECT_EQ(2u, cache.getKeyspaces().size());
+
+  tr1::shared_ptr<const KeyspaceDefinition> ks= cache.findKeyspace("Keyspace2");
+  ASSERT_TRUE(ks);
+  EXPECT_EQ("Keyspace2", ks->getName());
+  EXPECT_FALSE(cache.findKeyspace("Keyspace3"));
+
+  tr1::shared_ptr<const ColumnFamilyDefinition> cf= cache.findColumnFamily("Keyspace1", "Super1");
+  ASSERT_TRUE(cf);
+  EXPECT_EQ("Super", cf->getColumnType());
+  EXPECT_FALSE(cache.findColumnFamily("Keyspace2", "Super1"));
+  EXPECT_FALSE(cache.findColumnFamily("Keyspace3", "Super1"));
+}
+
+
+TEST(SchemaCache, ReloadKeepsOldDefinitionsAlive)
+{
+  SchemaCache cache;
+  cache.load(vector<KeyspaceDefinition>(1, makeKeyspace("Keyspace1", "Super1")), "v1");
+  tr1::shared_ptr<const ColumnFamilyDefinition> old= cache.findColumnFamily("Keyspace1", "Super1");
+  ASSERT_TRUE(old);
+
+  cache.load(vector<KeyspaceDefinition>(1, makeKeyspace("Keyspace1", "Other")), "v2");
+  EXPECT_FALSE(cache.findColumnFamily("Keyspace1", "Super1"));
+  EXPECT_TRUE(cache.findColumnFamily("Keyspace1", "Other"));
+  /* a definition taken before the reload is still usable */
+  EXPECT_EQ("Super1", old->getName());
+  EXPECT_EQ(2u, cache.getLoads());
+
+  cache.invalidate();
+  EXPECT_TRUE(cache.findColumnFamily("Keyspace1", "Other"));
+}
+
+
+TEST(SchemaCache, VersionOf)
+{
+  map<string, vector<string> > versions;
+  EXPECT_EQ("", SchemaCache::versionOf(versions));
+  versions["b2"].push_back("10.0.0.2");
+  versions["UNREACHABLE"].push_back("10.0.0.3");
+  EXPECT_EQ("b2", SchemaCache::versionOf(versions));
+  versions["a1"].push_back("10.0.0.1");
+  EXPECT_EQ("a1,b2", SchemaCache::versionOf(versions));
+}
+
+
+TEST(SchemaCache, IsAgreement)
+{
+  map<string, vector<string> > versions;
+  EXPECT_FALSE(SchemaCache::isAgreement(versions));
+  versions["UNREACHABLE"].push_back("10.0.0.3");
+  EXPECT_FALSE(SchemaCache::isAgreement(versions));
+  versions["b2"].push_back("10.0.0.2");
+  /* a node that cannot be asked does not hold up agreement */
+  EXPECT_TRUE(SchemaCache::isAgreement(versions));
+  versions["a1"].push_back("10.0.0.1");
+  EXPECT_FALSE(SchemaCache::isAgreement(versions));
+}
+
+
+/*
+ * a node whose schema only changes through the calls made on it; its
+ * schema version never changes, so only invalidation makes a cache
+ * read the definitions again
+ */
+class SchemaClient : public CassandraClient
+{
+public:
+  SchemaClient()
+    :
+      CassandraClient(boost::shared_ptr<apache::thrift::protocol::TProtocol>()),
+      keyspaces(1),
+      describes(0),
+      racing_cache(NULL)
+  {
+    keyspaces[0].name= "Keyspace1";
+    keyspaces[0].cf_defs.resize(1);
+    keyspaces[0].cf_defs[0].keyspace= "Keyspace1";
+    keyspaces[0].cf_defs[0].name= "Standard1";
+    keyspaces[0].cf_defs[0].default_validation_class= "LongType";
+    keyspaces[0].cf_defs[0].__isset.default_validation_class= true;
+  }
+
+  void describe_schema_versions(map<string, vector<string> >& ret)
+  {
+    ret["v1"].push_back("127.0.0.1");
+  }
+
+  void describe_keyspaces(vector<KsDef>& ret)
+  {
+    ++describes;
+    ret= keyspaces;
+    if (racing_cache)
+    {
+      /* another connection changes the schema while this one reads it */
+      racing_cache->invalidate();
+    }
+  }
+
+  void system_drop_keyspace(string& ret, const string& name)
+  {
+    for (vector<KsDef>::iterator it= keyspaces.begin(); it != keyspaces.end(); ++it)
+    {
+      if (it->name == name)
+      {
+        keyspaces.erase(it);
+        break;
+      }
+    }
+    ret= "v1";
+  }
+
+  void system_update_column_family(string& ret, const CfDef& cf_def)
+  {
+    keyspaces[0].cf_defs[0]= cf_def;
+    ret= "v1";
+  }
+
+  void insert(const string&, const ColumnParent&, const Column&, const ConsistencyLevel::type)
+  {}
+
+  vector<KsDef> keyspaces;
+  int describes;
+  SchemaCache *racing_cache;
+};
+
+
+TEST(SchemaCache, ValidatesAgainstTheChangedSchema)
+{
+  SchemaClient *thrift_client= new SchemaClient();
+  Cassandra client(thrift_client, "localhost", 9160, "Keyspace1");
+  tr1::shared_ptr<SchemaCache> cache(new SchemaCache());
+  client.setSchemaCache(cache);
+
+  /* "x" is not a long */
+  EXPECT_THROW(client.insertColumn("row", "Standard1", "a", "x"), InvalidRequestException);
+  EXPECT_EQ(1, thrift_client->describes);
+
+  ColumnFamilyDefinition cf_def;
+  cf_def.setKeyspaceName("Keyspace1");
+  cf_def.setName("Standard1");
+  cf_def.setDefaultValidationClass("BytesType");
+  client.updateColumnFamily(cf_def);
+  EXPECT_TRUE(cache->isStale());
+  EXPECT_NO_THROW(client.insertColumn("row", "Standard1", "a", "x"));
+  EXPECT_EQ(2, thrift_client->describes);
+  EXPECT_FALSE(cache->isStale());
+}
+
+
+TEST(SchemaCache, DroppedKeyspaceIsGone)
+{
+  SchemaClient *thrift_client= new SchemaClient();
+  tr1::shared_ptr<Cassandra> client(new Cassandra(thrift_client, "localhost", 9160, "Keyspace1"));
+  tr1::shared_ptr<SchemaCache> cache(new SchemaCache());
+  client->setSchemaCache(cache);
+  util::CassandraPool pool("localhost", 9160, 0, 1);
+  pool.addConnection(client);
+  /* polling, so lookups trust the cache until it is invalidated */
+  cache->startPolling(pool, 3600 * 1000);
+
+  EXPECT_EQ(1u, client->getKeyspaces().size());
+  EXPECT_EQ(1u, client->getKeyspaces().size());
+  EXPECT_EQ(1, thrift_client->describes);
+  client->dropKeyspace("Keyspace1");
+  EXPECT_TRUE(client->getKeyspaces().empty());
+  EXPECT_EQ(2, thrift_client->describes);
+  cache->stopPolling();
+}
+
+
+TEST(SchemaCache, InvalidateDuringLoadKeepsItStale)
+{
+  SchemaClient *thrift_client= new SchemaClient();
+  Cassandra client(thrift_client, "localhost", 9160, "Keyspace1");
+  SchemaCache cache;
+  thrift_client->racing_cache= &cache;
+  EXPECT_TRUE(cache.refresh(client));
+  EXPECT_TRUE(cache.isStale());
+
+  thrift_client->racing_cache= NULL;
+  EXPECT_TRUE(cache.refresh(client));
+  EXPECT_FALSE(cache.isStale());
+  EXPECT_FALSE(cache.refresh(client));
+}
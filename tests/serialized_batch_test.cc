@@ -0,0 +1,234 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+#include <gtest/gtest.h>
+
+#include <protocol/TBinaryProtocol.h>
+#include <transport/TTransportUtils.h>
+#include <transport/TVirtualTransport.h>
+
+#include <libgenthrift/Cassandra.h>
+
+#include <libcassandra/cassandra.h>
+#include <libcassandra/retry_policy.h>
+#include <libcassandra/serialized_batch.h>
+#include <libcassandra/util/pool.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using namespace org::apache::cassandra;
+
+
+/* what the generated client writes for the same call */
+static string sendBatchMutate(const SerializedBatch::MutationsMap& mutations,
+                              ConsistencyLevel::type level)
+{
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  CassandraClient thrift_client(boost::shared_ptr<TProtocol>(new TBinaryProtocol(buffer)));
+  thrift_client.send_batch_mutate(mutations, level);
+  return buffer->getBufferAsString();
+}
+
+
+static string batchMutateReply(bool timed_out)
+{
+  boost::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TBinaryProtocol protocol(buffer);
+  Cassandra_batch_mutate_result result;
+  result.__isset.te= timed_out;
+  protocol.writeMessageBegin("batch_mutate", T_REPLY, 0);
+  result.write(&protocol);
+  protocol.writeMessageEnd();
+  return buffer->getBufferAsString();
+}
+
+
+/*
+ * records what is written and answers from canned replies; the first
+ * reads can be made to fail as if the connection had been reset
+ */
+class ScriptedTransport : public TVirtualTransport<ScriptedTransport>
+{
+public:
+  ScriptedTransport(const string& in_replies, int in_read_failures)
+    :
+      replies(in_replies),
+      offset(0),
+      read_failures(in_read_failures),
+      written()
+  {}
+
+  bool isOpen()
+  {
+    return true;
+  }
+
+  uint32_t read(uint8_t *buf, uint32_t len)
+  {
+    if (read_failures > 0)
+    {
+      --read_failures;
+      throw TTransportException(TTransportException::END_OF_FILE, "connection reset");
+    }
+    uint32_t count= min(len, static_cast<uint32_t>(replies.size() - offset));
+    memcpy(buf, replies.data() + offset, count);
+    offset+= count;
+    return count;
+  }
+
+  void write(const uint8_t *buf, uint32_t len)
+  {
+    written.append(reinterpret_cast<const char *>(buf), len);
+  }
+
+  string replies;
+  size_t offset;
+  int read_failures;
+  string written;
+};
+
+
+static Cassandra *connectTo(boost::shared_ptr<ScriptedTransport> transport, const string& host)
+{
+  boost::shared_ptr<TProtocol> protocol(new TBinaryProtocol(transport));
+  return new Cassandra(new CassandraClient(protocol), host, 9160);
+}
+
+
+static string batchBytes(const SerializedBatch& batch)
+{
+  return string(reinterpret_cast<const char *>(batch.getData()), batch.size());
+}
+
+
+static Mutation makeInsert(const string& name, const string& value, int64_t timestamp)
+{
+  Mutation mutation;
+  mutation.column_or_supercolumn.column.name= name;
+  mutation.column_or_supercolumn.column.value= value;
+  mutation.column_or_supercolumn.column.timestamp= timestamp;
+  mutation.column_or_supercolumn.__isset.column= true;
+  mutation.__isset.column_or_supercolumn= true;
+  return mutation;
+}
+
+
+static SerializedBatch::MutationsMap makeMutations()
+{
+  SerializedBatch::MutationsMap mutations;
+  mutations["row1"]["Standard1"].push_back(makeInsert("name", "value", 1234567890123LL));
+  mutations["row1"]["Standard1"].push_back(makeInsert("other", "", 1234567890124LL));
+  mutations["row1"]["Standard2"].push_back(makeInsert("name", "value", 1234567890125LL));
+
+  Mutation deletion;
+  deletion.deletion.timestamp= 1234567890126LL;
+  deletion.deletion.predicate.column_names.push_back("gone");
+  deletion.deletion.predicate.__isset.column_names= true;
+  deletion.deletion.__isset.predicate= true;
+  deletion.__isset.deletion= true;
+  mutations["row2"]["Standard1"].push_back(deletion);
+  return mutations;
+}
+
+
+TEST(SerializedBatch, SendsTheGeneratedFrame)
+{
+  SerializedBatch::MutationsMap mutations= makeMutations();
+  SerializedBatch batch(mutations, ConsistencyLevel::ONE);
+  EXPECT_FALSE(batch.empty());
+  EXPECT_EQ(ConsistencyLevel::ONE, batch.getConsistencyLevel());
+
+  boost::shared_ptr<ScriptedTransport> transport(new ScriptedTransport(batchMutateReply(false), 0));
+  tr1::shared_ptr<Cassandra> client(connectTo(transport, "localhost"));
+  client->batchMutate(batch);
+  EXPECT_EQ(sendBatchMutate(mutations, ConsistencyLevel::ONE), transport->written);
+  EXPECT_NE(string::npos, transport->written.find(batchBytes(batch)));
+
+  const vector<pair<string, string> > &rows= batch.getRows();
+  ASSERT_EQ(3u, rows.size());
+  EXPECT_EQ(make_pair(string("row1"), string("Standard1")), rows[0]);
+  EXPECT_EQ(make_pair(string("row1"), string("Standard2")), rows[1]);
+  EXPECT_EQ(make_pair(string("row2"), string("Standard1")), rows[2]);
+
+  EXPECT_TRUE(SerializedBatch().empty());
+  EXPECT_EQ(0u, SerializedBatch().size());
+}
+
+
+TEST(SerializedBatch, RetryResendsAfterTimeOut)
+{
+  SerializedBatch::MutationsMap mutations= makeMutations();
+  SerializedBatch batch(mutations, ConsistencyLevel::ONE);
+  boost::shared_ptr<ScriptedTransport> transport(new ScriptedTransport(batchMutateReply(true) + batchMutateReply(false), 0));
+  tr1::shared_ptr<Cassandra> client(connectTo(transport, "localhost"));
+  client->batchMutate(batch, RetryPolicy(3, 1, 1));
+  string frame= sendBatchMutate(mutations, ConsistencyLevel::ONE);
+  EXPECT_EQ(frame + frame, transport->written);
+  EXPECT_EQ(transport->replies.size(), transport->offset);
+}
+
+
+TEST(SerializedBatch, RetryResendsAfterTransportError)
+{
+  SerializedBatch::MutationsMap mutations= makeMutations();
+  SerializedBatch batch(mutations, ConsistencyLevel::ONE);
+  boost::shared_ptr<ScriptedTransport> transport(new ScriptedTransport(batchMutateReply(false), 1));
+  tr1::shared_ptr<Cassandra> client(connectTo(transport, "localhost"));
+  client->batchMutate(batch, RetryPolicy(3, 1, 1));
+  string frame= sendBatchMutate(mutations, ConsistencyLevel::ONE);
+  EXPECT_EQ(frame + frame, transport->written);
+}
+
+
+TEST(SerializedBatch, TransportErrorMovesToAnotherHost)
+{
+  SerializedBatch::MutationsMap mutations= makeMutations();
+  SerializedBatch batch(mutations, ConsistencyLevel::ONE);
+  boost::shared_ptr<ScriptedTransport> broken(new ScriptedTransport(batchMutateReply(false), 1));
+  boost::shared_ptr<ScriptedTransport> other(new ScriptedTransport(batchMutateReply(false), 0));
+  util::CassandraPool pool("10.0.0.1", 9160, 0, 2);
+  ASSERT_TRUE(pool.addConnection(tr1::shared_ptr<Cassandra>(connectTo(other, "10.0.0.2"))));
+  tr1::shared_ptr<Cassandra> client(connectTo(broken, "10.0.0.1"));
+  client->batchMutate(batch, RetryPolicy(3, 1, 1), pool);
+
+  string frame= sendBatchMutate(mutations, ConsistencyLevel::ONE);
+  EXPECT_EQ(frame, broken->written);
+  EXPECT_EQ(frame, other->written);
+  /* the borrowed connection went back to the pool */
+  EXPECT_EQ(1u, pool.getSize());
+}
+
+
+TEST(SerializedBatch, SerializeBatch)
+{
+  /* no request is sent while encoding a batch */
+  Cassandra client(NULL, "localhost", 9160, "Keyspace1");
+  vector<Cassandra::ColumnInsertTuple> columns;
+  columns.push_back(Cassandra::ColumnInsertTuple("Standard1", "row1", "name", "value"));
+  columns.push_back(Cassandra::ColumnInsertTuple("Standard1", "row1", "other", "more"));
+  columns.push_back(Cassandra::ColumnInsertTuple("Standard2", "row2", "name", "value"));
+  vector<Cassandra::SuperColumnInsertTuple> super_columns;
+  SerializedBatch batch= client.serializeBatch(columns, super_columns, ConsistencyLevel::QUORUM);
+  EXPECT_FALSE(batch.empty());
+  EXPECT_EQ(ConsistencyLevel::QUORUM, batch.getConsistencyLevel());
+
+  const vector<pair<string, string> > &rows= batch.getRows();
+  ASSERT_EQ(2u, rows.size());
+  EXPECT_EQ(make_pair(string("row1"), string("Standard1")), rows[0]);
+  EXPECT_EQ(make_pair(string("row2"), string("Standard2")), rows[1]);
+}
@@ -0,0 +1,86 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/exception.h>
+#include <libcassandra/token.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+TEST(Token, RandomPartitioner)
+{
+  const string partitioner("org.apache.cassandra.dht.RandomPartitioner");
+  EXPECT_EQ("58332598431525814501020785164969033090", computeToken(partitioner, ""));
+  EXPECT_EQ("148866708576779697295343134153845407886", computeToken(partitioner, "abc"));
+  EXPECT_EQ("33953172161233235816159036076773107287", computeToken(partitioner, "row1"));
+  EXPECT_EQ("107888709712719693599006850600558835790", computeToken(partitioner, string(100, 'x')));
+}
+
+
+TEST(Token, OrderedPartitioners)
+{
+  EXPECT_EQ("616263", computeToken("org.apache.cassandra.dht.ByteOrderedPartitioner", "abc"));
+  EXPECT_EQ("abc", computeToken("org.apache.cassandra.dht.OrderPreservingPartitioner", "abc"));
+  EXPECT_THROW(computeToken("org.example.UnknownPartitioner", "abc"), Exception);
+}
+
+
+TEST(Token, CompareTokens)
+{
+  const string random("org.apache.cassandra.dht.RandomPartitioner");
+  EXPECT_LT(compareTokens(random, "9", "10"), 0);
+  EXPECT_GT(compareTokens(random, "20", "19"), 0);
+  EXPECT_EQ(0, compareTokens(random, "42", "42"));
+  const string bytes("org.apache.cassandra.dht.ByteOrderedPartitioner");
+  EXPECT_LT(compareTokens(bytes, "61", "6162"), 0);
+  EXPECT_GT(compareTokens(bytes, "ff", "7f00"), 0);
+  EXPECT_THROW(compareTokens("org.apache.cassandra.dht.CollatingOrderPreservingPartitioner", "a", "b"),
+               Exception);
+}
+
+
+static TokenRange makeRange(const string &start, const string &end, const string &host)
+{
+  TokenRange ret;
+  ret.start_token= start;
+  ret.end_token= end;
+  ret.endpoints.push_back(host);
+  return ret;
+}
+
+
+TEST(Token, FindOwningRange)
+{
+  const string random("org.apache.cassandra.dht.RandomPartitioner");
+  vector<TokenRange> ring;
+  ring.push_back(makeRange("100", "200", "10.0.0.2"));
+  ring.push_back(makeRange("200", "100", "10.0.0.1"));
+  /* ranges are open at the start and closed at the end */
+  EXPECT_EQ(0u, findOwningRange(random, ring, "150"));
+  EXPECT_EQ(0u, findOwningRange(random, ring, "200"));
+  EXPECT_EQ(1u, findOwningRange(random, ring, "100"));
+  /* the second range wraps around the end of the ring */
+  EXPECT_EQ(1u, findOwningRange(random, ring, "5"));
+  EXPECT_EQ(1u, findOwningRange(random, ring, "1000"));
+
+  /* a single node owns the whole ring */
+  vector<TokenRange> single(1, makeRange("100", "100", "10.0.0.1"));
+  EXPECT_EQ(0u, findOwningRange(random, single, "100"));
+  EXPECT_EQ(0u, findOwningRange(random, single, "7"));
+
+  vector<TokenRange> partial(1, makeRange("100", "200", "10.0.0.2"));
+  EXPECT_EQ(1u, findOwningRange(random, partial, "300"));
+}
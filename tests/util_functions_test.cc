@@ -8,6 +8,7 @@
  */
 
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -15,6 +16,7 @@
 
 using namespace std;
 using namespace libcassandra;
+using namespace org::apache::cassandra;
 
 
 TEST(UtilFunctions, parsePortFromURL)
@@ -31,3 +33,112 @@ TEST(UtilFunctions, parseHostFromURL)
   string host = parseHostFromURL(url);
   EXPECT_STREQ("localhost", host.c_str());
 }
+
+
+TEST(UtilFunctions, getColumnList)
+{
+  vector<ColumnOrSuperColumn> cols(3);
+  cols[0].column.name.assign("first");
+  cols[0].column.value.assign("one");
+  cols[2].column.name.assign("third");
+  cols[2].column.value.assign("three");
+  vector<Column> ret= getColumnList(cols);
+  ASSERT_EQ(2u, ret.size());
+  EXPECT_EQ("first", ret[0].name);
+  EXPECT_EQ("one", ret[0].value);
+  EXPECT_EQ("third", ret[1].name);
+  EXPECT_EQ("three", ret[1].value);
+}
+
+
+TEST(UtilFunctions, getSuperColumnList)
+{
+  vector<ColumnOrSuperColumn> cols(2);
+  cols[1].super_column.name.assign("super");
+  cols[1].super_column.columns.resize(2);
+  vector<SuperColumn> ret= getSuperColumnList(cols);
+  ASSERT_EQ(1u, ret.size());
+  EXPECT_EQ("super", ret[0].name);
+  EXPECT_EQ(2u, ret[0].columns.size());
+}
+
+
+TEST(UtilFunctions, singleValueCodecs)
+{
+  char buf[8];
+  encodeLong(-1234567890123LL, buf);
+  EXPECT_EQ(serializeLong(-1234567890123LL), string(buf, 8));
+  EXPECT_EQ(-1234567890123LL, decodeLong(buf));
+  encodeInt(0x01020304, buf);
+  EXPECT_EQ(string("\x01\x02\x03\x04", 4), string(buf, 4));
+  EXPECT_EQ(0x01020304, decodeInt(buf));
+  encodeDouble(1.0, buf);
+  EXPECT_EQ(string("\x3f\xf0\0\0\0\0\0\0", 8), string(buf, 8));
+  EXPECT_EQ(1.0, decodeDouble(buf));
+}
+
+
+TEST(UtilFunctions, bulkCodecs)
+{
+  /* an odd count exercises both the vector and the scalar loop */
+  const size_t count= 7;
+  int64_t longs[count];
+  int32_t ints[count];
+  double doubles[count];
+  for (size_t i= 0; i < count; ++i)
+  {
+    longs[i]= static_cast<int64_t>(i) * -1000000007LL;
+    ints[i]= static_cast<int32_t>(i) * 65537;
+    doubles[i]= static_cast<double>(i) / 3.0;
+  }
+  char buf[count * 8];
+  encodeLongs(longs, count, buf);
+  for (size_t i= 0; i < count; ++i)
+  {
+    EXPECT_EQ(serializeLong(longs[i]), string(buf + i * 8, 8));
+  }
+  int64_t long_copy[count];
+  decodeLongs(buf, count, long_copy);
+  encodeInts(ints, count, buf);
+  EXPECT_EQ(ints[5], decodeInt(buf + 20));
+  int32_t int_copy[count];
+  decodeInts(buf, count, int_copy);
+  encodeDoubles(doubles, count, buf);
+  EXPECT_EQ(doubles[6], decodeDouble(buf + 48));
+  double double_copy[count];
+  decodeDoubles(buf, count, double_copy);
+  for (size_t i= 0; i < count; ++i)
+  {
+    EXPECT_EQ(longs[i], long_copy[i]);
+    EXPECT_EQ(ints[i], int_copy[i]);
+    EXPECT_EQ(doubles[i], double_copy[i]);
+  }
+}
+
+
+TEST(UtilFunctions, uuidCodecs)
+{
+  uint64_t halves[4]= { 0x0011223344556677ULL, 0x8899aabbccddeeffULL, 1, 2 };
+  char buf[32];
+  encodeUUIDs(halves, 2, buf);
+  EXPECT_EQ(string("\x00\x11\x22\x33\x44\x55\x66\x77\x88\x99\xaa\xbb\xcc\xdd\xee\xff", 16),
+            string(buf, 16));
+  uint64_t copy[4];
+  decodeUUIDs(buf, 2, copy);
+  for (size_t i= 0; i < 4; ++i)
+  {
+    EXPECT_EQ(halves[i], copy[i]);
+  }
+}
+
+
+TEST(UtilFunctions, monotonicTimestamp)
+{
+  int64_t previous= createMonotonicTimestamp();
+  for (int i= 0; i < 1000; ++i)
+  {
+    int64_t now= createMonotonicTimestamp();
+    EXPECT_LE(previous, now);
+    previous= now;
+  }
+}
@@ -0,0 +1,143 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/util_functions.h>
+#include <libcassandra/uuid.h>
+
+using namespace std;
+using namespace libcassandra;
+
+
+TEST(TimeUUID, VersionAndVariant)
+{
+  string uuid= TimeUUID::generate();
+  ASSERT_EQ(TimeUUID::SIZE, uuid.size());
+  EXPECT_EQ(0x10, uuid[6] & 0xf0);
+  EXPECT_EQ(0x80, uuid[8] & 0xc0);
+}
+
+
+struct ClockSample
+{
+  int64_t before;
+  string uuid;
+  int64_t after;
+};
+
+
+static void *sampleClock(void *arg)
+{
+  ClockSample *sample= static_cast<ClockSample *>(arg);
+  sample->before= createTimestamp();
+  sample->uuid= TimeUUID::generate();
+  sample->after= createTimestamp();
+  return NULL;
+}
+
+
+TEST(TimeUUID, TimestampMatchesClock)
+{
+  /*
+   * UUIDs generated earlier in a thread may have run ahead of the clock,
+   * so the sample is taken on a thread that has not generated any
+   */
+  ClockSample sample;
+  pthread_t thread;
+  pthread_create(&thread, NULL, sampleClock, &sample);
+  pthread_join(thread, NULL);
+  int64_t micros= TimeUUID::getUnixMicros(sample.uuid.data());
+  EXPECT_GE(micros, sample.before);
+  EXPECT_LE(micros, sample.after);
+}
+
+
+TEST(TimeUUID, IncreasingWithinThread)
+{
+  vector<string> uuids;
+  for (int i= 0; i < 100000; ++i)
+  {
+    uuids.push_back(TimeUUID::generate());
+  }
+  for (size_t i= 1; i < uuids.size(); ++i)
+  {
+    ASSERT_LT(TimeUUID::getTimestamp(uuids[i - 1].data()),
+              TimeUUID::getTimestamp(uuids[i].data()));
+    ASSERT_LT(TimeUUID::compare(uuids[i - 1].data(), uuids[i].data()), 0);
+  }
+  vector<string> shuffled(uuids.rbegin(), uuids.rend());
+  sort(shuffled.begin(), shuffled.end(), TimeUUID::Less());
+  EXPECT_TRUE(shuffled == uuids);
+}
+
+
+TEST(TimeUUID, CompareOrdersByTimeFirst)
+{
+  /* a later timestamp sorts later even when its bytes compare lower */
+  uint64_t early[2]= { (0xffffffffULL << 32) | 0x1000, 0x8000000000000000ULL };
+  uint64_t late[2]= { (1ULL << 16) | 0x1000, 0x8000000000000000ULL };
+  char a[TimeUUID::SIZE];
+  char b[TimeUUID::SIZE];
+  encodeUUIDs(early, 1, a);
+  encodeUUIDs(late, 1, b);
+  EXPECT_LT(TimeUUID::compare(a, b), 0);
+  EXPECT_GT(TimeUUID::compare(b, a), 0);
+  EXPECT_EQ(0, TimeUUID::compare(a, a));
+}
+
+
+TEST(TimeUUID, CompareTiesOnSignedBytes)
+{
+  /* same timestamp; a node byte of 0xff is -1 to TimeUUIDType and sorts first */
+  uint64_t low[2]= { (1ULL << 16) | 0x1000, 0x8000000000000001ULL };
+  uint64_t high[2]= { (1ULL << 16) | 0x1000, 0x80000000000000ffULL };
+  char a[TimeUUID::SIZE];
+  char b[TimeUUID::SIZE];
+  encodeUUIDs(low, 1, a);
+  encodeUUIDs(high, 1, b);
+  EXPECT_GT(TimeUUID::compare(a, b), 0);
+  EXPECT_LT(TimeUUID::compare(b, a), 0);
+}
+
+
+static void *generateMany(void *arg)
+{
+  vector<string> *out= static_cast<vector<string> *>(arg);
+  for (int i= 0; i < 10000; ++i)
+  {
+    out->push_back(TimeUUID::generate());
+  }
+  return NULL;
+}
+
+
+TEST(TimeUUID, UniqueAcrossThreads)
+{
+  vector<vector<string> > results(4);
+  vector<pthread_t> threads(results.size());
+  for (size_t i= 0; i < threads.size(); ++i)
+  {
+    pthread_create(&threads[i], NULL, generateMany, &results[i]);
+  }
+  set<string> seen;
+  for (size_t i= 0; i < threads.size(); ++i)
+  {
+    pthread_join(threads[i], NULL);
+    seen.insert(results[i].begin(), results[i].end());
+  }
+  EXPECT_EQ(40000u, seen.size());
+}
@@ -0,0 +1,135 @@
+/*
+ * LibCassandra
+ * Copyright (C) 2010-2011 Padraig O'Sullivan
+ * All rights reserved.
+ *
+ * Use and distribution licensed under the BSD license. See
+ * the COPYING file in the parent directory for full text.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <libcassandra/exception.h>
+#include <libcassandra/util_functions.h>
+#include <libcassandra/value_codec.h>
+
+using namespace std;
+using namespace libcassandra;
+using namespace org::apache::cassandra;
+
+
+static string makeJson(size_t records)
+{
+  string ret("[");
+  for (size_t i= 0; i < records; ++i)
+  {
+    ret.append("{\"name\": \"sensor\", \"unit\": \"celsius\", \"value\": 21},");
+  }
+  ret.append("]");
+  return ret;
+}
+
+
+/* a codec this build knows nothing about */
+class OtherCodec : public ValueCodec
+{
+public:
+  unsigned char getId() const
+  {
+    return 42;
+  }
+  bool compress(const char *data, size_t length, string &out) const
+  {
+    out.append(data, length / 2);
+    return true;
+  }
+  void decompress(const char *, size_t, size_t, string &) const
+  {}
+};
+
+
+TEST(ZlibCodec, RoundTrip)
+{
+  ZlibCodec codec;
+  const string value= makeJson(200);
+  string encoded;
+  codec.encode(value, encoded);
+  EXPECT_LT(encoded.size(), value.size() / 4);
+  EXPECT_EQ(ValueCodec::MAGIC, static_cast<uint32_t>(decodeInt(encoded.data())));
+  EXPECT_EQ(ZlibCodec::ID, static_cast<unsigned char>(encoded[4]));
+  EXPECT_TRUE(codec.decode(encoded));
+  EXPECT_EQ(value, encoded);
+}
+
+
+TEST(ZlibCodec, SmallValuesStoredAsIs)
+{
+  ZlibCodec codec;
+  const string value("{\"a\": 1}");
+  string encoded;
+  codec.encode(value, encoded);
+  EXPECT_EQ(value, encoded);
+  EXPECT_FALSE(codec.decode(encoded));
+  EXPECT_EQ(value, encoded);
+}
+
+
+TEST(ZlibCodec, ValuesStartingWithTheMagicAreEscaped)
+{
+  ZlibCodec codec;
+  string value(4, '\0');
+  encodeInt(static_cast<int32_t>(ValueCodec::MAGIC), &value[0]);
+  value.append("short");
+  string encoded;
+  codec.encode(value, encoded);
+  EXPECT_EQ(value.size() + ValueCodec::HEADER_SIZE, encoded.size());
+  EXPECT_EQ(ValueCodec::RAW_ID, static_cast<unsigned char>(encoded[4]));
+  EXPECT_TRUE(codec.decode(encoded));
+  EXPECT_EQ(value, encoded);
+}
+
+
+TEST(ZlibCodec, UntaggedValuesLeftAlone)
+{
+  ZlibCodec codec;
+  vector<Column> columns(4);
+  columns[0].value.assign("plain old value");
+  columns[1].value.assign(makeJson(10));
+  string tagged;
+  codec.encode(columns[1].value, tagged);
+  columns[1].value.swap(tagged);
+  /* U+01C0 in UTF-8 and a negative big-endian long */
+  columns[2].value.assign("\xc7\x80\x01 text that happens to start with 0xc7");
+  columns[3].value.assign("\xc7\x00\x00\x00\x00\x00\x00\x01", 8);
+  codec.decode(columns);
+  EXPECT_EQ("plain old value", columns[0].value);
+  EXPECT_EQ(makeJson(10), columns[1].value);
+  EXPECT_EQ("\xc7\x80\x01 text that happens to start with 0xc7", columns[2].value);
+  EXPECT_EQ(string("\xc7\x00\x00\x00\x00\x00\x00\x01", 8), columns[3].value);
+}
+
+
+TEST(ZlibCodec, DamagedHeadersLeftAlone)
+{
+  ZlibCodec codec;
+  string encoded;
+  codec.encode(makeJson(50), encoded);
+  string truncated(encoded, 0, encoded.size() / 2);
+  EXPECT_FALSE(codec.decode(truncated));
+  EXPECT_EQ(string(encoded, 0, encoded.size() / 2), truncated);
+  string bad_id(encoded);
+  bad_id[4]= 42;
+  EXPECT_FALSE(codec.decode(bad_id));
+}
+
+
+TEST(ZlibCodec, UnknownCodec)
+{
+  OtherCodec other;
+  string encoded;
+  other.encode(makeJson(50), encoded);
+  EXPECT_THROW(ZlibCodec().decode(encoded), Exception);
+}